@@ -25,6 +25,9 @@ AP_LoggerFileReader::AP_LoggerFileReader() :
 
 AP_LoggerFileReader::~AP_LoggerFileReader()
 {
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    delete decompressor;
+#endif
     const uint64_t micros = now();
     const uint64_t delta = micros - start_micros;
     ::printf("Replay counts: %" PRIu64 " bytes  %u entries\n", bytes_read, message_count);
@@ -37,11 +40,38 @@ bool AP_LoggerFileReader::open_log(const char *logfile)
     if (fd == -1) {
         return false;
     }
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (decompressor == nullptr) {
+        decompressor = new AP_Logger_FileDecompressor;
+    }
+    if (!decompressor->open(fd)) {
+        delete decompressor;
+        decompressor = nullptr;
+    }
+    decompressed_offset = 0;
+#endif
     return true;
 }
 
 ssize_t AP_LoggerFileReader::read_input(void *buffer, const size_t count)
 {
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (decompressor != nullptr) {
+        // messages can span frames
+        uint8_t *b = (uint8_t *)buffer;
+        size_t ret = 0;
+        while (ret < count) {
+            const int32_t n = decompressor->read(decompressed_offset, &b[ret], count - ret);
+            if (n <= 0) {
+                break;
+            }
+            decompressed_offset += n;
+            ret += n;
+        }
+        bytes_read += ret;
+        return ret;
+    }
+#endif
     uint64_t ret = ::read(fd, buffer, count);
     bytes_read += ret;
     return ret;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <AP_Logger/AP_Logger.h>
+#include <AP_Logger/AP_Logger_Compress.h>
 
 #define LOGREADER_MAX_FORMATS 255 // must be >= highest MESSAGE
 
@@ -33,4 +34,10 @@ private:
     uint64_t start_micros;
 
     uint64_t packet_counts[LOGREADER_MAX_FORMATS] = {};
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // set if the log was written with LOG_FILE_COMPR
+    AP_Logger_FileDecompressor *decompressor = nullptr;
+    uint64_t decompressed_offset = 0;
+#endif
 };
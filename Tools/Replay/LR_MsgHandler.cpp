@@ -452,6 +452,52 @@ void LR_MsgHandler_PARM::process_message(uint8_t *msg)
     }
 }
 
+void LR_MsgHandler_ISBC::process_message(uint8_t *msg)
+{
+    const uint16_t n = require_field_uint16_t(msg, "N");
+    const uint16_t seqno = require_field_uint16_t(msg, "seqno");
+    const uint16_t count = require_field_uint16_t(msg, "cnt");
+
+    if (seqno == 0) {
+        isb_seqno = n;
+        next_sample = 0;
+        isbd_count = 0;
+        in_batch = true;
+    }
+    if (!in_batch) {
+        return;
+    }
+    if (n != isb_seqno || seqno != next_sample) {
+        printf("ISBC: batch %u has holes in it\n", (unsigned)isb_seqno);
+        in_batch = false;
+        return;
+    }
+
+    // the coded data is split across the three 64 byte fields
+    uint8_t data[BatchCodec::max_bytes];
+    require_field(msg, "d0", (char*)&data[0], 64);
+    require_field(msg, "d1", (char*)&data[64], 64);
+    require_field(msg, "d2", (char*)&data[128], 64);
+    if (count > BatchCodec::max_samples ||
+        !BatchCodec::decode(data, count, x, y, z)) {
+        printf("ISBC: batch %u corrupt at sample %u\n", (unsigned)isb_seqno, (unsigned)seqno);
+        in_batch = false;
+        return;
+    }
+    next_sample += count;
+
+    for (uint16_t i=0; i<count; i++) {
+        isbd_x[isbd_count] = x[i];
+        isbd_y[isbd_count] = y[i];
+        isbd_z[isbd_count] = z[i];
+        isbd_count++;
+        if (isbd_count == ARRAY_SIZE(isbd_x)) {
+            logger.Write_ISBD(isb_seqno, (seqno+i)/32, isbd_x, isbd_y, isbd_z);
+            isbd_count = 0;
+        }
+    }
+}
+
 void LR_MsgHandler_PM::process_message(uint8_t *msg)
 {
     uint32_t new_logdrop;
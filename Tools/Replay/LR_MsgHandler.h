@@ -3,6 +3,7 @@
 #include "MsgHandler.h"
 #include <AP_AHRS/AP_AHRS.h>
 #include <AP_GPS/AP_GPS.h>
+#include <AP_InertialSensor/BatchCodec.h>
 
 #include <functional>
 
@@ -463,6 +464,32 @@ private:
     const std::function<bool(const char *name, const float)>_set_parameter_callback;
 };
 
+// expands compressed ISBC messages into ISBD messages in the output log
+class LR_MsgHandler_ISBC : public LR_MsgHandler
+{
+public:
+    LR_MsgHandler_ISBC(log_Format &_f, AP_Logger &_logger,
+                       uint64_t &_last_timestamp_usec)
+        : LR_MsgHandler(_f, _logger, _last_timestamp_usec) { };
+
+    void process_message(uint8_t *msg) override;
+
+private:
+    int16_t x[BatchCodec::max_samples];
+    int16_t y[BatchCodec::max_samples];
+    int16_t z[BatchCodec::max_samples];
+
+    // samples decoded but not yet written as ISBD
+    int16_t isbd_x[32];
+    int16_t isbd_y[32];
+    int16_t isbd_z[32];
+    uint8_t isbd_count;
+
+    uint16_t isb_seqno;
+    uint16_t next_sample;
+    bool in_batch = false;
+};
+
 class LR_MsgHandler_PM : public LR_MsgHandler
 {
 public:
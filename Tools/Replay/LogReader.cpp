@@ -403,6 +403,9 @@ bool LogReader::handle_log_format_msg(const struct log_Format &f)
 	  msgparser[f.type] = new LR_MsgHandler_CHEK(formats[f.type], logger,
                                                      last_timestamp_usec,
                                                      check_state);
+	} else if (streq(name, "ISBC")) {
+	  msgparser[f.type] = new LR_MsgHandler_ISBC(formats[f.type], logger,
+                                                     last_timestamp_usec);
 	} else if (streq(name, "PM")) {
 	  msgparser[f.type] = new LR_MsgHandler_PM(formats[f.type], logger,
                                                    last_timestamp_usec);
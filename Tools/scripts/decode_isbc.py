@@ -0,0 +1,115 @@
+#!/usr/bin/env python
+'''
+decode compressed IMU batch sampler messages (ISBC), as written when
+INS_LOG_BAT_OPT has the compression bit set.
+
+This is a Python version of the decoder in
+libraries/AP_InertialSensor/BatchCodec.cpp; the two must be kept in
+step. Import it to decode ISBC messages in other tools, or run it on a
+log to check every batch decodes and print the compression statistics
+from the ISBS messages.
+'''
+from __future__ import print_function
+
+import struct
+import sys
+
+# bits in the unary part of a code before it is escaped
+ESCAPE_BITS = 16
+# bits in an escaped difference
+RAW_BITS = 17
+
+
+class CorruptData(Exception):
+    pass
+
+
+class BitReader(object):
+    def __init__(self, data):
+        self.data = bytearray(data)
+        self.pos = 0
+
+    def get(self, bits):
+        v = 0
+        for i in range(bits):
+            if self.pos >= 8 * len(self.data):
+                raise CorruptData("read past end of data")
+            b = (self.data[self.pos // 8] >> (7 - self.pos % 8)) & 1
+            self.pos += 1
+            v = (v << 1) | b
+        return v
+
+
+def isbc_bytes(m):
+    '''the coded data of an ISBC message'''
+    return struct.pack('<32h32h32h', *(list(m.d0) + list(m.d1) + list(m.d2)))
+
+
+def decode(data, count):
+    '''decode count samples from the coded data of an ISBC message,
+    returning lists of x, y and z'''
+    if count == 0:
+        return [], [], []
+    r = BitReader(data)
+    axes = []
+    for a in range(3):
+        v = r.get(16)
+        if v >= 0x8000:
+            v -= 0x10000
+        axes.append([v])
+    k = [r.get(4) for a in range(3)]
+    for i in range(1, count):
+        for a in range(3):
+            q = 0
+            while q < ESCAPE_BITS and r.get(1) == 1:
+                q += 1
+            if q < ESCAPE_BITS:
+                u = (q << k[a]) | r.get(k[a])
+            else:
+                u = r.get(RAW_BITS)
+            d = (u >> 1) ^ -(u & 1)
+            v = axes[a][-1] + d
+            if v < -32768 or v > 32767:
+                raise CorruptData("sample out of range")
+            axes[a].append(v)
+    return axes[0], axes[1], axes[2]
+
+
+def decode_message(m):
+    '''decode an ISBC message from pymavlink'''
+    return decode(isbc_bytes(m), m.cnt)
+
+
+def check_log(filename):
+    from pymavlink import mavutil
+    mlog = mavutil.mavlink_connection(filename)
+    batches = {}
+    while True:
+        m = mlog.recv_match(type=['ISBH', 'ISBC', 'ISBS'])
+        if m is None:
+            break
+        t = m.get_type()
+        if t == 'ISBH':
+            batches[m.N] = 0
+        elif t == 'ISBC':
+            if m.N not in batches:
+                continue
+            if m.seqno != batches[m.N]:
+                print("ISBH(%u) has holes in it" % m.N, file=sys.stderr)
+            try:
+                decode_message(m)
+            except CorruptData as e:
+                print("ISBC(%u,%u): %s" % (m.N, m.seqno, e), file=sys.stderr)
+            batches[m.N] = m.seqno + m.cnt
+        elif t == 'ISBS':
+            print("batch %u: %u samples in %u messages, ratio %.2f, %uus to encode" %
+                  (m.N, m.smp_cnt, m.msgs, m.ratio, m.EncUS))
+
+
+if __name__ == '__main__':
+    from argparse import ArgumentParser
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("logs", metavar="LOG", nargs="+")
+    args = parser.parse_args()
+    for filename in args.logs:
+        check_log(filename)
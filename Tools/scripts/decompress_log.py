@@ -0,0 +1,133 @@
+#!/usr/bin/env python
+'''
+turn a log written with LOG_FILE_COMPR set back into a normal log.
+
+The format is described in libraries/AP_Logger/AP_Logger_Compress.h.
+Logs that were cut short are decompressed up to the last complete
+frame.
+'''
+from __future__ import print_function
+
+import struct
+import sys
+
+FILE_MAGIC = 0x5a4c5041
+FRAME_MAGIC = 0x464c5041
+TRAILER_MAGIC = 0x544c5041
+FRAME_STORED = 1
+
+FILE_HEADER = struct.Struct('<IHH8x')
+FRAME_HEADER = struct.Struct('<IQHHB3x')
+FRAME_TRAILER = struct.Struct('<II')
+
+
+class CorruptData(Exception):
+    pass
+
+
+def lz4_decompress(src, length):
+    '''decompress an LZ4 block that decompresses to length bytes'''
+    src = bytearray(src)
+    dst = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        n = token >> 4
+        if n == 15:
+            while True:
+                if i >= len(src):
+                    raise CorruptData("literal length past end of data")
+                b = src[i]
+                i += 1
+                n += b
+                if b != 255:
+                    break
+        if i + n > len(src):
+            raise CorruptData("literals past end of data")
+        dst += src[i:i+n]
+        i += n
+        if i == len(src):
+            # the last sequence has no match
+            break
+        if i + 2 > len(src):
+            raise CorruptData("offset past end of data")
+        offset = src[i] | (src[i+1] << 8)
+        i += 2
+        if offset == 0 or offset > len(dst):
+            raise CorruptData("bad match offset")
+        n = token & 0xf
+        if n == 15:
+            while True:
+                if i >= len(src):
+                    raise CorruptData("match length past end of data")
+                b = src[i]
+                i += 1
+                n += b
+                if b != 255:
+                    break
+        n += 4
+        # matches can overlap the bytes they produce
+        start = len(dst) - offset
+        for j in range(n):
+            dst.append(dst[start + j])
+    if len(dst) != length:
+        raise CorruptData("decompressed to %u bytes, expected %u" % (len(dst), length))
+    return bytes(dst)
+
+
+def is_compressed(filename):
+    with open(filename, 'rb') as f:
+        hdr = f.read(FILE_HEADER.size)
+    return len(hdr) == FILE_HEADER.size and FILE_HEADER.unpack(hdr)[0] == FILE_MAGIC
+
+
+def decompress(infile, outfile):
+    '''decompress infile into outfile, returning the size of the log'''
+    with open(infile, 'rb') as f:
+        data = f.read()
+    if len(data) < FILE_HEADER.size:
+        raise CorruptData("file too short")
+    (magic, version, frame_size) = FILE_HEADER.unpack_from(data, 0)
+    if magic != FILE_MAGIC:
+        raise CorruptData("not a compressed log")
+    if version != 1:
+        raise CorruptData("unknown version %u" % version)
+
+    ofs = FILE_HEADER.size
+    size = 0
+    with open(outfile, 'wb') as out:
+        while ofs + FRAME_HEADER.size + FRAME_TRAILER.size <= len(data):
+            (magic, offset, length, clength, flags) = FRAME_HEADER.unpack_from(data, ofs)
+            end = ofs + FRAME_HEADER.size + clength + FRAME_TRAILER.size
+            if magic != FRAME_MAGIC or offset != size or length > frame_size or end > len(data):
+                print("%s: stopped at incomplete or corrupt frame at %u" % (infile, ofs), file=sys.stderr)
+                break
+            cdata = data[ofs+FRAME_HEADER.size:ofs+FRAME_HEADER.size+clength]
+            (frame_length, magic) = FRAME_TRAILER.unpack_from(data, end - FRAME_TRAILER.size)
+            if magic != TRAILER_MAGIC or frame_length != end - ofs:
+                print("%s: stopped at incomplete or corrupt frame at %u" % (infile, ofs), file=sys.stderr)
+                break
+            if flags & FRAME_STORED:
+                if clength != length:
+                    raise CorruptData("stored frame at %u has bad length" % ofs)
+                out.write(cdata)
+            else:
+                out.write(lz4_decompress(cdata, length))
+            size += length
+            ofs = end
+    return size
+
+
+if __name__ == '__main__':
+    from argparse import ArgumentParser
+    parser = ArgumentParser(description=__doc__)
+    parser.add_argument("infile", metavar="LOG")
+    parser.add_argument("outfile", metavar="OUTPUT")
+    args = parser.parse_args()
+
+    if not is_compressed(args.infile):
+        print("%s is not a compressed log" % args.infile, file=sys.stderr)
+        sys.exit(1)
+    size = decompress(args.infile, args.outfile)
+    print("Wrote %u bytes to %s" % (size, args.outfile))
@@ -43,6 +43,9 @@ static AP_Filesystem_Param fs_param;
 #include "AP_Filesystem_Sys.h"
 static AP_Filesystem_Sys fs_sys;
 
+#include "AP_Filesystem_Mission.h"
+static AP_Filesystem_Mission fs_mission;
+
 /*
   mapping from filesystem prefix to backend
  */
@@ -53,6 +56,7 @@ const AP_Filesystem::Backend AP_Filesystem::backends[] = {
 #endif
     { "@PARAM/", fs_param },
     { "@SYS/", fs_sys },
+    { "@MISSION/", fs_mission },
 };
 
 #define MAX_FD_PER_BACKEND 256U
@@ -215,6 +219,16 @@ bool AP_Filesystem::set_mtime(const char *filename, const uint32_t mtime_sec)
     return backend.fs.set_mtime(filename, mtime_sec);
 }
 
+/*
+  run work backends hand to the main thread
+ */
+void AP_Filesystem::update(void)
+{
+    for (uint8_t i=0; i<NUM_BACKENDS; i++) {
+        backends[i].fs.update();
+    }
+}
+
 namespace AP
 {
 AP_Filesystem &FS()
@@ -83,6 +83,10 @@ public:
     // set modification time on a file
     bool set_mtime(const char *filename, const uint32_t mtime_sec);
 
+    // run work backends hand to the main thread. Call from the main
+    // thread only
+    void update(void);
+
 private:
     struct Backend {
         const char *prefix;
@@ -0,0 +1,642 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  ArduPilot filesystem interface for mission, fence and rally items
+ */
+#include "AP_Filesystem.h"
+#include "AP_Filesystem_Mission.h"
+#include <AP_Math/AP_Math.h>
+#include <AP_Mission/AP_Mission.h>
+#include <AC_Fence/AC_Fence.h>
+#include <AP_Rally/AP_Rally.h>
+#include <GCS_MAVLink/MissionItemProtocol_Fence.h>
+#include <GCS_MAVLink/MissionItemProtocol_Rally.h>
+#include <errno.h>
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  packed format:
+    file header:
+      uint16_t magic = 0x763d
+      uint16_t mission_type   // MAV_MISSION_TYPE
+      uint16_t item_size      // size of one item, currently 38
+      uint16_t num_items
+      uint32_t crc            // CRC32 (as zlib.crc32) of all items
+
+    per-item:
+      mavlink_mission_item_int_t, in MAVLink wire order
+
+  items are fixed size, so any block of the file can be re-fetched
+  without reading the file from the start
+
+  a file written in the same format replaces the stored items when it
+  is closed. The whole file is checked first, and nothing is changed
+  if any of it is bad
+
+  files are used from the FTP thread, but the stored items are read and
+  changed on the main thread, see update()
+ */
+
+int AP_Filesystem_Mission::open(const char *fname, int flags)
+{
+    const int access = flags & O_ACCMODE;
+    if (access != O_RDONLY && access != O_WRONLY) {
+        errno = EINVAL;
+        return -1;
+    }
+    MAV_MISSION_TYPE mission_type;
+    if (!get_mission_type(fname, mission_type)) {
+        errno = ENOENT;
+        return -1;
+    }
+    uint8_t idx;
+    for (idx=0; idx<max_open_file; idx++) {
+        if (!file[idx].open) {
+            break;
+        }
+    }
+    if (idx == max_open_file) {
+        errno = ENFILE;
+        return -1;
+    }
+    struct rfile &r = file[idx];
+    if (access == O_WRONLY) {
+        uint16_t max_items;
+        if (!get_max_items(mission_type, max_items)) {
+            errno = ENOENT;
+            return -1;
+        }
+        r.mission_type = mission_type;
+        r.max_write_len = sizeof(struct header) + max_items * uint32_t(item_size);
+        r.writebuf = nullptr;
+        r.writebuf_size = 0;
+        r.write_len = 0;
+        r.file_ofs = 0;
+        r.writing = true;
+        r.open = true;
+        return idx;
+    }
+    if (!fetch_item_count(mission_type, r.num_items)) {
+        errno = ENOENT;
+        return -1;
+    }
+    mavlink_mission_item_int_t *items = new mavlink_mission_item_int_t[items_per_block];
+    if (items == nullptr) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    /*
+      the CRC is taken when the file is opened, so a GCS can tell if
+      the items changed while it was downloading them
+     */
+    uint32_t crc = 0xFFFFFFFF;
+    r.cached_first = -1;
+    r.cached_count = 0;
+    for (uint16_t first=0; first<r.num_items; first += items_per_block) {
+        const uint16_t n = MIN(r.num_items - first, uint16_t(items_per_block));
+        if (!fetch_items(mission_type, first, n, items)) {
+            delete[] items;
+            errno = EIO;
+            return -1;
+        }
+        for (uint16_t i=0; i<n; i++) {
+            crc = crc_crc32(crc, (const uint8_t *)&items[i], item_size);
+        }
+        r.cached_first = first;
+        r.cached_count = n;
+    }
+    r.crc = crc ^ 0xFFFFFFFF;
+    r.mission_type = mission_type;
+    r.cached_items = items;
+    r.file_ofs = 0;
+    r.writing = false;
+    r.open = true;
+    return idx;
+}
+
+int AP_Filesystem_Mission::close(int fd)
+{
+    if (fd < 0 || fd >= max_open_file || !file[fd].open) {
+        errno = EBADF;
+        return -1;
+    }
+    struct rfile &r = file[fd];
+    int ret = 0;
+    if (r.writing) {
+        if (!finish_upload(r)) {
+            errno = EINVAL;
+            ret = -1;
+        }
+        free(r.writebuf);
+        r.writebuf = nullptr;
+        r.writing = false;
+    } else {
+        delete[] r.cached_items;
+        r.cached_items = nullptr;
+    }
+    r.open = false;
+    return ret;
+}
+
+int32_t AP_Filesystem_Mission::read(int fd, void *buf, uint32_t count)
+{
+    if (fd < 0 || fd >= max_open_file || !file[fd].open || file[fd].writing) {
+        errno = EBADF;
+        return -1;
+    }
+    struct rfile &r = file[fd];
+    uint8_t *ubuf = (uint8_t *)buf;
+    size_t total = 0;
+
+    if (r.file_ofs < sizeof(struct header) && count > 0) {
+        struct header hdr;
+        hdr.mission_type = r.mission_type;
+        hdr.item_size = item_size;
+        hdr.num_items = r.num_items;
+        hdr.crc = r.crc;
+        const uint8_t n = MIN(sizeof(hdr) - r.file_ofs, count);
+        const uint8_t *b = (const uint8_t *)&hdr;
+        memcpy(ubuf, &b[r.file_ofs], n);
+        count -= n;
+        ubuf += n;
+        total += n;
+        r.file_ofs += n;
+    }
+
+    while (count > 0) {
+        const uint32_t data_ofs = r.file_ofs - sizeof(struct header);
+        const uint32_t idx = data_ofs / item_size;
+        const uint16_t item_ofs = data_ofs % item_size;
+        if (idx >= r.num_items) {
+            // EOF
+            break;
+        }
+        if (int32_t(idx) < r.cached_first || idx >= uint32_t(r.cached_first + r.cached_count)) {
+            const uint16_t nitems = MIN(r.num_items - idx, uint32_t(items_per_block));
+            if (!fetch_items(r.mission_type, idx, nitems, r.cached_items)) {
+                // the items have changed under us
+                r.cached_first = -1;
+                r.cached_count = 0;
+                errno = EIO;
+                return -1;
+            }
+            r.cached_first = idx;
+            r.cached_count = nitems;
+        }
+        const mavlink_mission_item_int_t &item = r.cached_items[idx - r.cached_first];
+        const uint16_t n = MIN(uint32_t(item_size - item_ofs), count);
+        memcpy(ubuf, &((const uint8_t *)&item)[item_ofs], n);
+        count -= n;
+        ubuf += n;
+        total += n;
+        r.file_ofs += n;
+    }
+    return total;
+}
+
+int32_t AP_Filesystem_Mission::write(int fd, const void *buf, uint32_t count)
+{
+    if (fd < 0 || fd >= max_open_file || !file[fd].open || !file[fd].writing) {
+        errno = EBADF;
+        return -1;
+    }
+    struct rfile &r = file[fd];
+    const uint32_t end = r.file_ofs + count;
+    if (end > r.max_write_len || end < r.file_ofs) {
+        errno = EFBIG;
+        return -1;
+    }
+    if (end > r.writebuf_size) {
+        // grow in steps as uploads arrive in small blocks
+        const uint32_t new_size = MIN(MAX(end, r.writebuf_size * 2), r.max_write_len);
+        uint8_t *new_buf = (uint8_t *)calloc(1, new_size);
+        if (new_buf == nullptr) {
+            errno = ENOMEM;
+            return -1;
+        }
+        if (r.writebuf != nullptr) {
+            memcpy(new_buf, r.writebuf, r.write_len);
+            free(r.writebuf);
+        }
+        r.writebuf = new_buf;
+        r.writebuf_size = new_size;
+    }
+    memcpy(&r.writebuf[r.file_ofs], buf, count);
+    r.file_ofs = end;
+    r.write_len = MAX(r.write_len, end);
+    return count;
+}
+
+int32_t AP_Filesystem_Mission::lseek(int fd, int32_t offset, int seek_from)
+{
+    if (fd < 0 || fd >= max_open_file || !file[fd].open) {
+        errno = EBADF;
+        return -1;
+    }
+    struct rfile &r = file[fd];
+    switch (seek_from) {
+    case SEEK_SET:
+        r.file_ofs = offset;
+        break;
+    case SEEK_CUR:
+        r.file_ofs += offset;
+        break;
+    case SEEK_END:
+        if (r.writing) {
+            r.file_ofs = r.write_len + offset;
+        } else {
+            r.file_ofs = sizeof(struct header) + r.num_items * uint32_t(item_size) + offset;
+        }
+        break;
+    }
+    return r.file_ofs;
+}
+
+int AP_Filesystem_Mission::stat(const char *name, struct stat *stbuf)
+{
+    MAV_MISSION_TYPE mission_type;
+    uint16_t num_items;
+    if (!get_mission_type(name, mission_type) ||
+        !fetch_item_count(mission_type, num_items)) {
+        errno = ENOENT;
+        return -1;
+    }
+    memset(stbuf, 0, sizeof(*stbuf));
+    stbuf->st_size = sizeof(struct header) + num_items * uint32_t(item_size);
+    return 0;
+}
+
+/*
+  hand a request to the main thread and wait for it to be run
+ */
+bool AP_Filesystem_Mission::run_request(struct request &req)
+{
+    if (hal.scheduler->in_main_thread()) {
+        return handle_request(req);
+    }
+    WITH_SEMAPHORE(request_sem);
+    req.done = false;
+    {
+        WITH_SEMAPHORE(pending_sem);
+        pending = &req;
+    }
+    const uint32_t start_ms = AP_HAL::millis();
+    while (true) {
+        hal.scheduler->delay(1);
+        WITH_SEMAPHORE(pending_sem);
+        if (req.done) {
+            return req.result;
+        }
+        if (AP_HAL::millis() - start_ms > request_timeout_ms) {
+            // the main thread isn't taking requests. As it holds
+            // pending_sem while running one, it can't be using req
+            pending = nullptr;
+            return false;
+        }
+    }
+}
+
+/*
+  run a request from another thread, called from the main thread
+ */
+void AP_Filesystem_Mission::update(void)
+{
+    WITH_SEMAPHORE(pending_sem);
+    if (pending == nullptr) {
+        return;
+    }
+    pending->result = handle_request(*pending);
+    pending->done = true;
+    pending = nullptr;
+}
+
+bool AP_Filesystem_Mission::handle_request(struct request &req)
+{
+    switch (req.type) {
+    case RequestType::GET_COUNT:
+        return get_item_count(req.mission_type, req.count);
+    case RequestType::GET_ITEMS:
+        for (uint16_t i=0; i<req.count; i++) {
+            if (!get_item(req.mission_type, req.first + i, req.items[i])) {
+                return false;
+            }
+        }
+        return true;
+    case RequestType::STORE_ITEMS:
+        switch (req.mission_type) {
+        case MAV_MISSION_TYPE_MISSION:
+            return finish_upload_mission(req.items, req.count);
+        case MAV_MISSION_TYPE_FENCE:
+            return finish_upload_fence(req.items, req.count);
+        case MAV_MISSION_TYPE_RALLY:
+            return finish_upload_rally(req.items, req.count);
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+bool AP_Filesystem_Mission::fetch_item_count(MAV_MISSION_TYPE mission_type, uint16_t &count)
+{
+    struct request req {};
+    req.type = RequestType::GET_COUNT;
+    req.mission_type = mission_type;
+    if (!run_request(req)) {
+        return false;
+    }
+    count = req.count;
+    return true;
+}
+
+bool AP_Filesystem_Mission::fetch_items(MAV_MISSION_TYPE mission_type, uint16_t first, uint16_t count, mavlink_mission_item_int_t *items)
+{
+    struct request req {};
+    req.type = RequestType::GET_ITEMS;
+    req.mission_type = mission_type;
+    req.first = first;
+    req.count = count;
+    req.items = items;
+    return run_request(req);
+}
+
+/*
+  map a file name to the type of item it holds
+ */
+bool AP_Filesystem_Mission::get_mission_type(const char *fname, MAV_MISSION_TYPE &mission_type) const
+{
+    if (strcmp(fname, "mission.dat") == 0) {
+        mission_type = MAV_MISSION_TYPE_MISSION;
+        return true;
+    }
+    if (strcmp(fname, "fence.dat") == 0) {
+        mission_type = MAV_MISSION_TYPE_FENCE;
+        return true;
+    }
+    if (strcmp(fname, "rally.dat") == 0) {
+        mission_type = MAV_MISSION_TYPE_RALLY;
+        return true;
+    }
+    return false;
+}
+
+/*
+  get the number of stored items, false if the vehicle doesn't support
+  this type of item
+ */
+bool AP_Filesystem_Mission::get_item_count(MAV_MISSION_TYPE mission_type, uint16_t &count) const
+{
+    switch (mission_type) {
+    case MAV_MISSION_TYPE_MISSION: {
+        const AP_Mission *mission = AP::mission();
+        if (mission == nullptr) {
+            return false;
+        }
+        count = mission->num_commands();
+        return true;
+    }
+    case MAV_MISSION_TYPE_FENCE: {
+        const AC_Fence *fence = AP::fence();
+        if (fence == nullptr) {
+            return false;
+        }
+        count = fence->polyfence().num_stored_items();
+        return true;
+    }
+    case MAV_MISSION_TYPE_RALLY: {
+        const AP_Rally *rally = AP::rally();
+        if (rally == nullptr) {
+            return false;
+        }
+        count = rally->get_rally_total();
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/*
+  pack one item the same way the MISSION_ITEM_INT protocol sends it,
+  less the target ids and current flag which depend on the requester
+ */
+bool AP_Filesystem_Mission::get_item(MAV_MISSION_TYPE mission_type, uint16_t seq, mavlink_mission_item_int_t &item) const
+{
+    memset(&item, 0, sizeof(item));
+
+    switch (mission_type) {
+    case MAV_MISSION_TYPE_MISSION: {
+        const AP_Mission *mission = AP::mission();
+        AP_Mission::Mission_Command cmd;
+        if (mission == nullptr ||
+            !mission->read_cmd_from_storage(seq, cmd) ||
+            !AP_Mission::mission_cmd_to_mavlink_int(cmd, item)) {
+            return false;
+        }
+        item.current = 0;
+        break;
+    }
+    case MAV_MISSION_TYPE_FENCE: {
+        AC_Fence *fence = AP::fence();
+        AC_PolyFenceItem fenceitem;
+        if (fence == nullptr ||
+            !fence->polyfence().get_item(seq, fenceitem) ||
+            MissionItemProtocol_Fence::convert_AC_PolyFenceItem_to_MISSION_ITEM_INT(fenceitem, item) != MAV_MISSION_ACCEPTED) {
+            return false;
+        }
+        break;
+    }
+    case MAV_MISSION_TYPE_RALLY: {
+        const AP_Rally *rally = AP::rally();
+        RallyLocation rallypoint;
+        if (rally == nullptr ||
+            !rally->get_rally_point_with_index(seq, rallypoint)) {
+            return false;
+        }
+        MissionItemProtocol_Rally::convert_RallyLocation_to_MISSION_ITEM_INT(rallypoint, item);
+        break;
+    }
+    default:
+        return false;
+    }
+
+    item.seq = seq;
+    item.mission_type = mission_type;
+    return true;
+}
+
+/*
+  get the most items that can be stored, false if the vehicle doesn't
+  support this type of item
+ */
+bool AP_Filesystem_Mission::get_max_items(MAV_MISSION_TYPE mission_type, uint16_t &count) const
+{
+    switch (mission_type) {
+    case MAV_MISSION_TYPE_MISSION: {
+        const AP_Mission *mission = AP::mission();
+        if (mission == nullptr) {
+            return false;
+        }
+        count = mission->num_commands_max();
+        return true;
+    }
+    case MAV_MISSION_TYPE_FENCE: {
+        const AC_Fence *fence = AP::fence();
+        if (fence == nullptr) {
+            return false;
+        }
+        count = fence->polyfence().max_items();
+        return true;
+    }
+    case MAV_MISSION_TYPE_RALLY: {
+        const AP_Rally *rally = AP::rally();
+        if (rally == nullptr) {
+            return false;
+        }
+        count = rally->get_rally_max();
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/*
+  check the header and CRC of an uploaded file, then have the main
+  thread hand its items to the store for their type
+ */
+bool AP_Filesystem_Mission::finish_upload(const rfile &r)
+{
+    if (r.writebuf == nullptr || r.write_len < sizeof(struct header)) {
+        return false;
+    }
+    struct header hdr;
+    memcpy(&hdr, r.writebuf, sizeof(hdr));
+    if (hdr.magic != header().magic ||
+        hdr.mission_type != r.mission_type ||
+        hdr.item_size != item_size ||
+        r.write_len != sizeof(struct header) + hdr.num_items * uint32_t(item_size)) {
+        return false;
+    }
+    const uint8_t *data = &r.writebuf[sizeof(struct header)];
+    if ((crc_crc32(0xFFFFFFFF, data, hdr.num_items * uint32_t(item_size)) ^ 0xFFFFFFFF) != hdr.crc) {
+        return false;
+    }
+
+    // items are packed, so copy them out to get them aligned
+    mavlink_mission_item_int_t *items = new mavlink_mission_item_int_t[MAX(hdr.num_items, 1U)];
+    if (items == nullptr) {
+        return false;
+    }
+    for (uint16_t i=0; i<hdr.num_items; i++) {
+        memcpy(&items[i], &data[i * uint32_t(item_size)], item_size);
+        items[i].seq = i;
+        items[i].mission_type = r.mission_type;
+    }
+
+    struct request req {};
+    req.type = RequestType::STORE_ITEMS;
+    req.mission_type = r.mission_type;
+    req.count = hdr.num_items;
+    req.items = items;
+    const bool ret = run_request(req);
+    delete[] items;
+    return ret;
+}
+
+bool AP_Filesystem_Mission::finish_upload_mission(const mavlink_mission_item_int_t *items, uint16_t count)
+{
+    AP_Mission *mission = AP::mission();
+    if (mission == nullptr || count > mission->num_commands_max()) {
+        return false;
+    }
+
+    // convert every item before changing anything
+    AP_Mission::Mission_Command cmd {};
+    for (uint16_t i=0; i<count; i++) {
+        if (AP_Mission::mavlink_int_to_mission_cmd(items[i], cmd) != MAV_MISSION_ACCEPTED) {
+            return false;
+        }
+        if (cmd.id == MAV_CMD_DO_JUMP &&
+            (cmd.content.jump.target == 0 || cmd.content.jump.target >= count)) {
+            return false;
+        }
+    }
+
+    WITH_SEMAPHORE(mission->get_semaphore());
+    for (uint16_t i=0; i<count; i++) {
+        if (AP_Mission::mavlink_int_to_mission_cmd(items[i], cmd) != MAV_MISSION_ACCEPTED) {
+            return false;
+        }
+        const bool ok = (i < mission->num_commands()) ? mission->replace_cmd(i, cmd) : mission->add_cmd(cmd);
+        if (!ok) {
+            return false;
+        }
+    }
+    mission->truncate(count);
+    return true;
+}
+
+bool AP_Filesystem_Mission::finish_upload_fence(const mavlink_mission_item_int_t *items, uint16_t count)
+{
+    AC_Fence *fence = AP::fence();
+    if (fence == nullptr || count > fence->polyfence().max_items()) {
+        return false;
+    }
+    AC_PolyFenceItem *fence_items = new AC_PolyFenceItem[MAX(count, 1U)];
+    if (fence_items == nullptr) {
+        return false;
+    }
+    bool ret = true;
+    for (uint16_t i=0; i<count; i++) {
+        if (MissionItemProtocol_Fence::convert_MISSION_ITEM_INT_to_AC_PolyFenceItem(items[i], fence_items[i]) != MAV_MISSION_ACCEPTED) {
+            ret = false;
+            break;
+        }
+    }
+    // write_fence() checks the fence as a whole before storing it
+    if (ret) {
+        ret = fence->polyfence().write_fence(fence_items, count);
+    }
+    delete[] fence_items;
+    return ret;
+}
+
+bool AP_Filesystem_Mission::finish_upload_rally(const mavlink_mission_item_int_t *items, uint16_t count)
+{
+    AP_Rally *rally = AP::rally();
+    if (rally == nullptr || count > rally->get_rally_max()) {
+        return false;
+    }
+
+    // convert every item before changing anything
+    RallyLocation rallypoint;
+    for (uint16_t i=0; i<count; i++) {
+        if (MissionItemProtocol_Rally::convert_MISSION_ITEM_INT_to_RallyLocation(items[i], rallypoint) != MAV_MISSION_ACCEPTED) {
+            return false;
+        }
+    }
+
+    rally->truncate(0);
+    for (uint16_t i=0; i<count; i++) {
+        if (MissionItemProtocol_Rally::convert_MISSION_ITEM_INT_to_RallyLocation(items[i], rallypoint) != MAV_MISSION_ACCEPTED ||
+            !rally->append(rallypoint)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,121 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "AP_Filesystem_backend.h"
+
+#include <AP_HAL/Semaphores.h>
+#include <GCS_MAVLink/GCS_MAVLink.h>
+
+class AP_Filesystem_Mission : public AP_Filesystem_Backend
+{
+public:
+    // functions that closely match the equivalent posix calls
+    int open(const char *fname, int flags) override;
+    int close(int fd) override;
+    int32_t read(int fd, void *buf, uint32_t count) override;
+    int32_t write(int fd, const void *buf, uint32_t count) override;
+    int32_t lseek(int fd, int32_t offset, int whence) override;
+    int stat(const char *pathname, struct stat *stbuf) override;
+
+    // run requests from other threads against the stored items
+    void update(void) override;
+
+private:
+    // only allow up to 4 files at a time
+    static constexpr uint8_t max_open_file = 4;
+
+    // each item is a MISSION_ITEM_INT payload in wire order
+    static constexpr uint16_t item_size = sizeof(mavlink_mission_item_int_t);
+
+    // header at front of the file
+    struct PACKED header {
+        uint16_t magic = 0x763d;
+        uint16_t mission_type;
+        uint16_t item_size;
+        uint16_t num_items;
+        uint32_t crc;
+    };
+
+    struct rfile {
+        bool open;
+        MAV_MISSION_TYPE mission_type;
+        uint16_t num_items;
+        uint32_t crc;
+        uint32_t file_ofs;
+        // a block of items fetched from the main thread, as reads
+        // usually split items
+        int32_t cached_first;
+        uint16_t cached_count;
+        mavlink_mission_item_int_t *cached_items;
+        // an upload is held here until the file is closed
+        bool writing;
+        uint8_t *writebuf;
+        uint32_t writebuf_size;
+        uint32_t write_len;
+        uint32_t max_write_len;
+    } file[max_open_file];
+
+    // items fetched per request to the main thread when reading
+    static constexpr uint8_t items_per_block = 8;
+
+    // how long to wait for the main thread to take a request
+    static constexpr uint16_t request_timeout_ms = 2000;
+
+    /*
+      the mission, fence and rally stores are used by the main thread
+      without locking, so everything that reads or changes them is
+      handed to the main thread, which runs it from update()
+     */
+    enum class RequestType : uint8_t {
+        GET_COUNT,
+        GET_ITEMS,
+        STORE_ITEMS,
+    };
+    struct request {
+        RequestType type;
+        MAV_MISSION_TYPE mission_type;
+        uint16_t first;
+        uint16_t count;
+        mavlink_mission_item_int_t *items;
+        bool done;
+        bool result;
+    };
+    // only one request at a time
+    HAL_Semaphore request_sem;
+    // protects pending, and is held while it is run
+    HAL_Semaphore pending_sem;
+    struct request *pending = nullptr;
+
+    bool run_request(struct request &req);
+    bool handle_request(struct request &req);
+    bool fetch_item_count(MAV_MISSION_TYPE mission_type, uint16_t &count);
+    bool fetch_items(MAV_MISSION_TYPE mission_type, uint16_t first, uint16_t count, mavlink_mission_item_int_t *items);
+
+    // these must only be called from the main thread
+
+    bool get_mission_type(const char *fname, MAV_MISSION_TYPE &mission_type) const;
+    bool get_item_count(MAV_MISSION_TYPE mission_type, uint16_t &count) const;
+    bool get_item(MAV_MISSION_TYPE mission_type, uint16_t seq, mavlink_mission_item_int_t &item) const;
+    bool get_max_items(MAV_MISSION_TYPE mission_type, uint16_t &count) const;
+
+    // check a whole upload and then have the main thread replace the
+    // stored items with it
+    bool finish_upload(const rfile &r);
+    bool finish_upload_mission(const mavlink_mission_item_int_t *items, uint16_t count);
+    bool finish_upload_fence(const mavlink_mission_item_int_t *items, uint16_t count);
+    bool finish_upload_rally(const mavlink_mission_item_int_t *items, uint16_t count);
+};
@@ -22,6 +22,7 @@
 #include <AP_Math/AP_Math.h>
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
+#include <AP_HAL/utility/Trace.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -65,6 +66,54 @@ int AP_Filesystem_Sys::open(const char *fname, int flags)
             }
         }
     }
+    if (strcmp(fname, "uarts.txt") == 0) {
+        const uint32_t max_size = 1024;
+        r.data->data = (char *)malloc(max_size);
+        if (r.data->data) {
+            r.data->length = hal.util->uart_info(r.data->data, max_size);
+        }
+    }
+    if (strcmp(fname, "storage.txt") == 0) {
+        const uint32_t max_size = 256;
+        r.data->data = (char *)malloc(max_size);
+        if (r.data->data) {
+            r.data->length = hal.storage->get_stats(r.data->data, max_size);
+            if (r.data->length == 0) { // not supported by this board
+                free(r.data->data);
+                r.data->data = nullptr;
+            }
+        }
+    }
+    if (strcmp(fname, "semaphores.txt") == 0) {
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+        // a line of around 180 characters per tracked semaphore
+        const uint32_t max_size = 64 + 180 * HAL_SEMAPHORE_PROFILE_MAX;
+#else
+        const uint32_t max_size = 12000;
+#endif
+        r.data->data = (char *)malloc(max_size);
+        if (r.data->data) {
+            r.data->length = AP::scheduler().semaphore_info(r.data->data, max_size);
+            if (r.data->length == 0) { // the feature may be disabled
+                free(r.data->data);
+                r.data->data = nullptr;
+            }
+        }
+    }
+#if AP_TRACE_ENABLED
+    r.data->streaming = false;
+    if (strcmp(fname, "trace.json") == 0 && AP_HAL::Trace::enabled()) {
+        // Chrome trace of the recent activity of every thread. This
+        // runs to megabytes, so it is produced as it is read
+        r.data->data = (char *)malloc(trace_chunk_size);
+        if (r.data->data) {
+            r.data->streaming = true;
+            AP_HAL::Trace::chrome_json_start(r.data->cursor);
+            r.data->data_ofs = 0;
+            r.data->length = AP_HAL::Trace::chrome_json_read(r.data->cursor, r.data->data, trace_chunk_size);
+        }
+    }
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     int8_t can_stats_num = -1;
     if (strcmp(fname, "can_log.txt") == 0) {
@@ -118,6 +167,19 @@ int32_t AP_Filesystem_Sys::read(int fd, void *buf, uint32_t count)
         return -1;
     }
     struct rfile &r = file[fd];
+#if AP_TRACE_ENABLED
+    if (r.data->streaming) {
+        if (!trace_fill(*r.data, r.file_ofs)) {
+            // EOF
+            return 0;
+        }
+        const uint32_t ofs = r.file_ofs - r.data->data_ofs;
+        count = MIN(count, r.data->length - ofs);
+        memcpy(buf, &r.data->data[ofs], count);
+        r.file_ofs += count;
+        return count;
+    }
+#endif
     count = MIN(count, r.data->length - r.file_ofs);
     memcpy(buf, &r.data->data[r.file_ofs], count);
     r.file_ofs += count;
@@ -131,6 +193,23 @@ int32_t AP_Filesystem_Sys::lseek(int fd, int32_t offset, int seek_from)
         return -1;
     }
     struct rfile &r = file[fd];
+#if AP_TRACE_ENABLED
+    if (r.data->streaming) {
+        // the length isn't known until the end is read
+        switch (seek_from) {
+        case SEEK_SET:
+            r.file_ofs = offset;
+            break;
+        case SEEK_CUR:
+            r.file_ofs += offset;
+            break;
+        case SEEK_END:
+            errno = EINVAL;
+            return -1;
+        }
+        return r.file_ofs;
+    }
+#endif
     switch (seek_from) {
     case SEEK_SET:
         r.file_ofs = MIN(offset, int32_t(r.data->length));
@@ -152,3 +231,27 @@ int AP_Filesystem_Sys::stat(const char *name, struct stat *stbuf)
     stbuf->st_size = 1024*1024;
     return 0;
 }
+
+#if AP_TRACE_ENABLED
+/*
+  make the chunk of trace.json in d hold file_ofs, returning false at
+  EOF. Reads are nearly always sequential; seeking back before the
+  current chunk starts the output again, which will have moved on
+ */
+bool AP_Filesystem_Sys::trace_fill(struct file_data &d, uint32_t file_ofs)
+{
+    if (file_ofs < d.data_ofs) {
+        AP_HAL::Trace::chrome_json_start(d.cursor);
+        d.data_ofs = 0;
+        d.length = AP_HAL::Trace::chrome_json_read(d.cursor, d.data, trace_chunk_size);
+    }
+    while (file_ofs >= d.data_ofs + d.length) {
+        if (d.length == 0) {
+            return false;
+        }
+        d.data_ofs += d.length;
+        d.length = AP_HAL::Trace::chrome_json_read(d.cursor, d.data, trace_chunk_size);
+    }
+    return true;
+}
+#endif
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "AP_Filesystem_backend.h"
+#include <AP_HAL/utility/Trace.h>
 
 class AP_Filesystem_Sys : public AP_Filesystem_Backend
 {
@@ -34,6 +35,13 @@ private:
     struct file_data {
         char *data;
         size_t length;
+#if AP_TRACE_ENABLED
+        // trace.json is rendered a chunk at a time as it is read,
+        // data holds the chunk starting at file offset data_ofs
+        bool streaming;
+        AP_HAL::Trace::JsonCursor cursor;
+        uint32_t data_ofs;
+#endif
     };
 
     struct rfile {
@@ -41,4 +49,12 @@ private:
         uint32_t file_ofs;
         struct file_data *data;
     } file[max_open_file];
+
+#if AP_TRACE_ENABLED
+    // size of each chunk of trace.json
+    static constexpr uint16_t trace_chunk_size = 1024;
+
+    // render chunks of trace.json until one holds file_ofs
+    bool trace_fill(struct file_data &d, uint32_t file_ofs);
+#endif
 };
@@ -49,4 +49,8 @@ public:
 
     // set modification time on a file
     virtual bool set_mtime(const char *filename, const uint32_t mtime_sec) { return false; }
+
+    // called from the main thread, for work that can't be done on
+    // the thread using the filesystem
+    virtual void update(void) {}
 };
@@ -109,6 +109,7 @@ bool AP_FlashStorage::init(void)
     // clear any write error
     write_error = false;
     reserved_space = 0;
+    compact_ofs = 0;
     
     // if the first sector is full then write out all data so we can erase it
     if (states[first_sector] == SECTOR_STATE_FULL) {
@@ -148,6 +149,9 @@ bool AP_FlashStorage::switch_full_sector(void)
     in_switch_full_sector = true;
     bool ret = protected_switch_full_sector();
     in_switch_full_sector = false;
+    if (ret) {
+        stats.full_switches++;
+    }
     return ret;
 }
 
@@ -175,6 +179,63 @@ bool AP_FlashStorage::protected_switch_full_sector(void)
 
 // write some data to virtual EEPROM
 bool AP_FlashStorage::write(uint16_t offset, uint16_t length)
+{
+    const uint32_t start_us = AP_HAL::micros();
+    const bool ret = write_blocks(offset, length);
+    stats.max_write_us = MAX(stats.max_write_us, AP_HAL::micros() - start_us);
+    return ret;
+}
+
+/*
+  do one step of freeing the full sector. The copy needs room for the
+  data and the reserve, so that a power failure before the erase
+  still leaves room for the full write out done by init(). If there
+  isn't room then the sector will be freed by switch_full_sector()
+  when the current sector fills
+ */
+bool AP_FlashStorage::compact_step(void)
+{
+    if (reserved_space == 0 || write_error) {
+        // the other sector is already available
+        return false;
+    }
+    const uint32_t start_us = AP_HAL::micros();
+
+    // skip zero blocks, as init() starts with a zeroed mem_buffer
+    const uint8_t max_write_local = max_write;
+    while (compact_ofs < storage_size &&
+           all_zero(compact_ofs, MIN(max_write_local, storage_size-compact_ofs))) {
+        compact_ofs += max_write;
+    }
+
+    if (compact_ofs < storage_size) {
+        const uint32_t space_available = flash_sector_size - write_offset;
+        const uint32_t space_required = 2*(sizeof(struct block_header) + max_write) + reserved_space;
+        if (space_available < space_required) {
+            return false;
+        }
+        if (!write_blocks(compact_ofs, MIN(max_write_local, storage_size-compact_ofs))) {
+            return false;
+        }
+        compact_ofs += max_write;
+    } else {
+        // all data is now in the current sector
+        if (!flash_erase_ok()) {
+            return true;
+        }
+        if (!erase_sector(current_sector ^ 1, true)) {
+            return false;
+        }
+        reserved_space = 0;
+        compact_ofs = 0;
+        stats.compactions++;
+    }
+
+    stats.max_step_us = MAX(stats.max_step_us, AP_HAL::micros() - start_us);
+    return reserved_space != 0;
+}
+
+bool AP_FlashStorage::write_blocks(uint16_t offset, uint16_t length)
 {
     if (write_error) {
         return false;
@@ -324,7 +385,10 @@ bool AP_FlashStorage::load_sector(uint8_t sector)
  */
 bool AP_FlashStorage::erase_sector(uint8_t sector, bool mark_available)
 {
-    if (!flash_erase(sector)) {
+    const uint32_t start_us = AP_HAL::micros();
+    const bool ret = flash_erase(sector);
+    stats.max_erase_us = MAX(stats.max_erase_us, AP_HAL::micros() - start_us);
+    if (!ret) {
         return false;
     }
     if (!mark_available) {
@@ -341,6 +405,8 @@ bool AP_FlashStorage::erase_sector(uint8_t sector, bool mark_available)
 bool AP_FlashStorage::erase_all(void)
 {
     write_error = false;
+    reserved_space = 0;
+    compact_ofs = 0;
 
     current_sector = 0;
     write_offset = sizeof(struct sector_header);
@@ -370,7 +436,7 @@ bool AP_FlashStorage::write_all()
         const uint8_t max_write_local = max_write;
         uint8_t n = MIN(max_write_local, storage_size-ofs);
         if (!all_zero(ofs, n)) {
-            if (!write(ofs, n)) {
+            if (!write_blocks(ofs, n)) {
                 return false;
             }
         }
@@ -438,6 +504,9 @@ bool AP_FlashStorage::switch_sectors(void)
     // we need to reserve some space in next sector to ensure we can successfully do a
     // full write out on init()
     reserved_space = reserve_size;
+
+    // and start copying data out of the full sector
+    compact_ofs = 0;
     
     write_offset = sizeof(header);
     return true;    
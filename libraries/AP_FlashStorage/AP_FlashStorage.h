@@ -34,6 +34,13 @@
     128k flash sectors with 16k storage size.
 
   - assumes two flash sectors are available
+
+  - when a sector fills the other one must be freed by copying all
+    data to the current sector and erasing it. Callers can do this
+    incrementally with compact_step() while otherwise idle, so that
+    a write never has to wait for the copy and the erase. If they
+    don't, the copy and erase happen inside the write that finds
+    both sectors full
  */
 #pragma once
 
@@ -120,6 +127,23 @@ public:
     // write some data to storage from mem_buffer
     bool write(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
 
+    /*
+      do one step of freeing the full sector: either copy one block of
+      mem_buffer to the current sector or, once all are copied, erase
+      the full sector if flash_erase_ok(). Returns true if there is
+      more to do
+     */
+    bool compact_step(void);
+
+    struct Stats {
+        uint32_t max_write_us;      // longest write() call
+        uint32_t max_step_us;       // longest compact_step() call
+        uint32_t max_erase_us;      // longest sector erase
+        uint16_t compactions;       // sectors freed by compact_step()
+        uint16_t full_switches;     // sectors freed inside write()
+    };
+    const Stats &get_stats(void) const { return stats; }
+
     // fixed storage size
     static const uint16_t storage_size = HAL_STORAGE_SIZE;
     
@@ -136,6 +160,11 @@ private:
     uint32_t reserved_space;
     bool write_error;
 
+    // next offset in mem_buffer to be copied by compact_step()
+    uint32_t compact_ofs;
+
+    Stats stats {};
+
     // 24 bit signature
 #if AP_FLASHSTORAGE_TYPE == AP_FLASHSTORAGE_TYPE_F4
     static const uint32_t signature = 0x51685B;
@@ -197,6 +226,9 @@ private:
     // amount of space needed to write full storage
     static const uint32_t reserve_size = (storage_size / max_write) * (sizeof(block_header) + max_write) + max_write;
         
+    // write data without timing it
+    bool write_blocks(uint16_t offset, uint16_t length) WARN_IF_UNUSED;
+
     // load data from a sector
     bool load_sector(uint8_t sector) WARN_IF_UNUSED;
 
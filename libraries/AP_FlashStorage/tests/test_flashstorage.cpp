@@ -0,0 +1,217 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_FlashStorage/AP_FlashStorage.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+/*
+  flash timing, roughly that of an STM32F4: 4us per byte programmed
+  plus some overhead per write, and 500ms to erase a 64k sector
+ */
+#define FLASH_SECTOR_SIZE  (64U * 1024U)
+#define FLASH_WRITE_US     10U
+#define FLASH_BYTE_US      4U
+#define FLASH_ERASE_US     500000U
+
+/*
+  two emulated flash sectors that can only have bits cleared, with a
+  clock advanced by every flash operation
+ */
+class FlashEmulator {
+public:
+    FlashEmulator() {
+        flash_erase(0);
+        flash_erase(1);
+        now_us = 0;
+    }
+
+    // write to storage and mem_mirror, returning the emulated time taken
+    uint32_t write(uint16_t offset, const uint8_t *data, uint16_t length) {
+        memcpy(&mem_mirror[offset], data, length);
+        memcpy(&mem_buffer[offset], data, length);
+        const uint64_t start_us = now_us;
+        if (!storage.write(offset, length)) {
+            write_failures++;
+        }
+        return now_us - start_us;
+    }
+
+    // one compaction step, returning the emulated time taken
+    uint32_t step(bool &more) {
+        const uint64_t start_us = now_us;
+        more = storage.compact_step();
+        return now_us - start_us;
+    }
+
+    // a random write the size of a few parameters
+    uint32_t random_write(void) {
+        const uint16_t ofs = random() % sizeof(mem_buffer);
+        const uint16_t length = MIN(uint16_t(1 + random() % 32), uint16_t(sizeof(mem_buffer) - ofs));
+        uint8_t data[32];
+        for (uint8_t j=0; j<length; j++) {
+            data[j] = random();
+        }
+        return write(ofs, data, length);
+    }
+
+    // reboot, reloading mem_buffer from flash
+    bool reinit(void) {
+        return storage.init() && memcmp(mem_buffer, mem_mirror, sizeof(mem_buffer)) == 0;
+    }
+
+    uint8_t mem_buffer[AP_FlashStorage::storage_size] {};
+    uint8_t mem_mirror[AP_FlashStorage::storage_size] {};
+    uint8_t flash[2][FLASH_SECTOR_SIZE];
+    uint64_t now_us;
+    bool erase_ok = true;
+    uint32_t write_failures;
+
+    bool flash_write(uint8_t sector, uint32_t offset, const uint8_t *data, uint16_t length) {
+        EXPECT_LT(sector, 2);
+        EXPECT_LE(offset + length, FLASH_SECTOR_SIZE);
+        for (uint16_t i=0; i<length; i++) {
+            // flash can only clear bits
+            EXPECT_EQ(data[i] & ~flash[sector][offset+i], 0) << "at " << offset+i;
+            flash[sector][offset+i] &= data[i];
+        }
+        now_us += FLASH_WRITE_US + length * FLASH_BYTE_US;
+        return true;
+    }
+    bool flash_read(uint8_t sector, uint32_t offset, uint8_t *data, uint16_t length) {
+        memcpy(data, &flash[sector][offset], length);
+        return true;
+    }
+    bool flash_erase(uint8_t sector) {
+        memset(flash[sector], 0xFF, FLASH_SECTOR_SIZE);
+        now_us += FLASH_ERASE_US;
+        return true;
+    }
+    bool flash_erase_ok(void) {
+        return erase_ok;
+    }
+
+    AP_FlashStorage storage{mem_buffer,
+            FLASH_SECTOR_SIZE,
+            FUNCTOR_BIND_MEMBER(&FlashEmulator::flash_write, bool, uint8_t, uint32_t, const uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&FlashEmulator::flash_read, bool, uint8_t, uint32_t, uint8_t *, uint16_t),
+            FUNCTOR_BIND_MEMBER(&FlashEmulator::flash_erase, bool, uint8_t),
+            FUNCTOR_BIND_MEMBER(&FlashEmulator::flash_erase_ok, bool)};
+};
+
+#define NUM_WRITES 20000
+
+/*
+  without compaction steps the full sector is copied and erased
+  inside a write
+ */
+TEST(AP_FlashStorage, synchronous_switch)
+{
+    srandom(1);
+    FlashEmulator *f = new FlashEmulator;
+    ASSERT_TRUE(f->storage.init());
+
+    uint32_t max_write_us = 0;
+    for (uint32_t i=0; i<NUM_WRITES; i++) {
+        max_write_us = MAX(max_write_us, f->random_write());
+    }
+    EXPECT_EQ(f->write_failures, 0U);
+    EXPECT_GT(f->storage.get_stats().full_switches, 0U);
+    EXPECT_EQ(f->storage.get_stats().compactions, 0U);
+    EXPECT_GE(max_write_us, FLASH_ERASE_US);
+    EXPECT_TRUE(f->reinit());
+    delete f;
+}
+
+/*
+  with a compaction step between writes, as a storage driver does
+  when it has nothing else to write, the spare sector is always
+  erased before it is needed
+ */
+TEST(AP_FlashStorage, background_compaction)
+{
+    srandom(1);
+    FlashEmulator *f = new FlashEmulator;
+    ASSERT_TRUE(f->storage.init());
+
+    uint32_t max_write_us = 0;
+    uint32_t max_copy_us = 0;
+    for (uint32_t i=0; i<NUM_WRITES; i++) {
+        max_write_us = MAX(max_write_us, f->random_write());
+        bool more;
+        const uint32_t step_us = f->step(more);
+        if (step_us < FLASH_ERASE_US) {
+            max_copy_us = MAX(max_copy_us, step_us);
+        }
+    }
+    EXPECT_EQ(f->write_failures, 0U);
+    EXPECT_EQ(f->storage.get_stats().full_switches, 0U);
+    EXPECT_GT(f->storage.get_stats().compactions, 0U);
+    // a write never waits for more than a few blocks
+    EXPECT_LT(max_write_us, 2000U);
+    EXPECT_LT(max_copy_us, 2000U);
+    EXPECT_TRUE(f->reinit());
+    delete f;
+}
+
+/*
+  the copy continues while erasing isn't allowed, but the erase waits
+ */
+TEST(AP_FlashStorage, erase_deferred)
+{
+    srandom(2);
+    FlashEmulator *f = new FlashEmulator;
+    ASSERT_TRUE(f->storage.init());
+
+    // fill the first sector
+    bool more = false;
+    while (!more) {
+        f->random_write();
+        f->step(more);
+    }
+
+    f->erase_ok = false;
+    for (uint16_t i=0; i<1000; i++) {
+        EXPECT_LT(f->step(more), FLASH_ERASE_US);
+        EXPECT_TRUE(more);
+    }
+    EXPECT_EQ(f->storage.get_stats().compactions, 0U);
+
+    f->erase_ok = true;
+    EXPECT_GE(f->step(more), FLASH_ERASE_US);
+    EXPECT_FALSE(more);
+    EXPECT_EQ(f->storage.get_stats().compactions, 1U);
+    EXPECT_TRUE(f->reinit());
+    delete f;
+}
+
+/*
+  a reboot part way through the copy loses nothing
+ */
+TEST(AP_FlashStorage, reboot_during_compaction)
+{
+    srandom(3);
+    FlashEmulator *f = new FlashEmulator;
+    ASSERT_TRUE(f->storage.init());
+
+    for (uint8_t n=0; n<3; n++) {
+        bool more = false;
+        while (!more) {
+            f->random_write();
+            f->step(more);
+        }
+        for (uint8_t i=0; i<50; i++) {
+            f->random_write();
+            f->step(more);
+        }
+        EXPECT_TRUE(f->reinit());
+    }
+    EXPECT_EQ(f->write_failures, 0U);
+    delete f;
+}
+
+AP_GTEST_MAIN()
@@ -118,6 +118,18 @@
 
 /* DEFINITIONS FOR BOARDS */
 
+// per-semaphore contention statistics, see AP_HAL/utility/SemProfile.h.
+// Defined before the board headers as they pull in the HAL semaphores
+#ifndef HAL_SEMAPHORE_PROFILE_ENABLED
+#define HAL_SEMAPHORE_PROFILE_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
+
+// number of semaphores the profiler can track. Linux and SITL have a
+// semaphore per UART, device and backend, so this is generous
+#ifndef HAL_SEMAPHORE_PROFILE_MAX
+#define HAL_SEMAPHORE_PROFILE_MAX 256
+#endif
+
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
     #include <AP_HAL/board/sitl.h>
 #elif CONFIG_HAL_BOARD == HAL_BOARD_LINUX
@@ -1,21 +1,25 @@
 #include "AP_HAL.h"
+#include "utility/SemProfile.h"
 
 extern const AP_HAL::HAL &hal;
 
 /*
   implement WithSemaphore class for WITH_SEMAPHORE() support
  */
-WithSemaphore::WithSemaphore(AP_HAL::Semaphore *mtx, uint32_t line) :
-    WithSemaphore(*mtx, line)
+WithSemaphore::WithSemaphore(AP_HAL::Semaphore *mtx, uint32_t line, const char *file) :
+    WithSemaphore(*mtx, line, file)
 {}
 
-WithSemaphore::WithSemaphore(AP_HAL::Semaphore &mtx, uint32_t line) :
+WithSemaphore::WithSemaphore(AP_HAL::Semaphore &mtx, uint32_t line, const char *file) :
     _mtx(mtx)
 {
     bool in_main = hal.scheduler->in_main_thread();
     if (in_main) {
         hal.util->persistent_data.semaphore_line = line;
     }
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    AP_HAL::SemProfile::set_call_site(file, line);
+#endif
     _mtx.take_blocking();
     if (in_main) {
         hal.util->persistent_data.semaphore_line = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AP_HAL_Namespace.h"
+#include "AP_HAL_Boards.h"
 
 #include <AP_Common/AP_Common.h>
 
@@ -36,8 +37,8 @@ public:
 
 class WithSemaphore {
 public:
-    WithSemaphore(AP_HAL::Semaphore *mtx, uint32_t line);
-    WithSemaphore(AP_HAL::Semaphore &mtx, uint32_t line);
+    WithSemaphore(AP_HAL::Semaphore *mtx, uint32_t line, const char *file=nullptr);
+    WithSemaphore(AP_HAL::Semaphore &mtx, uint32_t line, const char *file=nullptr);
 
     ~WithSemaphore();
 private:
@@ -47,4 +48,9 @@ private:
 // From: https://stackoverflow.com/questions/19666142/why-is-a-level-of-indirection-needed-for-this-concatenation-macro
 #define WITH_SEMAPHORE( sem ) JOIN( sem, __LINE__, __COUNTER__ )
 #define JOIN( sem, line, counter ) _DO_JOIN( sem, line, counter )
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+// the semaphore profiler names call sites by file and line
+#define _DO_JOIN( sem, line, counter ) WithSemaphore _getsem ## counter(sem, line, __FILE__)
+#else
 #define _DO_JOIN( sem, line, counter ) WithSemaphore _getsem ## counter(sem, line)
+#endif
@@ -10,5 +10,11 @@ public:
     virtual void read_block(void *dst, uint16_t src, size_t n) = 0;
     virtual void write_block(uint16_t dst, const void* src, size_t n) = 0;
     virtual void _timer_tick(void) {};
+
+    // write out any pending writes now, before a reboot
+    virtual void flush(void) {}
     virtual bool healthy(void) { return true; }
+
+    // request information on writes to the backing store
+    virtual size_t get_stats(char *buf, size_t bufsize) { return 0; }
 };
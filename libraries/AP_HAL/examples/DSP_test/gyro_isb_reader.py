@@ -1,7 +1,7 @@
 #!/usr/bin/env python
 
 '''
-extract ISBH and ISBD messages from AP_Logging files and produce C++ arrays for consumption by the DSP subsystem
+extract ISBH and ISBD (or compressed ISBC) messages from AP_Logging files and produce C++ arrays for consumption by the DSP subsystem
 '''
 from __future__ import print_function
 
@@ -21,6 +21,9 @@ args = parser.parse_args()
 
 from pymavlink import mavutil
 
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), '../../../../Tools/scripts'))
+import decode_isbc
+
 def isb_parser(logfile):
     '''display fft for raw ACC data in logfile'''
 
@@ -56,6 +59,23 @@ def isb_parser(logfile):
             self.data["Y"].extend(fftd.y)
             self.data["Z"].extend(fftd.z)
 
+        def add_isbc(self, isbc):
+            if isbc.N != self.fftnum:
+                print("Skipping ISBC with wrong fftnum (%u vs %u)\n" % (isbc.N, self.fftnum), file=sys.stderr)
+                return
+            if self.holes:
+                print("Skipping ISBC(%u) for ISBH(%u) with holes in it" % (isbc.seqno, self.fftnum), file=sys.stderr)
+                return
+            # ISBC seqno is the index of the first sample in the message
+            if isbc.seqno != len(self.data["X"]):
+                print("ISBH(%u) has holes in it" % isbc.N, file=sys.stderr)
+                self.holes = True
+                return
+            (x, y, z) = decode_isbc.decode_message(isbc)
+            self.data["X"].extend(x)
+            self.data["Y"].extend(y)
+            self.data["Z"].extend(z)
+
         def prefix(self):
             if self.sensor_type == 0:
                 return "Accel"
@@ -97,6 +117,12 @@ def isb_parser(logfile):
                 continue
             isbdata.add_isb(m)
 
+        if msg_type == "ISBC":
+            if isbdata is None:
+                sys.stderr.write("?(fftnum=%u)" % m.N)
+                continue
+            isbdata.add_isbc(m)
+
     print("", file=sys.stderr)
     time_delta = time.time() - start_time
     print("Extracted %u fft data sets" % len(isb_frames), file=sys.stderr)
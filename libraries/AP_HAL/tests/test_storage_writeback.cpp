@@ -0,0 +1,231 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/StorageWriteback.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define TEST_STORAGE_SIZE 4096
+#define TEST_LINE_SHIFT 3
+
+/*
+  a RAM buffer with write-back to a second buffer standing in for the
+  backing store, in the same way as the SITL and Linux storage drivers
+ */
+class TestStorage {
+public:
+    TestStorage(const StorageWriteback::Policy &policy) :
+        writeback(buffer, sizeof(buffer), TEST_LINE_SHIFT, policy) {
+        memset(buffer, 0, sizeof(buffer));
+        memset(backing, 0, sizeof(backing));
+    }
+
+    void write(uint16_t loc, const void *src, uint16_t n) {
+        writeback.write(loc, src, n, now_ms);
+    }
+
+    // one timer tick, returning the length written
+    uint32_t tick(bool fail=false) {
+        uint32_t offset, length;
+        if (!writeback.next_flush(now_ms, offset, length)) {
+            return 0;
+        }
+        if (fail) {
+            writeback.flush_failed(offset, length);
+            return 0;
+        }
+        memcpy(&backing[offset], &buffer[offset], length);
+        return length;
+    }
+
+    // tick until everything is written, returning the number of writes
+    uint32_t drain(void) {
+        uint32_t writes = 0;
+        while (!writeback.empty()) {
+            now_ms++;
+            if (tick() > 0) {
+                writes++;
+            }
+        }
+        return writes;
+    }
+
+    uint8_t buffer[TEST_STORAGE_SIZE];
+    uint8_t backing[TEST_STORAGE_SIZE];
+    StorageWriteback writeback;
+    uint32_t now_ms = 1000;
+};
+
+static const StorageWriteback::Policy posix_policy { 50, 500, 4096, 64 };
+static const StorageWriteback::Policy flash_policy { 50, 500, 256, 0 };
+
+TEST(StorageWriteback, changed_bytes_only)
+{
+    TestStorage s(posix_policy);
+    const uint8_t zeros[32] {};
+    EXPECT_FALSE(s.writeback.write(100, zeros, sizeof(zeros), s.now_ms));
+    EXPECT_TRUE(s.writeback.empty());
+
+    // only the line holding the changed byte is written
+    uint8_t data[32] {};
+    data[20] = 0x55;
+    EXPECT_TRUE(s.writeback.write(100, data, sizeof(data), s.now_ms));
+    EXPECT_FALSE(s.writeback.empty());
+    s.now_ms += 100;
+    EXPECT_EQ(s.tick(), 8U);
+    EXPECT_EQ(s.backing[120], 0x55);
+    EXPECT_TRUE(s.writeback.empty());
+
+    const StorageWriteback::Stats &stats = s.writeback.get_stats();
+    EXPECT_EQ(stats.write_calls, 2U);
+    EXPECT_EQ(stats.bytes_requested, 64U);
+    EXPECT_EQ(stats.bytes_changed, 1U);
+    EXPECT_EQ(stats.flushes, 1U);
+    EXPECT_EQ(stats.bytes_flushed, 8U);
+
+    // out of range writes are ignored
+    EXPECT_FALSE(s.writeback.write(TEST_STORAGE_SIZE-4, data, 8, s.now_ms));
+}
+
+TEST(StorageWriteback, flush_policy)
+{
+    TestStorage s(posix_policy);
+    const uint8_t v = 1;
+
+    // no flush while writes keep arriving
+    for (uint8_t i=0; i<40; i++) {
+        s.write(i*8, &v, 1);
+        s.now_ms += 10;
+        EXPECT_EQ(s.tick(), 0U);
+    }
+    // until the oldest write is max_delay_ms old
+    s.now_ms += 100;
+    s.write(400, &v, 1);
+    EXPECT_GT(s.tick(), 0U);
+
+    // or the writes have settled
+    TestStorage s2(posix_policy);
+    s2.write(0, &v, 1);
+    s2.now_ms += 49;
+    EXPECT_EQ(s2.tick(), 0U);
+    s2.now_ms += 1;
+    EXPECT_EQ(s2.tick(), 8U);
+
+    // forced flushes ignore the policy
+    s2.write(8, &v, 1);
+    uint32_t offset, length;
+    EXPECT_FALSE(s2.writeback.next_flush(s2.now_ms, offset, length));
+    EXPECT_TRUE(s2.writeback.next_flush(s2.now_ms, offset, length, true));
+    EXPECT_EQ(offset, 8U);
+}
+
+TEST(StorageWriteback, coalescing)
+{
+    // bytes 0..63 and 128..135 dirty, with a 64 byte clean gap
+    uint8_t ones[64];
+    memset(ones, 1, sizeof(ones));
+
+    TestStorage s(posix_policy);
+    s.write(0, ones, 64);
+    s.write(128, ones, 8);
+    s.now_ms += 50;
+    // the gap is bridged with the posix policy
+    EXPECT_EQ(s.tick(), 136U);
+    EXPECT_TRUE(s.writeback.empty());
+
+    TestStorage f(flash_policy);
+    f.write(0, ones, 64);
+    f.write(128, ones, 8);
+    f.now_ms += 50;
+    // but not with the flash policy
+    EXPECT_EQ(f.tick(), 64U);
+    EXPECT_EQ(f.tick(), 8U);
+
+    // and runs are split at max_write
+    TestStorage m(flash_policy);
+    uint8_t block[1024];
+    memset(block, 2, sizeof(block));
+    m.write(0, block, sizeof(block));
+    EXPECT_EQ(m.drain(), 4U);
+    EXPECT_EQ(memcmp(m.buffer, m.backing, sizeof(block)), 0);
+}
+
+TEST(StorageWriteback, failed_flush)
+{
+    TestStorage s(posix_policy);
+    const uint8_t v = 3;
+    s.write(200, &v, 1);
+    s.now_ms += 50;
+    EXPECT_EQ(s.tick(true), 0U);
+    EXPECT_FALSE(s.writeback.empty());
+    EXPECT_EQ(s.writeback.get_stats().errors, 1U);
+    EXPECT_EQ(s.writeback.get_stats().flushes, 0U);
+    EXPECT_EQ(s.tick(), 8U);
+    EXPECT_EQ(s.backing[200], 3);
+}
+
+/*
+  after the backing store is reopened everything is rewritten, which
+  a forced flush does at once
+ */
+TEST(StorageWriteback, rewrite_all)
+{
+    TestStorage s(posix_policy);
+    memset(s.buffer, 5, sizeof(s.buffer));
+    s.writeback.mark_all_dirty(s.now_ms);
+    EXPECT_FALSE(s.writeback.empty());
+
+    uint32_t offset, length;
+    while (s.writeback.next_flush(s.now_ms, offset, length, true)) {
+        memcpy(&s.backing[offset], &s.buffer[offset], length);
+    }
+    EXPECT_EQ(memcmp(s.buffer, s.backing, sizeof(s.buffer)), 0);
+    EXPECT_EQ(s.writeback.get_stats().bytes_flushed, uint32_t(TEST_STORAGE_SIZE));
+}
+
+/*
+  a storm of small writes like a mission upload, 15 byte commands
+  each written with several calls, is written back in a handful of
+  large writes and leaves the backing store identical
+ */
+TEST(StorageWriteback, write_storm)
+{
+    TestStorage s(posix_policy);
+    srandom(7);
+
+    uint32_t writes = 0;
+    for (uint16_t cmd=0; cmd<250; cmd++) {
+        const uint16_t ofs = 4 + cmd*15;
+        uint8_t id = 16 + random() % 8;
+        uint8_t p1 = random();
+        uint8_t content[12];
+        for (uint8_t i=0; i<sizeof(content); i++) {
+            content[i] = random();
+        }
+        s.write(ofs, &id, 1);
+        s.write(ofs+1, &p1, 1);
+        s.write(ofs+3, content, sizeof(content));
+        // one command per GCS round trip
+        s.now_ms += 5;
+        if (s.tick() > 0) {
+            writes++;
+        }
+    }
+    const uint16_t count = 250;
+    s.write(0, &count, sizeof(count));
+    writes += s.drain();
+
+    EXPECT_EQ(memcmp(s.buffer, s.backing, sizeof(s.buffer)), 0);
+    // a write per call before, now a few per max_delay_ms
+    EXPECT_EQ(s.writeback.get_stats().write_calls, 751U);
+    EXPECT_LE(writes, 12U);
+    EXPECT_EQ(writes, s.writeback.get_stats().flushes);
+
+    char buf[256];
+    EXPECT_GT(s.writeback.format_stats(buf, sizeof(buf)), 0);
+}
+
+AP_GTEST_MAIN()
@@ -0,0 +1,213 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  send and receive bursts of datagrams with one system call
+ */
+
+#include <AP_HAL/AP_HAL.h>
+#if HAL_OS_SOCKETS && !defined(HAL_BOOTLOADER_BUILD)
+
+#include <errno.h>
+#include <string.h>
+
+#include <AP_Math/AP_Math.h>
+
+#include "DatagramBatch.h"
+#include "packetise.h"
+
+extern const AP_HAL::HAL& hal;
+
+ssize_t DatagramBatch::send(int fd, ByteBuffer &buf, uint32_t max_bytes, const struct sockaddr_in *dest)
+{
+    const uint32_t n = MIN(MIN(buf.available(), max_bytes), sizeof(_tx));
+    if (n == 0) {
+        return 0;
+    }
+    buf.peekbytes(_tx, n);
+
+    // one datagram per MAVLink packet
+    struct iovec iov[AP_DATAGRAM_BATCH_MAX];
+    uint8_t count = 0;
+    uint32_t ofs = 0;
+    while (count < AP_DATAGRAM_BATCH_MAX && ofs < n) {
+        const uint16_t len = mavlink_packetise(&_tx[ofs], n - ofs);
+        if (len == 0) {
+            // wait for the rest of the packet
+            break;
+        }
+        iov[count].iov_base = &_tx[ofs];
+        iov[count].iov_len = len;
+        ofs += len;
+        count++;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    ssize_t sent_bytes = 0;
+    int sent = 0;
+#if AP_DATAGRAM_BATCH_MMSG
+    struct mmsghdr msgs[AP_DATAGRAM_BATCH_MAX] {};
+    for (uint8_t i = 0; i < count; i++) {
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = (void *)dest;
+        msgs[i].msg_hdr.msg_namelen = dest != nullptr ? sizeof(*dest) : 0;
+    }
+    _stats.send_calls++;
+    sent = ::sendmmsg(fd, msgs, count, MSG_DONTWAIT);
+    if (sent < 0) {
+        return -1;
+    }
+    for (int i = 0; i < sent; i++) {
+        sent_bytes += msgs[i].msg_len;
+    }
+#else
+    for (uint8_t i = 0; i < count; i++) {
+        _stats.send_calls++;
+        const ssize_t ret = ::sendto(fd, iov[i].iov_base, iov[i].iov_len, MSG_DONTWAIT,
+                                     (const struct sockaddr *)dest,
+                                     dest != nullptr ? sizeof(*dest) : 0);
+        if (ret < 0) {
+            if (sent == 0) {
+                return -1;
+            }
+            break;
+        }
+        sent_bytes += ret;
+        sent++;
+    }
+#endif
+
+    _stats.packets_sent += sent;
+    buf.advance(sent_bytes);
+    return sent_bytes;
+}
+
+ssize_t DatagramBatch::recv(int fd, const struct iovec *iov, int iovcnt, struct sockaddr_in *from)
+{
+    size_t space = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        space += iov[i].iov_len;
+    }
+    if (space == 0) {
+        return 0;
+    }
+
+    if (_rx_next >= _rx_count) {
+        // nothing left over from the last call
+        _rx_count = 0;
+        _rx_next = 0;
+        _rx_ofs = 0;
+        const int received = recv_batch(fd, space);
+        if (received < 0) {
+            return -1;
+        }
+        _rx_count = received;
+        _stats.packets_received += received;
+    }
+    if (_rx_count == 0) {
+        return 0;
+    }
+    if (from != nullptr) {
+        *from = _rx_from;
+    }
+
+    // pack the datagrams into the caller's buffers, keeping whatever
+    // doesn't fit for the next call
+    ssize_t total = 0;
+    int v = 0;
+    size_t v_ofs = 0;
+    while (_rx_next < _rx_count && v < iovcnt) {
+        const size_t len = MIN(_rx_len[_rx_next], sizeof(_rx[_rx_next]));
+        const size_t n = MIN(len - _rx_ofs, iov[v].iov_len - v_ofs);
+        memcpy((uint8_t *)iov[v].iov_base + v_ofs, &_rx[_rx_next][_rx_ofs], n);
+        total += n;
+        _rx_ofs += n;
+        v_ofs += n;
+        if (_rx_ofs == len) {
+            _rx_next++;
+            _rx_ofs = 0;
+        }
+        if (v_ofs == iov[v].iov_len) {
+            v++;
+            v_ofs = 0;
+        }
+    }
+    return total;
+}
+
+/*
+  receive datagrams into _rx, returning how many were received or -1
+ */
+int DatagramBatch::recv_batch(int fd, size_t space)
+{
+    // only ask for as many datagrams as there is room for, so that
+    // little is left over for the next call
+    const uint8_t count = constrain_int32(space / AP_DATAGRAM_BATCH_MTU, 1, AP_DATAGRAM_BATCH_MAX);
+    int received = 0;
+
+#if AP_DATAGRAM_BATCH_MMSG
+    struct mmsghdr msgs[AP_DATAGRAM_BATCH_MAX] {};
+    struct iovec rx_iov[AP_DATAGRAM_BATCH_MAX];
+    for (uint8_t i = 0; i < count; i++) {
+        rx_iov[i].iov_base = _rx[i];
+        rx_iov[i].iov_len = sizeof(_rx[i]);
+        msgs[i].msg_hdr.msg_iov = &rx_iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    msgs[0].msg_hdr.msg_name = &_rx_from;
+    msgs[0].msg_hdr.msg_namelen = sizeof(_rx_from);
+    _stats.recv_calls++;
+    received = ::recvmmsg(fd, msgs, count, MSG_DONTWAIT, nullptr);
+    if (received < 0) {
+        return -1;
+    }
+    for (int i = 0; i < received; i++) {
+        _rx_len[i] = msgs[i].msg_len;
+    }
+#else
+    for (uint8_t i = 0; i < count; i++) {
+        socklen_t fromlen = sizeof(_rx_from);
+        _stats.recv_calls++;
+        const ssize_t ret = ::recvfrom(fd, _rx[i], sizeof(_rx[i]), MSG_DONTWAIT,
+                                       i == 0 ? (struct sockaddr *)&_rx_from : nullptr,
+                                       i == 0 ? &fromlen : nullptr);
+        if (ret < 0) {
+            if (received == 0) {
+                return -1;
+            }
+            break;
+        }
+        _rx_len[i] = ret;
+        received++;
+    }
+#endif
+
+    return received;
+}
+
+int DatagramBatch::format_stats(char *buf, size_t bufsize, const char *name, const Stats &stats)
+{
+    return hal.util->snprintf(buf, bufsize,
+                              "%-6s TX %u pkts %u calls %.1f/call RX %u pkts %u calls %.1f/call\n",
+                              name,
+                              (unsigned)stats.packets_sent, (unsigned)stats.send_calls,
+                              stats.send_calls ? (double)stats.packets_sent / stats.send_calls : 0.0,
+                              (unsigned)stats.packets_received, (unsigned)stats.recv_calls,
+                              stats.recv_calls ? (double)stats.packets_received / stats.recv_calls : 0.0);
+}
+
+#endif // HAL_OS_SOCKETS && !HAL_BOOTLOADER_BUILD
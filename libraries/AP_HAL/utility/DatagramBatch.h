@@ -0,0 +1,101 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  send and receive bursts of datagrams with one system call, using
+  sendmmsg()/recvmmsg() where the OS has them
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+
+#if HAL_OS_SOCKETS
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+#include "RingBuffer.h"
+
+#ifndef AP_DATAGRAM_BATCH_MMSG
+#ifdef __linux__
+#define AP_DATAGRAM_BATCH_MMSG 1
+#else
+#define AP_DATAGRAM_BATCH_MMSG 0
+#endif
+#endif
+
+// maximum number of datagrams sent or received per system call
+#ifndef AP_DATAGRAM_BATCH_MAX
+#define AP_DATAGRAM_BATCH_MAX 16
+#endif
+
+// largest datagram we expect to receive
+#ifndef AP_DATAGRAM_BATCH_MTU
+#define AP_DATAGRAM_BATCH_MTU 1500
+#endif
+
+// largest MAVLink2 packet, including signature
+#define AP_DATAGRAM_BATCH_PACKET_MAX 280
+
+class DatagramBatch {
+public:
+    struct Stats {
+        uint32_t send_calls;
+        uint32_t packets_sent;
+        uint32_t recv_calls;
+        uint32_t packets_received;
+    };
+
+    /*
+      send up to AP_DATAGRAM_BATCH_MAX packets from the start of buf,
+      split on MAVLink packet boundaries so each datagram holds one
+      packet. At most max_bytes are sent. dest is needed for sockets
+      that aren't connected and may be nullptr otherwise. Sent bytes
+      are removed from buf. Returns the number of bytes sent, or -1
+      with errno set
+     */
+    ssize_t send(int fd, ByteBuffer &buf, uint32_t max_bytes, const struct sockaddr_in *dest);
+
+    /*
+      receive up to AP_DATAGRAM_BATCH_MAX datagrams and store them one
+      after the other in iov. from is set to the sender of the first
+      datagram if not nullptr. Anything that doesn't fit in iov is kept
+      and returned by the next call, before more is received. Returns
+      the number of bytes received, or -1 with errno set
+     */
+    ssize_t recv(int fd, const struct iovec *iov, int iovcnt, struct sockaddr_in *from);
+
+    const Stats &get_stats() const { return _stats; }
+
+    // one line of packets per system call for @SYS/uarts.txt
+    static int format_stats(char *buf, size_t bufsize, const char *name, const Stats &stats);
+
+private:
+    int recv_batch(int fd, size_t space);
+
+    Stats _stats {};
+
+    uint8_t _tx[AP_DATAGRAM_BATCH_MAX * AP_DATAGRAM_BATCH_PACKET_MAX];
+    uint8_t _rx[AP_DATAGRAM_BATCH_MAX][AP_DATAGRAM_BATCH_MTU];
+
+    // datagrams in _rx not yet returned by recv()
+    size_t _rx_len[AP_DATAGRAM_BATCH_MAX] {};
+    uint8_t _rx_count = 0;
+    uint8_t _rx_next = 0;
+    size_t _rx_ofs = 0;
+    struct sockaddr_in _rx_from {};
+};
+
+#endif // HAL_OS_SOCKETS
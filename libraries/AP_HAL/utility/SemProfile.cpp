@@ -0,0 +1,207 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AP_HAL/AP_HAL.h>
+#include "SemProfile.h"
+
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace AP_HAL {
+namespace SemProfile {
+
+static std::atomic<bool> _enabled;
+static std::atomic<uint16_t> _num_stats;
+static std::atomic<uint32_t> _num_untracked;
+static Stats _stats[HAL_SEMAPHORE_PROFILE_MAX];
+static thread_local Site _call_site;
+
+/*
+  wall clock microseconds. We don't use AP_HAL::micros() as in SITL
+  that is simulation time, which does not advance while blocked
+ */
+static uint32_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint32_t(ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000U);
+}
+
+void set_enabled(bool enabled)
+{
+    _enabled.store(enabled);
+}
+
+bool enabled(void)
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+void set_call_site(const char *file, uint16_t line)
+{
+    _call_site.file = file;
+    _call_site.line = line;
+}
+
+uint16_t num_stats(void)
+{
+    return _num_stats.load();
+}
+
+const Stats *get_stats(uint16_t idx)
+{
+    return idx < num_stats() ? &_stats[idx] : nullptr;
+}
+
+uint32_t num_untracked(void)
+{
+    return _num_untracked.load();
+}
+
+void format_site(const Site &site, char *buf, size_t bufsize)
+{
+    if (site.file == nullptr) {
+        snprintf(buf, bufsize, "?");
+        return;
+    }
+    const char *base = strrchr(site.file, '/');
+    snprintf(buf, bufsize, "%s:%u", base ? base + 1 : site.file, unsigned(site.line));
+}
+
+uint32_t Tracker::begin_take(void) const
+{
+    return enabled() ? now_us() : 0;
+}
+
+void Tracker::acquired(const void *sem, uint32_t start_us, bool contended)
+{
+    const Site site = _call_site;
+    _call_site.file = nullptr;
+
+    if (start_us == 0) {
+        // not recording, but keep the nesting depth right in case
+        // recording is enabled while we hold the semaphore
+        if (_depth > 0) {
+            _depth++;
+        }
+        return;
+    }
+
+    if (_stats == nullptr) {
+        if (_no_slot) {
+            return;
+        }
+        uint16_t idx = _num_stats.load();
+        do {
+            if (idx >= HAL_SEMAPHORE_PROFILE_MAX) {
+                _no_slot = true;
+                _num_untracked++;
+                return;
+            }
+        } while (!_num_stats.compare_exchange_weak(idx, idx + 1));
+        _stats[idx].sem = sem;
+        _stats = &_stats[idx];
+    }
+    if (_stats->name.file == nullptr && site.file != nullptr) {
+        _stats->name = site;
+    }
+
+    const uint32_t now = now_us();
+    const uint32_t wait_us = now - start_us;
+    _stats->acquire_count++;
+    if (contended) {
+        _stats->contended_count++;
+    }
+    uint8_t bucket = WAIT_LT_10US;
+    for (uint32_t limit = 10; bucket < WAIT_GE_10MS && wait_us >= limit; limit *= 10) {
+        bucket++;
+    }
+    _stats->wait_hist[bucket]++;
+    _stats->wait_total_us += wait_us;
+    if (wait_us > _stats->wait_max_us) {
+        _stats->wait_max_us = wait_us;
+    }
+
+    // hold time is measured for the outermost take of a recursive semaphore
+    if (_depth++ == 0) {
+        _hold_start_us = now;
+        _holder = site;
+    }
+}
+
+void Tracker::releasing(void)
+{
+    if (_depth == 0) {
+        return;
+    }
+    if (--_depth > 0 || _stats == nullptr) {
+        return;
+    }
+    const uint32_t hold_us = now_us() - _hold_start_us;
+    if (hold_us > _stats->hold_max_us) {
+        _stats->hold_max_us = hold_us;
+        _stats->hold_max_site = _holder;
+    }
+}
+
+size_t report(char *buf, size_t bufsize)
+{
+    size_t total = 0;
+    int n = snprintf(buf, bufsize, "SemaphoresV1 untracked=%lu\n", (unsigned long)num_untracked());
+    if (n <= 0 || size_t(n) >= bufsize) {
+        return 0;
+    }
+    total += n;
+
+    const uint16_t count = num_stats();
+    for (uint16_t i=0; i<count; i++) {
+        const Stats &s = _stats[i];
+        char name[40];
+        char holder[40];
+        if (s.name.file != nullptr) {
+            format_site(s.name, name, sizeof(name));
+        } else {
+            snprintf(name, sizeof(name), "%p", s.sem);
+        }
+        format_site(s.hold_max_site, holder, sizeof(holder));
+        n = snprintf(&buf[total], bufsize - total,
+                     "%-32.32s ACQ=%lu CONT=%lu W<10us=%lu W<100us=%lu W<1ms=%lu W<10ms=%lu W>10ms=%lu WMAX=%lu HMAX=%lu HOLDER=%s\n",
+                     name,
+                     (unsigned long)s.acquire_count,
+                     (unsigned long)s.contended_count,
+                     (unsigned long)s.wait_hist[WAIT_LT_10US],
+                     (unsigned long)s.wait_hist[WAIT_LT_100US],
+                     (unsigned long)s.wait_hist[WAIT_LT_1MS],
+                     (unsigned long)s.wait_hist[WAIT_LT_10MS],
+                     (unsigned long)s.wait_hist[WAIT_GE_10MS],
+                     (unsigned long)s.wait_max_us,
+                     (unsigned long)s.hold_max_us,
+                     holder);
+        if (n <= 0 || size_t(n) >= bufsize - total) {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+} // namespace SemProfile
+} // namespace AP_HAL
+
+#endif // HAL_SEMAPHORE_PROFILE_ENABLED
@@ -0,0 +1,102 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  semaphore contention profiler
+
+  HAL semaphores that embed a SemProfile::Tracker record how often
+  they are taken, how long takers wait and the longest time they are
+  held. Call sites come from WITH_SEMAPHORE(). Recording is off until
+  enabled at runtime, costing one branch per take and give.
+ */
+#pragma once
+
+// this header is pulled in by the HAL semaphores from within
+// AP_HAL_Boards.h, so it must not depend on the board headers. The
+// implementation is only built when HAL_SEMAPHORE_PROFILE_ENABLED
+#include <stddef.h>
+#include <stdint.h>
+
+namespace AP_HAL {
+namespace SemProfile {
+
+// wait time histogram buckets, each ten times wider than the last
+enum {
+    WAIT_LT_10US = 0,
+    WAIT_LT_100US,
+    WAIT_LT_1MS,
+    WAIT_LT_10MS,
+    WAIT_GE_10MS,
+    WAIT_NUM_BUCKETS
+};
+
+struct Site {
+    const char *file;
+    uint16_t line;
+};
+
+struct Stats {
+    Site name;          // first call site seen, used to identify the semaphore
+    const void *sem;
+    uint32_t acquire_count;
+    uint32_t contended_count;
+    uint32_t wait_hist[WAIT_NUM_BUCKETS];
+    uint64_t wait_total_us;
+    uint32_t wait_max_us;
+    uint32_t hold_max_us;
+    Site hold_max_site; // call site of the longest holder
+};
+
+// turn recording on or off
+void set_enabled(bool enabled);
+bool enabled(void);
+
+// remember the call site for the next take on this thread
+void set_call_site(const char *file, uint16_t line);
+
+// number of semaphores with statistics, and access to them
+uint16_t num_stats(void);
+const Stats *get_stats(uint16_t idx);
+
+// number of semaphores taken after the table filled up
+uint32_t num_untracked(void);
+
+// format a call site as basename:line
+void format_site(const Site &site, char *buf, size_t bufsize);
+
+// text report for @SYS/semaphores.txt
+size_t report(char *buf, size_t bufsize);
+
+/*
+  per-semaphore state, embedded in the HAL semaphore. Updates happen
+  while the semaphore is held, so they need no further locking
+ */
+class Tracker {
+public:
+    // timestamp to pass to acquired(), 0 when not recording
+    uint32_t begin_take(void) const;
+    void acquired(const void *sem, uint32_t start_us, bool contended);
+    void releasing(void);
+
+private:
+    Stats *_stats = nullptr;
+    // set once there was no room in the table, so it is only tried once
+    bool _no_slot = false;
+    uint32_t _hold_start_us = 0;
+    uint16_t _depth = 0;
+    Site _holder {};
+};
+
+} // namespace SemProfile
+} // namespace AP_HAL
@@ -20,6 +20,7 @@
 #if HAL_OS_SOCKETS
 
 #include "Socket.h"
+#include <errno.h>
 
 /*
   constructor
@@ -144,6 +145,7 @@ ssize_t SocketAPM::sendto(const void *buf, size_t size, const char *address, uin
 ssize_t SocketAPM::recv(void *buf, size_t size, uint32_t timeout_ms)
 {
     if (!pollin(timeout_ms)) {
+        errno = EWOULDBLOCK;
         return -1;
     }
     socklen_t len = sizeof(in_addr);
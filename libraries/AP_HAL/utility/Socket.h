@@ -62,13 +62,17 @@ public:
     // listen has been used. A new socket is returned
     SocketAPM *accept(uint32_t timeout_ms);
 
+    // file descriptor for waiting on the socket with poll/epoll
+    int get_fd(void) const { return fd; }
+
+    // fill in a socket address for sending to address:port
+    static void make_sockaddr(const char *address, uint16_t port, struct sockaddr_in &sockaddr);
+
 private:
     bool datagram;
     struct sockaddr_in in_addr {};
 
     int fd = -1;
-
-    void make_sockaddr(const char *address, uint16_t port, struct sockaddr_in &sockaddr);
 };
 
 #endif // HAL_OS_SOCKETS
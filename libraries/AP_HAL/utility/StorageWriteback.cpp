@@ -0,0 +1,179 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <AP_HAL/AP_HAL.h>
+#include <string.h>
+#include <AP_Math/AP_Math.h>
+#include "StorageWriteback.h"
+
+extern const AP_HAL::HAL& hal;
+
+StorageWriteback::StorageWriteback(uint8_t *buffer, uint32_t size, uint8_t line_shift, const Policy &policy) :
+    _buffer(buffer),
+    _size(size),
+    _line_shift(line_shift),
+    _num_lines((size + (1U<<line_shift) - 1) >> line_shift),
+    _policy(policy)
+{
+    _dirty = new std::atomic<uint32_t>[(_num_lines+31)/32]();
+}
+
+/*
+  mark the lines covering a range of bytes as dirty
+ */
+void StorageWriteback::mark_dirty(uint32_t loc, uint32_t length)
+{
+    if (length == 0) {
+        return;
+    }
+    const uint32_t last = (loc + length - 1) >> _line_shift;
+    for (uint32_t line = loc >> _line_shift; line <= last; line++) {
+        _dirty[line/32].fetch_or(1U << (line%32));
+    }
+}
+
+bool StorageWriteback::write(uint32_t loc, const void *src, uint32_t n, uint32_t now_ms)
+{
+    if (n == 0 || loc >= _size || n > _size - loc) {
+        return false;
+    }
+    _stats.write_calls++;
+    _stats.bytes_requested += n;
+
+    // only the bytes from the first to the last change are dirty
+    const uint8_t *b = (const uint8_t *)src;
+    uint8_t *dst = &_buffer[loc];
+    uint32_t first = 0;
+    while (first < n && b[first] == dst[first]) {
+        first++;
+    }
+    if (first == n) {
+        return false;
+    }
+    uint32_t last = n - 1;
+    while (b[last] == dst[last]) {
+        last--;
+    }
+    const uint32_t changed = last + 1 - first;
+    memcpy(&dst[first], &b[first], changed);
+    _stats.bytes_changed += changed;
+
+    _last_write_ms = now_ms;
+    if (!_pending) {
+        _first_dirty_ms = now_ms;
+        _pending = true;
+    }
+    mark_dirty(loc + first, changed);
+    return true;
+}
+
+/*
+  return the first dirty line, or -1 if all are clean
+ */
+int32_t StorageWriteback::first_dirty() const
+{
+    for (uint32_t i=0; i<(_num_lines+31)/32; i++) {
+        const uint32_t mask = _dirty[i].load();
+        if (mask != 0) {
+            return i*32 + __builtin_ctz(mask);
+        }
+    }
+    return -1;
+}
+
+bool StorageWriteback::empty() const
+{
+    return first_dirty() < 0;
+}
+
+void StorageWriteback::mark_all_dirty(uint32_t now_ms)
+{
+    _first_dirty_ms = now_ms;
+    _pending = true;
+    mark_dirty(0, _size);
+}
+
+bool StorageWriteback::next_flush(uint32_t now_ms, uint32_t &offset, uint32_t &length, bool force)
+{
+    const int32_t start = first_dirty();
+    if (start < 0) {
+        _pending = false;
+        return false;
+    }
+    if (!_pending) {
+        // lost a race with write(), the delay starts now
+        _first_dirty_ms = now_ms;
+        _pending = true;
+    }
+    if (!force &&
+        now_ms - _last_write_ms < _policy.settle_ms &&
+        now_ms - _first_dirty_ms < _policy.max_delay_ms) {
+        // writes are still arriving, let them coalesce
+        return false;
+    }
+
+    /*
+      extend the run over following dirty lines, bridging gaps of up
+      to max_gap clean bytes, until it reaches max_write bytes
+     */
+    const uint32_t max_lines = MAX(uint32_t(_policy.max_write >> _line_shift), 1U);
+    const uint32_t gap_lines = _policy.max_gap >> _line_shift;
+    uint32_t end = start + 1;
+    for (uint32_t line = end; line < _num_lines && line < start + max_lines; line++) {
+        if (is_dirty(line)) {
+            end = line + 1;
+        } else if (line + 1 - end > gap_lines) {
+            break;
+        }
+    }
+
+    // mark clean before the caller writes, so writes during the flush
+    // leave the line dirty
+    for (uint32_t line = start; line < end; line++) {
+        _dirty[line/32].fetch_and(~(1U << (line%32)));
+    }
+
+    // once everything is written the delay restarts with the next write
+    if (first_dirty() < 0) {
+        _pending = false;
+    }
+
+    offset = uint32_t(start) << _line_shift;
+    length = MIN((end - start) << _line_shift, _size - offset);
+    _stats.flushes++;
+    _stats.bytes_flushed += length;
+    return true;
+}
+
+void StorageWriteback::flush_failed(uint32_t offset, uint32_t length)
+{
+    mark_dirty(offset, length);
+    _stats.flushes--;
+    _stats.bytes_flushed -= length;
+    _stats.errors++;
+}
+
+int StorageWriteback::format_stats(char *buf, size_t bufsize) const
+{
+    const Stats &s = _stats;
+    return hal.util->snprintf(buf, bufsize,
+                              "writes %u bytes %u changed %u\n"
+                              "flushes %u bytes %u syncs %u errors %u\n"
+                              "writes/flush %.1f amplification %.2f\n",
+                              (unsigned)s.write_calls, (unsigned)s.bytes_requested, (unsigned)s.bytes_changed,
+                              (unsigned)s.flushes, (unsigned)s.bytes_flushed, (unsigned)s.syncs, (unsigned)s.errors,
+                              s.flushes ? (double)s.write_calls / s.flushes : 0.0,
+                              s.bytes_changed ? (double)s.bytes_flushed / s.bytes_changed : 0.0);
+}
@@ -0,0 +1,116 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  write-back tracking for the RAM copy of storage kept by HAL storage
+  drivers.
+
+  Writes only mark the bytes that actually changed as dirty, and the
+  driver flushes contiguous runs of dirty lines rather than single
+  lines. A flush policy holds off flushing while writes are still
+  arriving, so that a storm of small writes (a mission upload or a
+  parameter save) is written to the backing store as a few large
+  writes.
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+class StorageWriteback {
+public:
+    struct Policy {
+        // wait for this long without writes before flushing
+        uint16_t settle_ms;
+        // but never leave a line dirty for longer than this
+        uint16_t max_delay_ms;
+        // largest single write to the backing store, in bytes
+        uint16_t max_write;
+        // clean bytes that may be rewritten to join two dirty runs
+        uint16_t max_gap;
+    };
+
+    struct Stats {
+        uint32_t write_calls;     // write() calls
+        uint32_t bytes_requested; // bytes passed to write()
+        uint32_t bytes_changed;   // bytes that differed from the buffer
+        uint32_t flushes;         // writes to the backing store
+        uint32_t bytes_flushed;   // bytes written to the backing store
+        uint32_t syncs;           // fsync() or equivalent calls
+        uint32_t errors;          // failed writes to the backing store
+    };
+
+    /*
+      track writes to a buffer of size bytes, with dirty lines of
+      (1<<line_shift) bytes
+     */
+    StorageWriteback(uint8_t *buffer, uint32_t size, uint8_t line_shift, const Policy &policy);
+
+    /*
+      copy n bytes into the buffer at loc, marking any lines that
+      changed as dirty. Returns false if nothing changed
+     */
+    bool write(uint32_t loc, const void *src, uint32_t n, uint32_t now_ms);
+
+    /*
+      get the next run of the buffer to write to the backing store,
+      if the policy says it should be flushed now. The run is marked
+      clean; call flush_failed() if it can't be written. force
+      ignores the policy, for shutdown or re-initialisation
+     */
+    bool next_flush(uint32_t now_ms, uint32_t &offset, uint32_t &length, bool force=false);
+
+    // mark a run returned by next_flush() dirty again
+    void flush_failed(uint32_t offset, uint32_t length);
+
+    // record a sync of the backing store
+    void synced() { _stats.syncs++; }
+
+    // true if there is nothing to flush
+    bool empty() const;
+
+    // mark all lines dirty, forcing a full rewrite
+    void mark_all_dirty(uint32_t now_ms);
+
+    const Stats &get_stats() const { return _stats; }
+
+    // write counters for @SYS/storage.txt
+    int format_stats(char *buf, size_t bufsize) const;
+
+private:
+    uint8_t *_buffer;
+    const uint32_t _size;
+    const uint8_t _line_shift;
+    const uint32_t _num_lines;
+    const Policy _policy;
+
+    // one bit per line, set by the writing thread and cleared by the
+    // flushing thread
+    std::atomic<uint32_t> *_dirty;
+
+    // time of the last write, and of the first write since the buffer
+    // was last clean
+    uint32_t _last_write_ms = 0;
+    uint32_t _first_dirty_ms = 0;
+    bool _pending = false;
+
+    Stats _stats {};
+
+    void mark_dirty(uint32_t loc, uint32_t length);
+    bool is_dirty(uint32_t line) const {
+        return (_dirty[line/32].load() & (1U << (line%32))) != 0;
+    }
+    int32_t first_dirty() const;
+};
@@ -0,0 +1,250 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Trace.h"
+
+#if AP_TRACE_ENABLED
+
+#include <AP_HAL/AP_HAL.h>
+#include <atomic>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert((AP_TRACE_RING_SIZE & (AP_TRACE_RING_SIZE - 1)) == 0, "AP_TRACE_RING_SIZE must be a power of 2");
+
+namespace AP_HAL {
+namespace Trace {
+
+// one recorded event, 8 bytes
+struct Entry {
+    uint32_t time_us;
+    uint16_t id;
+    uint8_t event;
+    uint8_t reserved;
+};
+
+// per-thread ring. Only the owning thread writes, so the head is the
+// only thing that needs to be atomic
+struct Ring {
+    Entry entries[AP_TRACE_RING_SIZE];
+    std::atomic<uint32_t> head;
+    Ring *next;
+    uint16_t tid;
+    char name[16];
+};
+
+static std::atomic<bool> trace_enabled;
+static thread_local Ring *tls_ring;
+static bool ring_alloc_failed;
+
+static std::atomic<Ring *> rings;
+static std::atomic<uint16_t> num_rings;
+
+static pthread_mutex_t names_lock = PTHREAD_MUTEX_INITIALIZER;
+static const char *names[AP_TRACE_MAX_NAMES] = { "unknown" };
+static std::atomic<uint16_t> num_names { 1 };
+
+void set_enabled(bool enabled)
+{
+    trace_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled(void)
+{
+    return trace_enabled.load(std::memory_order_relaxed);
+}
+
+uint16_t register_name(const char *name)
+{
+    pthread_mutex_lock(&names_lock);
+    const uint16_t n = num_names.load();
+    for (uint16_t i=0; i<n; i++) {
+        if (names[i] == name || strcmp(names[i], name) == 0) {
+            pthread_mutex_unlock(&names_lock);
+            return i;
+        }
+    }
+    uint16_t id = 0;
+    if (n < AP_TRACE_MAX_NAMES) {
+        names[n] = name;
+        num_names.store(n + 1);
+        id = n;
+    }
+    pthread_mutex_unlock(&names_lock);
+    return id;
+}
+
+/*
+  give the calling thread a ring the first time it records an event
+ */
+static Ring *attach_thread(void)
+{
+    if (ring_alloc_failed) {
+        return nullptr;
+    }
+    Ring *r = new Ring;
+    if (r == nullptr) {
+        ring_alloc_failed = true;
+        return nullptr;
+    }
+    memset(r->entries, 0, sizeof(r->entries));
+    r->head.store(0);
+    r->tid = num_rings.fetch_add(1);
+    if (pthread_getname_np(pthread_self(), r->name, sizeof(r->name)) != 0 || r->name[0] == 0) {
+        snprintf(r->name, sizeof(r->name), "thread%u", unsigned(r->tid));
+    }
+
+    // push onto the list of rings, rings are never freed
+    Ring *old_head = rings.load();
+    do {
+        r->next = old_head;
+    } while (!rings.compare_exchange_weak(old_head, r));
+
+    tls_ring = r;
+    return r;
+}
+
+void record(Event event, uint16_t id)
+{
+    if (!trace_enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    Ring *r = tls_ring;
+    if (r == nullptr) {
+        r = attach_thread();
+        if (r == nullptr) {
+            return;
+        }
+    }
+    const uint32_t h = r->head.load(std::memory_order_relaxed);
+    Entry &e = r->entries[h & (AP_TRACE_RING_SIZE - 1)];
+    e.time_us = AP_HAL::micros();
+    e.id = id;
+    e.event = uint8_t(event);
+    r->head.store(h + 1, std::memory_order_release);
+}
+
+enum class JsonStage : uint8_t {
+    HEADER = 0,
+    THREAD_NAME,
+    EVENTS,
+    FOOTER,
+    DONE,
+};
+
+void chrome_json_start(JsonCursor &cursor)
+{
+    cursor.now64 = 0;
+    cursor.ring = rings.load();
+    cursor.next = 0;
+    cursor.head = 0;
+    cursor.stage = uint8_t(JsonStage::HEADER);
+    cursor.first = true;
+}
+
+/*
+  render the rings as Chrome trace JSON, a line at a time. The rings
+  keep being written while we read, so the oldest events of a busy
+  thread may be replaced by newer ones before they are output; those
+  are skipped, which only affects the start of its window
+ */
+size_t chrome_json_read(JsonCursor &cursor, char *buf, size_t bufsize)
+{
+    size_t total = 0;
+    const uint16_t nnames = num_names.load();
+    char line[chrome_json_min_buf];
+
+    while (cursor.stage != uint8_t(JsonStage::DONE)) {
+        int n = 0;
+        Ring *r = cursor.ring;
+        switch (JsonStage(cursor.stage)) {
+        case JsonStage::HEADER:
+            n = snprintf(line, sizeof(line), "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            break;
+        case JsonStage::THREAD_NAME:
+            n = snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%u,\"args\":{\"name\":\"%.15s\"}}",
+                         cursor.first ? "" : ",\n", unsigned(r->tid), r->name);
+            break;
+        case JsonStage::EVENTS: {
+            // skip anything overwritten since this ring was started
+            const uint32_t h = r->head.load(std::memory_order_acquire);
+            if (h - cursor.next > AP_TRACE_RING_SIZE) {
+                cursor.next = h - AP_TRACE_RING_SIZE;
+            }
+            if (int32_t(cursor.head - cursor.next) <= 0) {
+                cursor.ring = r->next;
+                cursor.stage = uint8_t(cursor.ring != nullptr ? JsonStage::THREAD_NAME : JsonStage::FOOTER);
+                continue;
+            }
+            const Entry &e = r->entries[cursor.next & (AP_TRACE_RING_SIZE - 1)];
+            // widen the 32 bit timestamp relative to when this ring
+            // was started, which is after all the events we output
+            const uint64_t ts = cursor.now64 - uint32_t(uint32_t(cursor.now64) - e.time_us);
+            const char *name = e.id < nnames ? names[e.id] : names[0];
+            n = snprintf(line, sizeof(line), ",\n{\"name\":\"%.64s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":0,\"tid\":%u}",
+                         name, e.event == uint8_t(Event::BEGIN) ? 'B' : 'E',
+                         (unsigned long long)ts, unsigned(r->tid));
+            break;
+        }
+        case JsonStage::FOOTER:
+            n = snprintf(line, sizeof(line), "\n]}\n");
+            break;
+        case JsonStage::DONE:
+            break;
+        }
+        if (n <= 0 || size_t(n) >= sizeof(line)) {
+            // can't happen with the lengths limited above
+            cursor.stage = uint8_t(JsonStage::DONE);
+            break;
+        }
+        if (size_t(n) > bufsize - total) {
+            // the rest goes in the next call
+            break;
+        }
+        memcpy(&buf[total], line, n);
+        total += n;
+
+        // move on to the next line
+        switch (JsonStage(cursor.stage)) {
+        case JsonStage::HEADER:
+            cursor.stage = uint8_t(cursor.ring != nullptr ? JsonStage::THREAD_NAME : JsonStage::FOOTER);
+            break;
+        case JsonStage::THREAD_NAME: {
+            cursor.first = false;
+            cursor.head = r->head.load(std::memory_order_acquire);
+            cursor.now64 = AP_HAL::micros64();
+            const uint32_t count = cursor.head < AP_TRACE_RING_SIZE ? cursor.head : AP_TRACE_RING_SIZE;
+            cursor.next = cursor.head - count;
+            cursor.stage = uint8_t(JsonStage::EVENTS);
+            break;
+        }
+        case JsonStage::EVENTS:
+            cursor.next++;
+            break;
+        case JsonStage::FOOTER:
+        case JsonStage::DONE:
+            cursor.stage = uint8_t(JsonStage::DONE);
+            break;
+        }
+    }
+
+    return total;
+}
+
+} // namespace Trace
+} // namespace AP_HAL
+
+#endif // AP_TRACE_ENABLED
@@ -0,0 +1,126 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  low overhead timeline tracing
+
+  Each thread records begin/end events into its own ring, so recording
+  takes no locks. The rings can be dumped as Chrome trace JSON (which
+  Perfetto also loads) to see what every thread was doing over the
+  last few thousand events.
+
+  Nothing is recorded until tracing is enabled, and a thread only gets
+  a ring the first time it records while tracing is enabled.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef AP_TRACE_ENABLED
+#define AP_TRACE_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
+
+// events kept per thread, must be a power of 2
+#ifndef AP_TRACE_RING_SIZE
+#define AP_TRACE_RING_SIZE 4096U
+#endif
+
+// maximum number of distinct event names
+#ifndef AP_TRACE_MAX_NAMES
+#define AP_TRACE_MAX_NAMES 256U
+#endif
+
+namespace AP_HAL {
+namespace Trace {
+
+enum class Event : uint8_t {
+    BEGIN = 0,
+    END   = 1,
+};
+
+#if AP_TRACE_ENABLED
+
+struct Ring;
+
+// position in the Chrome trace JSON output, so it can be produced a
+// piece at a time
+struct JsonCursor {
+    uint64_t now64;
+    Ring *ring;
+    uint32_t next;  // next event to output from ring
+    uint32_t head;  // head of ring when its output started
+    uint8_t stage;
+    bool first;     // nothing output after the header yet
+};
+
+// turn recording on or off
+void set_enabled(bool enabled);
+bool enabled(void);
+
+// return an id for a name, registering it if needed. The name must
+// remain valid for the life of the program. Returns 0 (the
+// "unknown" name) when the table is full
+uint16_t register_name(const char *name);
+
+// record an event on the calling thread's ring
+void record(Event event, uint16_t id);
+
+// start rendering the rings as Chrome trace JSON
+void chrome_json_start(JsonCursor &cursor);
+
+// render the next whole lines of Chrome trace JSON that fit in buf,
+// returning the length written, which is 0 once the output is done.
+// bufsize must be at least chrome_json_min_buf bytes
+size_t chrome_json_read(JsonCursor &cursor, char *buf, size_t bufsize);
+
+static const size_t chrome_json_min_buf = 128;
+
+#else
+
+static inline void set_enabled(bool enabled) {}
+static inline bool enabled(void) { return false; }
+static inline uint16_t register_name(const char *name) { return 0; }
+static inline void record(Event event, uint16_t id) {}
+
+#endif // AP_TRACE_ENABLED
+
+static inline void begin(uint16_t id) { record(Event::BEGIN, id); }
+static inline void end(uint16_t id) { record(Event::END, id); }
+
+// records a begin/end pair around a scope
+class Scope {
+public:
+    Scope(uint16_t id) : _id(id) { begin(_id); }
+    ~Scope() { end(_id); }
+
+    Scope(const Scope &other) = delete;
+    Scope &operator=(const Scope&) = delete;
+
+private:
+    const uint16_t _id;
+};
+
+} // namespace Trace
+} // namespace AP_HAL
+
+/*
+  trace the rest of the current scope under a fixed name, registering
+  the name the first time the scope is entered. Only one may be used
+  per scope
+ */
+#define AP_TRACE_SCOPE(name) \
+    static const uint16_t _ap_trace_id = AP_HAL::Trace::register_name(name); \
+    AP_HAL::Trace::Scope _ap_trace_scope(_ap_trace_id)
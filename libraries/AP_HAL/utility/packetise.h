@@ -5,3 +5,8 @@
 */
 uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n);
 
+/*
+  as above, for n bytes of data in a linear buffer
+*/
+uint16_t mavlink_packetise(const uint8_t *buf, uint16_t n);
+
@@ -252,6 +252,13 @@ void Storage::_timer_tick(void)
     }
     if (_dirty_mask.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#ifdef STORAGE_FLASH_PAGE
+        if (_initialisedType == StorageBackend::Flash) {
+            // nothing to write, so use the time to free the full
+            // sector, avoiding a long stall in a later write
+            _flash.compact_step();
+        }
+#endif
         return;
     }
 
@@ -277,6 +277,11 @@ void _usage(void)
     printf("\tcustom storage path:\n");
     printf("\t                   --storage-directory /var/APM/storage\n");
     printf("\t                   -s /var/APM/storage\n");
+    printf("\tCPU affinity (class=cpus:..., classes main, timer, uart, rcin, io, logger, worker, *):\n");
+    printf("\t                   --cpu-affinity main=3:timer=2:uart=1:rcin=1:io=0:worker=0-1\n");
+    printf("\t                   driver threads use the class matching their priority,\n");
+    printf("\t                   SPI, I2C and scripting threads use worker\n");
+    printf("\t                   -c 1-3\n");
 #if AP_MODULE_SUPPORTED
     printf("\tmodule support:\n");
     printf("\t                   --module-directory %s\n", AP_MODULE_DEFAULT_DIRECTORY);
@@ -306,11 +311,12 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         {"terrain-directory",   true,  0, 't'},
         {"storage-directory",   true,  0, 's'},
         {"module-directory",    true,  0, 'M'},
+        {"cpu-affinity",        true,  0, 'c'},
         {"help",                false,  0, 'h'},
         {0, false, 0, 0}
     };
 
-    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:",
+    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:c:",
                     options);
 
     /*
@@ -351,6 +357,11 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         case 's':
             utilInstance.set_custom_storage_directory(gopt.optarg);
             break;
+        case 'c':
+            if (!schedulerInstance.set_cpu_affinity(gopt.optarg)) {
+                exit(1);
+            }
+            break;
 #if AP_MODULE_SUPPORTED
         case 'M':
             module_path = gopt.optarg;
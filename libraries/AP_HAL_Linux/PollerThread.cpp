@@ -116,6 +116,20 @@ bool PollerThread::adjust_timer(TimerPollable *p, uint32_t timeout_usec)
     return (*it)->adjust_timer(timeout_usec);
 }
 
+bool PollerThread::register_pollable(Pollable *p, uint32_t events)
+{
+    if (!_poller) {
+        return false;
+    }
+
+    return _poller.register_pollable(p, events);
+}
+
+void PollerThread::unregister_pollable(const Pollable *p)
+{
+    _poller.unregister_pollable(p);
+}
+
 void PollerThread::_cleanup_timers()
 {
     if (!_poller) {
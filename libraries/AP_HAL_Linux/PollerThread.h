@@ -70,6 +70,13 @@ public:
                              uint32_t timeout_usec);
     bool adjust_timer(TimerPollable *p, uint32_t timeout_usec);
 
+    /*
+     * Watch a file descriptor from this thread. The Pollable callbacks
+     * run on this thread.
+     */
+    bool register_pollable(Pollable *p, uint32_t events);
+    void unregister_pollable(const Pollable *p);
+
     void mainloop();
 
     bool stop() override;
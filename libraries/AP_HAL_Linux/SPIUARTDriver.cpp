@@ -136,6 +136,44 @@ int SPIUARTDriver::_read_fd(uint8_t *buf, uint16_t n)
     return n;
 }
 
+ssize_t SPIUARTDriver::_writev_fd(const struct iovec *iov, int iovcnt)
+{
+    if (_external) {
+        return UARTDriver::_writev_fd(iov, iovcnt);
+    }
+
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const int ret = _write_fd((const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+        if (ret <= 0) {
+            break;
+        }
+        total += ret;
+    }
+    return total;
+}
+
+ssize_t SPIUARTDriver::_readv_fd(const struct iovec *iov, int iovcnt)
+{
+    if (_external) {
+        return UARTDriver::_readv_fd(iov, iovcnt);
+    }
+
+    ssize_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        const int ret = _read_fd((uint8_t *)iov[i].iov_base, iov[i].iov_len);
+        if (ret <= 0) {
+            break;
+        }
+        total += ret;
+        /* _read_fd() limits the transfer size */
+        if ((size_t)ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    return total;
+}
+
 void SPIUARTDriver::_timer_tick(void)
 {
     if (_external) {
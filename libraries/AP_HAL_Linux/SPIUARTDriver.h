@@ -15,6 +15,11 @@ public:
 protected:
     int _write_fd(const uint8_t *buf, uint16_t n) override;
     int _read_fd(uint8_t *buf, uint16_t n) override;
+    ssize_t _writev_fd(const struct iovec *iov, int iovcnt) override;
+    ssize_t _readv_fd(const struct iovec *iov, int iovcnt) override;
+
+    // SPI transfers are always polled
+    int _pollable_fd() override { return _external ? UARTDriver::_pollable_fd() : -1; }
 
     AP_HAL::OwnPtr<AP_HAL::SPIDevice> _dev;
 
@@ -1,15 +1,19 @@
 #include "Scheduler.h"
 
 #include <algorithm>
+#include <alloca.h>
 #include <errno.h>
+#include <malloc.h>
 #include <poll.h>
 #include <stdio.h>
+#include <sys/epoll.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/Trace.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
@@ -52,6 +56,7 @@ extern const AP_HAL::HAL& hal;
         .policy = SCHED_FIFO,                                   \
         .prio = APM_LINUX_##UPPER_NAME_##_PRIORITY,             \
         .rate = APM_LINUX_##UPPER_NAME_##_RATE,                 \
+        .thread_class = ThreadClass::UPPER_NAME_,               \
     }
 
 Scheduler::Scheduler()
@@ -73,6 +78,7 @@ void Scheduler::init_realtime()
 #endif
 
     mlockall(MCL_CURRENT|MCL_FUTURE);
+    prefault_memory();
 
     struct sched_param param = { .sched_priority = APM_LINUX_MAIN_PRIORITY };
     if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == -1) {
@@ -81,6 +87,273 @@ void Scheduler::init_realtime()
     }
 }
 
+/*
+  touch the main thread stack and a block of heap so the pages are
+  faulted in and locked before the main loop starts. Thread stacks are
+  mapped after mlockall(MCL_FUTURE) so they are populated on creation
+ */
+void Scheduler::prefault_memory()
+{
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+
+    // don't give freed heap back to the kernel, otherwise it has to be
+    // faulted in again the next time it is allocated
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    volatile uint8_t *heap = (volatile uint8_t *)malloc(LINUX_SCHEDULER_PREFAULT_HEAP_SIZE);
+    if (heap != nullptr) {
+        for (size_t i = 0; i < LINUX_SCHEDULER_PREFAULT_HEAP_SIZE; i += page_size) {
+            heap[i] = 0;
+        }
+        free((void *)heap);
+    }
+
+    volatile uint8_t *stack = (volatile uint8_t *)alloca(LINUX_SCHEDULER_PREFAULT_STACK_SIZE);
+    for (size_t i = 0; i < LINUX_SCHEDULER_PREFAULT_STACK_SIZE; i += page_size) {
+        stack[i] = 0;
+    }
+}
+
+/*
+  parse a CPU list like "0-2,5"
+ */
+static bool parse_cpu_list(const char *list, cpu_set_t &cpus)
+{
+    const long num_cpus = sysconf(_SC_NPROCESSORS_CONF);
+
+    CPU_ZERO(&cpus);
+    while (*list) {
+        char *end;
+        const unsigned long first = strtoul(list, &end, 10);
+        unsigned long last = first;
+        if (end == list) {
+            return false;
+        }
+        if (*end == '-') {
+            list = end + 1;
+            last = strtoul(list, &end, 10);
+            if (end == list || last < first) {
+                return false;
+            }
+        }
+        if (last >= CPU_SETSIZE || (long)last >= num_cpus) {
+            return false;
+        }
+        for (unsigned long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &cpus);
+        }
+        if (*end == ',' && end[1] != '\0') {
+            end++;
+        } else if (*end != '\0') {
+            return false;
+        }
+        list = end;
+    }
+
+    return CPU_COUNT(&cpus) > 0;
+}
+
+/*
+  format a CPU set as a list like "0-2,5"
+ */
+static void format_cpu_list(const cpu_set_t &cpus, char *buf, size_t bufsize)
+{
+    size_t len = 0;
+    buf[0] = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE && len < bufsize; cpu++) {
+        if (!CPU_ISSET(cpu, &cpus)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpus)) {
+            last++;
+        }
+        int n;
+        if (last == cpu) {
+            n = snprintf(&buf[len], bufsize - len, "%s%d", len ? "," : "", cpu);
+        } else {
+            n = snprintf(&buf[len], bufsize - len, "%s%d-%d", len ? "," : "", cpu, last);
+        }
+        if (n < 0) {
+            break;
+        }
+        len += n;
+        cpu = last;
+    }
+    if (len == 0 && bufsize > 1) {
+        strncpy(buf, "-", bufsize);
+    }
+}
+
+/*
+  set the CPU affinity profile. The spec is a list of class=cpus entries
+  separated by ':', e.g. "main=3:timer=2:uart=1:rcin=1:io=0:worker=0-1".
+  A "*" class, or a bare CPU list, is used for all classes not given
+  explicitly
+ */
+bool Scheduler::set_cpu_affinity(const char *spec)
+{
+    static const struct {
+        const char *name;
+        ThreadClass thread_class;
+    } class_names[] = {
+        { "main",   ThreadClass::MAIN },
+        { "timer",  ThreadClass::TIMER },
+        { "uart",   ThreadClass::UART },
+        { "rcin",   ThreadClass::RCIN },
+        { "io",     ThreadClass::IO },
+        // the logger does its file IO on the io thread
+        { "logger", ThreadClass::IO },
+        { "worker", ThreadClass::WORKER },
+        { "*",      ThreadClass::ANY },
+    };
+
+    char *s = strdup(spec);
+    if (s == nullptr) {
+        return false;
+    }
+
+    bool ret = true;
+    char *saveptr = nullptr;
+    for (char *entry = strtok_r(s, ":", &saveptr);
+         entry != nullptr;
+         entry = strtok_r(nullptr, ":", &saveptr)) {
+        ThreadClass thread_class = ThreadClass::ANY;
+        const char *list = entry;
+        char *eq = strchr(entry, '=');
+        if (eq != nullptr) {
+            *eq = 0;
+            list = eq + 1;
+            bool found = false;
+            for (uint8_t i = 0; i < ARRAY_SIZE(class_names); i++) {
+                if (strcmp(entry, class_names[i].name) == 0) {
+                    thread_class = class_names[i].thread_class;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                fprintf(stderr, "Unknown thread class '%s' in CPU affinity\n", entry);
+                ret = false;
+                break;
+            }
+        }
+        cpu_set_t cpus;
+        if (!parse_cpu_list(list, cpus)) {
+            fprintf(stderr, "Invalid CPU list '%s' in CPU affinity\n", list);
+            ret = false;
+            break;
+        }
+        _affinity[(uint8_t)thread_class] = cpus;
+        _affinity_set[(uint8_t)thread_class] = true;
+    }
+
+    free(s);
+    return ret;
+}
+
+const cpu_set_t *Scheduler::cpus_for(ThreadClass c) const
+{
+    if (_affinity_set[(uint8_t)c]) {
+        return &_affinity[(uint8_t)c];
+    }
+    if (_affinity_set[(uint8_t)ThreadClass::ANY]) {
+        return &_affinity[(uint8_t)ThreadClass::ANY];
+    }
+    return nullptr;
+}
+
+void Scheduler::apply_affinity(Thread &thread, ThreadClass c)
+{
+    const cpu_set_t *cpus = cpus_for(c);
+    if (cpus != nullptr) {
+        thread.set_cpu_affinity(*cpus);
+    }
+}
+
+/*
+  remember the CPUs a thread asked for and got. Returns the slot
+  used, so the CPUs it got can be filled in later, or -1 if there is
+  no room
+ */
+int8_t Scheduler::record_affinity(const char *name, ThreadClass c, const cpu_set_t *achieved)
+{
+    WITH_SEMAPHORE(_affinity_sem);
+
+    if (_num_affinity_records >= ARRAY_SIZE(_affinity_records)) {
+        return -1;
+    }
+    const int8_t slot = _num_affinity_records++;
+    AffinityRecord &r = _affinity_records[slot];
+    strncpy(r.name, name, sizeof(r.name) - 1);
+    const cpu_set_t *requested = cpus_for(c);
+    r.has_request = requested != nullptr;
+    if (r.has_request) {
+        r.requested = *requested;
+    }
+    r.has_achieved = achieved != nullptr;
+    if (r.has_achieved) {
+        r.achieved = *achieved;
+        print_affinity(r);
+    } else {
+        CPU_ZERO(&r.achieved);
+    }
+    return slot;
+}
+
+void Scheduler::record_achieved_affinity(int8_t slot, const cpu_set_t &achieved)
+{
+    WITH_SEMAPHORE(_affinity_sem);
+
+    if (slot < 0 || slot >= _num_affinity_records) {
+        return;
+    }
+    AffinityRecord &r = _affinity_records[slot];
+    r.achieved = achieved;
+    r.has_achieved = true;
+    print_affinity(r);
+}
+
+void Scheduler::print_affinity(const AffinityRecord &r) const
+{
+    if (r.has_request) {
+        char req[64], got[64];
+        format_cpu_list(r.requested, req, sizeof(req));
+        format_cpu_list(r.achieved, got, sizeof(got));
+        printf("CPU affinity: %s requested %s got %s%s\n", r.name, req, got,
+               CPU_EQUAL(&r.requested, &r.achieved) ? "" : " (MISMATCH)");
+    }
+}
+
+size_t Scheduler::cpu_affinity_report(char *buf, size_t bufsize)
+{
+    WITH_SEMAPHORE(_affinity_sem);
+
+    int total = hal.util->snprintf(buf, bufsize, "AffinityV1\n");
+    for (uint8_t i = 0; i < _num_affinity_records && total >= 0 && (size_t)total < bufsize; i++) {
+        const AffinityRecord &r = _affinity_records[i];
+        char req[64], got[64];
+        if (r.has_request) {
+            format_cpu_list(r.requested, req, sizeof(req));
+        } else {
+            strncpy(req, "any", sizeof(req));
+        }
+        if (r.has_achieved) {
+            format_cpu_list(r.achieved, got, sizeof(got));
+        } else {
+            strncpy(got, "unknown", sizeof(got));
+        }
+        const int n = hal.util->snprintf(&buf[total], bufsize - total, "%-15s req=%-12s cpus=%s\n",
+                                         r.name, req, got);
+        if (n < 0) {
+            break;
+        }
+        total += n;
+    }
+    return MIN((size_t)MAX(total, 0), bufsize);
+}
+
 void Scheduler::init()
 {
     int ret;
@@ -90,9 +363,9 @@ void Scheduler::init()
         int policy;
         int prio;
         uint32_t rate;
+        ThreadClass thread_class;
     } sched_table[] = {
         SCHED_THREAD(timer, TIMER),
-        SCHED_THREAD(uart, UART),
         SCHED_THREAD(rcin, RCIN),
         SCHED_THREAD(io, IO),
     };
@@ -101,8 +374,39 @@ void Scheduler::init()
 
     init_realtime();
 
-    /* set barrier to N + 1 threads: worker threads + main */
-    unsigned n_threads = ARRAY_SIZE(sched_table) + 1;
+    if (_affinity_set[(uint8_t)ThreadClass::MAIN] &&
+        !_affinity_set[(uint8_t)ThreadClass::ANY]) {
+        /*
+          isolate the main thread: threads without their own entry get
+          the CPUs we started with minus the main thread's CPUs, if that
+          leaves any
+         */
+        cpu_set_t others;
+        if (sched_getaffinity(0, sizeof(others), &others) == 0) {
+            const cpu_set_t started_with = others;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &_affinity[(uint8_t)ThreadClass::MAIN])) {
+                    CPU_CLR(cpu, &others);
+                }
+            }
+            _affinity[(uint8_t)ThreadClass::ANY] = CPU_COUNT(&others) > 0 ? others : started_with;
+            _affinity_set[(uint8_t)ThreadClass::ANY] = true;
+        }
+    }
+
+    const cpu_set_t *main_cpus = cpus_for(ThreadClass::MAIN);
+    if (main_cpus != nullptr &&
+        (ret = pthread_setaffinity_np(_main_ctx, sizeof(*main_cpus), main_cpus)) != 0) {
+        // a bad affinity setting shouldn't stop the vehicle flying
+        printf("Scheduler: failed to set main thread CPU affinity, leaving it unpinned: %s\n",
+               strerror(ret));
+    }
+    cpu_set_t achieved;
+    record_affinity("ap-main", ThreadClass::MAIN,
+                    pthread_getaffinity_np(_main_ctx, sizeof(achieved), &achieved) == 0 ? &achieved : nullptr);
+
+    /* set barrier to N + 2 threads: worker threads + uart + main */
+    unsigned n_threads = ARRAY_SIZE(sched_table) + 2;
     ret = pthread_barrier_init(&_initialized_barrier, nullptr, n_threads);
     if (ret) {
         AP_HAL::panic("Scheduler: Failed to initialise barrier object: %s",
@@ -114,8 +418,25 @@ void Scheduler::init()
 
         t->thread->set_rate(t->rate);
         t->thread->set_stack_size(1024 * 1024);
+        apply_affinity(*t->thread, t->thread_class);
         t->thread->start(t->name, t->policy, t->prio);
+        record_affinity(t->name, t->thread_class,
+                        t->thread->get_cpu_affinity(achieved) ? &achieved : nullptr);
+    }
+
+    /*
+      the uart thread waits for the devices to become readable, with a
+      timer to flush writes and poll devices that can't be waited on
+     */
+    if (_uart_thread.add_timer(FUNCTOR_BIND_MEMBER(&Scheduler::_uart_task, void), nullptr,
+                               AP_USEC_PER_SEC / APM_LINUX_UART_RATE) == nullptr) {
+        AP_HAL::panic("Scheduler: failed to create uart timer");
     }
+    _uart_thread.set_stack_size(1024 * 1024);
+    apply_affinity(_uart_thread, ThreadClass::UART);
+    _uart_thread.start("ap-uart", SCHED_FIFO, APM_LINUX_UART_PRIORITY);
+    record_affinity("ap-uart", ThreadClass::UART,
+                    _uart_thread.get_cpu_affinity(achieved) ? &achieved : nullptr);
 
 #if defined(DEBUG_STACK) && DEBUG_STACK
     register_timer_process(FUNCTOR_BIND_MEMBER(&Scheduler::_debug_stack, void));
@@ -220,6 +541,8 @@ void Scheduler::_timer_task()
     }
     _in_timer_proc = true;
 
+    AP_TRACE_SCOPE("timer");
+
     // now call the timer based drivers
     for (i = 0; i < _num_timer_procs; i++) {
         if (_timer_proc[i]) {
@@ -239,6 +562,8 @@ void Scheduler::_run_io(void)
 {
     _io_semaphore.take_blocking();
 
+    AP_TRACE_SCOPE("io");
+
     // now call the IO based drivers
     for (int i = 0; i < _num_io_procs; i++) {
         if (_io_proc[i]) {
@@ -254,6 +579,8 @@ void Scheduler::_run_io(void)
  */
 void Scheduler::_run_uarts()
 {
+    AP_TRACE_SCOPE("uart");
+
     // process any pending serial bytes
     hal.uartA->_timer_tick();
     hal.uartB->_timer_tick();
@@ -267,6 +594,7 @@ void Scheduler::_run_uarts()
 
 void Scheduler::_rcin_task()
 {
+    AP_TRACE_SCOPE("rcin");
     RCInput::from(hal.rcin)->_timer_tick();
 }
 
@@ -310,6 +638,8 @@ void Scheduler::system_initialized()
 
 void Scheduler::reboot(bool hold_in_bootloader)
 {
+    // don't lose writes that are waiting for the storage flush policy
+    hal.storage->flush();
     exit(1);
 }
 
@@ -340,6 +670,33 @@ bool Scheduler::SchedulerThread::_run()
     return PeriodicThread::_run();
 }
 
+bool Scheduler::WorkerThread::_run()
+{
+    cpu_set_t achieved;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(achieved), &achieved) == 0) {
+        _sched.record_achieved_affinity(_affinity_slot, achieved);
+    }
+
+    return Thread::_run();
+}
+
+bool Scheduler::SchedulerPollerThread::_run()
+{
+    _sched._wait_all_threads();
+
+    return PollerThread::_run();
+}
+
+bool Scheduler::register_uart_pollable(Pollable *p)
+{
+    return _uart_thread.register_pollable(p, EPOLLIN | EPOLLOUT | EPOLLET);
+}
+
+void Scheduler::unregister_uart_pollable(const Pollable *p)
+{
+    _uart_thread.unregister_pollable(p);
+}
+
 void Scheduler::teardown()
 {
     _timer_thread.stop();
@@ -358,35 +715,50 @@ void Scheduler::teardown()
 */
 bool Scheduler::thread_create(AP_HAL::MemberProc proc, const char *name, uint32_t stack_size, priority_base base, int8_t priority)
 {
-    Thread *thread = new Thread{(Thread::task_t)proc};
-    if (!thread) {
-        return false;
-    }
-
     uint8_t thread_priority = APM_LINUX_IO_PRIORITY;
+    ThreadClass thread_class = ThreadClass::WORKER;
+    /*
+      threads created by drivers share the CPUs of the scheduler
+      thread they stand in for, so a timer or uart bus thread runs
+      alongside the timer or uart thread. SPI, I2C, scripting and
+      anything else runs on the worker CPUs
+     */
     static const struct {
         priority_base base;
         uint8_t p;
+        ThreadClass c;
     } priority_map[] = {
-        { PRIORITY_BOOST, APM_LINUX_MAIN_PRIORITY},
-        { PRIORITY_MAIN, APM_LINUX_MAIN_PRIORITY},
-        { PRIORITY_SPI, AP_LINUX_SENSORS_SCHED_PRIO},
-        { PRIORITY_I2C, AP_LINUX_SENSORS_SCHED_PRIO},
-        { PRIORITY_CAN, APM_LINUX_TIMER_PRIORITY},
-        { PRIORITY_TIMER, APM_LINUX_TIMER_PRIORITY},
-        { PRIORITY_RCIN, APM_LINUX_RCIN_PRIORITY},
-        { PRIORITY_IO, APM_LINUX_IO_PRIORITY},
-        { PRIORITY_UART, APM_LINUX_UART_PRIORITY},
-        { PRIORITY_STORAGE, APM_LINUX_IO_PRIORITY},
-        { PRIORITY_SCRIPTING, APM_LINUX_SCRIPTING_PRIORITY},
+        { PRIORITY_BOOST, APM_LINUX_MAIN_PRIORITY, ThreadClass::WORKER},
+        { PRIORITY_MAIN, APM_LINUX_MAIN_PRIORITY, ThreadClass::WORKER},
+        { PRIORITY_SPI, AP_LINUX_SENSORS_SCHED_PRIO, ThreadClass::WORKER},
+        { PRIORITY_I2C, AP_LINUX_SENSORS_SCHED_PRIO, ThreadClass::WORKER},
+        { PRIORITY_CAN, APM_LINUX_TIMER_PRIORITY, ThreadClass::TIMER},
+        { PRIORITY_TIMER, APM_LINUX_TIMER_PRIORITY, ThreadClass::TIMER},
+        { PRIORITY_RCIN, APM_LINUX_RCIN_PRIORITY, ThreadClass::RCIN},
+        { PRIORITY_IO, APM_LINUX_IO_PRIORITY, ThreadClass::IO},
+        { PRIORITY_UART, APM_LINUX_UART_PRIORITY, ThreadClass::UART},
+        { PRIORITY_STORAGE, APM_LINUX_IO_PRIORITY, ThreadClass::IO},
+        { PRIORITY_SCRIPTING, APM_LINUX_SCRIPTING_PRIORITY, ThreadClass::WORKER},
     };
     for (uint8_t i=0; i<ARRAY_SIZE(priority_map); i++) {
         if (priority_map[i].base == base) {
             thread_priority = constrain_int16(priority_map[i].p + priority, 1, APM_LINUX_MAX_PRIORITY);
+            thread_class = priority_map[i].c;
             break;
         }
     }
 
+    /*
+      the thread frees itself and may be gone by the time start()
+      returns, so it fills in the CPUs it got from inside
+     */
+    const int8_t affinity_slot = record_affinity(name, thread_class, nullptr);
+
+    Thread *thread = new WorkerThread{(Thread::task_t)proc, *this, affinity_slot};
+    if (!thread) {
+        return false;
+    }
+
     // Add 256k to HAL-independent requested stack size
     thread->set_stack_size(256 * 1024 + stack_size);
 
@@ -396,6 +768,8 @@ bool Scheduler::thread_create(AP_HAL::MemberProc proc, const char *name, uint32_
      */
     thread->set_auto_free(true);
 
+    apply_affinity(*thread, thread_class);
+
     if (!thread->start(name, SCHED_FIFO, thread_priority)) {
         delete thread;
         return false;
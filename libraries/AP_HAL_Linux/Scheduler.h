@@ -4,6 +4,7 @@
 
 #include "AP_HAL_Linux.h"
 
+#include "PollerThread.h"
 #include "Semaphores.h"
 #include "Thread.h"
 
@@ -15,6 +16,14 @@
 #define AP_LINUX_SENSORS_SCHED_POLICY  SCHED_FIFO
 #define AP_LINUX_SENSORS_SCHED_PRIO 12
 
+// number of threads recorded in the CPU affinity report
+#define LINUX_SCHEDULER_MAX_AFFINITY_RECORDS 16
+
+// amount of main thread stack and heap touched at startup so that
+// page faults don't happen in the main loop
+#define LINUX_SCHEDULER_PREFAULT_STACK_SIZE (256 * 1024)
+#define LINUX_SCHEDULER_PREFAULT_HEAP_SIZE  (1024 * 1024)
+
 namespace Linux {
 
 class Scheduler : public AP_HAL::Scheduler {
@@ -52,8 +61,47 @@ public:
       create a new thread
      */
     bool thread_create(AP_HAL::MemberProc, const char *name, uint32_t stack_size, priority_base base, int8_t priority) override;
-    
+
+    /*
+      set the CPU affinity profile, see _usage() in HAL_Linux_Class.cpp
+      for the format. Must be called before init()
+     */
+    bool set_cpu_affinity(const char *spec);
+
+    /*
+      text report of the CPUs each thread was asked for and the CPUs
+      the kernel actually allowed
+     */
+    size_t cpu_affinity_report(char *buf, size_t bufsize);
+
+    /*
+      watch a UART device from the uart thread. Events are edge
+      triggered, see UARTDriver::_fill_read_buffer()
+     */
+    bool register_uart_pollable(Pollable *p);
+    void unregister_uart_pollable(const Pollable *p);
+
 private:
+    // threads that can be given their own set of CPUs
+    enum class ThreadClass : uint8_t {
+        MAIN,
+        TIMER,
+        UART,
+        RCIN,
+        IO,
+        WORKER,
+        ANY,    // default for classes not given explicitly
+        NUM
+    };
+
+    struct AffinityRecord {
+        char name[16];
+        cpu_set_t requested;
+        cpu_set_t achieved;
+        bool has_request;
+        bool has_achieved;
+    };
+
     class SchedulerThread : public PeriodicThread {
     public:
         SchedulerThread(Thread::task_t t, Scheduler &sched)
@@ -67,7 +115,46 @@ private:
         Scheduler &_sched;
     };
 
+    /*
+      a thread from thread_create(). It reports the CPUs it got from
+      inside the thread, as it may already have finished and been
+      freed by the time start() returns
+     */
+    class WorkerThread : public Thread {
+    public:
+        WorkerThread(Thread::task_t t, Scheduler &sched, int8_t affinity_slot)
+            : Thread(t)
+            , _sched(sched)
+            , _affinity_slot(affinity_slot)
+        { }
+
+    protected:
+        bool _run() override;
+
+        Scheduler &_sched;
+        const int8_t _affinity_slot;
+    };
+
+    class SchedulerPollerThread : public PollerThread {
+    public:
+        SchedulerPollerThread(Scheduler &sched)
+            : _sched(sched)
+        { }
+
+    protected:
+        bool _run() override;
+
+        Scheduler &_sched;
+    };
+
     void     init_realtime();
+    void     prefault_memory();
+
+    const cpu_set_t *cpus_for(ThreadClass c) const;
+    void     apply_affinity(Thread &thread, ThreadClass c);
+    int8_t   record_affinity(const char *name, ThreadClass c, const cpu_set_t *achieved);
+    void     record_achieved_affinity(int8_t slot, const cpu_set_t &achieved);
+    void     print_affinity(const AffinityRecord &r) const;
 
     void _wait_all_threads();
 
@@ -88,7 +175,7 @@ private:
     SchedulerThread _timer_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_timer_task, void), *this};
     SchedulerThread _io_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_io_task, void), *this};
     SchedulerThread _rcin_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_rcin_task, void), *this};
-    SchedulerThread _uart_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_uart_task, void), *this};
+    SchedulerPollerThread _uart_thread{*this};
 
     void _timer_task();
     void _io_task();
@@ -103,6 +190,13 @@ private:
     pthread_t _main_ctx;
 
     Semaphore _io_semaphore;
+
+    cpu_set_t _affinity[(uint8_t)ThreadClass::NUM];
+    bool _affinity_set[(uint8_t)ThreadClass::NUM];
+
+    AffinityRecord _affinity_records[LINUX_SCHEDULER_MAX_AFFINITY_RECORDS];
+    uint8_t _num_affinity_records;
+    Semaphore _affinity_sem;
 };
 
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <AP_HAL/AP_HAL_Macros.h>
 #include <AP_HAL/Semaphores.h>
+#include <AP_HAL/utility/SemProfile.h>
 #include <pthread.h>
 
 namespace Linux {
@@ -15,7 +16,11 @@ public:
     bool take(uint32_t timeout_ms) override;
     bool take_nonblocking() override;
 protected:
+    bool take_contended(uint32_t timeout_ms);
     pthread_mutex_t _lock;
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    AP_HAL::SemProfile::Tracker _profile;
+#endif
 };
 
 }
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <errno.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <sys/uio.h>
+
+#include <AP_HAL/utility/DatagramBatch.h>
+#include <AP_HAL/utility/RingBuffer.h>
 
 #include "AP_HAL_Linux.h"
 
@@ -13,6 +18,61 @@ public:
     virtual bool close() = 0;
     virtual ssize_t write(const uint8_t *buf, uint16_t n) = 0;
     virtual ssize_t read(uint8_t *buf, uint16_t n) = 0;
+
+    /*
+     * Vectored versions of read() and write() so both parts of a ring
+     * buffer can be transferred at once. Devices backed by a single file
+     * descriptor override these with readv()/writev().
+     */
+    virtual ssize_t readv(const struct iovec *iov, int iovcnt)
+    {
+        ssize_t total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            const ssize_t ret = read((uint8_t *)iov[i].iov_base, iov[i].iov_len);
+            if (ret <= 0) {
+                return total > 0 ? total : ret;
+            }
+            total += ret;
+            if ((size_t)ret < iov[i].iov_len) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    virtual ssize_t writev(const struct iovec *iov, int iovcnt)
+    {
+        ssize_t total = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            const ssize_t ret = write((const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+            if (ret <= 0) {
+                return total > 0 ? total : ret;
+            }
+            total += ret;
+            if ((size_t)ret < iov[i].iov_len) {
+                break;
+            }
+        }
+        return total;
+    }
+
+    /*
+     * File descriptor that becomes readable when there is data to be
+     * read, or -1 if the device has to be polled. It can change while
+     * the device is open, e.g. when a TCP client connects.
+     */
+    virtual int get_fd() { return -1; }
+
+    /*
+     * Datagram devices can send several MAVLink packets from @buf per
+     * system call, one packet per datagram. Sent bytes are removed from
+     * @buf. Returns the number of bytes sent or -1 with errno set.
+     */
+    virtual bool can_send_packets() const { return false; }
+    virtual ssize_t send_packets(ByteBuffer &buf) { errno = ENOTSUP; return -1; }
+
+    /* datagram statistics, nullptr if the device isn't packet based */
+    virtual const DatagramBatch::Stats *get_packet_stats() const { return nullptr; }
     virtual void set_blocking(bool blocking) = 0;
     virtual void set_speed(uint32_t speed) = 0;
     virtual AP_HAL::UARTDriver::flow_control get_flow_control(void) { return AP_HAL::UARTDriver::FLOW_CONTROL_ENABLE; }
@@ -9,6 +9,7 @@
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
 using namespace Linux;
@@ -141,8 +142,6 @@ void Storage::init()
         return;
     }
 
-    _dirty_mask = 0;
-
     dpath = hal.util->get_custom_storage_directory();
     if (!dpath) {
         dpath = HAL_BOARD_STORAGE_DIRECTORY;
@@ -170,30 +169,11 @@ void Storage::init()
         }
     }
 
+    _path = dpath;
     _fd = fd;
     _initialised = true;
 }
 
-/*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
- */
-void Storage::_mark_dirty(uint16_t loc, uint16_t length)
-{
-    if (length == 0) {
-        return;
-    }
-    uint16_t end = loc + length - 1;
-    for (uint8_t line=loc>>LINUX_STORAGE_LINE_SHIFT;
-         line <= end>>LINUX_STORAGE_LINE_SHIFT;
-         line++) {
-        _dirty_mask |= 1U << line;
-    }
-}
-
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
 {
     if (loc >= sizeof(_buffer)-(n-1)) {
@@ -210,59 +190,95 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
     }
     if (memcmp(src, &_buffer[loc], n) != 0) {
         init();
-        memcpy(&_buffer[loc], src, n);
-        _mark_dirty(loc, n);
+        _writeback.write(loc, src, n, AP_HAL::millis());
+    }
+}
+
+/*
+  write a run returned by next_flush(), syncing the file once
+  everything is written. next_flush() has already marked the run
+  clean, so a write to it from the main thread while we are writing
+  leaves it dirty for the next flush
+ */
+bool Storage::_write_run(uint32_t offset, uint32_t length)
+{
+    if (pwrite(_fd, &_buffer[offset], length, offset) != (ssize_t)length) {
+        // write error - likely EINTR
+        _writeback.flush_failed(offset, length);
+        close(_fd);
+        _fd = -1;
+        return false;
+    }
+    if (_writeback.empty()) {
+        if (fsync(_fd) != 0) {
+            close(_fd);
+            _fd = -1;
+            return false;
+        }
+        _writeback.synced();
+    }
+    return true;
+}
+
+/*
+  reopen the file after a write or sync error. Writes before a failed
+  fsync() may not have reached the card, so all of storage is written
+  again
+ */
+void Storage::_reopen(void)
+{
+    const uint32_t now = AP_HAL::millis();
+    if (now - _last_reopen_ms < 1000) {
+        return;
+    }
+    _last_reopen_ms = now;
+    _fd = open(_path, O_RDWR|O_CLOEXEC);
+    if (_fd != -1) {
+        _writeback.mark_all_dirty(now);
     }
 }
 
 void Storage::_timer_tick(void)
 {
-    if (!_initialised || _dirty_mask == 0 || _fd == -1) {
+    if (!_initialised) {
         return;
     }
+    WITH_SEMAPHORE(_flush_sem);
 
-    // write out the first dirty set of lines. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint8_t i, n;
-    for (i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask & (1<<i)) {
-            break;
-        }
+    if (_fd == -1) {
+        _reopen();
+        return;
     }
-    if (i == LINUX_STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+
+    // write out the first run of dirty lines once the writes have
+    // settled. We don't write more than one run to keep the latency
+    // of this call to a minimum
+    uint32_t offset, length;
+    if (_writeback.next_flush(AP_HAL::millis(), offset, length)) {
+        _write_run(offset, length);
+    }
+}
+
+/*
+  write everything now, without waiting for writes to settle
+ */
+void Storage::flush(void)
+{
+    if (!_initialised) {
         return;
     }
-    uint32_t write_mask = (1U<<i);
-    // see how many lines to write
-    for (n=1; (i+n) < LINUX_STORAGE_NUM_LINES &&
-             n < (LINUX_STORAGE_MAX_WRITE>>LINUX_STORAGE_LINE_SHIFT); n++) {
-        if (!(_dirty_mask & (1<<(n+i)))) {
+    WITH_SEMAPHORE(_flush_sem);
+
+    uint32_t offset, length;
+    while (_fd != -1 && _writeback.next_flush(AP_HAL::millis(), offset, length, true)) {
+        if (!_write_run(offset, length)) {
             break;
         }
-        // mark that line clean
-        write_mask |= (1<<(n+i));
     }
+}
 
-    /*
-      write the lines. This also updates _dirty_mask. Note that
-      because this is a SCHED_FIFO thread it will not be preempted
-      by the main task except during blocking calls. This means we
-      don't need a semaphore around the _dirty_mask updates.
-     */
-    if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
-        _dirty_mask &= ~write_mask;
-        if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
-            // write error - likely EINTR
-            _dirty_mask |= write_mask;
-            close(_fd);
-            _fd = -1;
-        }
-        if (_dirty_mask == 0) {
-            if (fsync(_fd) != 0) {
-                close(_fd);
-                _fd = -1;
-            }
-        }
-    }
+size_t Storage::get_stats(char *buf, size_t bufsize)
+{
+    const int n = _writeback.format_stats(buf, bufsize);
+    return MIN((size_t)MAX(n, 0), bufsize);
 }
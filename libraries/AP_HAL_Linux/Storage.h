@@ -1,10 +1,11 @@
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/StorageWriteback.h>
 
 #define LINUX_STORAGE_SIZE HAL_STORAGE_SIZE
-#define LINUX_STORAGE_MAX_WRITE 512
-#define LINUX_STORAGE_LINE_SHIFT 9
+#define LINUX_STORAGE_MAX_WRITE 4096
+#define LINUX_STORAGE_LINE_SHIFT 6
 #define LINUX_STORAGE_LINE_SIZE (1<<LINUX_STORAGE_LINE_SHIFT)
 #define LINUX_STORAGE_NUM_LINES (LINUX_STORAGE_SIZE/LINUX_STORAGE_LINE_SIZE)
 
@@ -13,7 +14,7 @@ namespace Linux {
 class Storage : public AP_HAL::Storage
 {
 public:
-    Storage() : _fd(-1),_dirty_mask(0) { }
+    Storage() : _fd(-1) { }
 
     static Storage *from(AP_HAL::Storage *storage) {
         return static_cast<Storage*>(storage);
@@ -33,15 +34,32 @@ public:
     void write_block(uint16_t dst, const void* src, size_t n) override;
 
     virtual void _timer_tick(void) override;
+    void flush(void) override;
+
+    size_t get_stats(char *buf, size_t bufsize) override;
 
 protected:
-    void _mark_dirty(uint16_t loc, uint16_t length);
     int _storage_create(const char *dpath);
+    bool _write_run(uint32_t offset, uint32_t length);
+    void _reopen(void);
 
+    const char *_path = nullptr;
     int _fd;
+    uint32_t _last_reopen_ms = 0;
+
+    // held while flushing, as flush() may be called from another
+    // thread to the timer tick
+    HAL_Semaphore _flush_sem;
     volatile bool _initialised;
-    volatile uint32_t _dirty_mask;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
+
+    /*
+      flush runs of dirty lines once writes have settled for 100ms, or
+      a second after the first write, rewriting up to one clean line
+      to join two runs
+     */
+    StorageWriteback _writeback{_buffer, sizeof(_buffer), LINUX_STORAGE_LINE_SHIFT,
+        { 100, 1000, LINUX_STORAGE_MAX_WRITE, LINUX_STORAGE_LINE_SIZE }};
 };
 
 }
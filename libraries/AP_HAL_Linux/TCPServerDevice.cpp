@@ -57,6 +57,41 @@ ssize_t TCPServerDevice::read(uint8_t *buf, uint16_t n)
     return ret;
 }
 
+ssize_t TCPServerDevice::writev(const struct iovec *iov, int iovcnt)
+{
+    if (sock == nullptr) {
+        // no client yet
+        errno = ENOTCONN;
+        return -1;
+    }
+    return ::writev(sock->get_fd(), iov, iovcnt);
+}
+
+/*
+  like read(), but without waiting for data as this is only called
+  once the socket is known to be readable or is being polled
+ */
+ssize_t TCPServerDevice::readv(const struct iovec *iov, int iovcnt)
+{
+    if (sock == nullptr) {
+        sock = listener.accept(0);
+        if (sock != nullptr) {
+            sock->set_blocking(_blocking);
+        }
+    }
+    if (sock == nullptr) {
+        errno = EAGAIN;
+        return -1;
+    }
+    ssize_t ret = ::readv(sock->get_fd(), iov, iovcnt);
+    if (ret == 0) {
+        // EOF, go back to waiting for a new connection
+        delete sock;
+        sock = nullptr;
+    }
+    return ret;
+}
+
 bool TCPServerDevice::open()
 {
     listener.reuseaddress();
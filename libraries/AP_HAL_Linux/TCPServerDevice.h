@@ -14,6 +14,11 @@ public:
     virtual void set_speed(uint32_t speed) override;
     virtual ssize_t write(const uint8_t *buf, uint16_t n) override;
     virtual ssize_t read(uint8_t *buf, uint16_t n) override;
+    virtual ssize_t readv(const struct iovec *iov, int iovcnt) override;
+    virtual ssize_t writev(const struct iovec *iov, int iovcnt) override;
+
+    // the listening socket until a client connects
+    virtual int get_fd() override { return sock != nullptr ? sock->get_fd() : listener.get_fd(); }
 
 private:
     SocketAPM listener{false};
@@ -17,6 +17,7 @@
 #include "Thread.h"
 
 #include <alloca.h>
+#include <errno.h>
 #include <limits.h>
 #include <sys/types.h>
 #include <stdio.h>
@@ -191,7 +192,30 @@ bool Thread::start(const char *name, int policy, int prio)
         }
     }
 
+    /*
+      a bad affinity shouldn't stop the thread from running, so if it
+      can't be applied the thread is started unpinned instead
+     */
+    if (_cpus_set &&
+        (r = pthread_attr_setaffinity_np(&attr, sizeof(_cpus), &_cpus)) != 0) {
+        fprintf(stderr, "Failed to set CPU affinity for thread '%s', running unpinned: %s\n",
+                name, strerror(r));
+        _cpus_set = false;
+    }
+
     r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
+    if (r == EINVAL && _cpus_set) {
+        // none of the CPUs asked for are online
+        fprintf(stderr, "Failed to start thread '%s' on its CPUs, running unpinned\n", name);
+        _cpus_set = false;
+        cpu_set_t all;
+        CPU_ZERO(&all);
+        for (uint16_t i = 0; i < CPU_SETSIZE; i++) {
+            CPU_SET(i, &all);
+        }
+        pthread_attr_setaffinity_np(&attr, sizeof(all), &all);
+        r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
+    }
     if (r != 0) {
         AP_HAL::panic("Failed to create thread '%s': %s",
                       name, strerror(r));
@@ -207,6 +231,27 @@ bool Thread::start(const char *name, int policy, int prio)
     return true;
 }
 
+bool Thread::set_cpu_affinity(const cpu_set_t &cpus)
+{
+    if (_started) {
+        return false;
+    }
+
+    _cpus = cpus;
+    _cpus_set = true;
+
+    return true;
+}
+
+bool Thread::get_cpu_affinity(cpu_set_t &cpus) const
+{
+    if (_ctx == 0) {
+        return false;
+    }
+
+    return pthread_getaffinity_np(_ctx, sizeof(cpus), &cpus) == 0;
+}
+
 bool Thread::is_current_thread()
 {
     return pthread_equal(pthread_self(), _ctx);
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <pthread.h>
+#include <sched.h>
 #include <inttypes.h>
 #include <stdlib.h>
 
@@ -47,6 +48,16 @@ public:
 
     void set_auto_free(bool auto_free) { _auto_free = auto_free; }
 
+    /*
+     * Restrict the thread to the given CPUs. Must be called before start().
+     */
+    bool set_cpu_affinity(const cpu_set_t &cpus);
+
+    /*
+     * Get the CPUs the kernel actually allows the thread to run on.
+     */
+    bool get_cpu_affinity(cpu_set_t &cpus) const;
+
     virtual bool stop() { return false; }
 
     bool join();
@@ -75,6 +86,9 @@ protected:
     } _stack_debug;
 
     size_t _stack_size = 0;
+
+    cpu_set_t _cpus;
+    bool _cpus_set = false;
 };
 
 class PeriodicThread : public Thread {
@@ -67,6 +67,16 @@ ssize_t UARTDevice::write(const uint8_t *buf, uint16_t n)
     return ret;
 }
 
+ssize_t UARTDevice::readv(const struct iovec *iov, int iovcnt)
+{
+    return ::readv(_fd, iov, iovcnt);
+}
+
+ssize_t UARTDevice::writev(const struct iovec *iov, int iovcnt)
+{
+    return ::writev(_fd, iov, iovcnt);
+}
+
 void UARTDevice::set_blocking(bool blocking)
 {
     int flags = fcntl(_fd, F_GETFL, 0);
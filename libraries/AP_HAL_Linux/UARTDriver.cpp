@@ -20,6 +20,7 @@
 #include <AP_HAL/AP_HAL.h>
 
 #include "ConsoleDevice.h"
+#include "Scheduler.h"
 #include "TCPServerDevice.h"
 #include "UARTDevice.h"
 #include "UDPDevice.h"
@@ -220,6 +221,7 @@ void UARTDriver::end()
         hal.scheduler->delay(1);
     }
 
+    _drop_pollable();
     _device->close();
     _deallocate_buffers();
 }
@@ -380,6 +382,27 @@ int UARTDriver::_read_fd(uint8_t *buf, uint16_t n)
     return _device->read(buf, n);
 }
 
+/*
+  vectored _write_fd(), used to write both parts of the ring buffer
+  with a single system call
+ */
+ssize_t UARTDriver::_writev_fd(const struct iovec *iov, int iovcnt)
+{
+    if (!_connected) {
+        _connected = _device->open();
+    }
+    if (!_connected) {
+        return 0;
+    }
+
+    return _device->writev(iov, iovcnt);
+}
+
+ssize_t UARTDriver::_readv_fd(const struct iovec *iov, int iovcnt)
+{
+    return _device->readv(iov, iovcnt);
+}
+
 
 /*
   try to push out one lump of pending bytes
@@ -391,6 +414,17 @@ bool UARTDriver::_write_pending_bytes(void)
     uint32_t available_bytes = _writebuf.available();
     uint16_t n = available_bytes;
 
+    if (_packetise && _device->can_send_packets()) {
+        // send several packets per system call, one per datagram
+        if (!_connected) {
+            _connected = _device->open();
+        }
+        if (_connected && available_bytes > 0) {
+            _device->send_packets(_writebuf);
+        }
+        return _writebuf.available() != available_bytes;
+    }
+
     if (_packetise && n > 0) {
         // send on MAVLink packet boundaries if possible
         n = mavlink_packetise(_writebuf, n);
@@ -408,18 +442,15 @@ bool UARTDriver::_write_pending_bytes(void)
                 _writebuf.advance(ret);
         } else {
             ByteBuffer::IoVec vec[2];
+            struct iovec iov[2];
             const auto n_vec = _writebuf.peekiovec(vec, n);
             for (int i = 0; i < n_vec; i++) {
-                ret = _write_fd(vec[i].data, (uint16_t)vec[i].len);
-                if (ret < 0) {
-                    break;
-                }
+                iov[i].iov_base = vec[i].data;
+                iov[i].iov_len = vec[i].len;
+            }
+            ret = _writev_fd(iov, n_vec);
+            if (ret > 0) {
                 _writebuf.advance(ret);
-
-                /* We wrote less than we asked for, stop */
-                if ((unsigned)ret != vec[i].len) {
-                    break;
-                }
             }
         }
     }
@@ -428,9 +459,9 @@ bool UARTDriver::_write_pending_bytes(void)
 }
 
 /*
-  push any pending bytes to/from the serial port. This is called at
-  1kHz in the timer thread. Doing it this way reduces the system call
-  overhead in the main task enormously.
+  push any pending bytes to/from the serial port. This is called from
+  the uart thread at APM_LINUX_UART_RATE. Doing it this way reduces the
+  system call overhead in the main task enormously.
  */
 void UARTDriver::_timer_tick(void)
 {
@@ -438,19 +469,87 @@ void UARTDriver::_timer_tick(void)
 
     _in_timer = true;
 
+    _update_pollable();
+
+    uint8_t num_send = 10;
+    while (num_send != 0 && _write_pending_bytes()) {
+        num_send--;
+    }
+
+    // devices we can't wait on are polled for input here, as are
+    // devices that had more data than fitted in the read buffer
+    if (_pollable.get_fd() < 0 || _rx_pending) {
+        _fill_read_buffer();
+    }
+
+    _in_timer = false;
+}
+
+/*
+  called from the uart thread when the device has data to be read
+ */
+void UARTDriver::_on_can_read()
+{
+    if (!_initialised) {
+        // the device won't signal again for data that is already
+        // waiting, so leave it for _timer_tick() to read
+        _rx_pending = true;
+        return;
+    }
+
+    _in_timer = true;
+    _fill_read_buffer();
+    _in_timer = false;
+}
+
+/*
+  called from the uart thread when the device has room for more data
+  after having been full
+ */
+void UARTDriver::_on_can_write()
+{
+    if (!_initialised) return;
+
+    _in_timer = true;
     uint8_t num_send = 10;
     while (num_send != 0 && _write_pending_bytes()) {
         num_send--;
     }
+    _in_timer = false;
+}
 
-    // try to fill the read buffer
-    int ret;
-    ByteBuffer::IoVec vec[2];
+/*
+  read from the device until it would block or the read buffer is
+  full. Readiness is edge triggered, so a device we are waiting on has
+  to be drained or we won't be told about the data that is left
+ */
+void UARTDriver::_fill_read_buffer()
+{
+    const bool waiting = _pollable.get_fd() >= 0;
+
+    while (true) {
+        ByteBuffer::IoVec vec[2];
+        struct iovec iov[2];
+        const auto n_vec = _readbuf.reserve(vec, _readbuf.space());
+        if (n_vec == 0) {
+            // buffer full, poll again on the next tick
+            _rx_pending = true;
+            return;
+        }
+        size_t len = 0;
+        for (int i = 0; i < n_vec; i++) {
+            iov[i].iov_base = vec[i].data;
+            iov[i].iov_len = vec[i].len;
+            len += vec[i].len;
+        }
 
-    const auto n_vec = _readbuf.reserve(vec, _readbuf.space());
-    for (int i = 0; i < n_vec; i++) {
-        ret = _read_fd(vec[i].data, vec[i].len);
-        if (ret < 0) {
+        const ssize_t ret = _readv_fd(iov, n_vec);
+        if (ret <= 0) {
+            if (waiting && (ret == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))) {
+                // EOF or error: the device may have a new file
+                // descriptor by the next tick
+                _drop_pollable();
+            }
             break;
         }
         _readbuf.commit((unsigned)ret);
@@ -458,14 +557,46 @@ void UARTDriver::_timer_tick(void)
         // update receive timestamp
         _receive_timestamp[_receive_timestamp_idx^1] = AP_HAL::micros64();
         _receive_timestamp_idx ^= 1;
-        
-        /* stop reading as we read less than we asked for */
-        if ((unsigned)ret < vec[i].len) {
+
+        /* stop reading a polled device as we read less than we asked for */
+        if (!waiting && (size_t)ret < len) {
             break;
         }
     }
 
-    _in_timer = false;
+    _rx_pending = false;
+}
+
+/*
+  keep the device file descriptor registered with the uart thread
+ */
+void UARTDriver::_update_pollable()
+{
+    const int fd = _connected ? _pollable_fd() : -1;
+    if (fd == _pollable.get_fd() || fd == _unpollable_fd) {
+        return;
+    }
+
+    _drop_pollable();
+    if (fd < 0) {
+        return;
+    }
+
+    _pollable.set_fd(fd);
+    if (!Scheduler::from(hal.scheduler)->register_uart_pollable(&_pollable)) {
+        // e.g. stdin redirected from a regular file, keep polling it
+        _pollable.set_fd(-1);
+        _unpollable_fd = fd;
+    }
+}
+
+void UARTDriver::_drop_pollable()
+{
+    if (_pollable.get_fd() < 0) {
+        return;
+    }
+    Scheduler::from(hal.scheduler)->unregister_uart_pollable(&_pollable);
+    _pollable.set_fd(-1);
 }
 
 void UARTDriver::configure_parity(uint8_t v) {
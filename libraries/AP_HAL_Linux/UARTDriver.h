@@ -4,6 +4,7 @@
 #include <AP_HAL/utility/RingBuffer.h>
 
 #include "AP_HAL_Linux.h"
+#include "Poller.h"
 #include "SerialDevice.h"
 #include "Semaphores.h"
 
@@ -49,6 +50,9 @@ public:
 
     void configure_parity(uint8_t v) override;
 
+    // datagram statistics for @SYS/uarts.txt, nullptr if not packet based
+    const DatagramBatch::Stats *get_packet_stats() const { return _device->get_packet_stats(); }
+
     virtual void set_flow_control(enum flow_control flow_control_setting) override
    {
        _device->set_flow_control(flow_control_setting);
@@ -70,6 +74,38 @@ public:
     uint64_t receive_time_constraint_us(uint16_t nbytes) override;
 
 private:
+    /*
+      device file descriptor watched from the uart thread, so received
+      bytes are read as soon as they arrive rather than on the next tick
+     */
+    class DevicePollable : public Pollable {
+    public:
+        DevicePollable(UARTDriver &uart) : _uart(uart) { }
+
+        // the file descriptor belongs to the device, don't close it
+        ~DevicePollable() { _fd = -1; }
+
+        void set_fd(int fd) { _fd = fd; }
+
+        void on_can_read() override { _uart._on_can_read(); }
+        void on_can_write() override { _uart._on_can_write(); }
+        void on_error() override { _uart._on_can_read(); }
+        void on_hang_up() override { _uart._on_can_read(); }
+
+    private:
+        UARTDriver &_uart;
+    };
+
+    DevicePollable _pollable{*this};
+    int _unpollable_fd = -1;
+    bool _rx_pending = false; // read buffer filled up before the device was drained
+
+    void _update_pollable();
+    void _drop_pollable();
+    void _fill_read_buffer();
+    void _on_can_read();
+    void _on_can_write();
+
     AP_HAL::OwnPtr<SerialDevice> _device;
     bool _nonblocking_writes;
     bool _console;
@@ -101,6 +137,11 @@ protected:
 
     virtual int _write_fd(const uint8_t *buf, uint16_t n);
     virtual int _read_fd(uint8_t *buf, uint16_t n);
+    virtual ssize_t _writev_fd(const struct iovec *iov, int iovcnt);
+    virtual ssize_t _readv_fd(const struct iovec *iov, int iovcnt);
+
+    // file descriptor to wait on for received data, -1 to poll
+    virtual int _pollable_fd() { return _device->get_fd(); }
 
     Linux::Semaphore _write_mutex;
 };
@@ -1,5 +1,6 @@
 #include "UDPDevice.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <sys/ioctl.h>
@@ -12,6 +13,7 @@ UDPDevice::UDPDevice(const char *ip, uint16_t port, bool bcast, bool input):
     _bcast(bcast),
     _input(input)
 {
+    SocketAPM::make_sockaddr(_ip, _port, _dest);
 }
 
 UDPDevice::~UDPDevice()
@@ -45,6 +47,35 @@ ssize_t UDPDevice::read(uint8_t *buf, uint16_t n)
     return ret;
 }
 
+/*
+  send a burst of MAVLink packets, one per datagram, with one system call
+ */
+ssize_t UDPDevice::send_packets(ByteBuffer &buf)
+{
+    if (_connected) {
+        return _batch.send(socket.get_fd(), buf, buf.available(), nullptr);
+    }
+    if (_input) {
+        // can't send until a packet has told us where to
+        errno = ENOTCONN;
+        return -1;
+    }
+    return _batch.send(socket.get_fd(), buf, buf.available(), &_dest);
+}
+
+/*
+  receive a burst of datagrams with one system call
+ */
+ssize_t UDPDevice::readv(const struct iovec *iov, int iovcnt)
+{
+    struct sockaddr_in from;
+    ssize_t ret = _batch.recv(socket.get_fd(), iov, iovcnt, _connected ? nullptr : &from);
+    if (!_connected && ret > 0) {
+        _connected = socket.connect(inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+    }
+    return ret;
+}
+
 bool UDPDevice::open()
 {
     if (_input) {
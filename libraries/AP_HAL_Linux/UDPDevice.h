@@ -14,6 +14,11 @@ public:
     virtual void set_speed(uint32_t speed) override;
     virtual ssize_t write(const uint8_t *buf, uint16_t n) override;
     virtual ssize_t read(uint8_t *buf, uint16_t n) override;
+    virtual ssize_t readv(const struct iovec *iov, int iovcnt) override;
+    virtual int get_fd() override { return socket.get_fd(); }
+    virtual bool can_send_packets() const override { return true; }
+    virtual ssize_t send_packets(ByteBuffer &buf) override;
+    virtual const DatagramBatch::Stats *get_packet_stats() const override { return &_batch.get_stats(); }
 private:
     SocketAPM socket{true};
     const char *_ip;
@@ -21,4 +26,6 @@ private:
     bool _bcast;
     bool _input;
     bool _connected = false;
+    struct sockaddr_in _dest;
+    DatagramBatch _batch;
 };
@@ -8,8 +8,11 @@
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
 #include "Heat_Pwm.h"
+#include "Scheduler.h"
+#include "UARTDriver.h"
 #include "ToneAlarm_Disco.h"
 #include "Util.h"
 
@@ -93,6 +96,31 @@ uint32_t Util::available_memory(void)
     return 256*1024;
 }
 
+size_t Util::thread_info(char *buf, size_t bufsize)
+{
+    return Scheduler::from(hal.scheduler)->cpu_affinity_report(buf, bufsize);
+}
+
+size_t Util::uart_info(char *buf, size_t bufsize)
+{
+    AP_HAL::UARTDriver *uarts[] = { hal.uartA, hal.uartB, hal.uartC, hal.uartD,
+                                    hal.uartE, hal.uartF, hal.uartG, hal.uartH };
+    int total = snprintf(buf, bufsize, "UARTV1\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(uarts) && total >= 0 && (size_t)total < bufsize; i++) {
+        const DatagramBatch::Stats *stats = UARTDriver::from(uarts[i])->get_packet_stats();
+        if (stats == nullptr) {
+            continue;
+        }
+        const char name[] = { 'u', 'a', 'r', 't', char('A' + i), 0 };
+        const int n = DatagramBatch::format_stats(&buf[total], bufsize - total, name, *stats);
+        if (n < 0) {
+            break;
+        }
+        total += n;
+    }
+    return MIN((size_t)MAX(total, 0), bufsize);
+}
+
 #ifndef HAL_LINUX_DEFAULT_SYSTEM_ID
 #define HAL_LINUX_DEFAULT_SYSTEM_ID "linux-unknown"
 #endif
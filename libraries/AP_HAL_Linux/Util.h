@@ -102,6 +102,12 @@ public:
 
     int get_hw_arm32();
 
+    // report thread CPU affinity for @SYS/threads.txt
+    size_t thread_info(char *buf, size_t bufsize) override;
+
+    // report datagram batching for @SYS/uarts.txt
+    size_t uart_info(char *buf, size_t bufsize) override;
+
     bool toneAlarm_init() override { return _toneAlarm.init(); }
     void toneAlarm_set_buzzer_tone(float frequency, float volume, uint32_t duration_ms) override {
         _toneAlarm.set_buzzer_tone(frequency, volume, duration_ms);
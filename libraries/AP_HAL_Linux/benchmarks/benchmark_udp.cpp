@@ -0,0 +1,168 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  compare sending and receiving MAVLink over UDP one packet per system
+  call, as UDPDevice used to, with DatagramBatch
+ */
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <AP_HAL/utility/DatagramBatch.h>
+#include <AP_HAL/utility/Socket.h>
+#include <AP_HAL/utility/packetise.h>
+
+// a MAVLink2 packet with a 48 byte payload
+static const uint8_t packet_len = 60;
+
+class Loopback {
+public:
+    Loopback() {
+        rx = socket(AF_INET, SOCK_DGRAM, 0);
+        tx = socket(AF_INET, SOCK_DGRAM, 0);
+        int bufsize = 4 * 1024 * 1024;
+        setsockopt(rx, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+        SocketAPM::make_sockaddr("127.0.0.1", 0, addr);
+        bind(rx, (struct sockaddr *)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(rx, (struct sockaddr *)&addr, &len);
+    }
+
+    ~Loopback() {
+        close(rx);
+        close(tx);
+    }
+
+    int rx;
+    int tx;
+    struct sockaddr_in addr;
+};
+
+static void fill_packets(ByteBuffer &buf, int count)
+{
+    uint8_t packet[packet_len] {};
+    packet[0] = 0xFD; // MAVLink2 start byte
+    packet[1] = packet_len - 12;
+    for (int i = 0; i < count; i++) {
+        packet[4] = i;
+        buf.write(packet, sizeof(packet));
+    }
+}
+
+static void send_packets(Loopback &lo, int count)
+{
+    uint8_t packet[packet_len] {};
+    for (int i = 0; i < count; i++) {
+        sendto(lo.tx, packet, sizeof(packet), 0, (struct sockaddr *)&lo.addr, sizeof(lo.addr));
+    }
+}
+
+static void BM_UDPSendPerPacket(benchmark::State& state)
+{
+    Loopback lo;
+    ByteBuffer buf{65536};
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        fill_packets(buf, state.range_x());
+        state.ResumeTiming();
+
+        while (buf.available() > 0) {
+            const uint16_t n = mavlink_packetise(buf, buf.available());
+            uint8_t tmpbuf[n];
+            buf.peekbytes(tmpbuf, n);
+            struct pollfd fds { lo.tx, POLLOUT, 0 };
+            if (poll(&fds, 1, 0) == 1) {
+                sendto(lo.tx, tmpbuf, n, MSG_DONTWAIT, (struct sockaddr *)&lo.addr, sizeof(lo.addr));
+            }
+            buf.advance(n);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK(BM_UDPSendPerPacket)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_UDPSendBatch(benchmark::State& state)
+{
+    Loopback lo;
+    ByteBuffer buf{65536};
+    DatagramBatch batch;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        fill_packets(buf, state.range_x());
+        state.ResumeTiming();
+
+        while (buf.available() > 0 &&
+               batch.send(lo.tx, buf, buf.available(), &lo.addr) > 0) {
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK(BM_UDPSendBatch)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_UDPRecvPerPacket(benchmark::State& state)
+{
+    Loopback lo;
+    uint8_t buf[8192];
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        send_packets(lo, state.range_x());
+        state.ResumeTiming();
+
+        struct pollfd fds { lo.rx, POLLIN, 0 };
+        while (poll(&fds, 1, 0) == 1 &&
+               recv(lo.rx, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK(BM_UDPRecvPerPacket)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_UDPRecvBatch(benchmark::State& state)
+{
+    Loopback lo;
+    uint8_t buf[AP_DATAGRAM_BATCH_MAX * AP_DATAGRAM_BATCH_MTU];
+    struct iovec iov { buf, sizeof(buf) };
+    DatagramBatch batch;
+
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        send_packets(lo, state.range_x());
+        state.ResumeTiming();
+
+        while (batch.recv(lo.rx, &iov, 1, nullptr) > 0) {
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range_x());
+}
+
+BENCHMARK(BM_UDPRecvBatch)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+#endif
+
+BENCHMARK_MAIN()
@@ -226,6 +226,7 @@ void HAL_SITL::run(int argc, char * const argv[], Callbacks* callbacks) const
     while (!HALSITL::Scheduler::_should_reboot) {
         if (HALSITL::Scheduler::_should_exit) {
             ::fprintf(stderr, "Exitting\n");
+            sitlStorage.flush();
             exit(0);
         }
         fill_stack_nan();
@@ -250,6 +251,8 @@ void HAL_SITL::run(int argc, char * const argv[], Callbacks* callbacks) const
 
 void HAL_SITL::actually_reboot()
 {
+    // don't lose writes that are waiting for the storage flush policy
+    sitlStorage.flush();
     execv(new_argv[0], new_argv);
     AP_HAL::panic("PANIC: REBOOT FAILED: %s", strerror(errno));
 }
@@ -4,6 +4,7 @@
 #include <AP_HAL_SITL/I2CDevice.h>
 #include "Scheduler.h"
 #include "UARTDriver.h"
+#include <AP_HAL/utility/Trace.h>
 #include <sys/time.h>
 #include <fenv.h>
 #include <AP_BoardConfig/AP_BoardConfig.h>
@@ -200,6 +201,8 @@ void Scheduler::_run_timer_procs()
     }
     _in_timer_proc = true;
 
+    AP_TRACE_SCOPE("timer");
+
     // now call the timer based drivers
     for (int i = 0; i < _num_timer_procs; i++) {
         if (_timer_proc[i]) {
@@ -222,6 +225,8 @@ void Scheduler::_run_io_procs()
     }
     _in_io_proc = true;
 
+    AP_TRACE_SCOPE("io");
+
     // now call the IO based drivers
     for (int i = 0; i < _num_io_procs; i++) {
         if (_io_proc[i]) {
@@ -4,6 +4,7 @@
 
 #include "Semaphores.h"
 #include "Scheduler.h"
+#include <AP_HAL/utility/Trace.h>
 
 extern const AP_HAL::HAL& hal;
 
@@ -21,6 +22,9 @@ Semaphore::Semaphore()
 
 bool Semaphore::give()
 {
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    _profile.releasing();
+#endif
     if (pthread_mutex_unlock(&_lock) != 0) {
         AP_HAL::panic("Bad semaphore usage");
     }
@@ -29,18 +33,37 @@ bool Semaphore::give()
 
 bool Semaphore::take(uint32_t timeout_ms)
 {
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    const uint32_t start_us = _profile.begin_take();
+#endif
+    if (pthread_mutex_trylock(&_lock) == 0) {
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+        _profile.acquired(this, start_us, false);
+#endif
+        return true;
+    }
+    const bool ret = take_contended(timeout_ms);
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    if (ret) {
+        _profile.acquired(this, start_us, true);
+    }
+#endif
+    return ret;
+}
+
+bool Semaphore::take_contended(uint32_t timeout_ms)
+{
+    // only contended takes are traced
+    AP_TRACE_SCOPE("sem_wait");
     if (timeout_ms == HAL_SEMAPHORE_BLOCK_FOREVER) {
         return pthread_mutex_lock(&_lock) == 0;
     }
-    if (take_nonblocking()) {
-        return true;
-    }
     uint64_t start = AP_HAL::micros64();
     do {
         Scheduler::from(hal.scheduler)->set_in_semaphore_take_wait(true);
         hal.scheduler->delay_microseconds(200);
         Scheduler::from(hal.scheduler)->set_in_semaphore_take_wait(false);
-        if (take_nonblocking()) {
+        if (pthread_mutex_trylock(&_lock) == 0) {
             return true;
         }
     } while ((AP_HAL::micros64() - start) < timeout_ms * 1000);
@@ -49,7 +72,16 @@ bool Semaphore::take(uint32_t timeout_ms)
 
 bool Semaphore::take_nonblocking()
 {
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    const uint32_t start_us = _profile.begin_take();
+    if (pthread_mutex_trylock(&_lock) != 0) {
+        return false;
+    }
+    _profile.acquired(this, start_us, false);
+    return true;
+#else
     return pthread_mutex_trylock(&_lock) == 0;
+#endif
 }
 
 #endif  // CONFIG_HAL_BOARD
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <AP_HAL/AP_HAL_Macros.h>
 #include <AP_HAL/Semaphores.h>
+#include <AP_HAL/utility/SemProfile.h>
 #include "AP_HAL_SITL_Namespace.h"
 #include <pthread.h>
 
@@ -14,5 +15,9 @@ public:
     bool take(uint32_t timeout_ms) override;
     bool take_nonblocking() override;
 protected:
+    bool take_contended(uint32_t timeout_ms);
     pthread_mutex_t _lock;
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    AP_HAL::SemProfile::Tracker _profile;
+#endif
 };
@@ -1,4 +1,5 @@
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
 #include <assert.h>
 #include <sys/types.h>
@@ -46,8 +47,6 @@ void Storage::_storage_open(void)
         return;
     }
 #endif
-        
-    _dirty_mask.clearall();
 
 #if STORAGE_USE_FLASH
     // load from storage backend
@@ -84,26 +83,6 @@ void Storage::_storage_open(void)
     _initialised = true;
 }
 
-/*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
-*/
-void Storage::_mark_dirty(uint16_t loc, uint16_t length)
-{
-    if (length == 0) {
-        return;
-    }
-    uint16_t end = loc + length - 1;
-    for (uint16_t line=loc>>STORAGE_LINE_SHIFT;
-         line <= end>>STORAGE_LINE_SHIFT;
-         line++) {
-        _dirty_mask.set(line);
-    }
-}
-
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
 {
     if (loc >= sizeof(_buffer)-(n-1)) {
@@ -120,8 +99,7 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
     }
     if (memcmp(src, &_buffer[loc], n) != 0) {
         _storage_open();
-        memcpy(&_buffer[loc], src, n);
-        _mark_dirty(loc, n);
+        _writeback.write(loc, src, n, AP_HAL::millis());
     }
 }
 
@@ -130,41 +108,65 @@ void Storage::_timer_tick(void)
     if (!_initialised) {
         return;
     }
-    if (_dirty_mask.empty()) {
+    if (_writeback.empty()) {
         _last_empty_ms = AP_HAL::millis();
+#if STORAGE_USE_FLASH
+        // nothing to write, so use the time to free the full sector
+        _flash.compact_step();
+#endif
         return;
     }
 
-    // write out the first dirty line. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint16_t i;
-    for (i=0; i<STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask.get(i)) {
-            break;
-        }
+    // write out the first run of dirty lines once the writes have
+    // settled. We don't write more than one run to keep the latency
+    // of this call to a minimum
+    uint32_t offset, length;
+    if (_writeback.next_flush(AP_HAL::millis(), offset, length)) {
+        _write_run(offset, length);
     }
-    if (i == STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+}
+
+/*
+  write everything now, without waiting for writes to settle. This is
+  called from the main thread, which also runs the timer tick
+ */
+void Storage::flush(void)
+{
+    if (!_initialised) {
         return;
     }
+    uint32_t offset, length;
+    while (_writeback.next_flush(AP_HAL::millis(), offset, length, true)) {
+        if (!_write_run(offset, length)) {
+            break;
+        }
+    }
+}
 
+/*
+  write a run returned by next_flush()
+ */
+bool Storage::_write_run(uint32_t offset, uint32_t length)
+{
 #if STORAGE_USE_POSIX
     if (using_filesystem && log_fd != -1) {
-        const off_t offset = STORAGE_LINE_SIZE*i;
-        if (lseek(log_fd, offset, SEEK_SET) != offset) {
-            return;
-        }
-        if (write(log_fd, &_buffer[offset], STORAGE_LINE_SIZE) != STORAGE_LINE_SIZE) {
-            return;
+        if (pwrite(log_fd, &_buffer[offset], length, offset) != (ssize_t)length) {
+            _writeback.flush_failed(offset, length);
+            return false;
         }
-        _dirty_mask.clear(i);
-        return;
+        return true;
     } 
 #endif
     
 #if STORAGE_USE_FLASH
     // save to storage backend
-    _flash_write(i);
+    if (!_flash_write(offset, length)) {
+        _writeback.flush_failed(offset, length);
+        return false;
+    }
+    return true;
+#else
+    return false;
 #endif
 }
 
@@ -183,15 +185,14 @@ void Storage::_flash_load(void)
 }
 
 /*
-  write one storage line. This also updates _dirty_mask. 
+  write a run of storage lines
 */
-void Storage::_flash_write(uint16_t line)
+bool Storage::_flash_write(uint16_t offset, uint16_t length)
 {
 #if STORAGE_USE_FLASH
-    if (_flash.write(line*STORAGE_LINE_SIZE, STORAGE_LINE_SIZE)) {
-        // mark the line clean
-        _dirty_mask.clear(line);
-    }
+    return _flash.write(offset, length);
+#else
+    return false;
 #endif
 }
 
@@ -340,4 +341,19 @@ bool Storage::healthy(void)
     return _initialised && AP_HAL::millis() - _last_empty_ms < 2000;
 }
 
-
+size_t Storage::get_stats(char *buf, size_t bufsize)
+{
+    int n = _writeback.format_stats(buf, bufsize);
+#if STORAGE_USE_FLASH
+    if (n >= 0 && size_t(n) < bufsize) {
+        const AP_FlashStorage::Stats &fs = _flash.get_stats();
+        const int n2 = hal.util->snprintf(&buf[n], bufsize-n,
+                                          "flash max write %uus step %uus erase %uus\n"
+                                          "flash compactions %u full switches %u\n",
+                                          (unsigned)fs.max_write_us, (unsigned)fs.max_step_us, (unsigned)fs.max_erase_us,
+                                          (unsigned)fs.compactions, (unsigned)fs.full_switches);
+        n += MAX(n2, 0);
+    }
+#endif
+    return MIN((size_t)MAX(n, 0), bufsize);
+}
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <AP_HAL/AP_HAL.h>
-#include <AP_Common/Bitmask.h>
+#include <AP_HAL/utility/StorageWriteback.h>
 #include "AP_HAL_SITL_Namespace.h"
 #include <AP_FlashStorage/AP_FlashStorage.h>
 
@@ -29,16 +29,28 @@ public:
     void write_block(uint16_t dst, const void* src, size_t n) override;
 
     void _timer_tick(void) override;
+    void flush(void) override;
     bool healthy(void) override;
+    size_t get_stats(char *buf, size_t bufsize) override;
 
 private:
     volatile bool _initialised;
     void _storage_create(void);
     void _storage_open(void);
     void _save_backup(void);
-    void _mark_dirty(uint16_t loc, uint16_t length);
+    bool _write_run(uint32_t offset, uint32_t length);
     uint8_t _buffer[HAL_STORAGE_SIZE] __attribute__((aligned(4)));
-    Bitmask<STORAGE_NUM_LINES> _dirty_mask;
+
+    /*
+      flush runs of dirty lines once writes have settled for 50ms, or
+      500ms after the first write
+     */
+#if STORAGE_USE_FLASH
+    // don't bridge clean lines, as every byte written uses up flash
+    StorageWriteback _writeback{_buffer, sizeof(_buffer), STORAGE_LINE_SHIFT, { 50, 500, 256, 0 }};
+#else
+    StorageWriteback _writeback{_buffer, sizeof(_buffer), STORAGE_LINE_SHIFT, { 50, 500, 4096, 64 }};
+#endif
 
 #if STORAGE_USE_FLASH
     bool _flash_write_data(uint8_t sector, uint32_t offset, const uint8_t *data, uint16_t length);
@@ -61,7 +73,7 @@ private:
 #endif
     
     void _flash_load(void);
-    void _flash_write(uint16_t line);
+    bool _flash_write(uint16_t offset, uint16_t length);
 
 #if STORAGE_USE_POSIX
     bool using_filesystem;
@@ -435,6 +435,10 @@ void UARTDriver::_udp_start_client(const char *address, uint16_t port)
         exit(1);
     }
 
+    if (_udp_batch == nullptr) {
+        _udp_batch = new DatagramBatch();
+    }
+
     _is_udp = true;
     _packetise = true;
     _connected = true;
@@ -652,7 +656,10 @@ void UARTDriver::_timer_tick(void)
         last_tick_us = now;
     }
 
-    if (_packetise) {
+    if (_packetise && _udp_batch != nullptr) {
+        // several packets per system call, one per datagram
+        _udp_batch->send(_fd, _writebuffer, max_bytes, nullptr);
+    } else if (_packetise) {
         uint16_t n = _writebuffer.available();
         n = MIN(n, max_bytes);
         if (n > 0) {
@@ -739,7 +746,12 @@ void UARTDriver::_timer_tick(void)
             _connected = false;
         }
     } else if (_select_check(_fd)) {
-        nread = recv(_fd, buf, space, MSG_DONTWAIT);
+        if (_udp_batch != nullptr) {
+            struct iovec iov { buf, space };
+            nread = _udp_batch->recv(_fd, &iov, 1, nullptr);
+        } else {
+            nread = recv(_fd, buf, space, MSG_DONTWAIT);
+        }
         if (nread <= 0 && !_is_udp) {
             // the socket has reached EOF
             close(_fd);
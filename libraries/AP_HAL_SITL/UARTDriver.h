@@ -8,6 +8,7 @@
 #include "AP_HAL_SITL_Namespace.h"
 #include <AP_HAL/utility/Socket.h>
 #include <AP_HAL/utility/RingBuffer.h>
+#include <AP_HAL/utility/DatagramBatch.h>
 
 class HALSITL::UARTDriver : public AP_HAL::UARTDriver {
 public:
@@ -85,7 +86,12 @@ public:
       A return value of zero means the HAL does not support this API
      */
     uint64_t receive_time_constraint_us(uint16_t nbytes) override;
-    
+
+    // datagram statistics for @SYS/uarts.txt, nullptr if not UDP
+    const DatagramBatch::Stats *get_packet_stats() const {
+        return _udp_batch != nullptr ? &_udp_batch->get_stats() : nullptr;
+    }
+
 private:
     uint8_t _portNumber;
     bool _connected = false; // true if a client has connected
@@ -123,6 +129,7 @@ private:
     uint64_t _receive_timestamp;
     bool _is_udp;
     bool _packetise;
+    DatagramBatch *_udp_batch = nullptr; // sends and receives bursts of UDP packets
     uint16_t _mc_myport;
     uint32_t last_tick_us;
 
@@ -1,6 +1,10 @@
 #include "Util.h"
 #include <sys/time.h>
 
+#include "UARTDriver.h"
+
+extern const AP_HAL::HAL& hal;
+
 #ifdef WITH_SITL_TONEALARM
 HALSITL::ToneAlarm_SF HALSITL::Util::_toneAlarm;
 #endif
@@ -130,6 +134,26 @@ void *HALSITL::Util::heap_realloc(void *heap_ptr, void *ptr, size_t new_size)
 
 #endif // ENABLE_HEAP
 
+size_t HALSITL::Util::uart_info(char *buf, size_t bufsize)
+{
+    AP_HAL::UARTDriver *uarts[] = { hal.uartA, hal.uartB, hal.uartC, hal.uartD,
+                                    hal.uartE, hal.uartF, hal.uartG, hal.uartH };
+    int total = snprintf(buf, bufsize, "UARTV1\n");
+    for (uint8_t i = 0; i < ARRAY_SIZE(uarts) && total >= 0 && (size_t)total < bufsize; i++) {
+        const DatagramBatch::Stats *stats = static_cast<HALSITL::UARTDriver *>(uarts[i])->get_packet_stats();
+        if (stats == nullptr) {
+            continue;
+        }
+        const char name[] = { 'u', 'a', 'r', 't', char('A' + i), 0 };
+        const int n = DatagramBatch::format_stats(&buf[total], bufsize - total, name, *stats);
+        if (n < 0) {
+            break;
+        }
+        total += n;
+    }
+    return MIN((size_t)MAX(total, 0), bufsize);
+}
+
 enum AP_HAL::Util::safety_state HALSITL::Util::safety_switch_state(void)
 {
     const SITL::SITL *sitl = AP::sitl();
@@ -57,6 +57,9 @@ public:
 
     enum safety_state safety_switch_state(void) override;
 
+    // report datagram batching for @SYS/uarts.txt
+    size_t uart_info(char *buf, size_t bufsize) override;
+
     bool trap() const override {
 #if defined(__CYGWIN__) || defined(__CYGWIN64__)
         return false;
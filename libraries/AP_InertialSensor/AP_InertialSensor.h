@@ -377,8 +377,13 @@ public:
         enum batch_opt_t {
             BATCH_OPT_SENSOR_RATE = (1<<0),
             BATCH_OPT_POST_FILTER = (1<<1),
+            BATCH_OPT_COMPRESS = (1<<2),
         };
 
+        // samples to wait for before sending a compressed message,
+        // unless the batch is complete
+        static const uint16_t isbc_min_samples = 256;
+
         void rotate_to_next_sensor();
         void update_doing_sensor_rate_logging();
 
@@ -391,6 +396,7 @@ public:
         bool isbh_sent : 1;
         bool _doing_sensor_rate_logging : 1;
         bool _doing_post_filter_logging : 1;
+        bool _compressing : 1; // sending this batch as ISBC
         uint8_t instance : 3; // instance we are sending data for
         AP_InertialSensor::IMU_SENSOR_TYPE type : 1;
         uint16_t isb_seqnum;
@@ -401,6 +407,10 @@ public:
         uint16_t data_read_offset; // units: samples
         uint32_t last_sent_ms;
 
+        // compression statistics for this batch
+        uint16_t isbc_msgs;
+        uint32_t isbc_encode_us;
+
         // all samples are multiplied by this
         uint16_t multiplier; // initialised as part of init()
 
@@ -316,6 +316,7 @@ void AP_InertialSensor_BMI055::read_fifo_gyro(void)
 
     // data is 16 bits with 2000dps range
     const float scale = radians(2000.0f) / 32767.0f;
+    Vector3f gyro_block[8];
     for (uint8_t i = 0; i < num_frames; i++) {
         const uint8_t *d = &data[i*6];
         int16_t xyz[3] {
@@ -326,8 +327,9 @@ void AP_InertialSensor_BMI055::read_fifo_gyro(void)
         gyro *= scale;
 
         _rotate_and_correct_gyro(gyro_instance, gyro);
-        _notify_new_gyro_raw_sample(gyro_instance, gyro);
+        gyro_block[i] = gyro;
     }
+    _notify_new_gyro_raw_samples(gyro_instance, gyro_block, num_frames);
 
     if (!dev_gyro->check_next_register()) {
         _inc_gyro_error_count(gyro_instance);
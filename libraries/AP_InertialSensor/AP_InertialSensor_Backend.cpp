@@ -54,14 +54,14 @@ void AP_InertialSensor_Backend::_set_gyro_oversampling(uint8_t instance, uint8_t
   sensor may vary slightly from the system clock. This slowly adjusts
   the rate to the observed rate
 */
-void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const
+void AP_InertialSensor_Backend::_update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint16_t nsamples) const
 {
     uint32_t now = AP_HAL::micros();
     if (start_us == 0) {
-        count = 0;
+        count = nsamples - 1;
         start_us = now;
     } else {
-        count++;
+        count += nsamples;
         if (now - start_us > 1000000UL) {
             float observed_rate_hz = count * 1.0e6f / (now - start_us);
 #if 0
@@ -127,6 +127,73 @@ void AP_InertialSensor_Backend::_rotate_and_correct_gyro(uint8_t instance, Vecto
     }
 }
 
+/*
+  the corrections are affine, so they can be found by correcting the
+  zero vector and the unit vectors. That costs more than correcting a
+  block of samples, so is only done when the inputs change
+ */
+void AP_InertialSensor_Backend::_update_accel_transform(uint8_t instance, const Matrix3f &raw_to_sensor, SampleTransform &t)
+{
+    const bool custom = _imu._board_orientation == ROTATION_CUSTOM && _imu._custom_rotation;
+    if (t.valid &&
+        t.raw_to_sensor == raw_to_sensor &&
+        t.offset == _imu._accel_offset[instance].get() &&
+        t.scale == _imu._accel_scale[instance].get() &&
+        t.orientation == _imu._accel_orientation[instance] &&
+        t.board_orientation == _imu._board_orientation &&
+        (!custom || t.custom_rotation == *_imu._custom_rotation)) {
+        return;
+    }
+    t.raw_to_sensor = raw_to_sensor;
+    t.offset = _imu._accel_offset[instance].get();
+    t.scale = _imu._accel_scale[instance].get();
+    t.orientation = _imu._accel_orientation[instance];
+    t.board_orientation = _imu._board_orientation;
+    if (custom) {
+        t.custom_rotation = *_imu._custom_rotation;
+    }
+
+    Vector3f e[3] { Vector3f(1,0,0), Vector3f(0,1,0), Vector3f(0,0,1) };
+    t.c.zero();
+    _rotate_and_correct_accel(instance, t.c);
+    for (uint8_t i=0; i<3; i++) {
+        _rotate_and_correct_accel(instance, e[i]);
+        e[i] -= t.c;
+    }
+    t.m = Matrix3f(e[0], e[1], e[2]).transposed() * raw_to_sensor;
+    t.valid = true;
+}
+
+void AP_InertialSensor_Backend::_update_gyro_transform(uint8_t instance, const Matrix3f &raw_to_sensor, SampleTransform &t)
+{
+    const bool custom = _imu._board_orientation == ROTATION_CUSTOM && _imu._custom_rotation;
+    if (t.valid &&
+        t.raw_to_sensor == raw_to_sensor &&
+        t.offset == _imu._gyro_offset[instance].get() &&
+        t.orientation == _imu._gyro_orientation[instance] &&
+        t.board_orientation == _imu._board_orientation &&
+        (!custom || t.custom_rotation == *_imu._custom_rotation)) {
+        return;
+    }
+    t.raw_to_sensor = raw_to_sensor;
+    t.offset = _imu._gyro_offset[instance].get();
+    t.orientation = _imu._gyro_orientation[instance];
+    t.board_orientation = _imu._board_orientation;
+    if (custom) {
+        t.custom_rotation = *_imu._custom_rotation;
+    }
+
+    Vector3f e[3] { Vector3f(1,0,0), Vector3f(0,1,0), Vector3f(0,0,1) };
+    t.c.zero();
+    _rotate_and_correct_gyro(instance, t.c);
+    for (uint8_t i=0; i<3; i++) {
+        _rotate_and_correct_gyro(instance, e[i]);
+        e[i] -= t.c;
+    }
+    t.m = Matrix3f(e[0], e[1], e[2]).transposed() * raw_to_sensor;
+    t.valid = true;
+}
+
 /*
   rotate gyro vector and add the gyro offset
  */
@@ -180,92 +247,186 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
         sample_us = _imu._gyro_last_sample_us[instance];
     }
 
+    _process_gyro_samples(instance, &gyro, 1, dt, last_sample_us, sample_us);
+}
+
+void AP_InertialSensor_Backend::_notify_new_gyro_raw_samples(uint8_t instance,
+                                                             const Vector3f *gyro,
+                                                             uint8_t n,
+                                                             float dt)
+{
+    if (n == 0 || ((1U<<instance) & _imu.imu_kill_mask)) {
+        return;
+    }
+
+    _update_sensor_rate(_imu._sample_gyro_count[instance], _imu._sample_gyro_start_us[instance],
+                        _imu._gyro_raw_sample_rates[instance], n);
+
+    if (dt <= 0) {
+        // don't accept below 100Hz
+        if (_imu._gyro_raw_sample_rates[instance] < 100) {
+            return;
+        }
+        dt = 1.0f / _imu._gyro_raw_sample_rates[instance];
+    }
+
+    // FIFO samples come in bunches, so the last one is taken as now
+    // and the others spaced by dt before it
+    uint64_t last_sample_us = _imu._gyro_last_sample_us[instance];
+    const uint64_t now = AP_HAL::micros64();
+    _imu._gyro_last_sample_us[instance] = now;
+
+    for (uint8_t ofs = 0; ofs < n; ofs += max_gyro_block) {
+        const uint8_t nblock = MIN(uint8_t(n - ofs), max_gyro_block);
+        const uint64_t sample_us = now - uint64_t((n - ofs - nblock) * dt * 1.0e6f);
+        _process_gyro_samples(instance, &gyro[ofs], nblock, dt, last_sample_us, sample_us);
+        last_sample_us = sample_us;
+    }
+}
+
+void AP_InertialSensor_Backend::_process_gyro_samples(uint8_t instance, const Vector3f *gyro, uint8_t n, float dt,
+                                                      uint64_t last_sample_us, uint64_t sample_us)
+{
 #if AP_MODULE_SUPPORTED
     // call gyro_sample hook if any
-    AP_Module::call_hook_gyro_sample(instance, dt, gyro);
+    for (uint8_t i = 0; i < n; i++) {
+        AP_Module::call_hook_gyro_sample(instance, dt, gyro[i]);
+    }
 #endif
 
     // push gyros if optical flow present
     if (hal.opticalflow) {
-        hal.opticalflow->push_gyro(gyro.x, gyro.y, dt);
+        for (uint8_t i = 0; i < n; i++) {
+            hal.opticalflow->push_gyro(gyro[i].x, gyro[i].y, dt);
+        }
     }
-    
-    // compute delta angle
-    Vector3f delta_angle = (gyro + _imu._last_raw_gyro[instance]) * 0.5f * dt;
-
-    // compute coning correction
-    // see page 26 of:
-    // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
-    // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
-    // see also examples/coning.py
-    Vector3f delta_coning = (_imu._delta_angle_acc[instance] +
-                             _imu._last_delta_angle[instance] * (1.0f / 6.0f));
-    delta_coning = delta_coning % delta_angle;
-    delta_coning *= 0.5f;
+
+    Vector3f gyro_filtered[max_gyro_block];
 
     {
         WITH_SEMAPHORE(_sem);
         uint64_t now = AP_HAL::micros64();
 
+        Vector3f delta_angle_acc = _imu._delta_angle_acc[instance];
+        float delta_angle_acc_dt = _imu._delta_angle_acc_dt[instance];
+        Vector3f last_delta_angle = _imu._last_delta_angle[instance];
+        Vector3f last_raw_gyro = _imu._last_raw_gyro[instance];
+        float sample_dt = dt;
+
         if (now - last_sample_us > 100000U) {
             // zero accumulator if sensor was unhealthy for 0.1s
-            _imu._delta_angle_acc[instance].zero();
-            _imu._delta_angle_acc_dt[instance] = 0;
-            dt = 0;
-            delta_angle.zero();
+            delta_angle_acc.zero();
+            delta_angle_acc_dt = 0;
+            sample_dt = 0;
+        }
+
+        for (uint8_t i = 0; i < n; i++) {
+            // compute delta angle
+            Vector3f delta_angle = (gyro[i] + last_raw_gyro) * 0.5f * sample_dt;
+
+            // compute coning correction
+            // see page 26 of:
+            // Tian et al (2010) Three-loop Integration of GPS and Strapdown INS with Coning and Sculling Compensation
+            // Available: http://www.sage.unsw.edu.au/snap/publications/tian_etal2010b.pdf
+            // see also examples/coning.py
+            Vector3f delta_coning = (delta_angle_acc +
+                                     last_delta_angle * (1.0f / 6.0f));
+            delta_coning = delta_coning % delta_angle;
+            delta_coning *= 0.5f;
+
+            // integrate delta angle accumulator
+            // the angles and coning corrections are accumulated separately in the
+            // referenced paper, but in simulation little difference was found between
+            // integrating together and integrating separately (see examples/coning.py)
+            delta_angle_acc += delta_angle + delta_coning;
+            delta_angle_acc_dt += sample_dt;
+
+            // save previous delta angle for coning correction
+            last_delta_angle = delta_angle;
+            last_raw_gyro = gyro[i];
+            sample_dt = dt;
         }
 
-        // integrate delta angle accumulator
-        // the angles and coning corrections are accumulated separately in the
-        // referenced paper, but in simulation little difference was found between
-        // integrating together and integrating separately (see examples/coning.py)
-        _imu._delta_angle_acc[instance] += delta_angle + delta_coning;
-        _imu._delta_angle_acc_dt[instance] += dt;
+        _imu._delta_angle_acc[instance] = delta_angle_acc;
+        _imu._delta_angle_acc_dt[instance] = delta_angle_acc_dt;
+        _imu._last_delta_angle[instance] = last_delta_angle;
+        _imu._last_raw_gyro[instance] = last_raw_gyro;
 
-        // save previous delta angle for coning correction
-        _imu._last_delta_angle[instance] = delta_angle;
-        _imu._last_raw_gyro[instance] = gyro;
 #if HAL_WITH_DSP
         // capture gyro window for FFT analysis
         if (_imu._gyro_window_size > 0) {
-            const Vector3f& scaled_gyro = gyro * _imu._gyro_raw_sampling_multiplier[instance];
-            _imu._gyro_window[instance][0].push(scaled_gyro.x);
-            _imu._gyro_window[instance][1].push(scaled_gyro.y);
-            _imu._gyro_window[instance][2].push(scaled_gyro.z);
+            const float multiplier = _imu._gyro_raw_sampling_multiplier[instance];
+            for (uint8_t i = 0; i < n; i++) {
+                _imu._gyro_window[instance][0].push(gyro[i].x * multiplier);
+            }
+            for (uint8_t i = 0; i < n; i++) {
+                _imu._gyro_window[instance][1].push(gyro[i].y * multiplier);
+            }
+            for (uint8_t i = 0; i < n; i++) {
+                _imu._gyro_window[instance][2].push(gyro[i].z * multiplier);
+            }
         }
 #endif
-        Vector3f gyro_filtered = gyro;
 
-        // apply the notch filter
-        if (_gyro_notch_enabled()) {
-            gyro_filtered = _imu._gyro_notch_filter[instance].apply(gyro_filtered);
-        }
+        // run each filter over the whole block, so its state and
+        // coefficients stay in cache. If the filtering fails in any way
+        // the filters are reset, the old value kept for that sample and
+        // the rest of the block filtered again from the reset state,
+        // just as when filtering one sample at a time
+        uint8_t first = 0;
+        while (first < n) {
+            for (uint8_t i = first; i < n; i++) {
+                gyro_filtered[i] = gyro[i];
+            }
 
-        // apply the harmonic notch filter
-        if (gyro_harmonic_notch_enabled()) {
-            gyro_filtered = _imu._gyro_harmonic_notch_filter[instance].apply(gyro_filtered);
-        }
+            // apply the notch filter
+            if (_gyro_notch_enabled()) {
+                NotchFilterVector3f &notch = _imu._gyro_notch_filter[instance];
+                for (uint8_t i = first; i < n; i++) {
+                    gyro_filtered[i] = notch.apply(gyro_filtered[i]);
+                }
+            }
+
+            // apply the harmonic notch filter
+            if (gyro_harmonic_notch_enabled()) {
+                HarmonicNotchFilterVector3f &notch = _imu._gyro_harmonic_notch_filter[instance];
+                for (uint8_t i = first; i < n; i++) {
+                    gyro_filtered[i] = notch.apply(gyro_filtered[i]);
+                }
+            }
 
-        // apply the low pass filter last to attentuate any notch induced noise
-        gyro_filtered = _imu._gyro_filter[instance].apply(gyro_filtered);
+            // apply the low pass filter last to attentuate any notch induced noise
+            LowPassFilter2pVector3f &lpf = _imu._gyro_filter[instance];
+            for (uint8_t i = first; i < n; i++) {
+                gyro_filtered[i] = lpf.apply(gyro_filtered[i]);
+            }
 
-        // if the filtering failed in any way then reset the filters and keep the old value
-        if (gyro_filtered.is_nan() || gyro_filtered.is_inf()) {
+            uint8_t bad = first;
+            while (bad < n && !gyro_filtered[bad].is_nan() && !gyro_filtered[bad].is_inf()) {
+                bad++;
+            }
+            if (bad == n) {
+                break;
+            }
             _imu._gyro_filter[instance].reset();
             _imu._gyro_notch_filter[instance].reset();
             _imu._gyro_harmonic_notch_filter[instance].reset();
-        } else {
-            _imu._gyro_filtered[instance] = gyro_filtered;
+            gyro_filtered[bad] = bad > 0 ? gyro_filtered[bad-1] : _imu._gyro_filtered[instance];
+            first = bad + 1;
         }
+        _imu._gyro_filtered[instance] = gyro_filtered[n-1];
 
         _imu._new_gyro_data[instance] = true;
     }
 
-    if (!_imu.batchsampler.doing_post_filter_logging()) {
-        log_gyro_raw(instance, sample_us, gyro);
-    }
-    else {
-        log_gyro_raw(instance, sample_us, _imu._gyro_filtered[instance]);
+    const bool post_filter = _imu.batchsampler.doing_post_filter_logging();
+    for (uint8_t i = 0; i < n; i++) {
+        const uint64_t t_us = sample_us - uint64_t((n - 1 - i) * dt * 1.0e6f);
+        if (!post_filter) {
+            log_gyro_raw(instance, t_us, gyro[i]);
+        } else {
+            log_gyro_raw(instance, t_us, gyro_filtered[i]);
+        }
     }
 }
 
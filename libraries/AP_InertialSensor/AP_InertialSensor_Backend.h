@@ -127,6 +127,32 @@ protected:
     void _rotate_and_correct_accel(uint8_t instance, Vector3f &accel);
     void _rotate_and_correct_gyro(uint8_t instance, Vector3f &gyro);
 
+    /*
+      the correction applied by _rotate_and_correct_accel() or
+      _rotate_and_correct_gyro() to raw register values, as
+      out = m * raw + c, for correcting a FIFOBlock at once. It is
+      kept by the backend and only recomputed when the calibration or
+      orientation changes
+     */
+    struct SampleTransform {
+        Matrix3f m;
+        Vector3f c;
+
+        // what m and c were computed from
+        Matrix3f raw_to_sensor;
+        Vector3f offset;
+        Vector3f scale;
+        Matrix3f custom_rotation;
+        enum Rotation orientation;
+        enum Rotation board_orientation;
+        bool valid;
+    };
+
+    // update a transform, where raw_to_sensor maps raw register
+    // values to the scaled sensor frame
+    void _update_accel_transform(uint8_t instance, const Matrix3f &raw_to_sensor, SampleTransform &t);
+    void _update_gyro_transform(uint8_t instance, const Matrix3f &raw_to_sensor, SampleTransform &t);
+
     // rotate gyro vector, offset and publish
     void _publish_gyro(uint8_t instance, const Vector3f &gyro);
 
@@ -138,6 +164,12 @@ protected:
     // sensors, and should be set to zero for FIFO based sensors
     void _notify_new_gyro_raw_sample(uint8_t instance, const Vector3f &accel, uint64_t sample_us=0);
 
+    // the same for a block of n rotated and corrected samples from a
+    // FIFO read, oldest first. Each filter stage is run over the whole
+    // block. dt is the sample interval, or zero to use the measured
+    // sample rate
+    void _notify_new_gyro_raw_samples(uint8_t instance, const Vector3f *gyro, uint8_t n, float dt=0);
+
     // rotate accel vector, scale, offset and publish
     void _publish_accel(uint8_t instance, const Vector3f &accel);
 
@@ -182,7 +214,7 @@ protected:
     }
 
     // update the sensor rate for FIFO sensors
-    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz) const;
+    void _update_sensor_rate(uint16_t &count, uint32_t &start_us, float &rate_hz, uint16_t nsamples=1) const;
 
     // return true if the sensors are still converging and sampling rates could change significantly
     bool sensors_converging() const { return AP_HAL::millis() < 30000; }
@@ -330,4 +362,12 @@ private:
     void log_accel_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &accel);
     void log_gyro_raw(uint8_t instance, const uint64_t sample_us, const Vector3f &gryo);
 
+    // largest block handled by _process_gyro_samples()
+    static const uint8_t max_gyro_block = 16;
+
+    // integrate, filter and log a block of gyro samples, the last one
+    // taken at sample_us
+    void _process_gyro_samples(uint8_t instance, const Vector3f *gyro, uint8_t n, float dt,
+                               uint64_t last_sample_us, uint64_t sample_us);
+
 };
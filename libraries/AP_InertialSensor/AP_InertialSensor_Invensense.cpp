@@ -57,6 +57,16 @@ extern const AP_HAL::HAL& hal;
 #define MPU_SAMPLE_SIZE 14
 #define MPU_FIFO_BUFFER_LEN 16
 
+// first register of each field in a FIFO sample
+#define MPU_FIFO_ACCEL 0
+#define MPU_FIFO_TEMP  3
+#define MPU_FIFO_GYRO  4
+
+// FIFO axes are (y, x, -z) in the sensor frame
+static const Matrix3f fifo_axes(0, 1, 0,
+                                1, 0, 0,
+                                0, 0, -1);
+
 #define int16_val(v, idx) ((int16_t)(((uint16_t)v[2*idx] << 8) | v[2*idx+1]))
 #define uint16_val(v, idx)(((uint16_t)v[2*idx] << 8) | v[2*idx+1])
 
@@ -83,6 +93,7 @@ AP_InertialSensor_Invensense::~AP_InertialSensor_Invensense()
     if (_fifo_buffer != nullptr) {
         hal.util->free_type(_fifo_buffer, MPU_FIFO_BUFFER_LEN * MPU_SAMPLE_SIZE, AP_HAL::Util::MEM_DMA_SAFE);
     }
+    delete _fifo_block;
     delete _auxiliary_bus;
 }
 
@@ -354,6 +365,11 @@ void AP_InertialSensor_Invensense::start()
     if (_fifo_buffer == nullptr) {
         AP_HAL::panic("Invensense: Unable to allocate FIFO buffer");
     }
+    static_assert(MPU_FIFO_BUFFER_LEN <= FIFOBlock::max_samples, "FIFOBlock too small");
+    _fifo_block = new FIFOBlock;
+    if (_fifo_block == nullptr) {
+        AP_HAL::panic("Invensense: Unable to allocate FIFO block");
+    }
 
     // start the timer process to read samples, using the fastest rate avilable
     _dev->register_periodic_callback(1000000UL / _gyro_backend_rate_hz, FUNCTOR_BIND_MEMBER(&AP_InertialSensor_Invensense::_poll_data, void));
@@ -428,43 +444,45 @@ void AP_InertialSensor_Invensense::_poll_data()
 
 bool AP_InertialSensor_Invensense::_accumulate(uint8_t *samples, uint8_t n_samples)
 {
-    for (uint8_t i = 0; i < n_samples; i++) {
-        const uint8_t *data = samples + MPU_SAMPLE_SIZE * i;
-        Vector3f accel, gyro;
-        bool fsync_set = false;
-
-#if INVENSENSE_EXT_SYNC_ENABLE
-        fsync_set = (int16_val(data, 2) & 1U) != 0;
-#endif
-        
-        accel = Vector3f(int16_val(data, 1),
-                         int16_val(data, 0),
-                         -int16_val(data, 2));
-        accel *= _accel_scale;
-
-        int16_t t2 = int16_val(data, 3);
-        if (!_check_raw_temp(t2)) {
-            if (!hal.scheduler->in_expected_delay()) {
-                debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
-            }
-            _fifo_reset(true);
-            return false;
+    FIFOBlock &b = *_fifo_block;
+    b.decode_be16(samples, MPU_SAMPLE_SIZE, n_samples);
+
+    // use temperature to detect FIFO corruption, keeping the samples
+    // before the first bad one
+    uint8_t n_good;
+    for (n_good = 0; n_good < n_samples; n_good++) {
+        if (!_check_raw_temp(b.raw[MPU_FIFO_TEMP][n_good])) {
+            break;
         }
-        float temp = t2 * temp_sensitivity + temp_zero;
-        
-        gyro = Vector3f(int16_val(data, 5),
-                        int16_val(data, 4),
-                        -int16_val(data, 6));
-        gyro *= _gyro_scale;
+    }
 
-        _rotate_and_correct_accel(_accel_instance, accel);
-        _rotate_and_correct_gyro(_gyro_instance, gyro);
+    // scale, rotate and correct the whole block
+    _update_accel_transform(_accel_instance, fifo_axes * _accel_scale, _accel_transform);
+    _update_gyro_transform(_gyro_instance, fifo_axes * _gyro_scale, _gyro_transform);
+    FIFOBlock::transform(b.raw[MPU_FIFO_ACCEL], b.raw[MPU_FIFO_ACCEL+1], b.raw[MPU_FIFO_ACCEL+2], n_good,
+                         _accel_transform.m, _accel_transform.c, b.accel);
+    FIFOBlock::transform(b.raw[MPU_FIFO_GYRO], b.raw[MPU_FIFO_GYRO+1], b.raw[MPU_FIFO_GYRO+2], n_good,
+                         _gyro_transform.m, _gyro_transform.c, b.gyro);
 
-        _notify_new_accel_raw_sample(_accel_instance, accel, 0, fsync_set);
-        _notify_new_gyro_raw_sample(_gyro_instance, gyro);
+    for (uint8_t i = 0; i < n_good; i++) {
+        bool fsync_set = false;
+#if INVENSENSE_EXT_SYNC_ENABLE
+        fsync_set = (b.raw[MPU_FIFO_ACCEL+2][i] & 1U) != 0;
+#endif
+        _notify_new_accel_raw_sample(_accel_instance, b.accel[i], 0, fsync_set);
 
+        float temp = b.raw[MPU_FIFO_TEMP][i] * temp_sensitivity + temp_zero;
         _temp_filtered = _temp_filter.apply(temp);
     }
+    _notify_new_gyro_raw_samples(_gyro_instance, b.gyro, n_good);
+
+    if (n_good < n_samples) {
+        if (!hal.scheduler->in_expected_delay()) {
+            debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, b.raw[MPU_FIFO_TEMP][n_good]);
+        }
+        _fifo_reset(true);
+        return false;
+    }
     return true;
 }
 
@@ -478,31 +496,37 @@ bool AP_InertialSensor_Invensense::_accumulate(uint8_t *samples, uint8_t n_sampl
  */
 bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *samples, uint8_t n_samples)
 {
+    FIFOBlock &b = *_fifo_block;
+    b.decode_be16(samples, MPU_SAMPLE_SIZE, n_samples);
+
     int32_t tsum = 0;
     const int32_t unscaled_clip_limit = _clip_limit / _accel_scale;
     bool clipped = false;
     bool ret = true;
-    
-    for (uint8_t i = 0; i < n_samples; i++) {
-        const uint8_t *data = samples + MPU_SAMPLE_SIZE * i;
 
-        // use temperatue to detect FIFO corruption
-        int16_t t2 = int16_val(data, 3);
+    // use temperatue to detect FIFO corruption, keeping the samples
+    // before the first bad one
+    uint8_t n_good;
+    for (n_good = 0; n_good < n_samples; n_good++) {
+        const int16_t t2 = b.raw[MPU_FIFO_TEMP][n_good];
         if (!_check_raw_temp(t2)) {
-            if (!hal.scheduler->in_expected_delay()) {
-                debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
-            }
-            _fifo_reset(true);
-            ret = false;
             break;
         }
         tsum += t2;
+    }
+
+    // unscaled sensor frame samples, filtered and accumulated below
+    FIFOBlock::transform(b.raw[MPU_FIFO_ACCEL], b.raw[MPU_FIFO_ACCEL+1], b.raw[MPU_FIFO_ACCEL+2], n_good, fifo_axes, Vector3f(), b.accel);
+    FIFOBlock::transform(b.raw[MPU_FIFO_GYRO], b.raw[MPU_FIFO_GYRO+1], b.raw[MPU_FIFO_GYRO+2], n_good, fifo_axes, Vector3f(), b.gyro);
+
+    // downsampled gyro samples, for the backend as one block
+    Vector3f gyro_out[FIFOBlock::max_samples];
+    uint8_t n_out = 0;
 
+    for (uint8_t i = 0; i < n_good; i++) {
         if (_accum.gyro_count % _gyro_to_accel_sample_ratio == 0) {
             // accel data is at 4kHz or 1kHz
-            Vector3f a(int16_val(data, 1),
-                       int16_val(data, 0),
-                       -int16_val(data, 2));
+            const Vector3f &a = b.accel[i];
             if (fabsf(a.x) > unscaled_clip_limit ||
                 fabsf(a.y) > unscaled_clip_limit ||
                 fabsf(a.z) > unscaled_clip_limit) {
@@ -528,9 +552,7 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
 
         _accum.gyro_count++;
 
-        Vector3f g(int16_val(data, 5),
-                   int16_val(data, 4),
-                   -int16_val(data, 6));
+        const Vector3f &g = b.gyro[i];
 
         Vector3f g2 = g * _gyro_scale;
         _notify_new_gyro_sensor_rate_sample(_gyro_instance, g2);
@@ -540,15 +562,24 @@ bool AP_InertialSensor_Invensense::_accumulate_sensor_rate_sampling(uint8_t *sam
         if (_accum.gyro_count % _gyro_fifo_downsample_rate == 0) {
             _accum.gyro *= _fifo_gyro_scale;
             _rotate_and_correct_gyro(_gyro_instance, _accum.gyro);
-            _notify_new_gyro_raw_sample(_gyro_instance, _accum.gyro);
+            gyro_out[n_out++] = _accum.gyro;
             _accum.gyro.zero();
         }
     }
+    _notify_new_gyro_raw_samples(_gyro_instance, gyro_out, n_out);
 
     if (clipped) {
         increment_clip_count(_accel_instance);
     }
 
+    if (n_good < n_samples) {
+        if (!hal.scheduler->in_expected_delay()) {
+            debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, b.raw[MPU_FIFO_TEMP][n_good]);
+        }
+        _fifo_reset(true);
+        ret = false;
+    }
+
     if (ret) {
         float temp = (static_cast<float>(tsum)/n_samples)*temp_sensitivity + temp_zero;
         _temp_filtered = _temp_filter.apply(temp);
@@ -21,6 +21,7 @@
 #include "AP_InertialSensor.h"
 #include "AP_InertialSensor_Backend.h"
 #include "AuxiliaryBus.h"
+#include "FIFOBlock.h"
 
 class AP_Invensense_AuxiliaryBus;
 class AP_Invensense_AuxiliaryBusSlave;
@@ -161,6 +162,11 @@ private:
     // buffer for fifo read
     uint8_t *_fifo_buffer;
 
+    // fifo read decoded into arrays
+    FIFOBlock *_fifo_block;
+    SampleTransform _accel_transform;
+    SampleTransform _gyro_transform;
+
     /*
       accumulators for sensor_rate sampling
       See description in _accumulate_sensor_rate_sampling()
@@ -308,6 +308,9 @@ void AP_InertialSensor_Invensensev2::_poll_data()
 
 bool AP_InertialSensor_Invensensev2::_accumulate(uint8_t *samples, uint8_t n_samples)
 {
+    Vector3f gyro_block[INV2_FIFO_BUFFER_LEN];
+    uint8_t n_gyro = 0;
+
     for (uint8_t i = 0; i < n_samples; i++) {
         const uint8_t *data = samples + INV2_SAMPLE_SIZE * i;
         Vector3f accel, gyro;
@@ -327,6 +330,7 @@ bool AP_InertialSensor_Invensensev2::_accumulate(uint8_t *samples, uint8_t n_sam
             if (!hal.scheduler->in_expected_delay()) {
                 debug("temp reset IMU[%u] %d %d", _accel_instance, _raw_temp, t2);
             }
+            _notify_new_gyro_raw_samples(_gyro_instance, gyro_block, n_gyro);
             _fifo_reset();
             return false;
         }
@@ -341,10 +345,11 @@ bool AP_InertialSensor_Invensensev2::_accumulate(uint8_t *samples, uint8_t n_sam
         _rotate_and_correct_gyro(_gyro_instance, gyro);
 
         _notify_new_accel_raw_sample(_accel_instance, accel, 0, fsync_set);
-        _notify_new_gyro_raw_sample(_gyro_instance, gyro);
+        gyro_block[n_gyro++] = gyro;
 
         _temp_filtered = _temp_filter.apply(temp);
     }
+    _notify_new_gyro_raw_samples(_gyro_instance, gyro_block, n_gyro);
     return true;
 }
 
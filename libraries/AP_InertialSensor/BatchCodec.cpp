@@ -0,0 +1,214 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BatchCodec.h"
+
+#include <string.h>
+
+namespace {
+
+class BitWriter {
+public:
+    BitWriter(uint8_t *_buf) : buf(_buf) {}
+
+    // append the low bits of v, bits <= 32
+    void put(uint32_t v, uint8_t bits) {
+        acc = (acc << bits) | (v & ((uint64_t(1) << bits) - 1));
+        nacc += bits;
+        while (nacc >= 8) {
+            nacc -= 8;
+            buf[ofs++] = uint8_t(acc >> nacc);
+        }
+    }
+
+    // write out any partial byte
+    void flush() {
+        if (nacc > 0) {
+            buf[ofs++] = uint8_t(acc << (8 - nacc));
+            nacc = 0;
+        }
+    }
+
+private:
+    uint8_t *buf;
+    uint16_t ofs = 0;
+    uint64_t acc = 0;
+    uint8_t nacc = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t *_buf, uint16_t _nbits) : buf(_buf), nbits(_nbits) {}
+
+    // read one bit, returning false past the end of the data
+    bool get_bit(uint8_t &b) {
+        if (pos >= nbits) {
+            return false;
+        }
+        b = (buf[pos/8] >> (7 - pos%8)) & 1;
+        pos++;
+        return true;
+    }
+
+    bool get(uint32_t &v, uint8_t bits) {
+        v = 0;
+        for (uint8_t i = 0; i < bits; i++) {
+            uint8_t b;
+            if (!get_bit(b)) {
+                return false;
+            }
+            v = (v << 1) | b;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t *buf;
+    const uint16_t nbits;
+    uint16_t pos = 0;
+};
+
+uint32_t zigzag(int32_t d)
+{
+    return (uint32_t(d) << 1) ^ uint32_t(d >> 31);
+}
+
+int32_t unzigzag(uint32_t u)
+{
+    return int32_t(u >> 1) ^ -int32_t(u & 1);
+}
+
+}
+
+uint16_t BatchCodec::encode(const int16_t *x, const int16_t *y, const int16_t *z, uint16_t n,
+                            uint8_t data[max_bytes], uint8_t &nbytes)
+{
+    nbytes = 0;
+    if (n == 0) {
+        return 0;
+    }
+    const int16_t *axis[3] { x, y, z };
+
+    /*
+      choose the Rice parameter for each axis from the mean size of
+      the differences at the start of the run: the largest k with
+      2^k no more than the mean
+     */
+    const uint16_t nwin = n < window ? n : window;
+    uint8_t k[3] {};
+    for (uint8_t a = 0; a < 3; a++) {
+        const int16_t *v = axis[a];
+        uint32_t sum = 0;
+        for (uint16_t i = 1; i < nwin; i++) {
+            sum += zigzag(int32_t(v[i]) - v[i-1]);
+        }
+        while (k[a] < 15 && (sum >> (k[a]+1)) >= nwin) {
+            k[a]++;
+        }
+    }
+
+    memset(data, 0, max_bytes);
+    BitWriter w(data);
+    for (uint8_t a = 0; a < 3; a++) {
+        w.put(uint16_t(axis[a][0]), 16);
+    }
+    for (uint8_t a = 0; a < 3; a++) {
+        w.put(k[a], 4);
+    }
+    uint16_t used = 3*16 + 3*4;
+
+    uint16_t count = 1;
+    for (; count < n; count++) {
+        uint32_t u[3];
+        uint16_t bits = 0;
+        for (uint8_t a = 0; a < 3; a++) {
+            u[a] = zigzag(int32_t(axis[a][count]) - axis[a][count-1]);
+            const uint32_t q = u[a] >> k[a];
+            bits += q < escape_bits ? q + 1 + k[a] : escape_bits + raw_bits;
+        }
+        if (used + bits > max_bytes * 8U) {
+            // next sample doesn't fit
+            break;
+        }
+        for (uint8_t a = 0; a < 3; a++) {
+            const uint32_t q = u[a] >> k[a];
+            if (q < escape_bits) {
+                // q ones, a zero, then the low k bits
+                w.put((1U << (q+1)) - 2, q+1);
+                w.put(u[a], k[a]);
+            } else {
+                w.put((1U << escape_bits) - 1, escape_bits);
+                w.put(u[a], raw_bits);
+            }
+        }
+        used += bits;
+    }
+    w.flush();
+    nbytes = (used + 7) / 8;
+    return count;
+}
+
+bool BatchCodec::decode(const uint8_t data[max_bytes], uint16_t count,
+                        int16_t *x, int16_t *y, int16_t *z)
+{
+    if (count == 0) {
+        return true;
+    }
+    int16_t *axis[3] { x, y, z };
+    BitReader r(data, max_bytes * 8U);
+    uint32_t v;
+    for (uint8_t a = 0; a < 3; a++) {
+        if (!r.get(v, 16)) {
+            return false;
+        }
+        axis[a][0] = int16_t(uint16_t(v));
+    }
+    uint32_t k[3];
+    for (uint8_t a = 0; a < 3; a++) {
+        if (!r.get(k[a], 4)) {
+            return false;
+        }
+    }
+    for (uint16_t i = 1; i < count; i++) {
+        for (uint8_t a = 0; a < 3; a++) {
+            uint8_t q = 0;
+            uint8_t b;
+            while (q < escape_bits) {
+                if (!r.get_bit(b)) {
+                    return false;
+                }
+                if (b == 0) {
+                    break;
+                }
+                q++;
+            }
+            uint32_t u;
+            if (q < escape_bits) {
+                if (!r.get(v, k[a])) {
+                    return false;
+                }
+                u = (uint32_t(q) << k[a]) | v;
+            } else if (!r.get(u, raw_bits)) {
+                return false;
+            }
+            const int32_t value = axis[a][i-1] + unzigzag(u);
+            if (value < INT16_MIN || value > INT16_MAX) {
+                return false;
+            }
+            axis[a][i] = int16_t(value);
+        }
+    }
+    return true;
+}
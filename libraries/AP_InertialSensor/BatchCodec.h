@@ -0,0 +1,61 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  lossless coding of IMU batch sampler data for the ISBC log message.
+
+  Each message decodes on its own. It starts with the first sample of
+  each axis and a Rice parameter per axis, followed by the difference
+  between each sample and the one before it, zigzag mapped to an
+  unsigned value and Rice coded. Differences too large for the Rice
+  code are escaped and written in full. Bits are packed most
+  significant first.
+
+  Tools/scripts/decode_isbc.py is a Python version of the decoder;
+  the two must be kept in step.
+ */
+#pragma once
+
+#include <stdint.h>
+
+class BatchCodec {
+public:
+    // bytes of coded data in an ISBC message
+    static const uint8_t max_bytes = 192;
+
+    // most samples a message can hold, at one bit per difference
+    static const uint16_t max_samples = 1 + (max_bytes*8 - 3*16 - 3*4) / 3;
+
+    /*
+      code as many of the n samples as fit into data, returning the
+      number coded. nbytes is set to the number of bytes used
+     */
+    static uint16_t encode(const int16_t *x, const int16_t *y, const int16_t *z, uint16_t n,
+                           uint8_t data[max_bytes], uint8_t &nbytes);
+
+    /*
+      decode count samples from data. Returns false if the data is
+      corrupt
+     */
+    static bool decode(const uint8_t data[max_bytes], uint16_t count,
+                       int16_t *x, int16_t *y, int16_t *z);
+
+private:
+    // bits in the unary part of a code before it is escaped
+    static const uint8_t escape_bits = 16;
+    // bits in an escaped difference
+    static const uint8_t raw_bits = 17;
+    // samples used to choose the Rice parameters
+    static const uint8_t window = 64;
+};
@@ -1,6 +1,9 @@
 #include "AP_InertialSensor.h"
 #include <GCS_MAVLink/GCS.h>
 #include <AP_Logger/AP_Logger.h>
+#include "BatchCodec.h"
+
+static_assert(sizeof(log_ISBC::data) == BatchCodec::max_bytes, "ISBC data must match BatchCodec");
 
 // Class level parameters
 const AP_Param::GroupInfo AP_InertialSensor::BatchSampler::var_info[] = {
@@ -23,8 +26,8 @@ const AP_Param::GroupInfo AP_InertialSensor::BatchSampler::var_info[] = {
 
     // @Param: BAT_OPT
     // @DisplayName: Batch Logging Options Mask
-    // @Description: Options for the BatchSampler. Post-filter and sensor-rate logging cannot be used at the same time.
-    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering
+    // @Description: Options for the BatchSampler. Post-filter and sensor-rate logging cannot be used at the same time. Compressed logging writes the samples losslessly as ISBC messages instead of ISBD messages, which takes fewer messages per batch.
+    // @Bitmask: 0:Sensor-Rate Logging (sample at full sensor rate seen by AP), 1: Sample post-filtering, 2: Compressed logging
     // @User: Advanced
     AP_GROUPINFO("BAT_OPT",  3, AP_InertialSensor::BatchSampler, _batch_options_mask, 0),
 
@@ -117,6 +120,10 @@ void AP_InertialSensor::BatchSampler::rotate_to_next_sensor()
         // should not have been called
         return;
     }
+
+    // a batch is sent either all compressed or all uncompressed
+    _compressing = (batch_opt_t)(_batch_options_mask.get()) & BATCH_OPT_COMPRESS;
+
     if ((1U<<instance) > (uint8_t)_sensor_mask) {
         // should only ever happen if user resets _sensor_mask
         instance = 0;
@@ -178,7 +185,15 @@ void AP_InertialSensor::BatchSampler::push_data_to_log()
     if (_sensor_mask == 0) {
         return;
     }
-    if (data_write_offset - data_read_offset < samples_per_msg) {
+    const uint16_t available = data_write_offset - data_read_offset;
+    if (_compressing) {
+        // wait for enough data to fill a compressed packet, unless
+        // the batch is complete
+        if (available == 0 ||
+            (available < isbc_min_samples && data_write_offset < _required_count)) {
+            return;
+        }
+    } else if (available < samples_per_msg) {
         // insuffucient data to pack a packet
         return;
     }
@@ -222,18 +237,44 @@ void AP_InertialSensor::BatchSampler::push_data_to_log()
         isbh_sent = true;
     }
     // pack and send a data packet:
-    if (!logger->Write_ISBD(isb_seqnum,
-                                   data_read_offset/samples_per_msg,
-                                   &data_x[data_read_offset],
-                                   &data_y[data_read_offset],
-                                   &data_z[data_read_offset])) {
-        // maybe later?!
-        return;
+    uint16_t sent;
+    if (_compressing) {
+        uint8_t data[BatchCodec::max_bytes];
+        uint8_t nbytes;
+        const uint32_t start_us = AP_HAL::micros();
+        sent = BatchCodec::encode(&data_x[data_read_offset],
+                                  &data_y[data_read_offset],
+                                  &data_z[data_read_offset],
+                                  available, data, nbytes);
+        isbc_encode_us += AP_HAL::micros() - start_us;
+        if (!logger->Write_ISBC(isb_seqnum, data_read_offset, sent, data)) {
+            // maybe later?!
+            return;
+        }
+        isbc_msgs++;
+    } else {
+        if (!logger->Write_ISBD(isb_seqnum,
+                                       data_read_offset/samples_per_msg,
+                                       &data_x[data_read_offset],
+                                       &data_y[data_read_offset],
+                                       &data_z[data_read_offset])) {
+            // maybe later?!
+            return;
+        }
+        sent = samples_per_msg;
     }
-    data_read_offset += samples_per_msg;
+    data_read_offset += sent;
     last_sent_ms = AP_HAL::millis();
     if (data_read_offset >= _required_count) {
         // that was the last one.  Clean up:
+        if (_compressing) {
+            const uint16_t per_msg = MAX(samples_per_msg.get(), 1);
+            const uint16_t isbd_msgs = (_required_count + per_msg - 1) / per_msg;
+            const float ratio = float(isbd_msgs * sizeof(log_ISBD)) / (isbc_msgs * sizeof(log_ISBC));
+            logger->Write_ISBS(isb_seqnum, _required_count, isbc_msgs, ratio, isbc_encode_us);
+            isbc_msgs = 0;
+            isbc_encode_us = 0;
+        }
         data_read_offset = 0;
         isb_seqnum++;
         isbh_sent = false;
@@ -0,0 +1,45 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "FIFOBlock.h"
+
+void FIFOBlock::decode_be16(const uint8_t *fifo, uint8_t sample_size, uint8_t n)
+{
+    const uint8_t nregs = MIN(uint8_t(sample_size/2), max_regs);
+    n = MIN(n, max_samples);
+    for (uint8_t r = 0; r < nregs; r++) {
+        const uint8_t *p = &fifo[2*r];
+        int16_t *out = raw[r];
+        for (uint8_t i = 0; i < n; i++) {
+            out[i] = int16_t((uint16_t(p[i*sample_size]) << 8) | p[i*sample_size+1]);
+        }
+    }
+}
+
+void FIFOBlock::transform(const int16_t *x, const int16_t *y, const int16_t *z, uint8_t n,
+                          const Matrix3f &m, const Vector3f &c, Vector3f *out)
+{
+    // copy to locals so the compiler knows they don't alias out
+    const float m00 = m.a.x, m01 = m.a.y, m02 = m.a.z;
+    const float m10 = m.b.x, m11 = m.b.y, m12 = m.b.z;
+    const float m20 = m.c.x, m21 = m.c.y, m22 = m.c.z;
+    const float c0 = c.x, c1 = c.y, c2 = c.z;
+    for (uint8_t i = 0; i < n; i++) {
+        const float fx = x[i], fy = y[i], fz = z[i];
+        out[i].x = m00*fx + m01*fy + m02*fz + c0;
+        out[i].y = m10*fx + m11*fy + m12*fz + c1;
+        out[i].z = m20*fx + m21*fy + m22*fz + c2;
+    }
+}
@@ -0,0 +1,52 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  block decoding of IMU FIFO reads.
+
+  A FIFO read is decoded into one array per 16 bit register, and the
+  axis mapping, scaling, offsets and rotations that a backend applies
+  to each sample are folded into one affine transform which is then
+  applied to the whole block. The loops have no calls or branches, so
+  the compiler can vectorise them.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <AP_Math/AP_Math.h>
+
+class FIFOBlock {
+public:
+    // largest FIFO read, in samples
+    static const uint8_t max_samples = 16;
+
+    // largest sample, in 16 bit registers
+    static const uint8_t max_regs = 8;
+
+    /*
+      decode n big endian samples of sample_size bytes into raw[][],
+      one array per register
+     */
+    void decode_be16(const uint8_t *fifo, uint8_t sample_size, uint8_t n);
+
+    /*
+      out[i] = m * (x[i], y[i], z[i]) + c for n samples
+     */
+    static void transform(const int16_t *x, const int16_t *y, const int16_t *z, uint8_t n,
+                          const Matrix3f &m, const Vector3f &c, Vector3f *out);
+
+    int16_t raw[max_regs][max_samples];
+    Vector3f accel[max_samples];
+    Vector3f gyro[max_samples];
+};
@@ -0,0 +1,173 @@
+/*
+  samples per second for decoding and correcting Invensense FIFO data,
+  one sample at a time as the backend used to and in blocks with
+  FIFOBlock.
+
+  Set FIFO_DUMP to a file of raw FIFO reads (14 byte samples: accel,
+  temperature, gyro, big endian) to use recorded data, otherwise a
+  synthetic vibration signal is used.
+ */
+#include <AP_gbenchmark.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_InertialSensor/FIFOBlock.h>
+
+#define SAMPLE_SIZE 14
+#define MAX_SAMPLES 8192
+
+#define int16_val(v, idx) ((int16_t)(((uint16_t)v[2*idx] << 8) | v[2*idx+1]))
+
+static uint8_t fifo[MAX_SAMPLES * SAMPLE_SIZE];
+static uint32_t fifo_samples;
+
+// calibration and orientation of a typical board
+static const Vector3f accel_offset(0.12f, -0.05f, 0.31f);
+static const Vector3f accel_cal_scale(1.002f, 0.997f, 1.011f);
+static const Vector3f gyro_offset(0.003f, -0.001f, 0.002f);
+static const float accel_scale = GRAVITY_MSS / 2048.0f;
+static const float gyro_scale = radians(2000.0f) / 32767.5f;
+
+static void put16(uint8_t *p, int16_t v)
+{
+    p[0] = uint16_t(v) >> 8;
+    p[1] = uint16_t(v) & 0xFF;
+}
+
+static void load_fifo(void)
+{
+    if (fifo_samples != 0) {
+        return;
+    }
+    const char *fname = getenv("FIFO_DUMP");
+    if (fname != nullptr) {
+        FILE *f = fopen(fname, "rb");
+        if (f != nullptr) {
+            fifo_samples = fread(fifo, SAMPLE_SIZE, MAX_SAMPLES, f);
+            fclose(f);
+        }
+        if (fifo_samples != 0) {
+            return;
+        }
+        ::printf("Unable to read %s, using synthetic data\n", fname);
+    }
+    // 1g on z, with motor vibration and noise at 8kHz
+    for (uint32_t i=0; i<MAX_SAMPLES; i++) {
+        uint8_t *p = &fifo[i*SAMPLE_SIZE];
+        const float t = i / 8000.0f;
+        const float vib = sinf(2*M_PI*180*t) + 0.3f*sinf(2*M_PI*360*t);
+        put16(&p[0], int16_t(300*vib + (random() % 64) - 32));
+        put16(&p[2], int16_t(200*vib + (random() % 64) - 32));
+        put16(&p[4], int16_t(-2048 + 500*vib + (random() % 64) - 32));
+        put16(&p[6], int16_t(1200 + (random() % 16)));
+        put16(&p[8], int16_t(150*vib + (random() % 16) - 8));
+        put16(&p[10], int16_t(100*vib + (random() % 16) - 8));
+        put16(&p[12], int16_t(50*vib + (random() % 16) - 8));
+    }
+    fifo_samples = MAX_SAMPLES;
+}
+
+static void correct_accel(Vector3f &accel)
+{
+    accel.rotate(ROTATION_YAW_90);
+    accel -= accel_offset;
+    accel.x *= accel_cal_scale.x;
+    accel.y *= accel_cal_scale.y;
+    accel.z *= accel_cal_scale.z;
+    accel.rotate(ROTATION_ROLL_180);
+}
+
+static void correct_gyro(Vector3f &gyro)
+{
+    gyro.rotate(ROTATION_YAW_90);
+    gyro -= gyro_offset;
+    gyro.rotate(ROTATION_ROLL_180);
+}
+
+/*
+  the per sample decode done by AP_InertialSensor_Invensense::_accumulate()
+ */
+static void BM_FIFODecodeSample(benchmark::State& state)
+{
+    load_fifo();
+    const uint8_t n = state.range(0);
+    uint32_t ofs = 0;
+    while (state.KeepRunning()) {
+        if (ofs + n > fifo_samples) {
+            ofs = 0;
+        }
+        for (uint8_t i = 0; i < n; i++) {
+            const uint8_t *data = &fifo[(ofs+i)*SAMPLE_SIZE];
+            Vector3f accel(int16_val(data, 1),
+                           int16_val(data, 0),
+                           -int16_val(data, 2));
+            accel *= accel_scale;
+            Vector3f gyro(int16_val(data, 5),
+                          int16_val(data, 4),
+                          -int16_val(data, 6));
+            gyro *= gyro_scale;
+            correct_accel(accel);
+            correct_gyro(gyro);
+            gbenchmark_escape(&accel);
+            gbenchmark_escape(&gyro);
+        }
+        ofs += n;
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_FIFODecodeSample)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+/*
+  get the affine transform of a correction, as
+  AP_InertialSensor_Backend::_update_accel_transform() does
+ */
+static void get_transform(void (*correct)(Vector3f &), const Matrix3f &raw_to_sensor, Matrix3f &m, Vector3f &c)
+{
+    Vector3f e[3] { Vector3f(1,0,0), Vector3f(0,1,0), Vector3f(0,0,1) };
+    c.zero();
+    correct(c);
+    for (uint8_t i=0; i<3; i++) {
+        correct(e[i]);
+        e[i] -= c;
+    }
+    m = Matrix3f(e[0], e[1], e[2]).transposed() * raw_to_sensor;
+}
+
+/*
+  block decode. The backend only finds the transforms again when the
+  calibration or orientation changes, so that is outside the loop
+ */
+static void BM_FIFODecodeBlock(benchmark::State& state)
+{
+    load_fifo();
+    const uint8_t n = state.range(0);
+    const Matrix3f fifo_axes(0, 1, 0,
+                             1, 0, 0,
+                             0, 0, -1);
+    Matrix3f accel_m, gyro_m;
+    Vector3f accel_c, gyro_c;
+    get_transform(correct_accel, fifo_axes * accel_scale, accel_m, accel_c);
+    get_transform(correct_gyro, fifo_axes * gyro_scale, gyro_m, gyro_c);
+
+    FIFOBlock *b = new FIFOBlock;
+    uint32_t ofs = 0;
+    while (state.KeepRunning()) {
+        if (ofs + n > fifo_samples) {
+            ofs = 0;
+        }
+        b->decode_be16(&fifo[ofs*SAMPLE_SIZE], SAMPLE_SIZE, n);
+        FIFOBlock::transform(b->raw[0], b->raw[1], b->raw[2], n, accel_m, accel_c, b->accel);
+        FIFOBlock::transform(b->raw[4], b->raw[5], b->raw[6], n, gyro_m, gyro_c, b->gyro);
+        gbenchmark_escape(b);
+        ofs += n;
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+    delete b;
+}
+
+BENCHMARK(BM_FIFODecodeBlock)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+#include <math.h>
+
+#include <AP_InertialSensor/BatchCodec.h>
+
+#define NUM_SAMPLES 1024
+
+/*
+  code a batch into as many messages as it takes, check it decodes
+  back exactly and return the number of messages
+ */
+static uint16_t round_trip(const int16_t *x, const int16_t *y, const int16_t *z, uint16_t n)
+{
+    int16_t dx[NUM_SAMPLES], dy[NUM_SAMPLES], dz[NUM_SAMPLES];
+    uint16_t ofs = 0;
+    uint16_t msgs = 0;
+    while (ofs < n) {
+        uint8_t data[BatchCodec::max_bytes];
+        uint8_t nbytes;
+        const uint16_t count = BatchCodec::encode(&x[ofs], &y[ofs], &z[ofs], n - ofs, data, nbytes);
+        EXPECT_GT(count, 0);
+        EXPECT_LE(nbytes, unsigned(BatchCodec::max_bytes));
+        EXPECT_TRUE(BatchCodec::decode(data, count, &dx[ofs], &dy[ofs], &dz[ofs]));
+        ofs += count;
+        msgs++;
+    }
+    for (uint16_t i=0; i<n; i++) {
+        EXPECT_EQ(x[i], dx[i]) << "at " << i;
+        EXPECT_EQ(y[i], dy[i]) << "at " << i;
+        EXPECT_EQ(z[i], dz[i]) << "at " << i;
+    }
+    return msgs;
+}
+
+// 1g on z with motor vibration and sensor noise, as accels are logged
+TEST(BatchCodec, vibration)
+{
+    int16_t x[NUM_SAMPLES], y[NUM_SAMPLES], z[NUM_SAMPLES];
+    srandom(1);
+    for (uint16_t i=0; i<NUM_SAMPLES; i++) {
+        const float t = i / 1000.0f;
+        const float vib = sinf(2*M_PI*180*t) + 0.3f*sinf(2*M_PI*360*t);
+        x[i] = 300*vib + (random() % 64) - 32;
+        y[i] = 200*vib + (random() % 64) - 32;
+        z[i] = -2048 + 500*vib + (random() % 64) - 32;
+    }
+    const uint16_t msgs = round_trip(x, y, z, NUM_SAMPLES);
+    // uncompressed takes one ISBD message per 32 samples
+    EXPECT_LT(msgs, NUM_SAMPLES/32);
+}
+
+// full scale steps and noise need the escape code
+TEST(BatchCodec, extremes)
+{
+    int16_t x[NUM_SAMPLES], y[NUM_SAMPLES], z[NUM_SAMPLES];
+    srandom(2);
+    for (uint16_t i=0; i<NUM_SAMPLES; i++) {
+        x[i] = (i & 1) ? INT16_MAX : INT16_MIN;
+        y[i] = random();
+        z[i] = (i % 100 < 50) ? 0 : -1;
+    }
+    round_trip(x, y, z, NUM_SAMPLES);
+}
+
+// a constant signal packs as many samples as fit
+TEST(BatchCodec, constant)
+{
+    int16_t x[NUM_SAMPLES], y[NUM_SAMPLES], z[NUM_SAMPLES];
+    for (uint16_t i=0; i<NUM_SAMPLES; i++) {
+        x[i] = 10;
+        y[i] = -10;
+        z[i] = 1000;
+    }
+    EXPECT_EQ(round_trip(x, y, z, NUM_SAMPLES), 3);
+    EXPECT_EQ(round_trip(x, y, z, 1), 1);
+
+    uint8_t data[BatchCodec::max_bytes];
+    uint8_t nbytes;
+    EXPECT_EQ(BatchCodec::encode(x, y, z, NUM_SAMPLES, data, nbytes), unsigned(BatchCodec::max_samples));
+}
+
+// a truncated message is reported as corrupt
+TEST(BatchCodec, corrupt)
+{
+    // a message can claim up to max_samples, so decode into buffers
+    // that size
+    int16_t x[BatchCodec::max_samples], y[BatchCodec::max_samples], z[BatchCodec::max_samples];
+    for (uint16_t i=0; i<64; i++) {
+        x[i] = y[i] = z[i] = i * 1000;
+    }
+    uint8_t data[BatchCodec::max_bytes];
+    uint8_t nbytes;
+    const uint16_t count = BatchCodec::encode(x, y, z, 64, data, nbytes);
+    EXPECT_TRUE(BatchCodec::decode(data, count, x, y, z));
+    EXPECT_FALSE(BatchCodec::decode(data, BatchCodec::max_samples, x, y, z));
+}
+
+AP_GTEST_MAIN()
@@ -0,0 +1,196 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_InertialSensor/AP_InertialSensor_Backend.h>
+#include <AP_InertialSensor/FIFOBlock.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+// Invensense FIFO layout: accel, temperature and gyro registers
+#define SAMPLE_SIZE 14
+#define FIFO_ACCEL 0
+#define FIFO_TEMP  3
+#define FIFO_GYRO  4
+
+#define int16_val(v, idx) ((int16_t)(((uint16_t)v[2*idx] << 8) | v[2*idx+1]))
+
+// FIFO axes are (y, x, -z) in the sensor frame
+static const Matrix3f fifo_axes(0, 1, 0,
+                                1, 0, 0,
+                                0, 0, -1);
+
+static const float accel_scale = GRAVITY_MSS / 2048;
+static const float gyro_scale = radians(2000.0f) / 32768;
+
+static AP_InertialSensor ins;
+
+/*
+  backend that exposes the correction of one accel and gyro instance,
+  both per sample and as a cached block transform
+ */
+class TestBackend : public AP_InertialSensor_Backend {
+public:
+    TestBackend(AP_InertialSensor &imu) : AP_InertialSensor_Backend(imu) {}
+
+    bool update() override { return true; }
+
+    using AP_InertialSensor_Backend::set_accel_orientation;
+    using AP_InertialSensor_Backend::set_gyro_orientation;
+
+    // the calibration is set directly, as it would be by loading parameters
+    void set_accel_cal(const Vector3f &offset, const Vector3f &scale) {
+        const_cast<Vector3f &>(_imu.get_accel_offsets(instance)) = offset;
+        const_cast<Vector3f &>(_imu.get_accel_scale(instance)) = scale;
+    }
+    void set_gyro_offset(const Vector3f &offset) {
+        const_cast<Vector3f &>(_imu.get_gyro_offsets(instance)) = offset;
+    }
+
+    // the per sample path the backend used before block decoding
+    void correct_sample(const uint8_t *data, Vector3f &accel, Vector3f &gyro) {
+        accel = Vector3f(int16_val(data, 1),
+                         int16_val(data, 0),
+                         -int16_val(data, 2));
+        accel *= accel_scale;
+        gyro = Vector3f(int16_val(data, 5),
+                        int16_val(data, 4),
+                        -int16_val(data, 6));
+        gyro *= gyro_scale;
+        _rotate_and_correct_accel(instance, accel);
+        _rotate_and_correct_gyro(instance, gyro);
+    }
+
+    // the block path, using the cached transforms
+    void correct_block(const uint8_t *fifo, uint8_t n, FIFOBlock &b) {
+        b.decode_be16(fifo, SAMPLE_SIZE, n);
+        _update_accel_transform(instance, fifo_axes * accel_scale, accel_transform);
+        _update_gyro_transform(instance, fifo_axes * gyro_scale, gyro_transform);
+        FIFOBlock::transform(b.raw[FIFO_ACCEL], b.raw[FIFO_ACCEL+1], b.raw[FIFO_ACCEL+2], n,
+                             accel_transform.m, accel_transform.c, b.accel);
+        FIFOBlock::transform(b.raw[FIFO_GYRO], b.raw[FIFO_GYRO+1], b.raw[FIFO_GYRO+2], n,
+                             gyro_transform.m, gyro_transform.c, b.gyro);
+    }
+
+    static const uint8_t instance = 0;
+    SampleTransform accel_transform {};
+    SampleTransform gyro_transform {};
+};
+
+static void fill_fifo(uint8_t *fifo, uint8_t n)
+{
+    for (uint16_t i=0; i<n*SAMPLE_SIZE; i++) {
+        fifo[i] = rand() & 0xFF;
+    }
+}
+
+/*
+  check the block path against the per sample path for every sample
+  in a FIFO read
+ */
+static void check_block(TestBackend &backend, const uint8_t *fifo, uint8_t n)
+{
+    FIFOBlock b;
+    backend.correct_block(fifo, n, b);
+    for (uint8_t i=0; i<n; i++) {
+        const uint8_t *data = &fifo[i*SAMPLE_SIZE];
+        EXPECT_EQ(b.raw[FIFO_TEMP][i], int16_val(data, FIFO_TEMP));
+
+        Vector3f accel, gyro;
+        backend.correct_sample(data, accel, gyro);
+        EXPECT_NEAR(b.accel[i].x, accel.x, 1e-4) << "sample " << unsigned(i);
+        EXPECT_NEAR(b.accel[i].y, accel.y, 1e-4) << "sample " << unsigned(i);
+        EXPECT_NEAR(b.accel[i].z, accel.z, 1e-4) << "sample " << unsigned(i);
+        EXPECT_NEAR(b.gyro[i].x, gyro.x, 1e-5) << "sample " << unsigned(i);
+        EXPECT_NEAR(b.gyro[i].y, gyro.y, 1e-5) << "sample " << unsigned(i);
+        EXPECT_NEAR(b.gyro[i].z, gyro.z, 1e-5) << "sample " << unsigned(i);
+    }
+}
+
+TEST(FIFOBlock, decode_be16)
+{
+    uint8_t fifo[FIFOBlock::max_samples * SAMPLE_SIZE];
+    fill_fifo(fifo, FIFOBlock::max_samples);
+
+    FIFOBlock b;
+    b.decode_be16(fifo, SAMPLE_SIZE, FIFOBlock::max_samples);
+    for (uint8_t i=0; i<FIFOBlock::max_samples; i++) {
+        for (uint8_t r=0; r<SAMPLE_SIZE/2; r++) {
+            EXPECT_EQ(b.raw[r][i], int16_val((&fifo[i*SAMPLE_SIZE]), r));
+        }
+    }
+}
+
+TEST(FIFOBlock, matches_per_sample)
+{
+    TestBackend backend(ins);
+    Matrix3f custom;
+    custom.from_euler(radians(10), radians(-20), radians(30));
+    ins.set_board_orientation(ROTATION_CUSTOM, &custom);
+    backend.set_accel_orientation(TestBackend::instance, ROTATION_ROLL_180_YAW_90);
+    backend.set_gyro_orientation(TestBackend::instance, ROTATION_ROLL_180_YAW_90);
+    backend.set_accel_cal(Vector3f(0.3f, -0.2f, 0.5f), Vector3f(1.01f, 0.98f, 1.02f));
+    backend.set_gyro_offset(Vector3f(0.01f, -0.02f, 0.005f));
+
+    uint8_t fifo[FIFOBlock::max_samples * SAMPLE_SIZE];
+    for (uint8_t n=1; n<=FIFOBlock::max_samples; n++) {
+        fill_fifo(fifo, n);
+        check_block(backend, fifo, n);
+    }
+
+    // the extremes of each register
+    for (uint16_t i=0; i<sizeof(fifo); i+=2) {
+        fifo[i] = (i/SAMPLE_SIZE) & 1 ? 0x80 : 0x7F;
+        fifo[i+1] = (i/SAMPLE_SIZE) & 1 ? 0x00 : 0xFF;
+    }
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    ins.set_board_orientation(ROTATION_NONE);
+}
+
+/*
+  the cached transforms must be rebuilt whenever an input to
+  _rotate_and_correct_accel() or _rotate_and_correct_gyro() changes
+ */
+TEST(FIFOBlock, transform_follows_changes)
+{
+    TestBackend backend(ins);
+    Matrix3f custom;
+    custom.from_euler(radians(5), radians(15), radians(-40));
+    ins.set_board_orientation(ROTATION_NONE);
+    backend.set_accel_orientation(TestBackend::instance, ROTATION_YAW_45);
+    backend.set_gyro_orientation(TestBackend::instance, ROTATION_YAW_45);
+    backend.set_accel_cal(Vector3f(), Vector3f(1, 1, 1));
+    backend.set_gyro_offset(Vector3f());
+
+    uint8_t fifo[FIFOBlock::max_samples * SAMPLE_SIZE];
+    fill_fifo(fifo, FIFOBlock::max_samples);
+    check_block(backend, fifo, FIFOBlock::max_samples);
+
+    // calibration
+    backend.set_accel_cal(Vector3f(0.4f, 0.1f, -0.3f), Vector3f(1, 1, 1));
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    backend.set_accel_cal(Vector3f(0.4f, 0.1f, -0.3f), Vector3f(0.97f, 1.03f, 1.0f));
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    backend.set_gyro_offset(Vector3f(-0.02f, 0.03f, 0.01f));
+    check_block(backend, fifo, FIFOBlock::max_samples);
+
+    // sensor orientation
+    backend.set_accel_orientation(TestBackend::instance, ROTATION_PITCH_90);
+    backend.set_gyro_orientation(TestBackend::instance, ROTATION_PITCH_90);
+    check_block(backend, fifo, FIFOBlock::max_samples);
+
+    // board orientation, including a change to the custom rotation
+    // matrix without a change to the orientation
+    ins.set_board_orientation(ROTATION_ROLL_90);
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    ins.set_board_orientation(ROTATION_CUSTOM, &custom);
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    custom.from_euler(radians(-25), radians(0), radians(60));
+    check_block(backend, fifo, FIFOBlock::max_samples);
+    ins.set_board_orientation(ROTATION_NONE);
+    check_block(backend, fifo, FIFOBlock::max_samples);
+}
+
+AP_GTEST_MAIN()
@@ -3,6 +3,7 @@
 #include "AP_Logger_Backend.h"
 
 #include "AP_Logger_File.h"
+#include "AP_Logger_Compress.h"
 #include "AP_Logger_SITL.h"
 #include "AP_Logger_DataFlash.h"
 #include "AP_Logger_MAVLink.h"
@@ -102,6 +103,36 @@ const AP_Param::GroupInfo AP_Logger::var_info[] = {
     // @User: Standard
     AP_GROUPINFO("_FILE_MB_FREE",  7, AP_Logger, _params.min_MB_free, 500),
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // @Param: _FILE_COMPR
+    // @DisplayName: Compress log files
+    // @Description: When set, the File backend compresses new log files as they are written. Logs downloaded over MAVLink are decompressed as they are sent. Logs copied off the SD card are turned back into normal logs with Tools/scripts/decompress_log.py. Takes effect when the next log is started.
+    // @Values: 0:Disabled,1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("_FILE_COMPR",  8, AP_Logger, _params.file_compress, 0),
+#endif
+
+    // @Param: _GOV_IMU
+    // @DisplayName: IMU message thinning when the log can't keep up
+    // @Description: When the File backend's buffer is filling faster than it can be written, only one in this many IMU and IMT messages of each instance are logged. The ratio doubles at each step if the buffer keeps filling, up to three steps. The LGOV message records each step. 0 or 1 never thins out IMU messages, leaving them to be dropped when the buffer is full.
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("_GOV_IMU",  9, AP_Logger, _params.gov_imu, 0),
+
+    // @Param: _GOV_RATE
+    // @DisplayName: RATE message thinning when the log can't keep up
+    // @Description: When the File backend's buffer is filling faster than it can be written, only one in this many RATE messages are logged. See LOG_GOV_IMU. 0 or 1 never thins out RATE messages.
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("_GOV_RATE",  10, AP_Logger, _params.gov_rate, 0),
+
+    // @Param: _GOV_PID
+    // @DisplayName: PID message thinning when the log can't keep up
+    // @Description: When the File backend's buffer is filling faster than it can be written, only one in this many of each of the PID messages are logged. See LOG_GOV_IMU. 0 or 1 never thins out PID messages.
+    // @Range: 0 50
+    // @User: Advanced
+    AP_GROUPINFO("_GOV_PID",  11, AP_Logger, _params.gov_pid, 0),
+
     AP_GROUPEND
 };
 
@@ -863,6 +894,7 @@ void AP_Logger::WriteV(const char *name, const char *labels, const char *units,
         return;
     }
 
+    uint8_t write_mask = 0;
     for (uint8_t i=0; i<_next_backend; i++) {
         if (!(f->sent_mask & (1U<<i))) {
             if (!backends[i]->Write_Emit_FMT(f->msg_type)) {
@@ -870,10 +902,127 @@ void AP_Logger::WriteV(const char *name, const char *labels, const char *units,
             }
             f->sent_mask |= (1U<<i);
         }
-        va_list arg_copy;
-        va_copy(arg_copy, arg_list);
-        backends[i]->Write(f->msg_type, arg_copy, is_critical);
-        va_end(arg_copy);
+        write_mask |= (1U<<i);
+    }
+    if (write_mask == 0) {
+        return;
+    }
+
+    // format the message once and give the same block to each
+    // backend; each backend does its own space checks and counts its
+    // own drops
+    uint8_t buffer[f->msg_len];
+    Write_format_message(f, arg_list, buffer);
+    for (uint8_t i=0; i<_next_backend; i++) {
+        if (write_mask & (1U<<i)) {
+            backends[i]->WritePrioritisedBlock(buffer, f->msg_len, is_critical);
+        }
+    }
+}
+
+/*
+  fill in buffer with a message of type f, taking the values from
+  arg_list
+ */
+void AP_Logger::Write_format_message(const struct log_write_fmt *f, va_list arg_list, uint8_t *buffer) const
+{
+    uint8_t offset = 0;
+    buffer[offset++] = HEAD_BYTE1;
+    buffer[offset++] = HEAD_BYTE2;
+    buffer[offset++] = f->msg_type;
+    const char *fmt = f->fmt;
+    const uint8_t fmt_len = strlen(fmt);
+    for (uint8_t i=0; i<fmt_len; i++) {
+        uint8_t charlen = 0;
+        switch(fmt[i]) {
+        case 'b': {
+            int8_t tmp = va_arg(arg_list, int);
+            memcpy(&buffer[offset], &tmp, sizeof(int8_t));
+            offset += sizeof(int8_t);
+            break;
+        }
+        case 'h':
+        case 'c': {
+            int16_t tmp = va_arg(arg_list, int);
+            memcpy(&buffer[offset], &tmp, sizeof(int16_t));
+            offset += sizeof(int16_t);
+            break;
+        }
+        case 'd': {
+            double tmp = va_arg(arg_list, double);
+            memcpy(&buffer[offset], &tmp, sizeof(double));
+            offset += sizeof(double);
+            break;
+        }
+        case 'i':
+        case 'L':
+        case 'e': {
+            int32_t tmp = va_arg(arg_list, int);
+            memcpy(&buffer[offset], &tmp, sizeof(int32_t));
+            offset += sizeof(int32_t);
+            break;
+        }
+        case 'f': {
+            float tmp = va_arg(arg_list, double);
+            memcpy(&buffer[offset], &tmp, sizeof(float));
+            offset += sizeof(float);
+            break;
+        }
+        case 'n':
+            charlen = 4;
+            break;
+        case 'M':
+        case 'B': {
+            uint8_t tmp = va_arg(arg_list, int);
+            memcpy(&buffer[offset], &tmp, sizeof(uint8_t));
+            offset += sizeof(uint8_t);
+            break;
+        }
+        case 'H':
+        case 'C': {
+            uint16_t tmp = va_arg(arg_list, int);
+            memcpy(&buffer[offset], &tmp, sizeof(uint16_t));
+            offset += sizeof(uint16_t);
+            break;
+        }
+        case 'I':
+        case 'E': {
+            uint32_t tmp = va_arg(arg_list, uint32_t);
+            memcpy(&buffer[offset], &tmp, sizeof(uint32_t));
+            offset += sizeof(uint32_t);
+            break;
+        }
+        case 'N':
+            charlen = 16;
+            break;
+        case 'Z':
+            charlen = 64;
+            break;
+        case 'q': {
+            int64_t tmp = va_arg(arg_list, int64_t);
+            memcpy(&buffer[offset], &tmp, sizeof(int64_t));
+            offset += sizeof(int64_t);
+            break;
+        }
+        case 'Q': {
+            uint64_t tmp = va_arg(arg_list, uint64_t);
+            memcpy(&buffer[offset], &tmp, sizeof(uint64_t));
+            offset += sizeof(uint64_t);
+            break;
+        }
+        case 'a': {
+            int16_t *tmp = va_arg(arg_list, int16_t*);
+            const uint8_t bytes = 32*2;
+            memcpy(&buffer[offset], tmp, bytes);
+            offset += bytes;
+            break;
+        }
+        }
+        if (charlen != 0) {
+            char *tmp = va_arg(arg_list, char*);
+            memcpy(&buffer[offset], tmp, charlen);
+            offset += charlen;
+        }
     }
 }
 
@@ -1220,6 +1369,51 @@ bool AP_Logger::Write_ISBD(const uint16_t isb_seqno,
     return backends[0]->WriteBlock(&pkt, sizeof(pkt));
 }
 
+// Write a run of compressed IMU readings to log:
+bool AP_Logger::Write_ISBC(const uint16_t isb_seqno,
+                                     const uint16_t seqno,
+                                     const uint16_t count,
+                                     const uint8_t data[192])
+{
+    if (_next_backend == 0) {
+        return false;
+    }
+    struct log_ISBC pkt = {
+        LOG_PACKET_HEADER_INIT(LOG_ISBC_MSG),
+        time_us    : AP_HAL::micros64(),
+        isb_seqno  : isb_seqno,
+        seqno      : seqno,
+        count      : count
+    };
+    memcpy(pkt.data, data, sizeof(pkt.data));
+
+    // only the first backend need succeed for us to be successful
+    for (uint8_t i=1; i<_next_backend; i++) {
+        backends[i]->WriteBlock(&pkt, sizeof(pkt));
+    }
+
+    return backends[0]->WriteBlock(&pkt, sizeof(pkt));
+}
+
+// Write compression statistics for a batch of IMU readings to log:
+void AP_Logger::Write_ISBS(const uint16_t seqno,
+                                     const uint16_t sample_count,
+                                     const uint16_t msg_count,
+                                     const float ratio,
+                                     const uint32_t encode_us)
+{
+    const struct log_ISBS pkt{
+        LOG_PACKET_HEADER_INIT(LOG_ISBS_MSG),
+        time_us      : AP_HAL::micros64(),
+        seqno        : seqno,
+        sample_count : sample_count,
+        msg_count    : msg_count,
+        ratio        : ratio,
+        encode_us    : encode_us,
+    };
+    WriteBlock(&pkt, sizeof(pkt));
+}
+
 // Wrote an event packet
 void AP_Logger::Write_Event(LogEvent id)
 {
@@ -241,6 +241,15 @@ public:
                         const int16_t x[32],
                         const int16_t y[32],
                         const int16_t z[32]);
+    bool Write_ISBC(uint16_t isb_seqno,
+                        uint16_t seqno,
+                        uint16_t count,
+                        const uint8_t data[192]);
+    void Write_ISBS(uint16_t seqno,
+                        uint16_t sample_count,
+                        uint16_t msg_count,
+                        float ratio,
+                        uint32_t encode_us);
     void Write_Vibration();
     void Write_RCIN(void);
     void Write_RCOUT(void);
@@ -346,6 +355,10 @@ public:
         AP_Int8 mav_bufsize; // in kilobytes
         AP_Int16 file_timeout; // in seconds
         AP_Int16 min_MB_free;
+        AP_Int8 file_compress;
+        AP_Int8 gov_imu;
+        AP_Int8 gov_rate;
+        AP_Int8 gov_pid;
     } _params;
 
     const struct LogStructure *structure(uint16_t num) const;
@@ -402,6 +415,9 @@ public:
     // output a FMT message for each backend if not already done so
     void Safe_Write_Emit_FMT(log_write_fmt *f);
 
+    // fill in a message from the values in arg_list
+    void Write_format_message(const struct log_write_fmt *f, va_list arg_list, uint8_t *buffer) const;
+
 protected:
 
     const struct LogStructure *_structures;
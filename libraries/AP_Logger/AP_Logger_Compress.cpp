@@ -0,0 +1,577 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_Logger_Compress.h"
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Math/AP_Math.h>
+
+using namespace AP_Logger_Compressed;
+
+// the LZ4 block format requires these
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT      12
+#define LZ4_MAX_OFFSET    65535
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> 20;
+}
+
+static_assert(AP_Logger_LZ4::hash_size == (1U<<12), "hash must match hash_size");
+
+// write a literal or match length over 15 as a run of bytes
+static inline uint8_t *put_length(uint8_t *op, uint32_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = len;
+    return op;
+}
+
+uint32_t AP_Logger_LZ4::compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap, uint16_t table[hash_size])
+{
+    if (len > 65536) {
+        return 0;
+    }
+    memset(table, 0, hash_size * sizeof(table[0]));
+
+    const uint8_t *const iend = src + len;
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + cap;
+
+    if (len > LZ4_MF_LIMIT) {
+        // the last match must start at least 12 bytes from the end
+        const uint8_t *const mflimit = iend - LZ4_MF_LIMIT;
+        const uint8_t *const matchlimit = iend - LZ4_LAST_LITERALS;
+        ip++;
+        while (ip <= mflimit) {
+            const uint32_t seq = read32(ip);
+            const uint32_t h = lz4_hash(seq);
+            const uint8_t *ref = src + table[h];
+            table[h] = uint16_t(ip - src);
+            if (ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // extend the match forwards, then backwards over the literals
+            const uint8_t *mp = ip + LZ4_MIN_MATCH;
+            const uint8_t *rp = ref + LZ4_MIN_MATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+
+            const uint32_t lit = ip - anchor;
+            const uint32_t mlen = (mp - ip) - LZ4_MIN_MATCH;
+            if (op + 1 + lit/255 + 1 + lit + 2 + mlen/255 + 1 > oend) {
+                return 0;
+            }
+            uint8_t *token = op++;
+            *token = (MIN(lit, 15U) << 4) | MIN(mlen, 15U);
+            if (lit >= 15) {
+                op = put_length(op, lit - 15);
+            }
+            memcpy(op, anchor, lit);
+            op += lit;
+            const uint16_t offset = ip - ref;
+            *op++ = offset & 0xFF;
+            *op++ = offset >> 8;
+            if (mlen >= 15) {
+                op = put_length(op, mlen - 15);
+            }
+            ip = mp;
+            anchor = ip;
+        }
+    }
+
+    // the rest is literals
+    const uint32_t lit = iend - anchor;
+    if (op + 1 + lit/255 + 1 + lit > oend) {
+        return 0;
+    }
+    *op++ = MIN(lit, 15U) << 4;
+    if (lit >= 15) {
+        op = put_length(op, lit - 15);
+    }
+    memcpy(op, anchor, lit);
+    op += lit;
+    return op - dst;
+}
+
+int32_t AP_Logger_LZ4::decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap)
+{
+    const uint8_t *ip = src;
+    const uint8_t *const iend = src + len;
+    uint8_t *op = dst;
+    uint8_t *const oend = dst + cap;
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+        uint32_t lit = token >> 4;
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > uint32_t(iend - ip) || lit > uint32_t(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) {
+            // the last sequence has no match
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        const uint16_t offset = ip[0] | (uint16_t(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > op - dst) {
+            return -1;
+        }
+        uint32_t mlen = token & 0x0F;
+        if (mlen == 15) {
+            uint8_t b;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LZ4_MIN_MATCH;
+        if (mlen > uint32_t(oend - op)) {
+            return -1;
+        }
+        // byte at a time, as the match may overlap its own output
+        const uint8_t *ref = op - offset;
+        for (uint32_t i=0; i<mlen; i++) {
+            *op++ = *ref++;
+        }
+    }
+    return op - dst;
+}
+
+bool AP_Logger_Compressed::is_compressed(const uint8_t *data, uint32_t len)
+{
+    file_header hdr;
+    if (len < sizeof(hdr)) {
+        return false;
+    }
+    memcpy(&hdr, data, sizeof(hdr));
+    return hdr.magic == file_magic;
+}
+
+/*
+  compressor
+ */
+AP_Logger_FileCompressor::~AP_Logger_FileCompressor()
+{
+    delete[] _in;
+    delete[] _out;
+    delete[] _table;
+}
+
+bool AP_Logger_FileCompressor::init()
+{
+    if (_in == nullptr) {
+        _in = new uint8_t[frame_size];
+        _out = new uint8_t[sizeof(frame_header) + AP_Logger_LZ4::bound(frame_size) + sizeof(frame_trailer)];
+        _table = new uint16_t[AP_Logger_LZ4::hash_size];
+    }
+    return _in != nullptr && _out != nullptr && _table != nullptr;
+}
+
+void AP_Logger_FileCompressor::start()
+{
+    const file_header hdr {
+        magic : file_magic,
+        version : AP_Logger_Compressed::version,
+        frame_size : AP_Logger_Compressed::frame_size,
+        reserved : {0, 0},
+    };
+    memcpy(_out, &hdr, sizeof(hdr));
+    _out_len = sizeof(hdr);
+    _out_ofs = 0;
+    _in_len = 0;
+    _offset = 0;
+    _stats = {};
+    _stats.bytes_out = sizeof(hdr);
+}
+
+void AP_Logger_FileCompressor::add(const uint8_t *data, uint32_t len)
+{
+    len = MIN(len, space());
+    memcpy(&_in[_in_len], data, len);
+    _in_len += len;
+}
+
+void AP_Logger_FileCompressor::finish_frame()
+{
+    if (_in_len == 0 || output_pending()) {
+        return;
+    }
+    const uint32_t start_us = AP_HAL::micros();
+
+    frame_header hdr {
+        magic : frame_magic,
+        offset : _offset,
+        length : uint16_t(_in_len),
+        clength : 0,
+        flags : 0,
+        reserved : {0, 0, 0},
+    };
+    uint8_t *data = &_out[sizeof(hdr)];
+    uint32_t clen = AP_Logger_LZ4::compress(_in, _in_len, data, _in_len, _table);
+    if (clen == 0) {
+        // doesn't compress, store it
+        memcpy(data, _in, _in_len);
+        clen = _in_len;
+        hdr.flags |= FRAME_STORED;
+    }
+    hdr.clength = clen;
+    memcpy(_out, &hdr, sizeof(hdr));
+
+    const frame_trailer trailer {
+        frame_length : uint32_t(sizeof(hdr) + clen + sizeof(frame_trailer)),
+        magic : trailer_magic,
+    };
+    memcpy(&data[clen], &trailer, sizeof(trailer));
+    _out_len = trailer.frame_length;
+    _out_ofs = 0;
+
+    _offset += _in_len;
+    _stats.bytes_in += _in_len;
+    _stats.bytes_out += _out_len;
+    _in_len = 0;
+    _stats.compress_us += AP_HAL::micros() - start_us;
+}
+
+bool AP_Logger_FileCompressor::output(const uint8_t *&data, uint32_t &len) const
+{
+    if (!output_pending()) {
+        return false;
+    }
+    data = &_out[_out_ofs];
+    len = _out_len - _out_ofs;
+    return true;
+}
+
+void AP_Logger_FileCompressor::output_advance(uint32_t len)
+{
+    _out_ofs = MIN(_out_ofs + len, _out_len);
+}
+
+/*
+  decompressor
+ */
+AP_Logger_FileDecompressor::~AP_Logger_FileDecompressor()
+{
+    delete[] _frame;
+    delete[] _cdata;
+}
+
+bool AP_Logger_FileDecompressor::read_at(uint64_t file_offset, void *data, uint32_t len)
+{
+    if (file_offset + len > _file_size) {
+        return false;
+    }
+    if (AP::FS().lseek(_fd, file_offset, SEEK_SET) == (off_t)-1) {
+        return false;
+    }
+    uint8_t *p = (uint8_t *)data;
+    while (len > 0) {
+        const int32_t n = AP::FS().read(_fd, p, len);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool AP_Logger_FileDecompressor::open(int fd)
+{
+    _fd = fd;
+    const off_t end = AP::FS().lseek(fd, 0, SEEK_END);
+    if (end == (off_t)-1) {
+        return false;
+    }
+    _file_size = end;
+
+    file_header hdr;
+    if (!read_at(0, &hdr, sizeof(hdr)) ||
+        !is_compressed((const uint8_t *)&hdr, sizeof(hdr)) ||
+        hdr.version != AP_Logger_Compressed::version ||
+        hdr.frame_size > AP_Logger_Compressed::frame_size) {
+        AP::FS().lseek(fd, 0, SEEK_SET);
+        return false;
+    }
+
+    _have_size = false;
+    _frame_offset = 0;
+    _frame_length = 0;
+    _index_count = 0;
+    _index_stride = 1;
+    _frames_seen = 0;
+    _scan_file_offset = sizeof(hdr);
+    _scan_offset = 0;
+    return true;
+}
+
+bool AP_Logger_FileDecompressor::read_frame_header(uint64_t file_offset, frame_header &hdr)
+{
+    if (!read_at(file_offset, &hdr, sizeof(hdr))) {
+        return false;
+    }
+    return hdr.magic == frame_magic &&
+        hdr.length <= frame_size &&
+        hdr.clength <= AP_Logger_LZ4::bound(frame_size) &&
+        file_offset + sizeof(hdr) + hdr.clength + sizeof(frame_trailer) <= _file_size;
+}
+
+void AP_Logger_FileDecompressor::index_add(uint64_t offset, uint64_t file_offset)
+{
+    if (_frames_seen++ % _index_stride != 0) {
+        return;
+    }
+    if (_index_count == index_size) {
+        // keep every other entry, and record half as often
+        for (uint16_t i=0; i<index_size/2; i++) {
+            _index[i] = _index[i*2];
+        }
+        _index_count = index_size/2;
+        _index_stride *= 2;
+        if ((_frames_seen-1) % _index_stride != 0) {
+            return;
+        }
+    }
+    _index[_index_count++] = { offset, file_offset };
+}
+
+/*
+  find the next frame not yet seen, adding it to the index
+ */
+bool AP_Logger_FileDecompressor::scan_next(frame_header &hdr, uint64_t &file_offset)
+{
+    if (!read_frame_header(_scan_file_offset, hdr) || hdr.offset != _scan_offset) {
+        return false;
+    }
+    file_offset = _scan_file_offset;
+    index_add(hdr.offset, file_offset);
+    _scan_file_offset += sizeof(hdr) + hdr.clength + sizeof(frame_trailer);
+    _scan_offset += hdr.length;
+    return true;
+}
+
+uint64_t AP_Logger_FileDecompressor::size()
+{
+    if (_have_size) {
+        return _size;
+    }
+    // the last frame gives the size of a complete log
+    frame_trailer trailer;
+    frame_header hdr;
+    if (_file_size >= sizeof(file_header) + sizeof(trailer) &&
+        read_at(_file_size - sizeof(trailer), &trailer, sizeof(trailer)) &&
+        trailer.magic == trailer_magic &&
+        trailer.frame_length <= _file_size - sizeof(file_header) &&
+        read_frame_header(_file_size - trailer.frame_length, hdr) &&
+        sizeof(hdr) + hdr.clength + sizeof(trailer) == trailer.frame_length) {
+        _size = hdr.offset + hdr.length;
+    } else if (find_last_frame(hdr)) {
+        // the log was cut short
+        _size = hdr.offset + hdr.length;
+    } else {
+        _size = 0;
+    }
+    _have_size = true;
+    return _size;
+}
+
+/*
+  find the last complete frame of a log that was cut short. Whatever
+  follows it is less than a frame, so only the end of the file needs
+  searching for its trailer
+ */
+bool AP_Logger_FileDecompressor::find_last_frame(frame_header &hdr)
+{
+    const uint32_t max_frame_length = sizeof(frame_header) + AP_Logger_LZ4::bound(frame_size) + sizeof(frame_trailer);
+    const uint64_t data_start = sizeof(file_header);
+    if (_file_size < data_start + sizeof(frame_trailer)) {
+        return false;
+    }
+    // lowest offset the trailer could start at
+    const uint64_t lowest = _file_size > data_start + max_frame_length + sizeof(frame_trailer) ?
+        _file_size - max_frame_length - sizeof(frame_trailer) : data_start;
+
+    uint8_t buf[256];
+    uint64_t block_end = _file_size;
+    while (true) {
+        const uint64_t block_start = block_end - lowest > sizeof(buf) ? block_end - sizeof(buf) : lowest;
+        const uint32_t len = block_end - block_start;
+        if (len < sizeof(frame_trailer) || !read_at(block_start, buf, len)) {
+            return false;
+        }
+        for (int32_t i = len - sizeof(frame_trailer); i >= 0; i--) {
+            frame_trailer trailer;
+            memcpy(&trailer, &buf[i], sizeof(trailer));
+            if (trailer.magic != trailer_magic) {
+                continue;
+            }
+            const uint64_t frame_end = block_start + i + sizeof(trailer);
+            if (trailer.frame_length > frame_end - data_start) {
+                continue;
+            }
+            if (read_frame_header(frame_end - trailer.frame_length, hdr) &&
+                sizeof(hdr) + hdr.clength + sizeof(trailer) == trailer.frame_length) {
+                return true;
+            }
+        }
+        if (block_start == lowest) {
+            return false;
+        }
+        // overlap the blocks so a trailer split between them is seen
+        block_end = block_start + sizeof(frame_trailer) - 1;
+    }
+}
+
+/*
+  pick up any data written since the file size was last checked,
+  returning true if there is more
+ */
+bool AP_Logger_FileDecompressor::refresh_file_size()
+{
+    const off_t end = AP::FS().lseek(_fd, 0, SEEK_END);
+    if (end == (off_t)-1 || uint64_t(end) <= _file_size) {
+        return false;
+    }
+    _file_size = end;
+    _have_size = false;
+    return true;
+}
+
+bool AP_Logger_FileDecompressor::find_frame(uint64_t offset, frame_header &hdr, uint64_t &file_offset)
+{
+    if (offset >= _scan_offset) {
+        while (scan_next(hdr, file_offset)) {
+            if (offset < hdr.offset + hdr.length) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // step forwards from the closest indexed frame
+    uint16_t i = _index_count;
+    while (i > 0 && _index[i-1].offset > offset) {
+        i--;
+    }
+    if (i == 0) {
+        return false;
+    }
+    file_offset = _index[i-1].file_offset;
+    while (read_frame_header(file_offset, hdr)) {
+        if (offset < hdr.offset + hdr.length) {
+            return offset >= hdr.offset;
+        }
+        file_offset += sizeof(hdr) + hdr.clength + sizeof(frame_trailer);
+    }
+    return false;
+}
+
+bool AP_Logger_FileDecompressor::load_frame(uint64_t offset)
+{
+    if (_frame == nullptr) {
+        // only allocated when the data is read, not for size()
+        _frame = new uint8_t[frame_size];
+        _cdata = new uint8_t[AP_Logger_LZ4::bound(frame_size)];
+        if (_frame == nullptr || _cdata == nullptr) {
+            return false;
+        }
+    }
+    frame_header hdr;
+    uint64_t file_offset;
+    if (!find_frame(offset, hdr, file_offset)) {
+        return false;
+    }
+    _frame_length = 0;
+    const uint64_t data_offset = file_offset + sizeof(hdr);
+    if (hdr.flags & FRAME_STORED) {
+        if (hdr.clength != hdr.length || !read_at(data_offset, _frame, hdr.length)) {
+            return false;
+        }
+    } else {
+        if (!read_at(data_offset, _cdata, hdr.clength) ||
+            AP_Logger_LZ4::decompress(_cdata, hdr.clength, _frame, frame_size) != hdr.length) {
+            return false;
+        }
+    }
+    _frame_offset = hdr.offset;
+    _frame_length = hdr.length;
+    return true;
+}
+
+int32_t AP_Logger_FileDecompressor::read(uint64_t offset, uint8_t *data, uint32_t len)
+{
+    if (_fd == -1) {
+        return -1;
+    }
+    if (offset < _frame_offset || offset >= _frame_offset + _frame_length) {
+        if (offset >= size() &&
+            (!refresh_file_size() || offset >= size())) {
+            return 0;
+        }
+        if (!load_frame(offset)) {
+            return -1;
+        }
+    }
+    const uint32_t ofs = offset - _frame_offset;
+    len = MIN(len, _frame_length - ofs);
+    memcpy(data, &_frame[ofs], len);
+    return len;
+}
+
+#endif // HAL_LOGGER_FILE_COMPRESS_ENABLED
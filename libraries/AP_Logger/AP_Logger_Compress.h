@@ -0,0 +1,214 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  compressed log files for AP_Logger_File.
+
+  A compressed log starts with a file header, followed by frames of up
+  to frame_size bytes of log data. Each frame is compressed on its own
+  in the LZ4 block format, or stored if it doesn't compress. Every
+  frame header records where the frame's data starts in the
+  uncompressed log, and every frame ends with a trailer giving the
+  frame's length. A reader can find the size of the log from the last
+  frame and step through the frames in either direction, so it can
+  seek without decompressing from the start. If the log was cut short
+  the reader searches back from the end of the file for the last
+  complete frame, which is never more than a frame away.
+
+  Tools/scripts/decompress_log.py turns a compressed log back into a
+  normal one.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+#ifndef HAL_LOGGER_FILE_COMPRESS_ENABLED
+#define HAL_LOGGER_FILE_COMPRESS_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+
+/*
+  LZ4 block format compression
+ */
+class AP_Logger_LZ4 {
+public:
+    // entries in the hash table passed to compress()
+    static const uint16_t hash_size = 4096;
+
+    // largest compressed size of len bytes
+    static uint32_t bound(uint32_t len) { return len + len/255 + 16; }
+
+    /*
+      compress len bytes, which must be at most 64k. Returns the
+      compressed length, or 0 if it would not fit in cap bytes
+     */
+    static uint32_t compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap, uint16_t table[hash_size]);
+
+    /*
+      decompress len bytes into at most cap bytes. Returns the
+      decompressed length, or -1 if the data is corrupt
+     */
+    static int32_t decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+};
+
+namespace AP_Logger_Compressed {
+
+static const uint32_t file_magic = 0x5a4c5041;    // "APLZ"
+static const uint32_t frame_magic = 0x464c5041;   // "APLF"
+static const uint32_t trailer_magic = 0x544c5041; // "APLT"
+static const uint16_t version = 1;
+static const uint16_t frame_size = 16384;
+
+struct PACKED file_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frame_size;
+    uint32_t reserved[2];
+};
+
+enum frame_flags : uint8_t {
+    FRAME_STORED = (1U<<0), // data is not compressed
+};
+
+struct PACKED frame_header {
+    uint32_t magic;
+    uint64_t offset;   // offset of the frame's data in the uncompressed log
+    uint16_t length;   // uncompressed length
+    uint16_t clength;  // length of the data in the file
+    uint8_t flags;
+    uint8_t reserved[3];
+};
+
+struct PACKED frame_trailer {
+    uint32_t frame_length; // header, data and trailer
+    uint32_t magic;
+};
+
+// true if data starts with a compressed log file header
+bool is_compressed(const uint8_t *data, uint32_t len);
+
+}
+
+/*
+  turns log data into frames for the IO thread to write
+ */
+class AP_Logger_FileCompressor {
+public:
+    ~AP_Logger_FileCompressor();
+
+    bool init();
+
+    // start a new file, queueing the file header for output and
+    // clearing the statistics
+    void start();
+
+    // bytes that can be added to the current frame
+    uint32_t space() const { return AP_Logger_Compressed::frame_size - _in_len; }
+    // bytes added to the current frame
+    uint32_t buffered() const { return _in_len; }
+
+    void add(const uint8_t *data, uint32_t len);
+
+    // compress the current frame into the output, if it has data
+    void finish_frame();
+
+    // get the output waiting to be written, false if there is none
+    bool output(const uint8_t *&data, uint32_t &len) const;
+    void output_advance(uint32_t len);
+    bool output_pending() const { return _out_ofs < _out_len; }
+
+    struct Stats {
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+        uint64_t compress_us;
+    };
+    const Stats &get_stats() const { return _stats; }
+
+private:
+    uint8_t *_in = nullptr;
+    uint32_t _in_len = 0;
+    uint8_t *_out = nullptr;
+    uint32_t _out_len = 0;
+    uint32_t _out_ofs = 0;
+    uint16_t *_table = nullptr;
+    uint64_t _offset = 0;
+    Stats _stats {};
+};
+
+/*
+  random access to the uncompressed data of a compressed log
+ */
+class AP_Logger_FileDecompressor {
+public:
+    ~AP_Logger_FileDecompressor();
+
+    /*
+      check the file open on fd is a compressed log. fd stays owned by
+      the caller
+     */
+    bool open(int fd);
+
+    // size of the uncompressed log
+    uint64_t size();
+
+    /*
+      read up to len bytes of the uncompressed log at offset,
+      returning the number read, 0 at the end of the log or -1 on
+      error. Reads stop at the end of a frame. A read at the end
+      checks if the file has grown, so a log that is still being
+      written can be read as it grows
+     */
+    int32_t read(uint64_t offset, uint8_t *data, uint32_t len);
+
+private:
+    int _fd = -1;
+    uint64_t _file_size;
+    uint64_t _size;
+    bool _have_size;
+
+    // the most recently decompressed frame
+    uint8_t *_frame = nullptr;
+    uint8_t *_cdata = nullptr;
+    uint64_t _frame_offset;
+    uint32_t _frame_length;
+
+    /*
+      a sparse index of frame positions, filled in as frames are
+      found. When it is full every other entry is dropped and only
+      every stride'th frame is recorded after that
+     */
+    static const uint16_t index_size = 256;
+    struct index_entry {
+        uint64_t offset;      // in the uncompressed log
+        uint64_t file_offset; // of the frame header
+    } _index[index_size];
+    uint16_t _index_count;
+    uint32_t _index_stride;
+    uint32_t _frames_seen;
+    // the first frame not yet seen by a forward scan
+    uint64_t _scan_file_offset;
+    uint64_t _scan_offset;
+
+    bool read_at(uint64_t file_offset, void *data, uint32_t len);
+    bool read_frame_header(uint64_t file_offset, AP_Logger_Compressed::frame_header &hdr);
+    void index_add(uint64_t offset, uint64_t file_offset);
+    bool scan_next(AP_Logger_Compressed::frame_header &hdr, uint64_t &file_offset);
+    bool find_last_frame(AP_Logger_Compressed::frame_header &hdr);
+    bool refresh_file_size();
+    bool find_frame(uint64_t offset, AP_Logger_Compressed::frame_header &hdr, uint64_t &file_offset);
+    bool load_frame(uint64_t offset);
+};
+
+#endif // HAL_LOGGER_FILE_COMPRESS_ENABLED
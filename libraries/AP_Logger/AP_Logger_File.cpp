@@ -52,6 +52,9 @@ AP_Logger_File::AP_Logger_File(AP_Logger &front,
     _perf_fsync(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_fsync")),
     _perf_errors(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_errors")),
     _perf_overruns(hal.util->perf_alloc(AP_HAL::Util::PC_COUNT, "DF_overruns"))
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    , _perf_compress(hal.util->perf_alloc(AP_HAL::Util::PC_ELAPSED, "DF_compress"))
+#endif
 {
     df_stats_clear();
 }
@@ -130,6 +133,36 @@ bool AP_Logger_File::log_exists(const uint16_t lognum) const
     return ret;
 }
 
+void AP_Logger_File::periodic_10Hz(const uint32_t now)
+{
+    AP_Logger_Backend::periodic_10Hz(now);
+
+    if (!logging_started()) {
+        return;
+    }
+    if (!semaphore.take_nonblocking()) {
+        return;
+    }
+    _governor.set_ratio(AP_Logger_RateGovernor::Group::IMU, _front._params.gov_imu);
+    _governor.set_ratio(AP_Logger_RateGovernor::Group::RATE, _front._params.gov_rate);
+    _governor.set_ratio(AP_Logger_RateGovernor::Group::PID, _front._params.gov_pid);
+    const bool changed = _governor.update(now, _writebuf.get_size(), _writebuf.space(), _log_file_size_bytes);
+    semaphore.give();
+
+    if (changed) {
+        const struct log_LGOV pkt {
+            LOG_PACKET_HEADER_INIT(LOG_LGOV_MSG),
+            time_us         : AP_HAL::micros64(),
+            level           : _governor.level(),
+            fill            : _governor.fill_pct(),
+            rate_in         : _governor.rate_in(),
+            rate_out        : _governor.rate_out(),
+            decimated       : _governor.take_decimated_count(),
+        };
+        WriteCriticalBlock(&pkt, sizeof(pkt));
+    }
+}
+
 void AP_Logger_File::periodic_1Hz()
 {
     AP_Logger_Backend::periodic_1Hz();
@@ -152,8 +185,40 @@ void AP_Logger_File::periodic_1Hz()
         _write_fd = -1;
         _initialised = false;
     }
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_compressing && logging_started()) {
+        Write_DSFC();
+    }
+#endif
 }
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+void AP_Logger_File::Write_DSFC()
+{
+    if (!write_fd_semaphore.take_nonblocking()) {
+        return;
+    }
+    const AP_Logger_FileCompressor::Stats stats = _compressor->get_stats();
+    write_fd_semaphore.give();
+
+    const uint64_t dt_in = stats.bytes_in - _last_compress_stats.bytes_in;
+    const uint64_t dt_out = stats.bytes_out - _last_compress_stats.bytes_out;
+    const uint64_t dt_us = stats.compress_us - _last_compress_stats.compress_us;
+    const struct log_DSFC pkt {
+        LOG_PACKET_HEADER_INIT(LOG_DSFC_MSG),
+        time_us         : AP_HAL::micros64(),
+        bytes_in        : stats.bytes_in,
+        bytes_out       : stats.bytes_out,
+        ratio           : dt_out ? float(dt_in) / dt_out : 0,
+        rate            : dt_us ? float(dt_in) / dt_us : 0,
+        compress_us     : uint32_t(dt_us),
+    };
+    WriteBlock(&pkt, sizeof(pkt));
+    _last_compress_stats = stats;
+}
+#endif
+
 void AP_Logger_File::periodic_fullrate()
 {
     AP_Logger_Backend::push_log_blocks();
@@ -476,6 +541,12 @@ bool AP_Logger_File::_WritePrioritisedBlock(const void *pBuffer, uint16_t size,
     if (!semaphore.take(1)) {
         return false;
     }
+
+    if (!is_critical && _governor.decimate(((const uint8_t *)pBuffer)[2])) {
+        // thinned out on purpose, so not counted as dropped
+        semaphore.give();
+        return true;
+    }
         
     uint32_t space = _writebuf.space();
 
@@ -556,6 +627,28 @@ uint32_t AP_Logger_File::_get_log_size(const uint16_t log_num)
         }
         write_fd_semaphore.give();
     }
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    {
+        // report the uncompressed size of compressed logs, as that
+        // is what get_log_data() returns
+        EXPECT_DELAY_MS(3000);
+        const int fd = AP::FS().open(fname, O_RDONLY);
+        if (fd != -1) {
+            AP_Logger_FileDecompressor *decompressor = new AP_Logger_FileDecompressor;
+            uint32_t size = 0;
+            const bool compressed = decompressor != nullptr && decompressor->open(fd);
+            if (compressed) {
+                size = decompressor->size();
+            }
+            delete decompressor;
+            AP::FS().close(fd);
+            if (compressed) {
+                free(fname);
+                return size;
+            }
+        }
+    }
+#endif
     struct stat st;
     EXPECT_DELAY_MS(3000);
     if (AP::FS().stat(fname, &st) != 0) {
@@ -653,9 +746,34 @@ int16_t AP_Logger_File::get_log_data(const uint16_t list_entry, const uint16_t p
         free(fname);
         _read_offset = 0;
         _read_fd_log_num = log_num;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        if (_read_decompressor == nullptr) {
+            _read_decompressor = new AP_Logger_FileDecompressor;
+        }
+        _read_compressed = _read_decompressor != nullptr && _read_decompressor->open(_read_fd);
+#endif
     }
     uint32_t ofs = page * (uint32_t)LOGGER_PAGE_SIZE + offset;
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_read_compressed) {
+        // a short read means the end of the log to the caller, so
+        // read across frame boundaries
+        uint16_t count = 0;
+        while (count < len) {
+            const int32_t n = _read_decompressor->read(ofs + count, &data[count], len - count);
+            if (n < 0) {
+                return count > 0 ? count : -1;
+            }
+            if (n == 0) {
+                break;
+            }
+            count += n;
+        }
+        return count;
+    }
+#endif
+
     if (ofs != _read_offset) {
         if (AP::FS().lseek(_read_fd, ofs, SEEK_SET) == (off_t)-1) {
             AP::FS().close(_read_fd);
@@ -725,6 +843,13 @@ void AP_Logger_File::stop_logging(void)
     if (_write_fd != -1) {
         int fd = _write_fd;
         _write_fd = -1;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+        if (_compressing && have_sem) {
+            // the IO thread can't write the last frame once the file
+            // is closed
+            write_last_frame(fd);
+        }
+#endif
         AP::FS().close(fd);
     }
     if (have_sem) {
@@ -732,6 +857,27 @@ void AP_Logger_File::stop_logging(void)
     }
 }
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+/*
+  compress whatever is left in the current frame and write it out
+ */
+void AP_Logger_File::write_last_frame(int fd)
+{
+    for (uint8_t i=0; i<2; i++) {
+        const uint8_t *data;
+        uint32_t len;
+        while (_compressor->output(data, len)) {
+            const ssize_t nwritten = AP::FS().write(fd, data, len);
+            if (nwritten <= 0) {
+                return;
+            }
+            _compressor->output_advance(nwritten);
+        }
+        _compressor->finish_frame();
+    }
+}
+#endif
+
 /*
   start writing to a new log file
  */
@@ -795,6 +941,24 @@ void AP_Logger_File::start_new_log(void)
     // create the log directory if need be
     ensure_log_directory_exists();
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // set up before the file is opened so the IO thread never sees
+    // the new file without knowing whether to compress it
+    _compressing = false;
+    if (_front._params.file_compress != 0) {
+        if (_compressor == nullptr) {
+            _compressor = new AP_Logger_FileCompressor;
+        }
+        if (_compressor != nullptr && _compressor->init()) {
+            _compressor->start();
+            _last_compress_stats = {};
+            _compressing = true;
+        } else {
+            hal.console->printf("Out of memory for log compression\n");
+        }
+    }
+#endif
+
     EXPECT_DELAY_MS(3000);
     _write_fd = AP::FS().open(_write_filename, O_WRONLY|O_CREAT|O_TRUNC);
     _cached_oldest_log = 0;
@@ -811,6 +975,9 @@ void AP_Logger_File::start_new_log(void)
     }
     _last_write_ms = AP_HAL::millis();
     _write_offset = 0;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    _compressed_offset = 0;
+#endif
     _writebuf.clear();
     write_fd_semaphore.give();
 
@@ -844,7 +1011,12 @@ void AP_Logger_File::flush(void)
 #if APM_BUILD_TYPE(APM_BUILD_Replay) || APM_BUILD_TYPE(APM_BUILD_UNKNOWN)
 {
     uint32_t tnow = AP_HAL::millis();
-    while (_write_fd != -1 && _initialised && !_open_error && _writebuf.available()) {
+    while (_write_fd != -1 && _initialised && !_open_error &&
+           (_writebuf.available()
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+            || (_compressing && (_compressor->buffered() || _compressor->output_pending()))
+#endif
+            )) {
         // convince the IO timer that it really is OK to write out
         // less than _writebuf_chunk bytes:
         if (tnow > 2001) { // avoid resetting _last_write_time to 0
@@ -868,24 +1040,11 @@ void AP_Logger_File::flush(void)
 #endif // APM_BUILD_TYPE(APM_BUILD_Replay) || APM_BUILD_TYPE(APM_BUILD_UNKNOWN)
 #endif
 
-void AP_Logger_File::_io_timer(void)
+/*
+  check there is room on the card, stopping logging if there isn't
+ */
+bool AP_Logger_File::check_free_space(uint32_t tnow)
 {
-    uint32_t tnow = AP_HAL::millis();
-    _io_timer_heartbeat = tnow;
-    if (_write_fd == -1 || !_initialised || _open_error) {
-        return;
-    }
-
-    uint32_t nbytes = _writebuf.available();
-    if (nbytes == 0) {
-        return;
-    }
-    if (nbytes < _writebuf_chunk && 
-        tnow - _last_write_time < 2000UL) {
-        // write in _writebuf_chunk-sized chunks, but always write at
-        // least once per 2 seconds if data is available
-        return;
-    }
     if (tnow - _free_space_last_check_time > _free_space_check_interval) {
         _free_space_last_check_time = tnow;
         last_io_operation = "disk_space_avail";
@@ -894,40 +1053,21 @@ void AP_Logger_File::_io_timer(void)
             stop_logging();
             _open_error = true; // prevent logging starting again
             last_io_operation = "";
-            return;
+            return false;
         }
         last_io_operation = "";
     }
+    return true;
+}
 
-    hal.util->perf_begin(_perf_write);
-
-    _last_write_time = tnow;
-    if (nbytes > _writebuf_chunk) {
-        // be kind to the filesystem layer
-        nbytes = _writebuf_chunk;
-    }
-
-    uint32_t size;
-    const uint8_t *head = _writebuf.readptr(size);
-    nbytes = MIN(nbytes, size);
-
-    // try to align writes on a 512 byte boundary to avoid filesystem reads
-    if ((nbytes + _write_offset) % 512 != 0) {
-        uint32_t ofs = (nbytes + _write_offset) % 512;
-        if (ofs < nbytes) {
-            nbytes -= ofs;
-        }
-    }
-
+/*
+  write to the log file, closing it if writes keep failing. The
+  caller must hold write_fd_semaphore
+ */
+ssize_t AP_Logger_File::write_to_file(const uint8_t *data, uint32_t nbytes, uint32_t tnow)
+{
     last_io_operation = "write";
-    if (!write_fd_semaphore.take(1)) {
-        return;
-    }
-    if (_write_fd == -1) {
-        write_fd_semaphore.give();
-        return;
-    }
-    ssize_t nwritten = AP::FS().write(_write_fd, head, nbytes);
+    ssize_t nwritten = AP::FS().write(_write_fd, data, nbytes);
     last_io_operation = "";
     if (nwritten <= 0) {
         if ((tnow - _last_write_ms)/1000U > unsigned(_front._params.file_timeout)) {
@@ -946,8 +1086,6 @@ void AP_Logger_File::_io_timer(void)
     } else {
         _last_write_failed = false;
         _last_write_ms = tnow;
-        _write_offset += nwritten;
-        _writebuf.advance(nwritten);
         /*
           the best strategy for minimizing corruption on microSD cards
           seems to be to write in 4k chunks and fsync the file on each
@@ -972,11 +1110,150 @@ void AP_Logger_File::_io_timer(void)
         }
 #endif
     }
+    return nwritten;
+}
+
+void AP_Logger_File::_io_timer(void)
+{
+    uint32_t tnow = AP_HAL::millis();
+    _io_timer_heartbeat = tnow;
+    if (_write_fd == -1 || !_initialised || _open_error) {
+        return;
+    }
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    if (_compressing) {
+        _io_timer_compressed(tnow);
+        return;
+    }
+#endif
+
+    uint32_t nbytes = _writebuf.available();
+    if (nbytes == 0) {
+        return;
+    }
+    if (nbytes < _writebuf_chunk && 
+        tnow - _last_write_time < 2000UL) {
+        // write in _writebuf_chunk-sized chunks, but always write at
+        // least once per 2 seconds if data is available
+        return;
+    }
+    if (!check_free_space(tnow)) {
+        return;
+    }
+
+    hal.util->perf_begin(_perf_write);
+
+    _last_write_time = tnow;
+    if (nbytes > _writebuf_chunk) {
+        // be kind to the filesystem layer
+        nbytes = _writebuf_chunk;
+    }
+
+    uint32_t size;
+    const uint8_t *head = _writebuf.readptr(size);
+    nbytes = MIN(nbytes, size);
+
+    // try to align writes on a 512 byte boundary to avoid filesystem reads
+    if ((nbytes + _write_offset) % 512 != 0) {
+        uint32_t ofs = (nbytes + _write_offset) % 512;
+        if (ofs < nbytes) {
+            nbytes -= ofs;
+        }
+    }
+
+    last_io_operation = "write";
+    if (!write_fd_semaphore.take(1)) {
+        return;
+    }
+    if (_write_fd == -1) {
+        write_fd_semaphore.give();
+        return;
+    }
+    const ssize_t nwritten = write_to_file(head, nbytes, tnow);
+    if (nwritten > 0) {
+        _write_offset += nwritten;
+        _writebuf.advance(nwritten);
+    }
 
     write_fd_semaphore.give();
     hal.util->perf_end(_perf_write);
 }
 
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+/*
+  move log data from the write buffer into the compressor a frame at
+  a time, and write the compressed frames out in _writebuf_chunk
+  pieces. _write_offset counts uncompressed bytes, so the size of the
+  log being written is the same as the size get_log_data() reads
+ */
+void AP_Logger_File::_io_timer_compressed(uint32_t tnow)
+{
+    uint32_t nbytes = _writebuf.available();
+    // don't hold data back for more than 2 seconds
+    const bool timed_out = tnow - _last_write_time >= 2000UL &&
+        (nbytes > 0 || _compressor->buffered() > 0);
+    if (!_compressor->output_pending() && nbytes < _writebuf_chunk && !timed_out) {
+        return;
+    }
+    if (!check_free_space(tnow)) {
+        return;
+    }
+
+    if (!write_fd_semaphore.take(1)) {
+        return;
+    }
+    if (_write_fd == -1 || !_compressing) {
+        write_fd_semaphore.give();
+        return;
+    }
+
+    hal.util->perf_begin(_perf_write);
+
+    if (!_compressor->output_pending()) {
+        while (nbytes > 0 && _compressor->space() > 0) {
+            uint32_t size;
+            const uint8_t *head = _writebuf.readptr(size);
+            size = MIN(MIN(size, nbytes), _compressor->space());
+            if (size == 0) {
+                break;
+            }
+            _compressor->add(head, size);
+            _writebuf.advance(size);
+            _write_offset += size;
+            nbytes -= size;
+        }
+        if (_compressor->space() == 0 || timed_out) {
+            _last_write_time = tnow;
+            hal.util->perf_begin(_perf_compress);
+            _compressor->finish_frame();
+            hal.util->perf_end(_perf_compress);
+        }
+    }
+
+    const uint8_t *data;
+    uint32_t len;
+    if (_compressor->output(data, len)) {
+        uint32_t nbytes = MIN(len, uint32_t(_writebuf_chunk));
+        // try to align writes on a 512 byte boundary to avoid filesystem reads
+        if ((nbytes + _compressed_offset) % 512 != 0) {
+            const uint32_t ofs = (nbytes + _compressed_offset) % 512;
+            if (ofs < nbytes) {
+                nbytes -= ofs;
+            }
+        }
+        const ssize_t nwritten = write_to_file(data, nbytes, tnow);
+        if (nwritten > 0) {
+            _compressed_offset += nwritten;
+            _compressor->output_advance(nwritten);
+        }
+    }
+
+    write_fd_semaphore.give();
+    hal.util->perf_end(_perf_write);
+}
+#endif
+
 bool AP_Logger_File::io_thread_alive() const
 {
     // if the io thread hasn't had a heartbeat in a full seconds then it is dead
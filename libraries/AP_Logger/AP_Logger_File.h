@@ -12,6 +12,8 @@
 
 #include <AP_HAL/utility/RingBuffer.h>
 #include "AP_Logger_Backend.h"
+#include "AP_Logger_Compress.h"
+#include "AP_Logger_RateGovernor.h"
 
 class AP_Logger_File : public AP_Logger_Backend
 {
@@ -47,6 +49,7 @@ public:
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX
     void flush(void) override;
 #endif
+    void periodic_10Hz(const uint32_t now) override;
     void periodic_1Hz() override;
     void periodic_fullrate() override;
 
@@ -107,9 +110,30 @@ private:
     void stop_logging(void) override;
 
     void _io_timer(void);
+    bool check_free_space(uint32_t tnow);
+    ssize_t write_to_file(const uint8_t *data, uint32_t nbytes, uint32_t tnow);
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    // compression of the log being written, if LOG_FILE_COMPR is set
+    AP_Logger_FileCompressor *_compressor;
+    bool _compressing;
+    // bytes written to the file, _write_offset counts uncompressed bytes
+    uint32_t _compressed_offset;
+    AP_Logger_FileCompressor::Stats _last_compress_stats;
+    void _io_timer_compressed(uint32_t tnow);
+    void write_last_frame(int fd);
+    void Write_DSFC();
+
+    // reading a compressed log
+    AP_Logger_FileDecompressor *_read_decompressor;
+    bool _read_compressed;
+#endif
 
     uint32_t last_messagewrite_message_sent;
 
+    // thins out high rate messages when the write buffer is filling
+    AP_Logger_RateGovernor _governor;
+
     // free-space checks; filling up SD cards under NuttX leads to
     // corrupt filesystems which cause loss of data, failure to gather
     // data and failures-to-boot.
@@ -129,6 +153,9 @@ private:
     AP_HAL::Util::perf_counter_t  _perf_fsync;
     AP_HAL::Util::perf_counter_t  _perf_errors;
     AP_HAL::Util::perf_counter_t  _perf_overruns;
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+    AP_HAL::Util::perf_counter_t  _perf_compress;
+#endif
 
     const char *last_io_operation = "";
 };
@@ -0,0 +1,130 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_Logger_RateGovernor.h"
+
+#include <AP_HAL/AP_HAL.h>
+#include "LogStructure.h"
+
+void AP_Logger_RateGovernor::set_ratio(Group group, uint8_t ratio)
+{
+    if (group < Group::NUM_GROUPS) {
+        _ratio[uint8_t(group)] = ratio;
+    }
+}
+
+int8_t AP_Logger_RateGovernor::group_for_msg(uint8_t msg_type)
+{
+    switch (msg_type) {
+    case LOG_IMU_MSG:
+    case LOG_IMU2_MSG:
+    case LOG_IMU3_MSG:
+    case LOG_IMUDT_MSG:
+    case LOG_IMUDT2_MSG:
+    case LOG_IMUDT3_MSG:
+        return int8_t(Group::IMU);
+    case LOG_RATE_MSG:
+        return int8_t(Group::RATE);
+    case LOG_PIDR_MSG:
+    case LOG_PIDP_MSG:
+    case LOG_PIDY_MSG:
+    case LOG_PIDA_MSG:
+    case LOG_PIDS_MSG:
+        return int8_t(Group::PID);
+    }
+    return -1;
+}
+
+bool AP_Logger_RateGovernor::update(uint32_t now_ms, uint32_t bufsize, uint32_t space, uint32_t bytes_in)
+{
+    if (bufsize == 0) {
+        return false;
+    }
+    const uint32_t used = space < bufsize ? bufsize - space : 0;
+    _fill_pct = uint64_t(used) * 100 / bufsize;
+
+    if (!_have_update) {
+        _have_update = true;
+        _last_update_ms = now_ms;
+        _last_bytes_in = bytes_in;
+        _last_used = used;
+        _low_since_ms = now_ms;
+        return false;
+    }
+
+    const uint32_t dt_ms = now_ms - _last_update_ms;
+    if (dt_ms == 0) {
+        return false;
+    }
+    // bytes_in starts again from zero with each new log
+    const uint32_t in = bytes_in >= _last_bytes_in ? bytes_in - _last_bytes_in : bytes_in;
+    // whatever came in and isn't still in the buffer was written out
+    const int64_t out = int64_t(in) + _last_used - used;
+    _rate_in = uint64_t(in) * 1000 / dt_ms;
+    _rate_out = out > 0 ? uint64_t(out) * 1000 / dt_ms : 0;
+    const bool filling = used > _last_used;
+
+    _last_update_ms = now_ms;
+    _last_bytes_in = bytes_in;
+    _last_used = used;
+
+    if (_fill_pct >= fill_low_pct) {
+        _low_since_ms = now_ms;
+    }
+
+    const uint8_t old_level = _level;
+    if (_level < max_level &&
+        (_fill_pct >= fill_full_pct || (_fill_pct >= fill_high_pct && filling)) &&
+        now_ms - _last_step_ms >= step_up_ms) {
+        _level++;
+        _last_step_ms = now_ms;
+    } else if (_level > 0 && now_ms - _low_since_ms >= step_down_ms) {
+        _level--;
+        _last_step_ms = now_ms;
+        // need another full period at low fill for the next step
+        _low_since_ms = now_ms;
+    }
+    return _level != old_level;
+}
+
+bool AP_Logger_RateGovernor::decimate(uint8_t msg_type)
+{
+    if (_level == 0) {
+        return false;
+    }
+    const int8_t group = group_for_msg(msg_type);
+    if (group < 0 || _ratio[group] <= 1) {
+        return false;
+    }
+    uint16_t ratio = uint16_t(_ratio[group]) << (_level - 1);
+    if (ratio > UINT8_MAX) {
+        ratio = UINT8_MAX;
+    }
+    if (_count[msg_type]++ == 0) {
+        return false;
+    }
+    if (_count[msg_type] >= ratio) {
+        _count[msg_type] = 0;
+    }
+    _decimated++;
+    return true;
+}
+
+uint32_t AP_Logger_RateGovernor::take_decimated_count()
+{
+    const uint32_t ret = _decimated;
+    _decimated = 0;
+    return ret;
+}
@@ -0,0 +1,100 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  thin out high rate log messages when the log can't keep up.
+
+  The governor watches how full a backend's write buffer is and whether
+  the buffer is being filled faster than it is written out. When the
+  buffer is filling it raises its level, and at each level the IMU,
+  RATE and PID messages are decimated by a larger ratio, keeping every
+  Nth message of each type. It steps back down once the buffer has
+  stayed nearly empty for a while. This spreads the loss evenly over
+  time instead of dropping every message once the buffer is full.
+ */
+#pragma once
+
+#include <stdint.h>
+
+class AP_Logger_RateGovernor {
+public:
+    enum class Group : uint8_t {
+        IMU  = 0,
+        RATE = 1,
+        PID  = 2,
+        NUM_GROUPS
+    };
+
+    static const uint8_t max_level = 3;
+
+    /*
+      set the ratio a group is decimated by at level 1. It doubles at
+      each level after that, up to 255. 0 or 1 leaves the group alone
+     */
+    void set_ratio(Group group, uint8_t ratio);
+
+    /*
+      update from the state of the write buffer. bytes_in is a running
+      count of the bytes put in the buffer. Returns true if the level
+      changed
+     */
+    bool update(uint32_t now_ms, uint32_t bufsize, uint32_t space, uint32_t bytes_in);
+
+    // true if a message of type msg_type should be thinned out
+    bool decimate(uint8_t msg_type);
+
+    uint8_t level() const { return _level; }
+
+    // buffer fill, as a percentage, and the rates the buffer was
+    // filled and emptied at, in bytes/second, from the last update
+    uint8_t fill_pct() const { return _fill_pct; }
+    uint32_t rate_in() const { return _rate_in; }
+    uint32_t rate_out() const { return _rate_out; }
+
+    // messages thinned out since the last call
+    uint32_t take_decimated_count();
+
+private:
+    // buffer fill at which the level is raised if the buffer is still
+    // filling, and at which it is raised regardless
+    static const uint8_t fill_high_pct = 50;
+    static const uint8_t fill_full_pct = 75;
+    // buffer fill below which the level is lowered...
+    static const uint8_t fill_low_pct = 25;
+    // ... once it has been that low for this long
+    static const uint16_t step_down_ms = 2000;
+    // shortest time between raising the level
+    static const uint16_t step_up_ms = 500;
+
+    static int8_t group_for_msg(uint8_t msg_type);
+
+    uint8_t _ratio[uint8_t(Group::NUM_GROUPS)] {};
+    uint8_t _level = 0;
+
+    // per message type counters, so that each instance of a message
+    // is thinned out evenly
+    uint8_t _count[256] {};
+    uint32_t _decimated = 0;
+
+    uint32_t _last_update_ms = 0;
+    uint32_t _last_bytes_in = 0;
+    uint32_t _last_used = 0;
+    uint32_t _last_step_ms = 0;
+    uint32_t _low_since_ms = 0;
+    bool _have_update = false;
+
+    uint8_t _fill_pct = 0;
+    uint32_t _rate_in = 0;
+    uint32_t _rate_out = 0;
+};
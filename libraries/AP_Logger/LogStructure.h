@@ -185,6 +185,26 @@ struct PACKED log_DSF {
     uint32_t buf_space_avg;
 };
 
+struct PACKED log_DSFC {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    float ratio;
+    float rate;
+    uint32_t compress_us;
+};
+
+struct PACKED log_LGOV {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t level;
+    uint8_t fill;
+    uint32_t rate_in;
+    uint32_t rate_out;
+    uint32_t decimated;
+};
+
 struct PACKED log_Event {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -278,6 +298,27 @@ struct PACKED log_ISBD {
 };
 static_assert(sizeof(log_ISBD) < 256, "log_ISBD is over-size");
 
+// compressed replacement for log_ISBD, see AP_InertialSensor/BatchCodec.h
+struct PACKED log_ISBC {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint16_t isb_seqno;
+    uint16_t seqno; // index of the first sample within isb_seqno
+    uint16_t count; // samples coded in data
+    uint8_t data[192];
+};
+static_assert(sizeof(log_ISBC) < 256, "log_ISBC is over-size");
+
+struct PACKED log_ISBS {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint16_t seqno;
+    uint16_t sample_count;
+    uint16_t msg_count;
+    float ratio;
+    uint32_t encode_us;
+};
+
 struct PACKED log_Vibe {
     LOG_PACKET_HEADER;
     uint64_t time_us;
@@ -875,6 +916,8 @@ struct PACKED log_TERRAIN {
     float current_height;
     uint16_t pending;
     uint16_t loaded;
+    uint32_t cache_hits;
+    uint32_t cache_misses;
 };
 
 /*
@@ -1291,6 +1334,30 @@ struct PACKED log_PSC {
     float accel_y;
 };
 
+struct PACKED log_Scripting {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    char name[16];
+    uint32_t run_time;
+    uint32_t gc_time;
+    uint32_t gc_max;
+    uint32_t total_mem;
+    uint32_t heap_peak;
+    uint8_t pool_frag;
+};
+
+struct PACKED log_Semaphore {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    char site[16];
+    uint32_t acquire_count;
+    uint32_t contended_count;
+    uint32_t slow_count;
+    uint32_t wait_max;
+    uint32_t hold_max;
+    char holder[16];
+};
+
 // FMT messages define all message formats other than FMT
 // UNIT messages define units which can be referenced by FMTU messages
 // FMTU messages associate types (e.g. centimeters/second/second) to FMT message fields
@@ -1337,6 +1404,16 @@ struct PACKED log_PSC {
 #define ISBD_UNITS  "s--ooo"
 #define ISBD_MULTS  "F--???"
 
+#define ISBC_LABELS "TimeUS,N,seqno,cnt,d0,d1,d2"
+#define ISBC_FMT    "QHHHaaa"
+#define ISBC_UNITS  "s------"
+#define ISBC_MULTS  "F------"
+
+#define ISBS_LABELS "TimeUS,N,smp_cnt,msgs,ratio,EncUS"
+#define ISBS_FMT    "QHHHfI"
+#define ISBS_UNITS  "s----s"
+#define ISBS_MULTS  "F----F"
+
 #define IMU_LABELS "TimeUS,GyrX,GyrY,GyrZ,AccX,AccY,AccZ,EG,EA,T,GH,AH,GHz,AHz"
 #define IMU_FMT   "QffffffIIfBBHH"
 #define IMU_UNITS "sEEEooo--O--zz"
@@ -1560,6 +1637,24 @@ struct PACKED log_PSC {
 // @Field: FMx: Maximum free space in write buffer in last time period
 // @Field: FAv: Average free space in write buffer in last time period
 
+// @LoggerMessage: DSFC
+// @Description: Log file compression statistics, written once a second while the File backend is compressing the log
+// @Field: TimeUS: Time since system startup
+// @Field: In: log data compressed so far
+// @Field: Out: bytes written to the log file so far
+// @Field: Ratio: log data over bytes written, in the last time period
+// @Field: CRate: megabytes of log data compressed per second spent compressing, in the last time period
+// @Field: CUS: time spent compressing in the last time period
+
+// @LoggerMessage: LGOV
+// @Description: Log rate governor decisions, written when the File backend changes how much it thins out high rate messages
+// @Field: TimeUS: Time since system startup
+// @Field: Lvl: new governor level, 0 when nothing is thinned out
+// @Field: Fill: write buffer fill
+// @Field: InR: rate the write buffer was being filled at
+// @Field: OutR: rate the write buffer was being written out at
+// @Field: Dec: messages thinned out since the last LGOV message
+
 // @LoggerMessage: DSTL
 // @Description: Deepstall Landing data
 // @Field: TimeUS: Time since system startup
@@ -1754,6 +1849,25 @@ struct PACKED log_PSC {
 // @Field: GHz: gyroscope measurement rate
 // @Field: AHz: accelerometer measurement rate
 
+// @LoggerMessage: ISBC
+// @Description: Compressed batch sampled IMU data, written instead of ISBD when compression is enabled in INS_LOG_BAT_OPT
+// @Field: TimeUS: Time since system startup
+// @Field: N: batch number, matching the ISBH header for the batch
+// @Field: seqno: index of the first sample of this message within the batch
+// @Field: cnt: number of samples in this message
+// @Field: d0: first third of the coded samples
+// @Field: d1: second third of the coded samples
+// @Field: d2: last third of the coded samples
+
+// @LoggerMessage: ISBS
+// @Description: Batch sampler compression statistics, written at the end of each compressed batch
+// @Field: TimeUS: Time since system startup
+// @Field: N: batch number
+// @Field: smp_cnt: number of samples in the batch
+// @Field: msgs: number of ISBC messages the batch took
+// @Field: ratio: bytes the batch would have taken as ISBD messages over the bytes taken as ISBC messages
+// @Field: EncUS: total time spent compressing the batch
+
 // @LoggerMessage: LGR
 // @Description: Landing gear information
 // @Field: TimeUS: Time since system startup
@@ -2204,6 +2318,8 @@ struct PACKED log_PSC {
 // @Field: CHeight: Vehicle height above terrain
 // @Field: Pending: Number of tile requests outstanding
 // @Field: Loaded: Number of tiles in memory
+// @Field: Hit: Number of tile lookups satisfied from the memory cache
+// @Field: Miss: Number of tile lookups which required a disk read
 
 // @LoggerMessage: TSYN
 // @Description: Time synchronisation response information
@@ -2488,6 +2604,28 @@ struct PACKED log_PSC {
 // @Field: AX: Acceleration, X-axis
 // @Field: AY: Acceleration, Y-axis
 
+// @LoggerMessage: SCR
+// @Description: Scripting runtime and memory statistics
+// @Field: TimeUS: Time since system startup
+// @Field: Name: script name
+// @Field: Runtime: run time of the script, including any incremental garbage collection during the run
+// @Field: GCTime: time for the full garbage collection after the script run
+// @Field: GCMax: longest garbage collection time for this script
+// @Field: Mem: Lua memory in use after the script run
+// @Field: Peak: peak scripting heap use, including the pool arena and script bookkeeping
+// @Field: PFrag: percentage of the small object pools which is free
+
+// @LoggerMessage: SEM
+// @Description: Semaphore contention statistics, logged when semaphore profiling is enabled in SCHED_OPTIONS
+// @Field: TimeUS: Time since system startup
+// @Field: Site: call site that first took the semaphore
+// @Field: Acq: number of times the semaphore was taken
+// @Field: Cont: number of takes that had to wait
+// @Field: Slow: number of takes that waited 1ms or more
+// @Field: WMax: longest wait to take the semaphore
+// @Field: HMax: longest time the semaphore was held
+// @Field: Holder: call site of the longest holder
+
 // messages for all boards
 #define LOG_BASE_STRUCTURES \
     { LOG_FORMAT_MSG, sizeof(log_Format), \
@@ -2613,7 +2751,7 @@ struct PACKED log_PSC {
     { LOG_XKV2_MSG, sizeof(log_ekfStateVar), \
       "XKV2","Qffffffffffff","TimeUS,V12,V13,V14,V15,V16,V17,V18,V19,V20,V21,V22,V23", "s------------", "F------------" }, \
     { LOG_TERRAIN_MSG, sizeof(log_TERRAIN), \
-      "TERR","QBLLHffHH","TimeUS,Status,Lat,Lng,Spacing,TerrH,CHeight,Pending,Loaded", "s-DU-mm--", "F-GG-00--" }, \
+      "TERR","QBLLHffHHII","TimeUS,Status,Lat,Lng,Spacing,TerrH,CHeight,Pending,Loaded,Hit,Miss", "s-DU-mm----", "F-GG-00----" }, \
     { LOG_GPS_UBX1_MSG, sizeof(log_Ubx1), \
       "UBX1", "QBHBBHI",  "TimeUS,Instance,noisePerMS,jamInd,aPower,agcCnt,config", "s#-----", "F------"  }, \
     { LOG_GPS_UBX2_MSG, sizeof(log_Ubx2), \
@@ -2674,10 +2812,18 @@ struct PACKED log_PSC {
       "ISBH",ISBH_FMT,ISBH_LABELS,ISBH_UNITS,ISBH_MULTS },  \
     { LOG_ISBD_MSG, sizeof(log_ISBD), \
       "ISBD",ISBD_FMT,ISBD_LABELS, ISBD_UNITS, ISBD_MULTS }, \
+    { LOG_ISBC_MSG, sizeof(log_ISBC), \
+      "ISBC",ISBC_FMT,ISBC_LABELS, ISBC_UNITS, ISBC_MULTS }, \
+    { LOG_ISBS_MSG, sizeof(log_ISBS), \
+      "ISBS",ISBS_FMT,ISBS_LABELS, ISBS_UNITS, ISBS_MULTS }, \
     { LOG_ORGN_MSG, sizeof(log_ORGN), \
       "ORGN","QBLLe","TimeUS,Type,Lat,Lng,Alt", "s-DUm", "F-GGB" },   \
     { LOG_DF_FILE_STATS, sizeof(log_DSF), \
       "DSF", "QIHIIII", "TimeUS,Dp,Blk,Bytes,FMn,FMx,FAv", "s--b---", "F--0---" }, \
+    { LOG_DSFC_MSG, sizeof(log_DSFC), \
+      "DSFC", "QQQffI", "TimeUS,In,Out,Ratio,CRate,CUS", "sbb--s", "F00--F" }, \
+    { LOG_LGOV_MSG, sizeof(log_LGOV), \
+      "LGOV", "QBBIII", "TimeUS,Lvl,Fill,InR,OutR,Dec", "s-%---", "F-0---" }, \
     { LOG_RPM_MSG, sizeof(log_RPM), \
       "RPM",  "Qff", "TimeUS,rpm1,rpm2", "sqq", "F00" }, \
     { LOG_RATE_MSG, sizeof(log_Rate), \
@@ -2707,7 +2853,11 @@ struct PACKED log_PSC {
     { LOG_WINCH_MSG, sizeof(log_Winch), \
       "WINC", "QBBBBBfffHfb", "TimeUS,Heal,ThEnd,Mov,Clut,Mode,DLen,Len,DRate,Tens,Vcc,Temp", "s-----mmn?vO", "F-----000000" }, \
     { LOG_PSC_MSG, sizeof(log_PSC), \
-      "PSC", "Qffffffffffff", "TimeUS,TPX,TPY,PX,PY,TVX,TVY,VX,VY,TAX,TAY,AX,AY", "smmmmnnnnoooo", "F000000000000" }
+      "PSC", "Qffffffffffff", "TimeUS,TPX,TPY,PX,PY,TVX,TVY,VX,VY,TAX,TAY,AX,AY", "smmmmnnnnoooo", "F000000000000" }, \
+    { LOG_SCRIPTING_MSG, sizeof(log_Scripting), \
+      "SCR", "QNIIIIIB", "TimeUS,Name,Runtime,GCTime,GCMax,Mem,Peak,PFrag", "s-sssbb%", "F-FFF000" }, \
+    { LOG_SEMAPHORE_MSG, sizeof(log_Semaphore), \
+      "SEM", "QNIIIIIN", "TimeUS,Site,Acq,Cont,Slow,WMax,HMax,Holder", "s----ss-", "F----FF-" }
 
 // @LoggerMessage: SBPH
 // @Description: Swift Health Data
@@ -2852,9 +3002,13 @@ enum LogMessages : uint8_t {
     LOG_BEACON_MSG,
     LOG_PROXIMITY_MSG,
     LOG_DF_FILE_STATS,
+    LOG_DSFC_MSG,
+    LOG_LGOV_MSG,
     LOG_SRTL_MSG,
     LOG_ISBH_MSG,
     LOG_ISBD_MSG,
+    LOG_ISBC_MSG,
+    LOG_ISBS_MSG,
     LOG_ASP2_MSG,
     LOG_PERFORMANCE_MSG,
     LOG_OPTFLOW_MSG,
@@ -2870,6 +3024,8 @@ enum LogMessages : uint8_t {
     LOG_SIMPLE_AVOID_MSG,
     LOG_WINCH_MSG,
     LOG_PSC_MSG,
+    LOG_SCRIPTING_MSG,
+    LOG_SEMAPHORE_MSG,
 
     _LOG_LAST_MSG_
 };
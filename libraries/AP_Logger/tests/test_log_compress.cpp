@@ -0,0 +1,248 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Logger/AP_Logger_Compress.h>
+
+#if HAL_LOGGER_FILE_COMPRESS_ENABLED
+
+using namespace AP_Logger_Compressed;
+
+#define TEST_LOG "test_log_compress.bin"
+
+/*
+  something like log data: fixed headers and slowly changing
+  timestamps and values, with some noise
+ */
+static void fill_log(uint8_t *data, uint32_t len)
+{
+    uint64_t t = 0;
+    uint32_t i = 0;
+    while (i < len) {
+        uint8_t msg[40] { 0xA3, 0x95, uint8_t(30 + (t/1000) % 5) };
+        memcpy(&msg[3], &t, sizeof(t));
+        for (uint8_t j=11; j<sizeof(msg); j++) {
+            msg[j] = (j % 4 == 0) ? (random() & 3) : (j % 4 == 1) ? (t >> 12) : 0;
+        }
+        const uint32_t n = MIN(uint32_t(sizeof(msg)), len - i);
+        memcpy(&data[i], msg, n);
+        i += n;
+        t += 2500;
+    }
+}
+
+static void lz4_round_trip(const uint8_t *data, uint32_t len)
+{
+    uint16_t table[AP_Logger_LZ4::hash_size];
+    uint8_t *c = new uint8_t[AP_Logger_LZ4::bound(len)];
+    uint8_t *d = new uint8_t[len+1];
+    const uint32_t clen = AP_Logger_LZ4::compress(data, len, c, AP_Logger_LZ4::bound(len), table);
+    ASSERT_GT(clen, 0U);
+    EXPECT_EQ(AP_Logger_LZ4::decompress(c, clen, d, len), int32_t(len));
+    EXPECT_EQ(memcmp(data, d, len), 0);
+    // corrupt data must not overrun the output
+    for (uint32_t i=0; i<clen; i+=7) {
+        c[i] ^= 0x5A;
+        AP_Logger_LZ4::decompress(c, clen, d, len);
+    }
+    delete[] c;
+    delete[] d;
+}
+
+TEST(AP_Logger_Compress, lz4)
+{
+    srandom(1);
+    static uint8_t data[frame_size];
+    fill_log(data, sizeof(data));
+    for (uint32_t len=0; len<40; len++) {
+        lz4_round_trip(data, len);
+    }
+    lz4_round_trip(data, sizeof(data));
+
+    // log data compresses
+    uint16_t table[AP_Logger_LZ4::hash_size];
+    static uint8_t c[frame_size];
+    const uint32_t clen = AP_Logger_LZ4::compress(data, sizeof(data), c, sizeof(c), table);
+    EXPECT_GT(clen, 0U);
+    EXPECT_LT(clen, sizeof(data)*3/4);
+
+    // random data doesn't fit in its own size
+    for (uint32_t i=0; i<sizeof(data); i++) {
+        data[i] = random();
+    }
+    EXPECT_EQ(AP_Logger_LZ4::compress(data, sizeof(data), c, sizeof(c), table), 0U);
+    lz4_round_trip(data, sizeof(data));
+}
+
+/*
+  write len bytes of data through the compressor in uneven pieces,
+  returning the size of the file
+ */
+static uint32_t write_log(const uint8_t *data, uint32_t len)
+{
+    AP_Logger_FileCompressor *comp = new AP_Logger_FileCompressor;
+    EXPECT_TRUE(comp->init());
+    comp->start();
+    int fd = AP::FS().open(TEST_LOG, O_WRONLY|O_CREAT|O_TRUNC);
+    EXPECT_NE(fd, -1);
+    uint32_t ofs = 0;
+    uint32_t file_size = 0;
+    while (ofs < len || comp->buffered() > 0 || comp->output_pending()) {
+        const uint8_t *out;
+        uint32_t n;
+        if (comp->output(out, n)) {
+            n = MIN(n, 4096U);
+            EXPECT_EQ(AP::FS().write(fd, out, n), int32_t(n));
+            comp->output_advance(n);
+            file_size += n;
+            continue;
+        }
+        n = MIN(MIN(uint32_t(1 + random() % 5000), len - ofs), comp->space());
+        comp->add(&data[ofs], n);
+        ofs += n;
+        // the IO thread finishes frames early when data is slow to arrive
+        if (comp->space() == 0 || ofs == len || random() % 20 == 0) {
+            comp->finish_frame();
+        }
+    }
+    AP::FS().close(fd);
+    EXPECT_EQ(comp->get_stats().bytes_in, len);
+    EXPECT_EQ(comp->get_stats().bytes_out, file_size);
+    delete comp;
+    return file_size;
+}
+
+// read back at random offsets
+static void check_reads(const uint8_t *data, uint64_t len)
+{
+    int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    ASSERT_NE(fd, -1);
+    AP_Logger_FileDecompressor *d = new AP_Logger_FileDecompressor;
+    ASSERT_TRUE(d->open(fd));
+    EXPECT_EQ(d->size(), len);
+    uint8_t buf[512];
+    // sequential, as a log download does
+    uint64_t ofs = 0;
+    while (ofs < len) {
+        const int32_t n = d->read(ofs, buf, 90);
+        ASSERT_GT(n, 0);
+        ASSERT_EQ(memcmp(buf, &data[ofs], n), 0) << "at " << ofs;
+        ofs += n;
+    }
+    EXPECT_EQ(d->read(len, buf, sizeof(buf)), 0);
+    // and random, as for a replayed or re-requested download
+    for (uint16_t i=0; i<2000; i++) {
+        ofs = random() % len;
+        const int32_t n = d->read(ofs, buf, sizeof(buf));
+        ASSERT_GT(n, 0);
+        ASSERT_EQ(memcmp(buf, &data[ofs], n), 0) << "at " << ofs;
+    }
+    delete d;
+    AP::FS().close(fd);
+}
+
+TEST(AP_Logger_Compress, file)
+{
+    srandom(2);
+    // enough frames to thin out the index
+    const uint32_t len = 8 * 1024 * 1024;
+    uint8_t *data = new uint8_t[len];
+    fill_log(data, len);
+    const uint32_t file_size = write_log(data, len);
+    EXPECT_LT(file_size, len*3/4);
+    check_reads(data, len);
+
+    // a log that isn't compressed is left alone
+    int fd = AP::FS().open(TEST_LOG, O_WRONLY|O_CREAT|O_TRUNC);
+    AP::FS().write(fd, data, 4096);
+    AP::FS().close(fd);
+    fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    AP_Logger_FileDecompressor d;
+    EXPECT_FALSE(d.open(fd));
+    AP::FS().close(fd);
+
+    AP::FS().unlink(TEST_LOG);
+    delete[] data;
+}
+
+// a log cut short part way through a frame loses only that frame
+TEST(AP_Logger_Compress, truncated)
+{
+    srandom(3);
+    const uint32_t len = 1024 * 1024;
+    uint8_t *data = new uint8_t[len];
+    fill_log(data, len);
+    const uint32_t file_size = write_log(data, len);
+    ASSERT_EQ(truncate(TEST_LOG, file_size - 100), 0);
+
+    int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    AP_Logger_FileDecompressor *d = new AP_Logger_FileDecompressor;
+    ASSERT_TRUE(d->open(fd));
+    const uint64_t size = d->size();
+    EXPECT_LT(size, len);
+    EXPECT_GT(size, len - frame_size - 1);
+    check_reads(data, size);
+    delete d;
+    AP::FS().close(fd);
+    AP::FS().unlink(TEST_LOG);
+    delete[] data;
+}
+
+// a log that is still being written can be read as it grows
+TEST(AP_Logger_Compress, growing)
+{
+    srandom(4);
+    const uint32_t len = 512 * 1024;
+    uint8_t *data = new uint8_t[len];
+    fill_log(data, len);
+    const uint32_t file_size = write_log(data, len);
+
+    uint8_t *file = new uint8_t[file_size];
+    int fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    ASSERT_EQ(AP::FS().read(fd, file, file_size), int32_t(file_size));
+    AP::FS().close(fd);
+
+    // start with a third of the file, part way through a frame
+    const uint32_t part = file_size / 3;
+    int wfd = AP::FS().open(TEST_LOG, O_WRONLY|O_CREAT|O_TRUNC);
+    ASSERT_EQ(AP::FS().write(wfd, file, part), int32_t(part));
+
+    fd = AP::FS().open(TEST_LOG, O_RDONLY);
+    AP_Logger_FileDecompressor *d = new AP_Logger_FileDecompressor;
+    ASSERT_TRUE(d->open(fd));
+    uint8_t buf[512];
+    uint64_t ofs = 0;
+    int32_t n;
+    while ((n = d->read(ofs, buf, sizeof(buf))) > 0) {
+        ASSERT_EQ(memcmp(buf, &data[ofs], n), 0) << "at " << ofs;
+        ofs += n;
+    }
+    EXPECT_EQ(n, 0);
+    EXPECT_GT(ofs, 0U);
+    EXPECT_LT(ofs, len);
+
+    // the rest arrives and reading carries on to the end
+    ASSERT_EQ(AP::FS().write(wfd, &file[part], file_size - part), int32_t(file_size - part));
+    AP::FS().close(wfd);
+    while ((n = d->read(ofs, buf, sizeof(buf))) > 0) {
+        ASSERT_EQ(memcmp(buf, &data[ofs], n), 0) << "at " << ofs;
+        ofs += n;
+    }
+    EXPECT_EQ(n, 0);
+    EXPECT_EQ(ofs, len);
+    EXPECT_EQ(d->size(), len);
+
+    delete d;
+    AP::FS().close(fd);
+    AP::FS().unlink(TEST_LOG);
+    delete[] file;
+    delete[] data;
+}
+
+#endif // HAL_LOGGER_FILE_COMPRESS_ENABLED
+
+AP_GTEST_MAIN()
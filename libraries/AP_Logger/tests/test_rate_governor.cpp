@@ -0,0 +1,120 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Logger/AP_Logger_RateGovernor.h>
+#include <AP_Logger/LogStructure.h>
+
+#define BUFSIZE 16384U
+
+typedef AP_Logger_RateGovernor::Group Group;
+
+/*
+  feed the governor a buffer that fills at rate_in and empties at
+  rate_out bytes/second for ms milliseconds, updating at 10Hz
+ */
+static void run(AP_Logger_RateGovernor &gov, uint32_t &now, uint32_t &used, uint32_t &bytes_in,
+                uint32_t rate_in, uint32_t rate_out, uint32_t ms)
+{
+    for (uint32_t t=0; t<ms; t+=100) {
+        now += 100;
+        bytes_in += rate_in / 10;
+        int64_t u = int64_t(used) + rate_in/10 - rate_out/10;
+        if (u < 0) {
+            u = 0;
+        }
+        if (u > BUFSIZE) {
+            u = BUFSIZE;
+        }
+        used = u;
+        gov.update(now, BUFSIZE, BUFSIZE - used, bytes_in);
+    }
+}
+
+TEST(AP_Logger_RateGovernor, levels)
+{
+    AP_Logger_RateGovernor gov;
+    uint32_t now = 1000, used = 0, bytes_in = 0;
+
+    // keeping up, nothing to do
+    run(gov, now, used, bytes_in, 20000, 40000, 5000);
+    EXPECT_EQ(gov.level(), 0U);
+
+    // can't keep up: the level goes up a step at a time
+    run(gov, now, used, bytes_in, 40000, 30000, 1000);
+    EXPECT_EQ(gov.level(), 1U);
+    EXPECT_GT(gov.fill_pct(), 50U);
+    EXPECT_EQ(gov.rate_in(), 40000U);
+    EXPECT_EQ(gov.rate_out(), 30000U);
+    run(gov, now, used, bytes_in, 40000, 30000, 3000);
+    EXPECT_EQ(gov.level(), unsigned(AP_Logger_RateGovernor::max_level));
+
+    // above the high mark but emptying: stays put
+    run(gov, now, used, bytes_in, 30000, 35000, 1000);
+    EXPECT_EQ(gov.level(), unsigned(AP_Logger_RateGovernor::max_level));
+
+    // once the buffer is nearly empty it steps back down, slowly
+    run(gov, now, used, bytes_in, 10000, 40000, 1000);
+    EXPECT_LT(gov.fill_pct(), 25U);
+    EXPECT_EQ(gov.level(), unsigned(AP_Logger_RateGovernor::max_level));
+    run(gov, now, used, bytes_in, 10000, 40000, 2000);
+    EXPECT_EQ(gov.level(), unsigned(AP_Logger_RateGovernor::max_level) - 1);
+    run(gov, now, used, bytes_in, 10000, 40000, 4000);
+    EXPECT_EQ(gov.level(), 0U);
+}
+
+TEST(AP_Logger_RateGovernor, new_log)
+{
+    AP_Logger_RateGovernor gov;
+    uint32_t now = 1000, used = 0, bytes_in = 1000000;
+    run(gov, now, used, bytes_in, 20000, 20000, 1000);
+
+    // the byte count starts again with a new log
+    bytes_in = 0;
+    used = 0;
+    run(gov, now, used, bytes_in, 20000, 20000, 100);
+    EXPECT_EQ(gov.rate_in(), 20000U);
+    EXPECT_EQ(gov.level(), 0U);
+}
+
+TEST(AP_Logger_RateGovernor, decimate)
+{
+    AP_Logger_RateGovernor gov;
+    gov.set_ratio(Group::IMU, 2);
+    gov.set_ratio(Group::PID, 3);
+
+    // nothing is thinned out at level 0
+    for (uint8_t i=0; i<10; i++) {
+        EXPECT_FALSE(gov.decimate(LOG_IMU_MSG));
+    }
+
+    uint32_t now = 1000, used = 0, bytes_in = 0;
+    run(gov, now, used, bytes_in, 40000, 30000, 1000);
+    ASSERT_EQ(gov.level(), 1U);
+
+    // each instance is thinned out evenly, even when interleaved
+    uint16_t kept_imu1 = 0, kept_imu2 = 0, kept_pid = 0, kept_rate = 0;
+    for (uint16_t i=0; i<120; i++) {
+        kept_imu1 += !gov.decimate(LOG_IMU_MSG);
+        kept_imu2 += !gov.decimate(LOG_IMU2_MSG);
+        kept_pid += !gov.decimate(LOG_PIDR_MSG);
+        kept_rate += !gov.decimate(LOG_RATE_MSG);
+        EXPECT_FALSE(gov.decimate(LOG_GPS_MSG));
+    }
+    EXPECT_EQ(kept_imu1, 60U);
+    EXPECT_EQ(kept_imu2, 60U);
+    EXPECT_EQ(kept_pid, 40U);
+    EXPECT_EQ(kept_rate, 120U);
+    EXPECT_EQ(gov.take_decimated_count(), 60U + 60U + 80U);
+    EXPECT_EQ(gov.take_decimated_count(), 0U);
+
+    // the ratio doubles with each level
+    run(gov, now, used, bytes_in, 40000, 30000, 500);
+    ASSERT_EQ(gov.level(), 2U);
+    kept_imu1 = 0;
+    for (uint16_t i=0; i<120; i++) {
+        kept_imu1 += !gov.decimate(LOG_IMU_MSG);
+    }
+    EXPECT_EQ(kept_imu1, 30U);
+}
+
+AP_GTEST_MAIN()
@@ -633,6 +633,12 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
         return false;
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    if (cache_read(index, cmd)) {
+        return true;
+    }
+#endif
+
     // Find out proper location in memory by using the start_byte position + the index
     // we can load a command, we don't process it yet
     // read WP position
@@ -680,6 +686,10 @@ bool AP_Mission::read_cmd_from_storage(uint16_t index, Mission_Command& cmd) con
     // set command's index to it's position in eeprom
     cmd.index = index;
 
+#if AP_MISSION_CACHE_ENABLED
+    cache_store(index, cmd);
+#endif
+
     // return success
     return true;
 }
@@ -755,6 +765,12 @@ bool AP_Mission::write_cmd_to_storage(uint16_t index, const Mission_Command& cmd
         _storage.write_block(pos_in_storage+5, packed.bytes, 10);
     }
 
+#if AP_MISSION_CACHE_ENABLED
+    // the next read decodes the command from storage again, so the
+    // cache holds exactly what was stored
+    cache_invalidate(index);
+#endif
+
     // remember when the mission last changed
     _last_change_time_ms = AP_HAL::millis();
 
@@ -1927,7 +1943,7 @@ uint16_t AP_Mission::get_landing_sequence_start()
     float min_distance = -1;
 
     // Go through mission looking for nearest landing start command
-    for (uint16_t i = 1; i < num_commands(); i++) {
+    for (uint16_t i = next_landing_cmd(0); i < num_commands(); i = next_landing_cmd(i)) {
         Mission_Command tmp;
         if (!read_cmd_from_storage(i, tmp)) {
             continue;
@@ -1977,7 +1993,7 @@ bool AP_Mission::jump_to_abort_landing_sequence(void)
     if (AP::ahrs().get_position(current_loc)) {
         float min_distance = FLT_MAX;
 
-        for (uint16_t i = 1; i < num_commands(); i++) {
+        for (uint16_t i = next_landing_cmd(0); i < num_commands(); i = next_landing_cmd(i)) {
             Mission_Command tmp;
             if (!read_cmd_from_storage(i, tmp)) {
                 continue;
@@ -2257,6 +2273,125 @@ bool AP_Mission::contains_item(MAV_CMD command) const
     return false;
 }
 
+/*
+  return the index of the next command after index which may be a
+  DO_LAND_START or DO_GO_AROUND. Without the landing index that is
+  every command
+ */
+uint16_t AP_Mission::next_landing_cmd(uint16_t index) const
+{
+#if AP_MISSION_CACHE_ENABLED
+    WITH_SEMAPHORE(_rsem);
+
+    if (cache_update_landing_index()) {
+        for (uint16_t i=0; i<_cache.landing_count; i++) {
+            if (_cache.landing[i] > index) {
+                return _cache.landing[i];
+            }
+        }
+        return num_commands();
+    }
+#endif
+    return index + 1;
+}
+
+#if AP_MISSION_CACHE_ENABLED
+/*
+  return a decoded command from the cache if it has been loaded
+ */
+bool AP_Mission::cache_read(uint16_t index, Mission_Command& cmd) const
+{
+    if (index >= _cache.size || (_cache.loaded[index/32] & (1U << (index%32))) == 0) {
+        return false;
+    }
+    cmd = _cache.cmds[index];
+    return true;
+}
+
+/*
+  add a decoded command to the cache, allocating it on first use
+ */
+void AP_Mission::cache_store(uint16_t index, const Mission_Command& cmd) const
+{
+    if (_cache.cmds == nullptr) {
+        if (_cache.alloc_failed) {
+            return;
+        }
+        const uint16_t size = num_commands_max();
+        _cache.cmds = new Mission_Command[size];
+        _cache.loaded = new uint32_t[(size+31)/32];
+        if (_cache.cmds == nullptr || _cache.loaded == nullptr) {
+            delete[] _cache.cmds;
+            delete[] _cache.loaded;
+            _cache.cmds = nullptr;
+            _cache.loaded = nullptr;
+            _cache.alloc_failed = true;
+            return;
+        }
+        memset(_cache.loaded, 0, ((size+31)/32) * sizeof(uint32_t));
+        _cache.size = size;
+    }
+    if (index >= _cache.size) {
+        return;
+    }
+    _cache.cmds[index] = cmd;
+    _cache.loaded[index/32] |= 1U << (index%32);
+}
+
+void AP_Mission::cache_invalidate(uint16_t index)
+{
+    if (index < _cache.size) {
+        _cache.loaded[index/32] &= ~(1U << (index%32));
+    }
+    _cache.landing_valid = false;
+}
+
+/*
+  rebuild the landing index if the mission has changed. Returns false
+  if there is no index, in which case callers search every command
+ */
+bool AP_Mission::cache_update_landing_index() const
+{
+    const uint16_t total = num_commands();
+    if (_cache.landing_valid && _cache.landing_total == total) {
+        return true;
+    }
+
+    uint16_t count = 0;
+    for (uint16_t pass=0; pass<2; pass++) {
+        count = 0;
+        for (uint16_t i=1; i<total; i++) {
+            Mission_Command tmp;
+            if (!read_cmd_from_storage(i, tmp)) {
+                continue;
+            }
+            if (tmp.id == MAV_CMD_DO_LAND_START || tmp.id == MAV_CMD_DO_GO_AROUND) {
+                if (pass == 1) {
+                    _cache.landing[count] = i;
+                }
+                count++;
+            }
+        }
+        if (pass == 0) {
+            delete[] _cache.landing;
+            _cache.landing = nullptr;
+            if (count > 0) {
+                _cache.landing = new uint16_t[count];
+                if (_cache.landing == nullptr) {
+                    _cache.landing_valid = false;
+                    return false;
+                }
+            }
+        }
+    }
+
+    _cache.landing_count = count;
+    _cache.landing_total = total;
+    _cache.landing_valid = true;
+    return true;
+}
+#endif // AP_MISSION_CACHE_ENABLED
+
 // reset the mission history to prevent recalling previous mission histories after a mission restart.
 void AP_Mission::reset_wp_history(void)
 {
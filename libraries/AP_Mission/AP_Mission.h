@@ -44,6 +44,11 @@
 #define AP_MISSION_MAX_WP_HISTORY           7       // The maximum number of previous wp commands that will be stored from the active missions history
 #define LAST_WP_PASSED (AP_MISSION_MAX_WP_HISTORY-2)
 
+// keep a decoded copy of the mission in RAM on boards with plenty of it
+#ifndef AP_MISSION_CACHE_ENABLED
+#define AP_MISSION_CACHE_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX)
+#endif
+
 /// @class    AP_Mission
 /// @brief    Object managing Mission
 class AP_Mission
@@ -313,6 +318,9 @@ public:
         _flags.in_landing_sequence = false;
         _flags.resuming_mission = false;
         _force_resume = false;
+#if AP_MISSION_CACHE_ENABLED
+        memset(&_cache, 0, sizeof(_cache));
+#endif
     }
 
     // get singleton instance
@@ -642,6 +650,10 @@ private:
     // check if command is a landing type command.  Asside the obvious, MAV_CMD_DO_PARACHUTE is considered a type of landing
     bool is_landing_type_cmd(uint16_t id) const;
 
+    // return the index of the next command after index which may be a
+    // DO_LAND_START or DO_GO_AROUND, or num_commands() if there are none
+    uint16_t next_landing_cmd(uint16_t index) const;
+
     // approximate the distance travelled to get to a landing.  DO_JUMP commands are observed in look forward.
     bool distance_to_landing(uint16_t index, float &tot_distance,Location current_loc);
 
@@ -690,6 +702,29 @@ private:
     // const functions
     static HAL_Semaphore _rsem;
 
+#if AP_MISSION_CACHE_ENABLED
+    // decoded commands, filled as they are read from storage and
+    // invalidated as they are written. Mutable as it is filled from
+    // the const read_cmd_from_storage()
+    mutable struct {
+        Mission_Command *cmds;
+        uint32_t *loaded;           // bitmask of valid entries in cmds
+        uint16_t size;
+        bool alloc_failed;
+
+        // sorted indexes of the DO_LAND_START and DO_GO_AROUND commands
+        uint16_t *landing;
+        uint16_t landing_count;
+        uint16_t landing_total;     // _cmd_total when landing was built
+        bool landing_valid;
+    } _cache;
+
+    bool cache_read(uint16_t index, Mission_Command& cmd) const;
+    void cache_store(uint16_t index, const Mission_Command& cmd) const;
+    void cache_invalidate(uint16_t index);
+    bool cache_update_landing_index() const;
+#endif
+
     // mission items common to all vehicles:
     bool start_command_do_gripper(const AP_Mission::Mission_Command& cmd);
     bool start_command_do_servorelayevents(const AP_Mission::Mission_Command& cmd);
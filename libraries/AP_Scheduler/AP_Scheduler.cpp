@@ -26,6 +26,7 @@
 #include <AP_Logger/AP_Logger.h>
 #include <AP_InertialSensor/AP_InertialSensor.h>
 #include <AP_InternalError/AP_InternalError.h>
+#include <AP_HAL/utility/SemProfile.h>
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
 #include <SITL/SITL.h>
 #endif
@@ -60,10 +61,17 @@ const AP_Param::GroupInfo AP_Scheduler::var_info[] = {
     // @Param: OPTIONS
     // @DisplayName: Scheduling options
     // @Description: This controls optional aspects of the scheduler.
-    // @Bitmask: 0:Enable per-task perf info
+    // @Bitmask: 0:Enable per-task perf info,1:Run thread safe tasks on worker threads (Linux and SITL only),2:Profile semaphore contention (Linux and SITL only),3:Record a timeline trace of all threads, readable as @SYS/trace.json (Linux and SITL only)
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",  2, AP_Scheduler, _options, 0),
 
+    // @Param: POLICY
+    // @DisplayName: Scheduling policy
+    // @Description: This controls the order in which tasks that are due to run are given time each loop. TableOrder runs them in the order of the vehicle task table. EarliestDeadline runs the task closest to missing its deadline first, which stops tasks near the end of the table from being starved under load. RateMonotonic runs the highest rate tasks first. Both urgency based policies use the observed run time of a task rather than its declared maximum when deciding if it fits in the remaining loop time.
+    // @Values: 0:TableOrder,1:EarliestDeadline,2:RateMonotonic
+    // @User: Advanced
+    AP_GROUPINFO("POLICY",  3, AP_Scheduler, _policy, uint8_t(Policy::TABLE_ORDER)),
+
     AP_GROUPEND
 };
 
@@ -117,6 +125,23 @@ void AP_Scheduler::init(const AP_Scheduler::Task *tasks, uint8_t num_tasks, uint
     memset(_last_run, 0, sizeof(_last_run[0]) * _num_tasks);
     _tick_counter = 0;
 
+    // allocated unconditionally so the policy can be changed in flight
+    _task_state = new TaskState[_num_tasks];
+    _ready = new ReadyTask[_num_tasks];
+    if (_task_state != nullptr) {
+        memset(_task_state, 0, sizeof(_task_state[0]) * _num_tasks);
+    }
+
+#if AP_TRACE_ENABLED
+    _trace_ids = new uint16_t[_num_tasks + 1];
+    if (_trace_ids != nullptr) {
+        for (uint8_t i=0; i<_num_tasks; i++) {
+            _trace_ids[i] = AP_HAL::Trace::register_name(get_task(i).name);
+        }
+        _trace_ids[_num_tasks] = AP_HAL::Trace::register_name("fast_loop");
+    }
+#endif
+
     // setup initial performance counters
     perf_info.set_loop_rate(get_loop_rate_hz());
     perf_info.reset();
@@ -167,90 +192,282 @@ void AP_Scheduler::run(uint32_t time_available)
         }
     }
     
-    for (uint8_t i=0; i<_num_tasks; i++) {
-        const AP_Scheduler::Task& task = (i < _num_unshared_tasks) ? _tasks[i] : _common_tasks[i - _num_unshared_tasks];
+#if AP_SCHEDULER_WORKERS_ENABLED
+    collect_offloaded_tasks();
+#endif
 
-        uint32_t dt = _tick_counter - _last_run[i];
-        // we allow 0 to mean loop rate
-        uint32_t interval_ticks = (is_zero(task.rate_hz) ? 1 : _loop_rate_hz / task.rate_hz);
-        if (interval_ticks < 1) {
-            interval_ticks = 1;
+    if (_policy != uint8_t(Policy::TABLE_ORDER) && _task_state != nullptr && _ready != nullptr) {
+        run_by_urgency(time_available, now);
+    } else {
+        for (uint8_t i=0; i<_num_tasks; i++) {
+            const AP_Scheduler::Task& task = get_task(i);
+
+            const uint16_t dt = ticks_since(_tick_counter, _last_run[i]);
+            uint32_t interval_ticks = task_interval_ticks(task);
+            if (dt < interval_ticks) {
+                // this task is not yet scheduled to run again
+                continue;
+            }
+            if (!run_task(i, dt, interval_ticks, task.max_time_micros, time_available, now)) {
+                break;
+            }
         }
+    }
+
+    // update number of spare microseconds
+    _spare_micros += time_available;
+
+    _spare_ticks++;
+    if (_spare_ticks == 32) {
+        _spare_ticks /= 2;
+        _spare_micros /= 2;
+    }
+}
+
+/*
+  return the number of ticks between runs of a task
+ */
+uint32_t AP_Scheduler::task_interval_ticks(const Task &task) const
+{
+    // we allow 0 to mean loop rate
+    uint32_t interval_ticks = (is_zero(task.rate_hz) ? 1 : _loop_rate_hz / task.rate_hz);
+    if (interval_ticks < 1) {
+        interval_ticks = 1;
+    }
+    return interval_ticks;
+}
+
+/*
+  return the time we expect a task to need. Once a task has run we
+  use its observed run time plus a margin, capped at the table value
+ */
+uint16_t AP_Scheduler::task_budget_us(uint8_t i) const
+{
+    const uint16_t max_us = get_task(i).max_time_micros;
+    const uint16_t observed_us = _task_state[i].runtime_us;
+    if (observed_us == 0) {
+        return max_us;
+    }
+    return MIN(uint32_t(max_us), observed_us + observed_us/8U);
+}
+
+/*
+  run the due tasks in order of urgency rather than table order. A
+  task released on tick T must run before it is released again, so
+  its deadline is one interval after it became due
+ */
+void AP_Scheduler::run_by_urgency(uint32_t &time_available, uint32_t &now)
+{
+    const bool rate_monotonic = (_policy == uint8_t(Policy::RATE_MONOTONIC));
+
+    // collect the due tasks, keeping them sorted with an insertion
+    // sort as only a handful are due on any one tick. Ties keep table order
+    uint8_t num_ready = 0;
+    for (uint8_t i=0; i<_num_tasks; i++) {
+        const uint16_t dt = ticks_since(_tick_counter, _last_run[i]);
+        const uint32_t interval_ticks = task_interval_ticks(get_task(i));
         if (dt < interval_ticks) {
-            // this task is not yet scheduled to run again
             continue;
         }
-        // this task is due to run. Do we have enough time to run it?
-        _task_time_allowed = task.max_time_micros;
-
-        if (dt >= interval_ticks*2) {
-            perf_info.task_slipped(i);
+        const int32_t key = urgency_key(rate_monotonic, interval_ticks, dt);
+        uint8_t pos = num_ready;
+        while (pos > 0 && _ready[pos-1].key > key) {
+            _ready[pos] = _ready[pos-1];
+            pos--;
         }
+        _ready[pos].key = key;
+        _ready[pos].index = i;
+        num_ready++;
+    }
 
-        if (dt >= interval_ticks*max_task_slowdown) {
-            // we are going beyond the maximum slowdown factor for a
-            // task. This will trigger increasing the time budget
-            task_not_achieved++;
+    for (uint8_t r=0; r<num_ready; r++) {
+        const uint8_t i = _ready[r].index;
+        const uint16_t dt = ticks_since(_tick_counter, _last_run[i]);
+        const uint32_t interval_ticks = task_interval_ticks(get_task(i));
+        if (!run_task(i, dt, interval_ticks, task_budget_us(i), time_available, now)) {
+            break;
         }
+    }
+}
 
-        if (_task_time_allowed > time_available) {
-            // not enough time to run this task.  Continue loop -
-            // maybe another task will fit into time remaining
-            continue;
-        }
+/*
+  run a single due task if budget_us fits in the time available.
+  Returns false once the time available for this tick is used up
+ */
+bool AP_Scheduler::run_task(uint8_t i, uint16_t dt, uint32_t interval_ticks, uint16_t budget_us,
+                            uint32_t &time_available, uint32_t &now)
+{
+    const AP_Scheduler::Task& task = get_task(i);
 
-        // run it
-        _task_time_started = now;
-        hal.util->persistent_data.scheduler_task = i;
-        if (_debug > 1 && _perf_counters && _perf_counters[i]) {
-            hal.util->perf_begin(_perf_counters[i]);
-        }
+    // this task is due to run. Do we have enough time to run it?
+    _task_time_allowed = task.max_time_micros;
+
+    if (dt >= interval_ticks*2) {
+        perf_info.task_slipped(i);
+    }
+
+    if (dt >= interval_ticks*max_task_slowdown) {
+        // we are going beyond the maximum slowdown factor for a
+        // task. This will trigger increasing the time budget
+        task_not_achieved++;
+    }
+
+#if AP_SCHEDULER_WORKERS_ENABLED
+    if (_workers != nullptr && _workers->busy(i)) {
+        // still running on a worker from an earlier dispatch
+        return true;
+    }
+    if ((task.flags & TASK_FLAG_THREAD_SAFE) && offload_task(i)) {
+        // a worker runs it, costing the main loop no time
+        count_deadline_misses(i, dt, interval_ticks);
+        _last_run[i] = _tick_counter;
+        return true;
+    }
+#endif
+
+    if (budget_us > time_available) {
+        // not enough time to run this task.  Continue loop -
+        // maybe another task will fit into time remaining
+        return true;
+    }
+
+    // run it
+    _task_time_started = now;
+    hal.util->persistent_data.scheduler_task = i;
+    if (_debug > 1 && _perf_counters && _perf_counters[i]) {
+        hal.util->perf_begin(_perf_counters[i]);
+    }
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
-        fill_nanf_stack();
+    fill_nanf_stack();
 #endif
-        task.function();
-        if (_debug > 1 && _perf_counters && _perf_counters[i]) {
-            hal.util->perf_end(_perf_counters[i]);
-        }
-        hal.util->persistent_data.scheduler_task = -1;
+#if AP_TRACE_ENABLED
+    if (_trace_ids != nullptr) {
+        AP_HAL::Trace::begin(_trace_ids[i]);
+    }
+#endif
+    task.function();
+#if AP_TRACE_ENABLED
+    if (_trace_ids != nullptr) {
+        AP_HAL::Trace::end(_trace_ids[i]);
+    }
+#endif
+    if (_debug > 1 && _perf_counters && _perf_counters[i]) {
+        hal.util->perf_end(_perf_counters[i]);
+    }
+    hal.util->persistent_data.scheduler_task = -1;
 
-        // record the tick counter when we ran. This drives
-        // when we next run the event
-        _last_run[i] = _tick_counter;
+    // record the tick counter when we ran. This drives
+    // when we next run the event
+    _last_run[i] = _tick_counter;
 
-        // work out how long the event actually took
-        now = AP_HAL::micros();
-        uint32_t time_taken = now - _task_time_started;
-        bool overrun = false;
-        if (time_taken > _task_time_allowed) {
-            overrun = true;
-            // the event overran!
-            debug(3, "Scheduler overrun task[%u-%s] (%u/%u)\n",
-                  (unsigned)i,
-                  task.name,
-                  (unsigned)time_taken,
-                  (unsigned)_task_time_allowed);
-        }
+    // work out how long the event actually took
+    now = AP_HAL::micros();
+    uint32_t time_taken = now - _task_time_started;
 
-        perf_info.update_task_info(i, time_taken, overrun);
+    count_deadline_misses(i, dt, interval_ticks);
+    record_task_time(i, time_taken);
 
-        if (time_taken >= time_available) {
-            time_available = 0;
-            break;
+    if (time_taken >= time_available) {
+        time_available = 0;
+        return false;
+    }
+    time_available -= time_taken;
+    return true;
+}
+
+/*
+  count the deadlines a task missed before it was started
+ */
+void AP_Scheduler::count_deadline_misses(uint8_t i, uint16_t dt, uint32_t interval_ticks)
+{
+    // every whole interval past the first is a missed deadline
+    const uint32_t missed = deadlines_missed(dt, interval_ticks);
+    if (_task_state == nullptr || missed == 0) {
+        return;
+    }
+    TaskState &ts = _task_state[i];
+    ts.deadline_misses = MIN(uint32_t(UINT16_MAX), ts.deadline_misses + missed);
+    debug(2, "Scheduler deadline miss task[%u-%s] (%u ticks)\n",
+          (unsigned)i,
+          get_task(i).name,
+          (unsigned)dt);
+}
+
+/*
+  update the statistics for a task that has finished running
+ */
+void AP_Scheduler::record_task_time(uint8_t i, uint32_t time_taken)
+{
+    const uint16_t time_allowed = get_task(i).max_time_micros;
+    bool overrun = false;
+    if (time_taken > time_allowed) {
+        overrun = true;
+        // the event overran!
+        debug(3, "Scheduler overrun task[%u-%s] (%u/%u)\n",
+              (unsigned)i,
+              get_task(i).name,
+              (unsigned)time_taken,
+              (unsigned)time_allowed);
+    }
+
+    if (_task_state != nullptr) {
+        // track a peak that decays slowly towards the recent run times
+        TaskState &ts = _task_state[i];
+        const uint16_t taken_us = MIN(time_taken, uint32_t(UINT16_MAX));
+        if (taken_us >= ts.runtime_us) {
+            ts.runtime_us = taken_us;
+        } else {
+            ts.runtime_us -= (ts.runtime_us - taken_us) / 16U;
         }
-        time_available -= time_taken;
     }
 
-    // update number of spare microseconds
-    _spare_micros += time_available;
+    perf_info.update_task_info(i, time_taken, overrun);
+}
 
-    _spare_ticks++;
-    if (_spare_ticks == 32) {
-        _spare_ticks /= 2;
-        _spare_micros /= 2;
+#if AP_SCHEDULER_WORKERS_ENABLED
+/*
+  hand a thread safe task to the worker threads, starting them on
+  first use. Returns false if the task should run on the main thread
+ */
+bool AP_Scheduler::offload_task(uint8_t i)
+{
+    if (!(_options & uint8_t(Options::WORKER_THREADS))) {
+        return false;
+    }
+    if (_workers == nullptr) {
+        if (_workers_failed) {
+            return false;
+        }
+        _workers = new AP::TaskWorkers();
+        if (_workers == nullptr || !_workers->init(_num_tasks)) {
+            // init only fails if no thread was started, so nothing
+            // else can be referencing the pool
+            delete _workers;
+            _workers = nullptr;
+            _workers_failed = true;
+            hal.console->printf("Scheduler: worker threads unavailable\n");
+            return false;
+        }
     }
+    return _workers->dispatch(i, get_task(i).function);
 }
 
+/*
+  pick up the statistics of tasks the workers have finished
+ */
+void AP_Scheduler::collect_offloaded_tasks(void)
+{
+    if (_workers == nullptr) {
+        return;
+    }
+    uint8_t i;
+    uint32_t time_taken;
+    while (_workers->collect(i, time_taken)) {
+        record_task_time(i, time_taken);
+    }
+}
+#endif // AP_SCHEDULER_WORKERS_ENABLED
+
 /*
   return number of micros until the current task reaches its deadline
  */
@@ -281,7 +498,10 @@ void AP_Scheduler::loop()
     // wait for an INS sample
     hal.util->persistent_data.scheduler_task = -3;
     _rsem.give();
-    AP::ins().wait_for_sample();
+    {
+        AP_TRACE_SCOPE("wait_for_sample");
+        AP::ins().wait_for_sample();
+    }
     _rsem.take_blocking();
     hal.util->persistent_data.scheduler_task = -1;
 
@@ -298,7 +518,17 @@ void AP_Scheduler::loop()
     // ---------------------
     if (_fastloop_fn) {
         hal.util->persistent_data.scheduler_task = -2;
+#if AP_TRACE_ENABLED
+        if (_trace_ids != nullptr) {
+            AP_HAL::Trace::begin(_trace_ids[_num_tasks]);
+        }
+#endif
         _fastloop_fn();
+#if AP_TRACE_ENABLED
+        if (_trace_ids != nullptr) {
+            AP_HAL::Trace::end(_trace_ids[_num_tasks]);
+        }
+#endif
         hal.util->persistent_data.scheduler_task = -1;
     }
 
@@ -371,10 +601,22 @@ void AP_Scheduler::update_logging()
     if (debug_flags()) {
         perf_info.update_logging();
     }
+#if AP_TRACE_ENABLED
+    AP_HAL::Trace::set_enabled((_options & uint8_t(Options::TRACE)) != 0);
+#endif
     if (_log_performance_bit != (uint32_t)-1 &&
         AP::logger().should_log(_log_performance_bit)) {
         Log_Write_Performance();
     }
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    const bool sem_profile = (_options & uint8_t(Options::SEMAPHORE_PROFILE)) != 0;
+    AP_HAL::SemProfile::set_enabled(sem_profile);
+    if (sem_profile &&
+        _log_performance_bit != (uint32_t)-1 &&
+        AP::logger().should_log(_log_performance_bit)) {
+        Log_Write_Semaphores();
+    }
+#endif
     perf_info.set_loop_rate(get_loop_rate_hz());
     perf_info.reset();
     // dynamically update the per-task perf counter
@@ -407,13 +649,67 @@ void AP_Scheduler::Log_Write_Performance()
     AP::logger().WriteCriticalBlock(&pkt, sizeof(pkt));
 }
 
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+// Write a contention packet for each semaphore that has had to wait
+void AP_Scheduler::Log_Write_Semaphores()
+{
+    using namespace AP_HAL::SemProfile;
+    const uint64_t now = AP_HAL::micros64();
+    for (uint8_t i = 0; i < num_stats(); i++) {
+        const Stats *s = get_stats(i);
+        if (s == nullptr || s->contended_count == 0) {
+            continue;
+        }
+        struct log_Semaphore pkt = {
+            LOG_PACKET_HEADER_INIT(LOG_SEMAPHORE_MSG),
+            time_us         : now,
+            site            : {},
+            acquire_count   : s->acquire_count,
+            contended_count : s->contended_count,
+            slow_count      : s->wait_hist[WAIT_LT_10MS] + s->wait_hist[WAIT_GE_10MS],
+            wait_max        : s->wait_max_us,
+            hold_max        : s->hold_max_us,
+            holder          : {},
+        };
+        char site[32];
+        if (s->name.file != nullptr) {
+            format_site(s->name, site, sizeof(site));
+        } else {
+            hal.util->snprintf(site, sizeof(site), "%p", s->sem);
+        }
+        strncpy_noterm(pkt.site, site, sizeof(pkt.site));
+        format_site(s->hold_max_site, site, sizeof(site));
+        strncpy_noterm(pkt.holder, site, sizeof(pkt.holder));
+        AP::logger().WriteBlock(&pkt, sizeof(pkt));
+    }
+}
+#endif
+
+// display semaphore statistics as text buffer for @SYS/semaphores.txt
+size_t AP_Scheduler::semaphore_info(char *buf, size_t bufsize)
+{
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    // dynamically enable statistics collection
+    if (!(_options & uint8_t(Options::SEMAPHORE_PROFILE))) {
+        _options |= uint8_t(Options::SEMAPHORE_PROFILE);
+        AP_HAL::SemProfile::set_enabled(true);
+    }
+    return AP_HAL::SemProfile::report(buf, bufsize);
+#else
+    return 0;
+#endif
+}
+
 // display task statistics as text buffer for @SYS/tasks.txt
 size_t AP_Scheduler::task_info(char *buf, size_t bufsize)
 {
     size_t total = 0;
 
+    // the urgency based policies add a deadline miss column
+    const bool show_deadlines = (_policy != uint8_t(Policy::TABLE_ORDER));
+
     // a header to allow for machine parsers to determine format
-    int n = hal.util->snprintf(buf, bufsize, "TasksV1\n");
+    int n = hal.util->snprintf(buf, bufsize, show_deadlines ? "TasksV2\n" : "TasksV1\n");
 
     if (n <= 0) {
         return 0;
@@ -454,13 +750,17 @@ size_t AP_Scheduler::task_info(char *buf, size_t bufsize)
         }
 
 #if HAL_MINIMIZE_FEATURES
-        const char* fmt = "%-16.16s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
+        const char* fmt = show_deadlines ? "%-16.16s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%% DLM=%3u\n"
+                                         : "%-16.16s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
 #else
-        const char* fmt = "%-32.32s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
+        const char* fmt = show_deadlines ? "%-32.32s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%% DLM=%3u\n"
+                                         : "%-32.32s MIN=%3u MAX=%3u AVG=%3u OVR=%3u SLP=%3u, TOT=%4.1f%%\n";
 #endif
+        // the fast loop has no deadline of its own, get_deadline_misses() returns 0 for it
         n = hal.util->snprintf(buf, bufsize, fmt, task_name,
             unsigned(MIN(ti->min_time_us, 999)), unsigned(MIN(ti->max_time_us, 999)), unsigned(avg),
-            unsigned(MIN(ti->overrun_count, 999)), unsigned(MIN(ti->slip_count, 999)), pct);
+            unsigned(MIN(ti->overrun_count, 999)), unsigned(MIN(ti->slip_count, 999)), pct,
+            unsigned(MIN(get_deadline_misses(i), 999)));
 
         if (n <= 0) {
             break;
@@ -25,6 +25,8 @@
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 #include "PerfInfo.h"       // loop perf monitoring
+#include "TaskWorkers.h"    // worker threads for thread safe tasks
+#include <AP_HAL/utility/Trace.h>
 
 #if HAL_MINIMIZE_FEATURES
 #define AP_SCHEDULER_NAME_INITIALIZER(_clazz,_name) .name = #_name,
@@ -36,12 +38,22 @@
 /*
   useful macro for creating scheduler task table
  */
-#define SCHED_TASK_CLASS(classname, classptr, func, _rate_hz, _max_time_micros) { \
+#define SCHED_TASK_CLASS_FLAGS(classname, classptr, func, _rate_hz, _max_time_micros, _flags) { \
     .function = FUNCTOR_BIND(classptr, &classname::func, void),\
     AP_SCHEDULER_NAME_INITIALIZER(classname, func)\
     .rate_hz = _rate_hz,\
-    .max_time_micros = _max_time_micros\
+    .max_time_micros = _max_time_micros,\
+    .flags = _flags\
 }
+#define SCHED_TASK_CLASS(classname, classptr, func, _rate_hz, _max_time_micros) \
+    SCHED_TASK_CLASS_FLAGS(classname, classptr, func, _rate_hz, _max_time_micros, 0)
+
+/*
+  a task that does not touch flight critical state and may run on a
+  worker thread, concurrently with the main loop
+ */
+#define SCHED_TASK_CLASS_THREAD_SAFE(classname, classptr, func, _rate_hz, _max_time_micros) \
+    SCHED_TASK_CLASS_FLAGS(classname, classptr, func, _rate_hz, _max_time_micros, AP_Scheduler::TASK_FLAG_THREAD_SAFE)
 
 /*
   A task scheduler for APM main loops
@@ -77,10 +89,25 @@ public:
         const char *name;
         float rate_hz;
         uint16_t max_time_micros;
+        uint8_t flags;
+    };
+
+    enum TaskFlags : uint8_t {
+        TASK_FLAG_THREAD_SAFE = 1U << 0, // may be run on a worker thread
     };
 
     enum class Options : uint8_t {
-        RECORD_TASK_INFO = 1 << 0
+        RECORD_TASK_INFO = 1 << 0,
+        WORKER_THREADS   = 1 << 1,
+        SEMAPHORE_PROFILE = 1 << 2,
+        TRACE            = 1 << 3,
+    };
+
+    // order in which due tasks are offered time each loop
+    enum class Policy : uint8_t {
+        TABLE_ORDER       = 0, // task table order
+        EARLIEST_DEADLINE = 1, // closest deadline first
+        RATE_MONOTONIC    = 2, // highest rate first
     };
 
     // initialise scheduler
@@ -102,6 +129,25 @@ public:
     // return current tick counter
     uint16_t ticks() const { return _tick_counter; }
 
+    // ticks from last_tick to now_tick, allowing for the tick counter
+    // wrapping
+    static uint16_t ticks_since(uint16_t now_tick, uint16_t last_tick) {
+        return uint16_t(now_tick - last_tick);
+    }
+
+    // sort key for a task that has been due for dt ticks: the
+    // interval for rate monotonic, otherwise the ticks until its
+    // deadline, negative once it has been missed
+    static int32_t urgency_key(bool rate_monotonic, uint32_t interval_ticks, uint16_t dt) {
+        return rate_monotonic ? int32_t(interval_ticks) : int32_t(2*interval_ticks) - int32_t(dt);
+    }
+
+    // deadlines missed by a task that started dt ticks after its
+    // last run
+    static uint32_t deadlines_missed(uint16_t dt, uint32_t interval_ticks) {
+        return dt < interval_ticks*2 ? 0 : dt / interval_ticks - 1;
+    }
+
     // run the tasks. Call this once per 'tick'.
     // time_available is the amount of time available to run
     // tasks in microseconds
@@ -158,12 +204,50 @@ public:
 
     size_t task_info(char *buf, size_t bufsize);
 
+    // semaphore contention report for @SYS/semaphores.txt
+    size_t semaphore_info(char *buf, size_t bufsize);
+
+    // return the number of times a task has run after its deadline since boot
+    uint16_t get_deadline_misses(uint8_t task_index) const {
+        return (_task_state != nullptr && task_index < _num_tasks) ? _task_state[task_index].deadline_misses : 0;
+    }
+
     static const struct AP_Param::GroupInfo var_info[];
 
     // loop performance monitoring:
     AP::PerfInfo perf_info;
 
 private:
+    // per-task state used to order tasks by urgency
+    struct TaskState {
+        uint16_t runtime_us;      // decaying peak of the observed run time
+        uint16_t deadline_misses; // number of deadlines missed since boot
+    };
+
+    // a task that is due to run, with its sort key
+    struct ReadyTask {
+        int32_t key;
+        uint8_t index;
+    };
+
+    const Task &get_task(uint8_t i) const {
+        return (i < _num_unshared_tasks) ? _tasks[i] : _common_tasks[i - _num_unshared_tasks];
+    }
+    uint32_t task_interval_ticks(const Task &task) const;
+    uint16_t task_budget_us(uint8_t i) const;
+    void run_by_urgency(uint32_t &time_available, uint32_t &now);
+    bool run_task(uint8_t i, uint16_t dt, uint32_t interval_ticks, uint16_t budget_us,
+                  uint32_t &time_available, uint32_t &now);
+    void count_deadline_misses(uint8_t i, uint16_t dt, uint32_t interval_ticks);
+#if HAL_SEMAPHORE_PROFILE_ENABLED
+    void Log_Write_Semaphores();
+#endif
+    void record_task_time(uint8_t i, uint32_t time_taken);
+#if AP_SCHEDULER_WORKERS_ENABLED
+    bool offload_task(uint8_t i);
+    void collect_offloaded_tasks(void);
+#endif
+
     // function that is called before anything in the scheduler table:
     scheduler_fastloop_fn_t _fastloop_fn;
 
@@ -178,6 +262,9 @@ private:
 
     // scheduler options
     AP_Int8 _options;
+
+    // task ordering policy, from the Policy enum
+    AP_Int8 _policy;
     
     // calculated loop period in usec
     uint16_t _loop_period_us;
@@ -204,6 +291,23 @@ private:
     // tick counter at the time we last ran each task
     uint16_t *_last_run;
 
+    // run time and deadline statistics for each task
+    TaskState *_task_state;
+
+    // scratch list of due tasks, sorted by urgency
+    ReadyTask *_ready;
+
+#if AP_TRACE_ENABLED
+    // trace name ids of each task, with the fast loop last
+    uint16_t *_trace_ids;
+#endif
+
+#if AP_SCHEDULER_WORKERS_ENABLED
+    // worker threads for thread safe tasks, created on first use
+    AP::TaskWorkers *_workers;
+    bool _workers_failed;
+#endif
+
     // number of microseconds allowed for the current task
     uint32_t _task_time_allowed;
 
@@ -0,0 +1,141 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "TaskWorkers.h"
+
+#if AP_SCHEDULER_WORKERS_ENABLED
+
+extern const AP_HAL::HAL& hal;
+
+/*
+  allocate the per-task state and start the worker threads
+ */
+bool AP::TaskWorkers::init(uint8_t num_tasks)
+{
+    _slots = new Slot[num_tasks];
+    _pending.index = new uint8_t[num_tasks];
+    _done.index = new uint8_t[num_tasks];
+    if (_slots == nullptr || _pending.index == nullptr || _done.index == nullptr) {
+        return false;
+    }
+    for (uint8_t i=0; i<num_tasks; i++) {
+        _slots[i].state = State::IDLE;
+    }
+    _num_tasks = num_tasks;
+
+    uint8_t started = 0;
+    for (uint8_t i=0; i<AP_SCHEDULER_NUM_WORKERS; i++) {
+        if (hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AP::TaskWorkers::worker_thread, void),
+                                         "sched_worker", 8192, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+            started++;
+        }
+    }
+    return started > 0;
+}
+
+bool AP::TaskWorkers::ring_pop(Ring &ring, uint8_t &task_index)
+{
+    if (ring.count == 0) {
+        return false;
+    }
+    task_index = ring.index[ring.head];
+    ring.head = (ring.head + 1) % _num_tasks;
+    ring.count--;
+    return true;
+}
+
+void AP::TaskWorkers::ring_push(Ring &ring, uint8_t task_index)
+{
+    ring.index[(ring.head + ring.count) % _num_tasks] = task_index;
+    ring.count++;
+}
+
+/*
+  queue a task for the workers. Called from the main thread
+ */
+bool AP::TaskWorkers::dispatch(uint8_t task_index, task_fn_t function)
+{
+    if (task_index >= _num_tasks) {
+        return false;
+    }
+    pthread_mutex_lock(&_mutex);
+    Slot &slot = _slots[task_index];
+    if (slot.state != State::IDLE) {
+        pthread_mutex_unlock(&_mutex);
+        return false;
+    }
+    slot.function = function;
+    slot.state = State::QUEUED;
+    ring_push(_pending, task_index);
+    pthread_cond_signal(&_cond);
+    pthread_mutex_unlock(&_mutex);
+    return true;
+}
+
+bool AP::TaskWorkers::busy(uint8_t task_index)
+{
+    if (task_index >= _num_tasks) {
+        return false;
+    }
+    pthread_mutex_lock(&_mutex);
+    const bool ret = _slots[task_index].state != State::IDLE;
+    pthread_mutex_unlock(&_mutex);
+    return ret;
+}
+
+/*
+  collect a finished task so its statistics can be updated on the
+  main thread. A task becomes available for dispatch again once it
+  has been collected
+ */
+bool AP::TaskWorkers::collect(uint8_t &task_index, uint32_t &time_taken_us)
+{
+    pthread_mutex_lock(&_mutex);
+    const bool ret = ring_pop(_done, task_index);
+    if (ret) {
+        Slot &slot = _slots[task_index];
+        time_taken_us = slot.time_taken_us;
+        slot.state = State::IDLE;
+    }
+    pthread_mutex_unlock(&_mutex);
+    return ret;
+}
+
+void AP::TaskWorkers::worker_thread(void)
+{
+    while (true) {
+        pthread_mutex_lock(&_mutex);
+        uint8_t task_index;
+        while (!ring_pop(_pending, task_index)) {
+            pthread_cond_wait(&_cond, &_mutex);
+        }
+        Slot &slot = _slots[task_index];
+        slot.state = State::RUNNING;
+        task_fn_t function = slot.function;
+        pthread_mutex_unlock(&_mutex);
+
+        const uint32_t start_us = AP_HAL::micros();
+        function();
+        const uint32_t time_taken_us = AP_HAL::micros() - start_us;
+
+        pthread_mutex_lock(&_mutex);
+        slot.time_taken_us = time_taken_us;
+        slot.state = State::DONE;
+        ring_push(_done, task_index);
+        pthread_mutex_unlock(&_mutex);
+    }
+}
+
+#endif // AP_SCHEDULER_WORKERS_ENABLED
@@ -0,0 +1,98 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  pool of worker threads used to run scheduler tasks that have been
+  marked as thread safe, taking them off the main loop
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+#ifndef AP_SCHEDULER_WORKERS_ENABLED
+#define AP_SCHEDULER_WORKERS_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
+
+#ifndef AP_SCHEDULER_NUM_WORKERS
+#define AP_SCHEDULER_NUM_WORKERS 2
+#endif
+
+#if AP_SCHEDULER_WORKERS_ENABLED
+
+#include <pthread.h>
+
+namespace AP {
+
+class TaskWorkers {
+public:
+    FUNCTOR_TYPEDEF(task_fn_t, void);
+
+    TaskWorkers() {}
+
+    /* Do not allow copies */
+    TaskWorkers(const TaskWorkers &other) = delete;
+    TaskWorkers &operator=(const TaskWorkers&) = delete;
+
+    // allocate per-task state and start the worker threads
+    bool init(uint8_t num_tasks);
+
+    // queue a task to be run by a worker. Returns false if the task is
+    // still queued or running from an earlier dispatch
+    bool dispatch(uint8_t task_index, task_fn_t function);
+
+    // true if the task has been dispatched and has not yet been collected
+    bool busy(uint8_t task_index);
+
+    // collect one finished task, returns false when there are no more
+    bool collect(uint8_t &task_index, uint32_t &time_taken_us);
+
+private:
+    enum class State : uint8_t {
+        IDLE,
+        QUEUED,
+        RUNNING,
+        DONE,
+    };
+
+    struct Slot {
+        task_fn_t function;
+        uint32_t time_taken_us;
+        State state;
+    };
+
+    void worker_thread(void);
+
+    // ring of task indexes, each task can only be in a ring once so
+    // a ring the size of the task list can never overflow
+    struct Ring {
+        uint8_t *index;
+        uint8_t head;
+        uint8_t count;
+    };
+    bool ring_pop(Ring &ring, uint8_t &task_index);
+    void ring_push(Ring &ring, uint8_t task_index);
+
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t _cond = PTHREAD_COND_INITIALIZER;
+
+    uint8_t _num_tasks;
+    Slot *_slots;
+    Ring _pending;
+    Ring _done;
+};
+
+};
+
+#endif // AP_SCHEDULER_WORKERS_ENABLED
@@ -0,0 +1,43 @@
+#include <AP_gtest.h>
+
+#include <AP_Scheduler/AP_Scheduler.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+TEST(AP_Scheduler, ticks_since)
+{
+    EXPECT_EQ(AP_Scheduler::ticks_since(100, 90), 10U);
+    EXPECT_EQ(AP_Scheduler::ticks_since(90, 90), 0U);
+
+    // the 16 bit tick counter wraps
+    EXPECT_EQ(AP_Scheduler::ticks_since(3, 65533), 6U);
+    EXPECT_EQ(AP_Scheduler::ticks_since(0, 65535), 1U);
+}
+
+TEST(AP_Scheduler, deadlines_across_wrap)
+{
+    // a 50Hz task on a 400Hz loop, last run just before the wrap
+    const uint32_t interval = 8;
+    uint16_t last_run = 65530;
+
+    // on time: due 8 ticks later, after the wrap
+    uint16_t dt = AP_Scheduler::ticks_since(uint16_t(last_run + 8), last_run);
+    EXPECT_EQ(dt, 8U);
+    EXPECT_EQ(AP_Scheduler::deadlines_missed(dt, interval), 0U);
+    EXPECT_EQ(AP_Scheduler::urgency_key(false, interval, dt), 8);
+
+    // late by one interval
+    dt = AP_Scheduler::ticks_since(uint16_t(last_run + 16), last_run);
+    EXPECT_EQ(AP_Scheduler::deadlines_missed(dt, interval), 1U);
+    EXPECT_EQ(AP_Scheduler::urgency_key(false, interval, dt), 0);
+
+    // a task due across the wrap sorts ahead of one with more slack
+    last_run = 65534;
+    dt = AP_Scheduler::ticks_since(uint16_t(last_run + 20), last_run);
+    const int32_t late_key = AP_Scheduler::urgency_key(false, interval, dt);
+    const int32_t fresh_key = AP_Scheduler::urgency_key(false, 4, 4);
+    EXPECT_LT(late_key, fresh_key);
+    EXPECT_EQ(AP_Scheduler::deadlines_missed(dt, interval), 1U);
+}
+
+AP_GTEST_MAIN()
@@ -101,6 +101,22 @@ const AP_Param::GroupInfo AP_Scripting::var_info[] = {
     // @User: Standard
     AP_GROUPINFO("USER4", 8, AP_Scripting, _user[3], 0.0),
 
+    // @Param: DEBUG_OPTS
+    // @DisplayName: Scripting Debug Options
+    // @Description: Debugging options for scripting. Logging the statistics records the run time, garbage collection time and memory use of every script run in the SCR log message.
+    // @Bitmask: 0:Log runtime and memory statistics
+    // @User: Advanced
+    AP_GROUPINFO("DEBUG_OPTS", 9, AP_Scripting, _debug_options, 0),
+
+    // @Param: POOL_PCT
+    // @DisplayName: Scripting Small Object Pool Size
+    // @Description: Percentage of the scripting heap set aside for pools of small Lua objects, which keeps tables, closures and userdata from fragmenting the rest of the heap. The pools are reserved when scripting starts and are not available for larger allocations. 0 disables the pools.
+    // @Units: %
+    // @Range: 0 50
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("POOL_PCT", 10, AP_Scripting, _pool_percent, SCRIPTING_POOL_PERCENT),
+
     AP_GROUPEND
 };
 
@@ -186,7 +202,7 @@ void AP_Scripting::repl_stop(void) {
 }
 
 void AP_Scripting::thread(void) {
-    lua_scripts *lua = new lua_scripts(_script_vm_exec_count, _script_heap_size, _debug_level, terminal);
+    lua_scripts *lua = new lua_scripts(_script_vm_exec_count, _script_heap_size, _pool_percent, _debug_level, _debug_options, terminal);
     if (lua == nullptr || !lua->heap_allocated()) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Unable to allocate scripting memory");
         delete lua;
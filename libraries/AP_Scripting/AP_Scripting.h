@@ -44,6 +44,10 @@ public:
    // User parameters for inputs into scripts 
    AP_Float _user[4]; 
 
+    enum class DebugOption : uint16_t {
+        LOG_STATS = (1U<<0),
+    };
+
     struct terminal_s {
         int output_fd;
         off_t input_offset;
@@ -62,7 +66,9 @@ private:
     AP_Int8 _enable;
     AP_Int32 _script_vm_exec_count;
     AP_Int32 _script_heap_size;
+    AP_Int8 _pool_percent;
     AP_Int8 _debug_level;
+    AP_Int16 _debug_options;
 
     bool _init_failed;  // true if memory allocation failed
 
@@ -27,6 +27,7 @@ char keyword_write[]               = "write";
 char keyword_attr_enum[]    = "'enum";
 char keyword_attr_literal[] = "'literal";
 char keyword_attr_null[]    = "'Null";
+char keyword_attr_reuse[]   = "'Reuse";
 
 // type keywords
 char keyword_boolean[]  = "boolean";
@@ -139,6 +140,7 @@ struct range_check {
 enum type_flags {
   TYPE_FLAGS_NULLABLE = (1U << 1),
   TYPE_FLAGS_ENUM     = (1U << 2),
+  TYPE_FLAGS_REUSE    = (1U << 3), // output may be written into a caller supplied object
 };
 
 struct type {
@@ -485,6 +487,8 @@ int parse_type(struct type *type, const uint32_t restrictions, enum range_check_
         error(ERROR_USERDATA, "%s is not nullable in this context", data_type);
       }
       type->flags |= TYPE_FLAGS_NULLABLE;
+    } else if (strcmp(attribute, keyword_attr_reuse) == 0) {
+      type->flags |= TYPE_FLAGS_REUSE;
     } else {
       error(ERROR_USERDATA, "Unknown attribute: %s", attribute);
     }
@@ -556,8 +560,31 @@ int parse_type(struct type *type, const uint32_t restrictions, enum range_check_
     }
   }
 
+  // only boxed outputs can be written into an object the script already holds
+  if (type->flags & TYPE_FLAGS_REUSE) {
+    switch (type->type) {
+      case TYPE_UINT32_T:
+      case TYPE_USERDATA:
+        break;
+      case TYPE_FLOAT:
+      case TYPE_INT8_T:
+      case TYPE_INT16_T:
+      case TYPE_INT32_T:
+      case TYPE_UINT8_T:
+      case TYPE_UINT16_T:
+      case TYPE_BOOLEAN:
+      case TYPE_STRING:
+      case TYPE_ENUM:
+      case TYPE_AP_OBJECT:
+      case TYPE_LITERAL:
+      case TYPE_NONE:
+        error(ERROR_USERDATA, "%s types cannot be reused", data_type);
+        break;
+    }
+  }
+
   // add range checks, unless disabled or a nullable type
-  if (range_type != RANGE_CHECK_NONE && !(type->flags & TYPE_FLAGS_NULLABLE)) {
+  if (range_type != RANGE_CHECK_NONE && !(type->flags & (TYPE_FLAGS_NULLABLE | TYPE_FLAGS_REUSE))) {
     switch (type->type) {
       case TYPE_FLOAT:
       case TYPE_INT8_T:
@@ -648,6 +675,9 @@ void handle_method(char *parent_name, struct method **methods) {
   method->line = state.line_num;
 
   parse_type(&(method->return_type), TYPE_RESTRICTION_NONE, RANGE_CHECK_NONE);
+  if (method->return_type.flags & TYPE_FLAGS_REUSE) {
+    method->flags |= TYPE_FLAGS_REUSE;
+  }
 
   // iterate the arguments
   struct type arg_type = {};
@@ -655,6 +685,12 @@ void handle_method(char *parent_name, struct method **methods) {
     if (arg_type.type == TYPE_NONE) {
       error(ERROR_USERDATA, "Can't pass an empty argument to a method");
     }
+    if (arg_type.flags & TYPE_FLAGS_REUSE) {
+      // a reusable argument is an output, which is the same as a nullable argument
+      // that may optionally be handed an existing object to fill
+      arg_type.flags |= TYPE_FLAGS_NULLABLE;
+      method->flags |= TYPE_FLAGS_REUSE;
+    }
     if ((method->return_type.type != TYPE_BOOLEAN) && (arg_type.flags & TYPE_FLAGS_NULLABLE)) {
       error(ERROR_USERDATA, "Nullable arguments are only available on a boolean method");
     }
@@ -1310,6 +1346,67 @@ void emit_userdata_fields() {
   }
 }
 
+// fetches the optional object a script passed in to receive a reusable output
+void emit_reuse_slot(const struct type *t, const int lua_index) {
+  switch (t->type) {
+    case TYPE_USERDATA:
+      fprintf(source, "    %s * reuse_%d = lua_isnoneornil(L, %d) ? nullptr : check_%s(L, %d);\n",
+              t->data.ud.name, lua_index, lua_index, t->data.ud.sanatized_name, lua_index);
+      break;
+    case TYPE_UINT32_T:
+      fprintf(source, "    uint32_t * reuse_%d = lua_isnoneornil(L, %d) ? nullptr : static_cast<uint32_t *>(luaL_checkudata(L, %d, \"uint32_t\"));\n",
+              lua_index, lua_index, lua_index);
+      break;
+    case TYPE_BOOLEAN:
+    case TYPE_FLOAT:
+    case TYPE_INT8_T:
+    case TYPE_INT16_T:
+    case TYPE_INT32_T:
+    case TYPE_UINT8_T:
+    case TYPE_UINT16_T:
+    case TYPE_STRING:
+    case TYPE_ENUM:
+    case TYPE_LITERAL:
+    case TYPE_AP_OBJECT:
+    case TYPE_NONE:
+      error(ERROR_INTERNAL, "Attempted to reuse an unboxed type");
+      break;
+  }
+}
+
+// pushes a reusable output, filling the caller supplied object if there was one, otherwise allocating a new one
+void emit_reuse_output(const struct type *t, const int lua_index, const char *data_name, const char *indentation) {
+  fprintf(source, "%sif (reuse_%d != nullptr) {\n", indentation, lua_index);
+  fprintf(source, "%s    *reuse_%d = %s;\n", indentation, lua_index, data_name);
+  fprintf(source, "%s    lua_pushvalue(L, %d);\n", indentation, lua_index);
+  fprintf(source, "%s} else {\n", indentation);
+  switch (t->type) {
+    case TYPE_USERDATA:
+      fprintf(source, "%s    new_%s(L);\n", indentation, t->data.ud.sanatized_name);
+      fprintf(source, "%s    *check_%s(L, -1) = %s;\n", indentation, t->data.ud.sanatized_name, data_name);
+      break;
+    case TYPE_UINT32_T:
+      fprintf(source, "%s    new_uint32_t(L);\n", indentation);
+      fprintf(source, "%s    *static_cast<uint32_t *>(luaL_checkudata(L, -1, \"uint32_t\")) = %s;\n", indentation, data_name);
+      break;
+    case TYPE_BOOLEAN:
+    case TYPE_FLOAT:
+    case TYPE_INT8_T:
+    case TYPE_INT16_T:
+    case TYPE_INT32_T:
+    case TYPE_UINT8_T:
+    case TYPE_UINT16_T:
+    case TYPE_STRING:
+    case TYPE_ENUM:
+    case TYPE_LITERAL:
+    case TYPE_AP_OBJECT:
+    case TYPE_NONE:
+      error(ERROR_INTERNAL, "Attempted to reuse an unboxed type");
+      break;
+  }
+  fprintf(source, "%s}\n", indentation);
+}
+
 void emit_userdata_method(const struct userdata *data, const struct method *method) {
   int arg_count = 1;
 
@@ -1335,7 +1432,33 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
     }
     arg = arg->next;
   }
-  fprintf(source, "    binding_argcheck(L, %d);\n", arg_count);
+
+  // reusable outputs are optional trailing arguments, the return value comes first followed by any output arguments
+  int reuse_count = 0;
+  if (method->flags & TYPE_FLAGS_REUSE) {
+    if (method->return_type.flags & TYPE_FLAGS_REUSE) {
+      reuse_count++;
+    }
+    arg = method->arguments;
+    while (arg != NULL) {
+      if (arg->type.flags & TYPE_FLAGS_REUSE) {
+        reuse_count++;
+      }
+      arg = arg->next;
+    }
+  }
+  const int first_reuse_index = arg_count + 1;
+
+  if (reuse_count == 0) {
+    fprintf(source, "    binding_argcheck(L, %d);\n", arg_count);
+  } else {
+    fprintf(source, "    const int args = lua_gettop(L);\n");
+    fprintf(source, "    if (args > %d) {\n", arg_count + reuse_count);
+    fprintf(source, "        return luaL_argerror(L, args, \"too many arguments\");\n");
+    fprintf(source, "    } else if (args < %d) {\n", arg_count);
+    fprintf(source, "        return luaL_argerror(L, args, \"too few arguments\");\n");
+    fprintf(source, "    }\n");
+  }
 
   switch (data->ud_type) {
     case UD_USERDATA:
@@ -1371,6 +1494,21 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
     arg = arg->next;
   }
 
+  // resolve any objects to be reused before taking the semaphores, as a type error will longjmp out
+  if (reuse_count > 0) {
+    int reuse_index = first_reuse_index;
+    if (method->return_type.flags & TYPE_FLAGS_REUSE) {
+      emit_reuse_slot(&(method->return_type), reuse_index++);
+    }
+    arg = method->arguments;
+    while (arg != NULL) {
+      if (arg->type.flags & TYPE_FLAGS_REUSE) {
+        emit_reuse_slot(&(arg->type), reuse_index++);
+      }
+      arg = arg->next;
+    }
+  }
+
   if (data->flags & UD_FLAG_SEMAPHORE) {
     fprintf(source, "    ud->get_semaphore().take_blocking();\n");
   }
@@ -1515,8 +1653,14 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
         return_count = 0;
         arg = method->arguments;
         int arg_index = NULLABLE_ARG_COUNT_BASE + 2;
+        int reuse_index = first_reuse_index + ((method->return_type.flags & TYPE_FLAGS_REUSE) ? 1 : 0);
         while (arg != NULL) {
-          if (arg->type.flags & TYPE_FLAGS_NULLABLE) {
+          if (arg->type.flags & TYPE_FLAGS_REUSE) {
+            return_count++;
+            char data_name[32];
+            snprintf(data_name, sizeof(data_name), "data_%d", arg_index);
+            emit_reuse_output(&(arg->type), reuse_index++, data_name, "        ");
+          } else if (arg->type.flags & TYPE_FLAGS_NULLABLE) {
             return_count++;
             switch (arg->type.type) {
               case TYPE_BOOLEAN:
@@ -1580,6 +1724,10 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
       fprintf(source, "    lua_pushinteger(L, data);\n");
       break;
     case TYPE_UINT32_T:
+      if (method->return_type.flags & TYPE_FLAGS_REUSE) {
+        emit_reuse_output(&(method->return_type), first_reuse_index, "data", "    ");
+        break;
+      }
       fprintf(source, "        new_uint32_t(L);\n");
       fprintf(source, "        *static_cast<uint32_t *>(luaL_checkudata(L, -1, \"uint32_t\")) = data;\n");
       break;
@@ -1587,6 +1735,10 @@ void emit_userdata_method(const struct userdata *data, const struct method *meth
       fprintf(source, "    lua_pushstring(L, data);\n");
       break;
     case TYPE_USERDATA:
+      if (method->return_type.flags & TYPE_FLAGS_REUSE) {
+        emit_reuse_output(&(method->return_type), first_reuse_index, "data", "    ");
+        break;
+      }
       // userdatas must allocate a new container to return
       fprintf(source, "    new_%s(L);\n", method->return_type.data.ud.sanatized_name);
       fprintf(source, "    *check_%s(L, -1) = data;\n", method->return_type.data.ud.sanatized_name);
@@ -0,0 +1,169 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lua_pool_allocator.h"
+#include <AP_Math/AP_Math.h>
+#include <string.h>
+
+extern const AP_HAL::HAL& hal;
+
+// block sizes are multiples of 16 to keep the alignment Lua expects
+const uint16_t lua_pool_allocator::class_size[num_classes] = { 16, 32, 48, 64 };
+
+lua_pool_allocator::lua_pool_allocator(void *heap, uint32_t heap_size, uint8_t pool_percent) :
+    _heap(heap)
+{
+    if (_heap == nullptr) {
+        return;
+    }
+    uint16_t num_pages = (uint64_t(heap_size) * MIN(pool_percent, 50U) / 100) / page_size;
+    if (num_pages == 0) {
+        return;
+    }
+    _page_class = (uint8_t *)hal.util->heap_realloc(_heap, nullptr, num_pages);
+    _arena = (uint8_t *)hal.util->heap_realloc(_heap, nullptr, num_pages * page_size);
+    if (_page_class == nullptr || _arena == nullptr) {
+        // run without pools
+        hal.util->heap_realloc(_heap, _page_class, 0);
+        hal.util->heap_realloc(_heap, _arena, 0);
+        _page_class = nullptr;
+        _arena = nullptr;
+        return;
+    }
+    memset(_page_class, page_unused, num_pages);
+    _num_pages = num_pages;
+    _heap_used = num_pages * (page_size + 1);
+    _heap_peak = _heap_used;
+}
+
+int8_t lua_pool_allocator::size_class(size_t size)
+{
+    for (uint8_t i=0; i<num_classes; i++) {
+        if (size <= class_size[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+  get a block from a size class, taking a new page from the arena if
+  the free list is empty
+ */
+void *lua_pool_allocator::pool_alloc(uint8_t cls)
+{
+    if (_free_list[cls] == nullptr) {
+        if (_next_page >= _num_pages) {
+            return nullptr;
+        }
+        // split a fresh page into blocks for this class
+        const uint16_t page = _next_page++;
+        _page_class[page] = cls;
+        uint8_t *base = &_arena[page * page_size];
+        const uint16_t size = class_size[cls];
+        for (uint16_t ofs = 0; ofs + size <= page_size; ofs += size) {
+            free_block *b = (free_block *)&base[ofs];
+            b->next = _free_list[cls];
+            _free_list[cls] = b;
+        }
+    }
+    free_block *b = _free_list[cls];
+    _free_list[cls] = b->next;
+    _pool_used += class_size[cls];
+    return b;
+}
+
+void lua_pool_allocator::pool_free(void *ptr)
+{
+    const uint8_t cls = block_class(ptr);
+    free_block *b = (free_block *)ptr;
+    b->next = _free_list[cls];
+    _free_list[cls] = b;
+    _pool_used -= class_size[cls];
+}
+
+void *lua_pool_allocator::heap_realloc(void *ptr, size_t osize, size_t nsize)
+{
+    void *ret = hal.util->heap_realloc(_heap, ptr, nsize);
+    if (ret != nullptr || nsize == 0) {
+        _heap_used += nsize - osize;
+        _heap_peak = MAX(_heap_peak, _heap_used);
+    }
+    return ret;
+}
+
+/*
+  lua_Alloc compatible allocation. Note that osize is only the size of
+  the old block when ptr is not null, otherwise it is an object type
+ */
+void *lua_pool_allocator::realloc(void *ptr, size_t osize, size_t nsize)
+{
+    if (ptr == nullptr) {
+        osize = 0;
+    }
+    const bool old_pooled = in_pool(ptr);
+
+    if (nsize == 0) {
+        if (old_pooled) {
+            pool_free(ptr);
+        } else if (ptr != nullptr) {
+            heap_realloc(ptr, osize, 0);
+        }
+        return nullptr;
+    }
+
+    if (old_pooled && nsize <= class_size[block_class(ptr)]) {
+        // still fits, which always covers shrinking a pooled block
+        return ptr;
+    }
+
+    const int8_t cls = size_class(nsize);
+    void *new_ptr = nullptr;
+    if (cls >= 0) {
+        new_ptr = pool_alloc(cls);
+        if (new_ptr == nullptr) {
+            _pool_fallbacks++;
+        }
+    }
+    if (new_ptr == nullptr) {
+        if (ptr != nullptr && !old_pooled) {
+            // heap to heap
+            return heap_realloc(ptr, osize, nsize);
+        }
+        new_ptr = heap_realloc(nullptr, 0, nsize);
+        if (new_ptr == nullptr) {
+            return nullptr;
+        }
+    }
+
+    if (ptr != nullptr) {
+        memcpy(new_ptr, ptr, MIN(osize, nsize));
+        if (old_pooled) {
+            pool_free(ptr);
+        } else {
+            heap_realloc(ptr, osize, 0);
+        }
+    }
+    return new_ptr;
+}
+
+uint8_t lua_pool_allocator::pool_fragmentation(void) const
+{
+    const uint32_t carved = _next_page * page_size;
+    if (carved == 0) {
+        return 0;
+    }
+    return (carved - _pool_used) * 100 / carved;
+}
@@ -0,0 +1,108 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+// default percentage of the scripting heap reserved for small object
+// pools, 0 to disable them
+#ifndef SCRIPTING_POOL_PERCENT
+  #define SCRIPTING_POOL_PERCENT 0
+#endif
+
+/*
+  allocator for the Lua state, layered on top of the HAL scripting heap
+
+  Small allocations (tables, closures, short strings and userdata such
+  as Vector3f and Location) are served from size class pools carved
+  out of a single arena at the start of the heap. Each pool hands out
+  fixed size blocks from 256 byte pages, so churn of small objects
+  doesn't fragment the main heap. The size class of a pooled block is
+  found from its page, so blocks can be shrunk in place without ever
+  failing, as Lua requires.
+
+  Larger allocations, and small ones when the arena is exhausted, go
+  to the heap as before. The arena is reserved up front and never
+  returned to the heap, so the pools are off unless a percentage of
+  the heap is given for them.
+ */
+class lua_pool_allocator
+{
+public:
+    lua_pool_allocator(void *heap, uint32_t heap_size, uint8_t pool_percent);
+
+    /* Do not allow copies */
+    lua_pool_allocator(const lua_pool_allocator &other) = delete;
+    lua_pool_allocator &operator=(const lua_pool_allocator&) = delete;
+
+    // allocation function with lua_Alloc semantics
+    void *realloc(void *ptr, size_t osize, size_t nsize);
+
+    // bytes currently allocated, including the pool arena
+    uint32_t heap_used(void) const { return _heap_used; }
+
+    // highest value of heap_used()
+    uint32_t heap_peak(void) const { return _heap_peak; }
+
+    // bytes of pool blocks in use
+    uint32_t pool_used(void) const { return _pool_used; }
+
+    // percentage of the pool pages handed out which is sitting unused
+    // on the free lists
+    uint8_t pool_fragmentation(void) const;
+
+    // number of small allocations which fell back to the heap
+    uint32_t pool_fallbacks(void) const { return _pool_fallbacks; }
+
+private:
+    static const uint8_t num_classes = 4;
+    static const uint16_t class_size[num_classes];
+    static const uint16_t page_size = 256;
+    static const uint8_t page_unused = 0xFF;
+
+    struct free_block {
+        free_block *next;
+    };
+
+    void *_heap;
+
+    uint8_t *_arena = nullptr;
+    uint16_t _num_pages = 0;
+    uint16_t _next_page = 0;
+    uint8_t *_page_class = nullptr; // size class of each page, or page_unused
+    free_block *_free_list[num_classes] {};
+
+    uint32_t _heap_used = 0;
+    uint32_t _heap_peak = 0;
+    uint32_t _pool_used = 0;
+    uint32_t _pool_fallbacks = 0;
+
+    bool in_pool(const void *ptr) const {
+        return ptr != nullptr && (const uint8_t *)ptr >= _arena &&
+            (const uint8_t *)ptr < _arena + _num_pages * page_size;
+    }
+
+    // size class for a request, or -1 if it is too large for the pools
+    static int8_t size_class(size_t size);
+
+    // size class of a pooled block
+    uint8_t block_class(const void *ptr) const {
+        return _page_class[((const uint8_t *)ptr - _arena) / page_size];
+    }
+
+    void *pool_alloc(uint8_t cls);
+    void pool_free(void *ptr);
+    void *heap_realloc(void *ptr, size_t osize, size_t nsize);
+};
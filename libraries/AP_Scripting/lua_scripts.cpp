@@ -16,6 +16,7 @@
 #include "lua_scripts.h"
 #include <AP_HAL/AP_HAL.h>
 #include <GCS_MAVLink/GCS.h>
+#include <AP_Logger/AP_Logger.h>
 #include "AP_Scripting.h"
 
 #include <AP_Scripting/lua_generated_bindings.h>
@@ -25,11 +26,15 @@ extern const AP_HAL::HAL& hal;
 bool lua_scripts::overtime;
 jmp_buf lua_scripts::panic_jmp;
 
-lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal)
+lua_scripts::lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &pool_percent, const AP_Int8 &debug_level, const AP_Int16 &debug_options, struct AP_Scripting::terminal_s &_terminal)
     : _vm_steps(vm_steps),
       _debug_level(debug_level),
+      _debug_options(debug_options),
      terminal(_terminal) {
     _heap = hal.util->allocate_heap_memory(heap_size);
+    if (_heap != nullptr) {
+        _allocator = new lua_pool_allocator(_heap, heap_size, MAX(pool_percent.get(), 0));
+    }
 }
 
 void lua_scripts::hook(lua_State *L, lua_Debug *ar) {
@@ -74,7 +79,7 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
         }
     }
 
-    script_info *new_script = (script_info *)hal.util->heap_realloc(_heap, nullptr, sizeof(script_info));
+    script_info *new_script = (script_info *)_allocator->realloc(nullptr, 0, sizeof(script_info));
     if (new_script == nullptr) {
         // No memory, shouldn't happen, we even attempted to do a GC
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Insufficent memory loading %s", filename);
@@ -84,6 +89,7 @@ lua_scripts::script_info *lua_scripts::load_script(lua_State *L, char *filename)
 
     new_script->name = filename;
     new_script->next = nullptr;
+    new_script->gc_max_us = 0;
 
     create_sandbox(L);
     lua_setupvalue(L, -2, 1);
@@ -143,7 +149,7 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
 
         // FIXME: because chunk name fetching is not working we are allocating and storing an extra string we shouldn't need to
         size_t size = strlen(dirname) + strlen(de->d_name) + 2;
-        char * filename = (char *) hal.util->heap_realloc(_heap, nullptr, size);
+        char * filename = (char *)_allocator->realloc(nullptr, 0, size);
         if (filename == nullptr) {
             continue;
         }
@@ -152,7 +158,7 @@ void lua_scripts::load_all_scripts_in_dir(lua_State *L, const char *dirname) {
         // we have something that looks like a lua file, attempt to load it
         script_info * script = load_script(L, filename);
         if (script == nullptr) {
-            hal.util->heap_realloc(_heap, filename, 0);
+            _allocator->realloc(filename, size, 0);
             continue;
         }
         reschedule_script(script);
@@ -268,8 +274,9 @@ void lua_scripts::remove_script(lua_State *L, script_info *script) {
         // state could be null if we are force killing all scripts
         luaL_unref(L, LUA_REGISTRYINDEX, script->lua_ref);
     }
-    hal.util->heap_realloc(_heap, script->name, 0);
-    hal.util->heap_realloc(_heap, script, 0);
+    // go through the allocator so the heap statistics include them
+    _allocator->realloc(script->name, strlen(script->name) + 1, 0);
+    _allocator->realloc(script, sizeof(script_info), 0);
 }
 
 void lua_scripts::reschedule_script(script_info *script) {
@@ -310,8 +317,32 @@ void lua_scripts::reschedule_script(script_info *script) {
 void *lua_scripts::_heap;
 
 void *lua_scripts::alloc(void *ud, void *ptr, size_t osize, size_t nsize) {
-    (void)ud; (void)osize;  /* not used */
-    return hal.util->heap_realloc(_heap, ptr, nsize);
+    return ((lua_pool_allocator *)ud)->realloc(ptr, osize, nsize);
+}
+
+void lua_scripts::log_script_stats(const script_info *script, uint32_t run_time_us, uint32_t gc_time_us, uint32_t mem) {
+    AP_Logger *logger = AP_Logger::get_singleton();
+    if (logger == nullptr || !logger->logging_started()) {
+        return;
+    }
+
+    // strip the directory from the script name
+    const char *name = strrchr(script->name, '/');
+    name = (name == nullptr) ? script->name : name + 1;
+
+    struct log_Scripting pkt {
+        LOG_PACKET_HEADER_INIT(LOG_SCRIPTING_MSG),
+        time_us         : AP_HAL::micros64(),
+        name            : {},
+        run_time        : run_time_us,
+        gc_time         : gc_time_us,
+        gc_max          : script->gc_max_us,
+        total_mem       : mem,
+        heap_peak       : _allocator->heap_peak(),
+        pool_frag       : _allocator->pool_fragmentation(),
+    };
+    strncpy(pkt.name, name, sizeof(pkt.name));
+    logger->WriteBlock(&pkt, sizeof(pkt));
 }
 
 void lua_scripts::repl_cleanup (void) {
@@ -353,7 +384,7 @@ void lua_scripts::run(void) {
         repl_cleanup();
     }
 
-    lua_state = lua_newstate(alloc, NULL);
+    lua_state = lua_newstate(alloc, _allocator);
     lua_State *L = lua_state;
     if (L == nullptr) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Lua: Couldn't allocate a lua state");
@@ -408,20 +439,50 @@ void lua_scripts::run(void) {
             const int startMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
             const uint32_t loadEnd = AP_HAL::micros();
 
+            // the script may be removed or rescheduled by running it
+            script_info *script = scripts;
+
             run_next_script(L);
 
             const uint32_t runEnd = AP_HAL::micros();
             const int endMem = lua_gc(L, LUA_GCCOUNT, 0) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0);
+
+            // garbage collect after each script, this shouldn't matter, but seems to resolve a memory leak
+            lua_gc(L, LUA_GCCOLLECT, 0);
+
+            // this is only the full collection after the run, any
+            // incremental collection during the run is in its run time
+            const uint32_t gcTime = AP_HAL::micros() - runEnd;
+
+            // only report on scripts which are still scheduled, the
+            // others have been freed
+            bool script_active = false;
+            for (const script_info *s = scripts; s != nullptr; s = s->next) {
+                if (s == script) {
+                    script_active = true;
+                    break;
+                }
+            }
+            if (script_active) {
+                script->gc_max_us = MAX(script->gc_max_us, gcTime);
+                if (_debug_options.get() & uint16_t(AP_Scripting::DebugOption::LOG_STATS)) {
+                    log_script_stats(script, runEnd - loadEnd, gcTime, endMem);
+                }
+            }
+
             if (_debug_level > 1) {
-                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Time: %u Mem: %d + %d",
+                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Time: %u GC: %u Mem: %d + %d",
                                                     (unsigned int)(runEnd - loadEnd),
+                                                    (unsigned int)gcTime,
                                                     (int)endMem,
                                                     (int)(endMem - startMem));
+                gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: Heap: %u peak: %u pool: %u frag: %u%%",
+                                                    (unsigned int)_allocator->heap_used(),
+                                                    (unsigned int)_allocator->heap_peak(),
+                                                    (unsigned int)_allocator->pool_used(),
+                                                    (unsigned int)_allocator->pool_fragmentation());
             }
 
-            // garbage collect after each script, this shouldn't matter, but seems to resolve a memory leak
-            lua_gc(L, LUA_GCCOLLECT, 0);
-
         } else {
             if (_debug_level > 0) {
                 gcs().send_text(MAV_SEVERITY_DEBUG, "Lua: No scripts to run");
@@ -20,6 +20,7 @@
 
 #include <AP_Filesystem/posix_compat.h>
 #include "lua_bindings.h"
+#include "lua_pool_allocator.h"
 #include <AP_Scripting/AP_Scripting.h>
 
 #ifndef REPL_DIRECTORY
@@ -49,14 +50,14 @@
 class lua_scripts
 {
 public:
-    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &debug_level, struct AP_Scripting::terminal_s &_terminal);
+    lua_scripts(const AP_Int32 &vm_steps, const AP_Int32 &heap_size, const AP_Int8 &pool_percent, const AP_Int8 &debug_level, const AP_Int16 &debug_options, struct AP_Scripting::terminal_s &_terminal);
 
     /* Do not allow copies */
     lua_scripts(const lua_scripts &other) = delete;
     lua_scripts &operator=(const lua_scripts&) = delete;
 
     // return true if initialisation failed
-    bool heap_allocated() const { return _heap != nullptr; }
+    bool heap_allocated() const { return _heap != nullptr && _allocator != nullptr; }
 
     // run scripts, does not return unless an error occured
     void run(void);
@@ -72,6 +73,7 @@ private:
        int lua_ref;          // reference to the loaded script object
        uint64_t next_run_ms; // time (in milliseconds) the script should next be run at
        char *name;           // filename for the script // FIXME: This information should be available from Lua
+       uint32_t gc_max_us;   // longest garbage collection after a run of the script
        script_info *next;
     } script_info;
 
@@ -116,8 +118,13 @@ private:
 
     const AP_Int32 & _vm_steps;
     const AP_Int8 & _debug_level;
+    const AP_Int16 & _debug_options;
+
+    // log runtime, garbage collection and memory statistics for a script run
+    void log_script_stats(const script_info *script, uint32_t run_time_us, uint32_t gc_time_us, uint32_t mem);
 
     static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
 
     static void *_heap;
+    lua_pool_allocator *_allocator;
 };
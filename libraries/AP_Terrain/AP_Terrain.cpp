@@ -50,10 +50,18 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
     // @Param: OPTIONS
     // @DisplayName: Terrain options
     // @Description: Options to change behaviour of terrain system
-    // @Bitmask: 0:Disable Download
+    // @Bitmask: 0:Disable Download, 1:Memory map terrain files (Linux only)
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",   2, AP_Terrain, options, 0),
-    
+
+    // @Param: CACHE_SZ
+    // @DisplayName: Terrain cache size
+    // @Description: The number of terrain grid blocks kept in memory. Each block is about 2 kilobytes and covers an area of 32x28 grid spacings. A larger cache reduces the number of SD card reads needed on long, fast flights and allows blocks along the mission legs to be loaded ahead of the vehicle. If the allocation fails the cache size is halved until it succeeds.
+    // @Range: 4 128
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("CACHE_SZ",  3, AP_Terrain, config_cache_size, TERRAIN_GRID_BLOCK_CACHE_SIZE),
+
     AP_GROUPEND
 };
 
@@ -108,6 +116,83 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
     // find the grid
     const struct grid_block &grid = find_grid_cache(info).grid;
 
+    if (!interpolate_height(grid, info, height)) {
+        return false;
+    }
+
+    if (loc.lat == ahrs.get_home().lat &&
+        loc.lng == ahrs.get_home().lng) {
+        // remember home altitude as a special case
+        home_height = height;
+        home_loc = loc;
+    }
+
+    // apply correction which assumes home altitude is at terrain altitude
+    if (corrected) {
+        height += (ahrs.get_home().alt * 0.01f) - home_height;
+    }
+
+    return true;
+}
+
+
+/*
+  find the terrain heights in meters above sea level for an array of
+  locations. The grid block and the SW corner of the block are only
+  looked up when a point moves to a different block from the previous
+  point, which for closely spaced points along a path is rare
+ */
+uint16_t AP_Terrain::height_amsl(const Location *loc, uint16_t count, float *height, bool *valid, bool corrected)
+{
+    if (!allocate()) {
+        if (valid != nullptr) {
+            memset(valid, 0, count*sizeof(valid[0]));
+        }
+        return 0;
+    }
+
+    float correction = 0;
+    if (corrected) {
+        correction = (AP::ahrs().get_home().alt * 0.01f) - home_height;
+    }
+
+    uint16_t num_valid = 0;
+    struct grid_info info, last_info;
+    const struct grid_block *grid = nullptr;
+
+    for (uint16_t i=0; i<count; i++) {
+        calculate_grid_index(loc[i], info);
+        if (grid == nullptr ||
+            info.lat_degrees != last_info.lat_degrees ||
+            info.lon_degrees != last_info.lon_degrees ||
+            info.grid_idx_x != last_info.grid_idx_x ||
+            info.grid_idx_y != last_info.grid_idx_y) {
+            // moved to a new grid block
+            calculate_grid_corner(info);
+            grid = &find_grid_cache(info).grid;
+            last_info = info;
+        } else {
+            info.grid_lat = last_info.grid_lat;
+            info.grid_lon = last_info.grid_lon;
+        }
+        const bool ok = interpolate_height(*grid, info, height[i]);
+        if (ok) {
+            height[i] += correction;
+            num_valid++;
+        }
+        if (valid != nullptr) {
+            valid[i] = ok;
+        }
+    }
+
+    return num_valid;
+}
+
+/*
+  interpolate the terrain height within a grid block
+ */
+bool AP_Terrain::interpolate_height(const struct grid_block &grid, const struct grid_info &info, float &height)
+{
     /*
       note that we rely on the one square overlap to ensure these
       calculations don't go past the end of the arrays
@@ -115,7 +200,6 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
     ASSERT_RANGE(info.idx_x, 0, TERRAIN_GRID_BLOCK_SIZE_X-2);
     ASSERT_RANGE(info.idx_y, 0, TERRAIN_GRID_BLOCK_SIZE_Y-2);
 
-
     // check we have all 4 required heights
     if (!check_bitmap(grid, info.idx_x,   info.idx_y) ||
         !check_bitmap(grid, info.idx_x,   info.idx_y+1) ||
@@ -141,22 +225,9 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
 
     height = avg;
 
-    if (loc.lat == ahrs.get_home().lat &&
-        loc.lng == ahrs.get_home().lng) {
-        // remember home altitude as a special case
-        home_height = height;
-        home_loc = loc;
-    }
-
-    // apply correction which assumes home altitude is at terrain altitude
-    if (corrected) {
-        height += (ahrs.get_home().alt * 0.01f) - home_height;
-    }
-
     return true;
 }
 
-
 /* 
    find difference between home terrain height and the terrain
    height at the current location in meters. A positive result
@@ -278,16 +349,27 @@ float AP_Terrain::lookahead(float bearing, float distance, float climb_ratio)
     float climb = 0;
     float lookahead_estimate = 0;
 
-    // check for terrain at grid spacing intervals
+    // check for terrain at grid spacing intervals, looking up a batch
+    // of points at a time
+    const uint8_t batch_size = 16;
+    Location points[batch_size];
+    float heights[batch_size];
+    bool valid[batch_size];
     while (distance > 0) {
-        loc.offset_bearing(bearing, grid_spacing);
-        climb += climb_ratio * grid_spacing;
-        distance -= grid_spacing;
-        float height;
-        if (height_amsl(loc, height, false)) {
-            float rise = (height - base_height) - climb;
-            if (rise > lookahead_estimate) {
-                lookahead_estimate = rise;
+        uint8_t n = 0;
+        while (distance > 0 && n < batch_size) {
+            loc.offset_bearing(bearing, grid_spacing);
+            distance -= grid_spacing;
+            points[n++] = loc;
+        }
+        height_amsl(points, n, heights, valid, false);
+        for (uint8_t i=0; i<n; i++) {
+            climb += climb_ratio * grid_spacing;
+            if (valid[i]) {
+                float rise = (heights[i] - base_height) - climb;
+                if (rise > lookahead_estimate) {
+                    lookahead_estimate = rise;
+                }
             }
         }
     }
@@ -328,6 +410,9 @@ void AP_Terrain::update(void)
     // check for pending rally data
     update_rally_data();
 
+    // read ahead along the mission legs we are flying
+    update_prefetch();
+
     // update capabilities and status
     if (allocate()) {
         if (!pos_valid) {
@@ -358,10 +443,11 @@ void AP_Terrain::log_terrain_data()
     float terrain_height = 0;
     float current_height = 0;
     uint16_t pending, loaded;
+    uint32_t hits, misses;
 
     height_amsl(loc, terrain_height, false);
     height_above_terrain(current_height, true);
-    get_statistics(pending, loaded);
+    get_statistics(pending, loaded, hits, misses);
 
     struct log_TERRAIN pkt = {
         LOG_PACKET_HEADER_INIT(LOG_TERRAIN_MSG),
@@ -373,7 +459,9 @@ void AP_Terrain::log_terrain_data()
         terrain_height : terrain_height,
         current_height : current_height,
         pending        : pending,
-        loaded         : loaded
+        loaded         : loaded,
+        cache_hits     : hits,
+        cache_misses   : misses
     };
     AP::logger().WriteBlock(&pkt, sizeof(pkt));
 }
@@ -390,13 +478,25 @@ bool AP_Terrain::allocate(void)
     if (cache != nullptr) {
         return true;
     }
-    cache = (struct grid_cache *)calloc(TERRAIN_GRID_BLOCK_CACHE_SIZE, sizeof(cache[0]));
+    const uint16_t min_size = 4;
+    uint16_t size = constrain_int16(config_cache_size.get(), min_size, 128);
+    while (true) {
+        cache = (struct grid_cache *)calloc(size, sizeof(cache[0]));
+        if (cache != nullptr || size == min_size) {
+            break;
+        }
+        // try again with a smaller cache
+        size = MAX(size/2, min_size);
+    }
     if (cache == nullptr) {
         gcs().send_text(MAV_SEVERITY_CRITICAL, "Terrain: Allocation failed");
         memory_alloc_failed = true;
         return false;
     }
-    cache_size = TERRAIN_GRID_BLOCK_CACHE_SIZE;
+    if (size != (uint16_t)config_cache_size.get()) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "Terrain: cache size %u", (unsigned)size);
+    }
+    cache_size = size;
     return true;
 }
 
@@ -29,6 +29,7 @@
 
 #include <AP_Param/AP_Param.h>
 #include <AP_Mission/AP_Mission.h>
+#include "TerrainMmap.h"
 
 #define TERRAIN_DEBUG 0
 
@@ -51,8 +52,20 @@
 #define TERRAIN_GRID_BLOCK_SIZE_X (TERRAIN_GRID_MAVLINK_SIZE*TERRAIN_GRID_BLOCK_MUL_X)
 #define TERRAIN_GRID_BLOCK_SIZE_Y (TERRAIN_GRID_MAVLINK_SIZE*TERRAIN_GRID_BLOCK_MUL_Y)
 
-// number of grid_blocks in the LRU memory cache
+// default number of grid_blocks in the LRU memory cache
+#ifndef TERRAIN_GRID_BLOCK_CACHE_SIZE
 #define TERRAIN_GRID_BLOCK_CACHE_SIZE 12
+#endif
+
+// maximum number of blocks ahead of the vehicle to prefetch along
+// the active mission legs
+#ifndef TERRAIN_PREFETCH_MAX_BLOCKS
+#define TERRAIN_PREFETCH_MAX_BLOCKS 6
+#endif
+
+// a cache slot must not have been accessed for this long before it
+// can be reused by a prefetch
+#define TERRAIN_PREFETCH_MIN_AGE_MS 10000
 
 // format of grid on disk
 #define TERRAIN_GRID_FORMAT_VERSION 1
@@ -126,6 +139,17 @@ public:
      */
     bool height_amsl(const Location &loc, float &height, bool corrected);
 
+    /*
+      find the terrain heights in meters above sea level for an array
+      of locations, such as the points along a path. Consecutive
+      points in the same grid block share the grid lookup, so this is
+      much cheaper than calling height_amsl() for each point
+
+      valid[i] is set to whether height[i] is available, and may be
+      nullptr. Returns the number of heights available
+     */
+    uint16_t height_amsl(const Location *loc, uint16_t count, float *height, bool *valid, bool corrected);
+
     /* 
        find difference between home terrain height and the terrain
        height at the current location in meters. A positive result
@@ -185,6 +209,8 @@ public:
       get some statistics for TERRAIN_REPORT
      */
     void get_statistics(uint16_t &pending, uint16_t &loaded) const;
+    void get_statistics(uint16_t &pending, uint16_t &loaded,
+                        uint32_t &cache_hits, uint32_t &cache_misses) const;
 
     /*
       returns true if initialisation failed because out-of-memory
@@ -288,12 +314,33 @@ private:
 
     // given a location, fill a grid_info structure
     void calculate_grid_info(const Location &loc, struct grid_info &info) const;
+    void calculate_grid_index(const Location &loc, struct grid_info &info) const;
+    void calculate_grid_corner(struct grid_info &info) const;
+
+    // interpolate the height within a grid, false if data is missing
+    bool interpolate_height(const struct grid_block &grid, const struct grid_info &info, float &height);
 
     /*
       find a grid structure given a grid_info
     */
     struct grid_cache &find_grid_cache(const struct grid_info &info);
 
+    /*
+      find a cache index given a grid_info, returning -1 if not cached
+    */
+    int16_t lookup_grid_cache(const struct grid_info &info) const;
+
+    /*
+      setup a cache slot for a grid_info, marking it for disk read
+    */
+    struct grid_cache &init_grid_cache(uint16_t idx, const struct grid_info &info);
+
+    /*
+      start loading a grid into the cache without evicting recently
+      used grids. Returns true if the grid is now in the cache
+    */
+    bool prefetch_grid(const struct grid_info &info);
+
     /*
       calculate bit number in grid_block bitmap. This corresponds to a
       bit representing a 4x4 mavlink transmitted block
@@ -333,6 +380,8 @@ private:
     void open_file(void);
     void seek_offset(void);
     uint32_t east_blocks(struct grid_block &block) const;
+    uint32_t block_file_offset(struct grid_block &block) const;
+    bool block_valid(struct grid_block &block, int32_t lat, int32_t lon);
     void write_block(void);
     void read_block(void);
 
@@ -346,14 +395,23 @@ private:
      */
     void update_rally_data(void);
 
+    /*
+      prefetch grids along the active mission legs
+     */
+    void update_prefetch(void);
+    bool start_prefetch(uint16_t nav_index);
+    Location prefetch_point(float distance) const;
+
 
     // parameters
     AP_Int8  enable;
     AP_Int16 grid_spacing; // meters between grid points
     AP_Int16 options; // option bits
+    AP_Int16 config_cache_size; // number of grid blocks in memory
 
     enum class Options {
         DisableDownload = (1U<<0),
+        MmapStore       = (1U<<1),
     };
 
     // reference to AP_Mission, so we can ask preload terrain data for 
@@ -361,9 +419,13 @@ private:
     const AP_Mission &mission;
 
     // cache of grids in memory, LRU
-    uint8_t cache_size = 0;
+    uint16_t cache_size = 0;
     struct grid_cache *cache = nullptr;
 
+    // cache statistics, for TERRAIN_REPORT and logging
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+
     // a grid_cache block waiting for disk IO
     enum DiskIoState {
         DiskIoIdle      = 0,
@@ -383,6 +445,13 @@ private:
     // open file handle on degree file
     int fd;
 
+#if AP_TERRAIN_MMAP_ENABLED
+    // memory mapped view of degree files, allowing grids to be
+    // loaded on the main thread without waiting for the IO thread
+    AP_Terrain_Mmap mmap_store;
+    bool load_from_mmap(struct grid_cache &gcache);
+#endif
+
     // has the timer been setup?
     bool timer_setup;
 
@@ -419,6 +488,26 @@ private:
     // grid spacing during mission check
     uint16_t last_mission_spacing;
 
+    /*
+      prefetch cursor: the current leg, from the vehicle to the
+      current waypoint, and the leg after it, with the distance along
+      them that has been checked
+     */
+    struct {
+        bool valid;
+        bool complete;
+        uint16_t nav_index;
+        uint32_t mission_change_ms;
+        int16_t spacing;
+        Location origin;
+        Location target;
+        float leg_length;
+        float leg_bearing;
+        float next_length;
+        float next_bearing;
+        float checked_m;
+    } prefetch;
+
     // next rally command to check
     uint16_t next_rally_index;
 
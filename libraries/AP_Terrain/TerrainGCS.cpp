@@ -203,6 +203,17 @@ void AP_Terrain::get_statistics(uint16_t &pending, uint16_t &loaded) const
     }
 }
 
+/*
+  get statistics including cache hit/miss counts
+*/
+void AP_Terrain::get_statistics(uint16_t &pending, uint16_t &loaded,
+                                uint32_t &hits, uint32_t &misses) const
+{
+    get_statistics(pending, loaded);
+    hits = cache_hits;
+    misses = cache_misses;
+}
+
 
 /* 
    handle terrain messages from GCS
@@ -94,6 +94,9 @@ void AP_Terrain::schedule_disk_io(void)
             cache[cache_idx].last_access_ms = AP_HAL::millis();
         }
         disk_io_state = DiskIoIdle;
+        // immediately queue the next pending read so that a run of
+        // prefetched blocks doesn't take two update cycles per block
+        check_disk_read();
         break;
     }
 
@@ -214,6 +217,12 @@ void AP_Terrain::open_file(void)
 
     file_lat_degrees = block.lat_degrees;
     file_lon_degrees = block.lon_degrees;
+
+#if AP_TERRAIN_MMAP_ENABLED
+    if (options.get() & uint16_t(Options::MmapStore)) {
+        mmap_store.map_file(fd, file_lat_degrees, file_lon_degrees);
+    }
+#endif
 }
 
 /*
@@ -234,14 +243,21 @@ uint32_t AP_Terrain::east_blocks(struct grid_block &block) const
 }
 
 /*
-  seek to the right offset for disk_block
+  get the file offset of a block within its degree file
  */
-void AP_Terrain::seek_offset(void)
+uint32_t AP_Terrain::block_file_offset(struct grid_block &block) const
 {
-    struct grid_block &block = disk_block.block;
     // work out how many longitude blocks there are at this latitude
     uint32_t blocknum = east_blocks(block) * block.grid_idx_x + block.grid_idx_y;
-    uint32_t file_offset = blocknum * sizeof(union grid_io_block);
+    return blocknum * sizeof(union grid_io_block);
+}
+
+/*
+  seek to the right offset for disk_block
+ */
+void AP_Terrain::seek_offset(void)
+{
+    uint32_t file_offset = block_file_offset(disk_block.block);
     if (AP::FS().lseek(fd, file_offset, SEEK_SET) != (off_t)file_offset) {
 #if TERRAIN_DEBUG
         hal.console->printf("Seek %lu failed - %s\n",
@@ -275,6 +291,12 @@ void AP_Terrain::write_block(void)
         io_failure = true;
     } else {
         AP::FS().fsync(fd);
+#if AP_TERRAIN_MMAP_ENABLED
+        if (options.get() & uint16_t(Options::MmapStore)) {
+            // extend the mapping if the file has grown
+            mmap_store.map_file(fd, file_lat_degrees, file_lon_degrees);
+        }
+#endif
 #if TERRAIN_DEBUG
         printf("wrote block at %ld %ld ret=%d mask=%07llx\n",
                (long)disk_block.block.lat,
@@ -300,12 +322,7 @@ void AP_Terrain::read_block(void)
 
     ssize_t ret = AP::FS().read(fd, &disk_block, sizeof(disk_block));
     if (ret != sizeof(disk_block) || 
-        !TERRAIN_LATLON_EQUAL(disk_block.block.lat,lat) ||
-        !TERRAIN_LATLON_EQUAL(disk_block.block.lon,lon) ||
-        disk_block.block.bitmap == 0 ||
-        disk_block.block.spacing != grid_spacing ||
-        disk_block.block.version != TERRAIN_GRID_FORMAT_VERSION ||
-        disk_block.block.crc != get_block_crc(disk_block.block)) {
+        !block_valid(disk_block.block, lat, lon)) {
 #if TERRAIN_DEBUG
         printf("read empty block at %ld %ld ret=%d (%ld %ld %u 0x%08lx) 0x%04x:0x%04x\n",
                (long)lat,
@@ -336,6 +353,51 @@ void AP_Terrain::read_block(void)
     disk_io_state = DiskIoDoneRead;
 }
 
+/*
+  check that a block read from disk is a valid block for the given
+  SW corner
+ */
+bool AP_Terrain::block_valid(struct grid_block &block, int32_t lat, int32_t lon)
+{
+    return TERRAIN_LATLON_EQUAL(block.lat,lat) &&
+        TERRAIN_LATLON_EQUAL(block.lon,lon) &&
+        block.bitmap != 0 &&
+        block.spacing == grid_spacing &&
+        block.version == TERRAIN_GRID_FORMAT_VERSION &&
+        block.crc == get_block_crc(block);
+}
+
+#if AP_TERRAIN_MMAP_ENABLED
+/*
+  try to fill a grid waiting for a disk read from the memory mapped
+  degree file. This runs on the main thread, and only succeeds if the
+  IO thread has already mapped the file. Returns true if the grid is
+  now valid
+ */
+bool AP_Terrain::load_from_mmap(struct grid_cache &gcache)
+{
+    if (gcache.state != GRID_CACHE_DISKWAIT) {
+        return false;
+    }
+    struct grid_block &grid = gcache.grid;
+    const int32_t lat = grid.lat;
+    const int32_t lon = grid.lon;
+    if (!mmap_store.is_mapped(grid.lat_degrees, grid.lon_degrees)) {
+        return false;
+    }
+    union grid_io_block io_block;
+    if (!mmap_store.read(grid.lat_degrees, grid.lon_degrees,
+                         block_file_offset(grid), &io_block, sizeof(io_block)) ||
+        !block_valid(io_block.block, lat, lon)) {
+        // not on disk yet, leave it to the IO thread
+        return false;
+    }
+    grid = io_block.block;
+    gcache.state = GRID_CACHE_VALID;
+    return true;
+}
+#endif // AP_TERRAIN_MMAP_ENABLED
+
 /*
   timer called to do disk IO
  */
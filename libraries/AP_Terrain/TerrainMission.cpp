@@ -24,6 +24,7 @@
 #include <GCS_MAVLink/GCS.h>
 #include "AP_Terrain.h"
 #include <AP_GPS/AP_GPS.h>
+#include <AP_AHRS/AP_AHRS.h>
 
 #if AP_TERRAIN_AVAILABLE
 
@@ -164,4 +165,140 @@ void AP_Terrain::update_rally_data(void)
     }
 }
 
+/*
+  find the point a distance along the legs being prefetched
+ */
+Location AP_Terrain::prefetch_point(float distance) const
+{
+    Location loc;
+    if (distance <= prefetch.leg_length) {
+        loc = prefetch.origin;
+        loc.offset_bearing(prefetch.leg_bearing, distance);
+    } else {
+        loc = prefetch.target;
+        loc.offset_bearing(prefetch.next_bearing, MIN(distance - prefetch.leg_length, prefetch.next_length));
+    }
+    return loc;
+}
+
+/*
+  start prefetching a new leg, from the vehicle to the current
+  waypoint and on to the waypoint after it. The following leg is read
+  from storage here, once per leg
+ */
+bool AP_Terrain::start_prefetch(uint16_t nav_index)
+{
+    Location loc;
+    if (!AP::ahrs().get_position(loc)) {
+        return false;
+    }
+
+    prefetch.valid = true;
+    prefetch.complete = false;
+    prefetch.nav_index = nav_index;
+    prefetch.mission_change_ms = mission.last_change_time_ms();
+    prefetch.spacing = grid_spacing;
+    prefetch.checked_m = 0;
+    prefetch.leg_length = 0;
+    prefetch.next_length = 0;
+
+    const Location &wp1 = mission.get_current_nav_cmd().content.location;
+    if (wp1.lat == 0 && wp1.lng == 0) {
+        // nothing to prefetch until the next leg
+        prefetch.complete = true;
+        return true;
+    }
+    prefetch.origin = loc;
+    prefetch.target = wp1;
+    prefetch.leg_length = loc.get_distance(wp1);
+    prefetch.leg_bearing = loc.get_bearing_to(wp1) * 0.01f;
+
+    for (uint16_t idx = nav_index+1; idx < mission.num_commands(); idx++) {
+        AP_Mission::Mission_Command cmd;
+        if (!mission.read_cmd_from_storage(idx, cmd)) {
+            break;
+        }
+        if (!AP_Mission::is_nav_cmd(cmd)) {
+            continue;
+        }
+        const Location &wp2 = cmd.content.location;
+        if (wp2.lat != 0 || wp2.lng != 0) {
+            prefetch.next_length = wp1.get_distance(wp2);
+            prefetch.next_bearing = wp1.get_bearing_to(wp2) * 0.01f;
+        }
+        break;
+    }
+    return true;
+}
+
+/*
+  prefetch grids along the current mission leg and the leg after
+  it. This allows disk reads (and GCS requests for missing data) to
+  happen before the vehicle reaches the grids, which matters for fast
+  aircraft that cross a grid block in a few seconds.
+
+  The legs are walked once, up to a few blocks ahead of the vehicle,
+  so once they are checked this costs nothing until the vehicle moves
+  to the next leg or the mission changes
+ */
+void AP_Terrain::update_prefetch(void)
+{
+    if (mission.state() != AP_Mission::MISSION_RUNNING ||
+        grid_spacing <= 0) {
+        prefetch.valid = false;
+        return;
+    }
+
+    const uint16_t nav_index = mission.get_current_nav_index();
+    if (!prefetch.valid ||
+        prefetch.nav_index != nav_index ||
+        prefetch.mission_change_ms != mission.last_change_time_ms() ||
+        prefetch.spacing != grid_spacing) {
+        if (!start_prefetch(nav_index)) {
+            return;
+        }
+    }
+    if (prefetch.complete) {
+        return;
+    }
+
+    Location loc;
+    if (!AP::ahrs().get_position(loc)) {
+        return;
+    }
+
+    // only look a few blocks ahead of the vehicle, so prefetched
+    // grids don't push each other out of the cache
+    const float block_m = TERRAIN_GRID_BLOCK_SPACING_X * grid_spacing;
+    const float total = prefetch.leg_length + prefetch.next_length;
+    const float along = MAX(prefetch.leg_length - loc.get_distance(prefetch.target), 0.0f);
+    const float limit = MIN(along + TERRAIN_PREFETCH_MAX_BLOCKS * block_m, total);
+
+    // step at half a grid block so we can't skip over a block
+    const float step = 0.5f * block_m;
+    uint8_t remaining = MIN(TERRAIN_PREFETCH_MAX_BLOCKS, cache_size/2);
+
+    while (prefetch.checked_m <= limit) {
+        struct grid_info info;
+        calculate_grid_info(prefetch_point(prefetch.checked_m), info);
+        if (lookup_grid_cache(info) == -1) {
+            if (remaining == 0 || !prefetch_grid(info)) {
+                // no free cache slots, try this point again next time
+                return;
+            }
+            remaining--;
+        }
+        if (prefetch.checked_m >= total) {
+            prefetch.complete = true;
+            return;
+        }
+        // don't step over the waypoint between the legs
+        float next_m = MIN(prefetch.checked_m + step, total);
+        if (prefetch.checked_m < prefetch.leg_length && next_m > prefetch.leg_length) {
+            next_m = prefetch.leg_length;
+        }
+        prefetch.checked_m = next_m;
+    }
+}
+
 #endif // AP_TERRAIN_AVAILABLE
@@ -0,0 +1,137 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  memory mapped access to terrain degree files on Linux
+ */
+
+#include "TerrainMmap.h"
+
+#if AP_TERRAIN_MMAP_ENABLED
+
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+AP_Terrain_Mmap::~AP_Terrain_Mmap()
+{
+    unmap_all();
+}
+
+/*
+  find a mapped file
+ */
+AP_Terrain_Mmap::mapped_file *AP_Terrain_Mmap::find_file(int8_t lat_degrees, int16_t lon_degrees)
+{
+    for (uint8_t i=0; i<max_files; i++) {
+        if (files[i].base != nullptr &&
+            files[i].lat_degrees == lat_degrees &&
+            files[i].lon_degrees == lon_degrees) {
+            return &files[i];
+        }
+    }
+    return nullptr;
+}
+
+void AP_Terrain_Mmap::unmap(struct mapped_file &f)
+{
+    if (f.base != nullptr) {
+        munmap((void *)f.base, f.length);
+    }
+    memset(&f, 0, sizeof(f));
+}
+
+/*
+  map a degree file, replacing the least recently used mapping if
+  needed. If the file is already mapped and has grown then it is
+  remapped to cover the new length
+ */
+bool AP_Terrain_Mmap::map_file(int fd, int8_t lat_degrees, int16_t lon_degrees)
+{
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0 || st.st_size <= 0) {
+        return false;
+    }
+    const size_t length = st.st_size;
+
+    {
+        WITH_SEMAPHORE(sem);
+        struct mapped_file *f = find_file(lat_degrees, lon_degrees);
+        if (f != nullptr && f->length >= length) {
+            // already mapped at full length
+            return true;
+        }
+    }
+
+    // do the mmap without the semaphore held so readers are not
+    // held up by the system call
+    void *base = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    WITH_SEMAPHORE(sem);
+    struct mapped_file *f = find_file(lat_degrees, lon_degrees);
+    if (f == nullptr) {
+        // use an empty slot, or the least recently used one
+        f = &files[0];
+        for (uint8_t i=0; i<max_files; i++) {
+            if (files[i].base == nullptr) {
+                f = &files[i];
+                break;
+            }
+            if (files[i].last_use_ms < f->last_use_ms) {
+                f = &files[i];
+            }
+        }
+    }
+    unmap(*f);
+    f->base = (const uint8_t *)base;
+    f->length = length;
+    f->lat_degrees = lat_degrees;
+    f->lon_degrees = lon_degrees;
+    f->last_use_ms = AP_HAL::millis();
+    return true;
+}
+
+/*
+  copy from a mapped degree file
+ */
+bool AP_Terrain_Mmap::read(int8_t lat_degrees, int16_t lon_degrees, uint32_t offset, void *buf, uint32_t len)
+{
+    WITH_SEMAPHORE(sem);
+    struct mapped_file *f = find_file(lat_degrees, lon_degrees);
+    if (f == nullptr || offset + len > f->length) {
+        return false;
+    }
+    memcpy(buf, &f->base[offset], len);
+    f->last_use_ms = AP_HAL::millis();
+    return true;
+}
+
+bool AP_Terrain_Mmap::is_mapped(int8_t lat_degrees, int16_t lon_degrees)
+{
+    WITH_SEMAPHORE(sem);
+    return find_file(lat_degrees, lon_degrees) != nullptr;
+}
+
+void AP_Terrain_Mmap::unmap_all(void)
+{
+    WITH_SEMAPHORE(sem);
+    for (uint8_t i=0; i<max_files; i++) {
+        unmap(files[i]);
+    }
+}
+
+#endif // AP_TERRAIN_MMAP_ENABLED
@@ -0,0 +1,82 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+
+#ifndef AP_TERRAIN_MMAP_ENABLED
+#define AP_TERRAIN_MMAP_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
+
+#if AP_TERRAIN_MMAP_ENABLED
+
+/*
+  read-only memory mapped view of the terrain degree files
+
+  Files are mapped by the terrain IO thread after it opens them, and
+  blocks are then copied out of the mapping by the main thread without
+  any system calls. The mappings share the kernel page cache with the
+  normal read/write file IO, so blocks written by the IO thread are
+  visible through the mapping.
+ */
+class AP_Terrain_Mmap {
+public:
+    AP_Terrain_Mmap() {}
+    ~AP_Terrain_Mmap();
+
+    /* Do not allow copies */
+    AP_Terrain_Mmap(const AP_Terrain_Mmap &other) = delete;
+    AP_Terrain_Mmap &operator=(const AP_Terrain_Mmap&) = delete;
+
+    // number of degree files that may be mapped at once
+    static const uint8_t max_files = 4;
+
+    /*
+      map (or remap if it has grown) an open degree file. Called
+      from the IO thread
+     */
+    bool map_file(int fd, int8_t lat_degrees, int16_t lon_degrees);
+
+    /*
+      copy len bytes at offset from a mapped degree file. Returns
+      false if the file isn't mapped or is too short. Safe to call
+      from any thread and never blocks on file IO beyond a possible
+      page fault
+     */
+    bool read(int8_t lat_degrees, int16_t lon_degrees, uint32_t offset, void *buf, uint32_t len);
+
+    // return true if the given degree file is mapped
+    bool is_mapped(int8_t lat_degrees, int16_t lon_degrees);
+
+    // unmap all files
+    void unmap_all(void);
+
+private:
+    struct mapped_file {
+        const uint8_t *base;
+        size_t length;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+        uint32_t last_use_ms;
+    } files[max_files];
+
+    HAL_Semaphore sem;
+
+    // find a mapped file, or nullptr
+    struct mapped_file *find_file(int8_t lat_degrees, int16_t lon_degrees);
+    void unmap(struct mapped_file &f);
+};
+
+#endif // AP_TERRAIN_MMAP_ENABLED
@@ -59,6 +59,17 @@ bool AP_Terrain::check_bitmap(const struct grid_block &grid, uint8_t idx_x, uint
   grid indices
 */
 void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info) const
+{
+    calculate_grid_index(loc, info);
+    calculate_grid_corner(info);
+}
+
+/*
+  given a location, calculate the degree reference, the 32x28 grid
+  indices and the position within the grid. This is the part of
+  calculate_grid_info() that differs between points in the same grid
+*/
+void AP_Terrain::calculate_grid_index(const Location &loc, struct grid_info &info) const
 {
     // grids start on integer degrees. This makes storing terrain data
     // on the SD card a bit easier
@@ -91,42 +102,49 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
     info.frac_x = (offset.x - idx_x * grid_spacing) / grid_spacing;
     info.frac_y = (offset.y - idx_y * grid_spacing) / grid_spacing;
 
-    // calculate lat/lon of SW corner of 32*28 grid_block
-    ref.offset(info.grid_idx_x * TERRAIN_GRID_BLOCK_SPACING_X * (float)grid_spacing,
-               info.grid_idx_y * TERRAIN_GRID_BLOCK_SPACING_Y * (float)grid_spacing);
-    info.grid_lat = ref.lat;
-    info.grid_lon = ref.lng;
-
     ASSERT_RANGE(info.idx_x,0,TERRAIN_GRID_BLOCK_SPACING_X-1);
     ASSERT_RANGE(info.idx_y,0,TERRAIN_GRID_BLOCK_SPACING_Y-1);
     ASSERT_RANGE(info.frac_x,0,1);
     ASSERT_RANGE(info.frac_y,0,1);
 }
 
+/*
+  calculate lat/lon of SW corner of the 32*28 grid_block given the
+  degree reference and grid indices from calculate_grid_index()
+*/
+void AP_Terrain::calculate_grid_corner(struct grid_info &info) const
+{
+    Location ref;
+    ref.lat = info.lat_degrees*10*1000*1000L;
+    ref.lng = info.lon_degrees*10*1000*1000L;
+    ref.offset(info.grid_idx_x * TERRAIN_GRID_BLOCK_SPACING_X * (float)grid_spacing,
+               info.grid_idx_y * TERRAIN_GRID_BLOCK_SPACING_Y * (float)grid_spacing);
+    info.grid_lat = ref.lat;
+    info.grid_lon = ref.lng;
+}
+
 
 /*
-  find a grid structure given a grid_info
+  find a cache index given a grid_info, returning -1 if not cached
  */
-AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info)
+int16_t AP_Terrain::lookup_grid_cache(const struct grid_info &info) const
 {
-    uint16_t oldest_i = 0;
-
-    // see if we have that grid
     for (uint16_t i=0; i<cache_size; i++) {
         if (TERRAIN_LATLON_EQUAL(cache[i].grid.lat,info.grid_lat) &&
             TERRAIN_LATLON_EQUAL(cache[i].grid.lon,info.grid_lon) &&
             cache[i].grid.spacing == grid_spacing) {
-            cache[i].last_access_ms = AP_HAL::millis();
-            return cache[i];
-        }
-        if (cache[i].last_access_ms < cache[oldest_i].last_access_ms) {
-            oldest_i = i;
+            return i;
         }
     }
+    return -1;
+}
 
-    // Not found. Use the oldest grid and make it this grid,
-    // initially unpopulated
-    struct grid_cache &grid = cache[oldest_i];
+/*
+  setup a cache slot for a grid_info, initially unpopulated
+ */
+AP_Terrain::grid_cache &AP_Terrain::init_grid_cache(uint16_t idx, const struct grid_info &info)
+{
+    struct grid_cache &grid = cache[idx];
     memset(&grid, 0, sizeof(grid));
 
     grid.grid.lat = info.grid_lat;
@@ -142,9 +160,80 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
     // mark as waiting for disk read
     grid.state = GRID_CACHE_DISKWAIT;
 
+#if AP_TERRAIN_MMAP_ENABLED
+    if (options.get() & uint16_t(Options::MmapStore)) {
+        // try to satisfy the read directly from the mapped file
+        load_from_mmap(grid);
+    }
+#endif
+
     return grid;
 }
 
+/*
+  find a grid structure given a grid_info
+ */
+AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info)
+{
+    // see if we have that grid
+    const int16_t idx = lookup_grid_cache(info);
+    if (idx != -1) {
+        cache_hits++;
+        cache[idx].last_access_ms = AP_HAL::millis();
+        return cache[idx];
+    }
+    cache_misses++;
+
+    // Not found. Use the least recently used grid and make it this
+    // grid. Grids with pending disk writes are only replaced if
+    // there is nothing else available
+    uint16_t oldest_i = 0;
+    bool oldest_dirty = true;
+    for (uint16_t i=0; i<cache_size; i++) {
+        const bool dirty = (cache[i].state == GRID_CACHE_DIRTY);
+        if ((oldest_dirty && !dirty) ||
+            (dirty == oldest_dirty && cache[i].last_access_ms < cache[oldest_i].last_access_ms)) {
+            oldest_i = i;
+            oldest_dirty = dirty;
+        }
+    }
+
+    return init_grid_cache(oldest_i, info);
+}
+
+/*
+  start loading a grid into the cache for read-ahead. Only slots that
+  are unused, or have not been accessed recently and have no pending
+  writes, are reused so that prefetching never evicts grids the
+  vehicle is currently flying over
+ */
+bool AP_Terrain::prefetch_grid(const struct grid_info &info)
+{
+    if (lookup_grid_cache(info) != -1) {
+        return true;
+    }
+    const uint32_t now = AP_HAL::millis();
+    int16_t slot = -1;
+    for (uint16_t i=0; i<cache_size; i++) {
+        if (cache[i].state == GRID_CACHE_INVALID) {
+            slot = i;
+            break;
+        }
+        if (cache[i].state != GRID_CACHE_VALID ||
+            now - cache[i].last_access_ms < TERRAIN_PREFETCH_MIN_AGE_MS) {
+            continue;
+        }
+        if (slot == -1 || cache[i].last_access_ms < cache[slot].last_access_ms) {
+            slot = i;
+        }
+    }
+    if (slot == -1) {
+        return false;
+    }
+    init_grid_cache(slot, info);
+    return true;
+}
+
 /*
   find cache index of disk_block
  */
@@ -0,0 +1,94 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_AHRS/AP_AHRS_DCM.h>
+#include <AP_Baro/AP_Baro.h>
+#include <AP_Compass/AP_Compass.h>
+#include <AP_GPS/AP_GPS.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_Mission/AP_Mission.h>
+#include <AP_Terrain/AP_Terrain.h>
+#include <GCS_MAVLink/GCS_Dummy.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+const struct AP_Param::GroupInfo        GCS_MAVLINK_Parameters::var_info[] = {
+    AP_GROUPEND
+};
+
+#if AP_TERRAIN_AVAILABLE
+
+/*
+  compare looking up the terrain height of points along a path one at
+  a time against the batched lookup. The path is 200 points at 50m
+  spacing, crossing several grid blocks. No terrain data is loaded,
+  so this measures the grid lookup cost which the batch API shares
+  between points
+ */
+
+class MissionCallbacks {
+public:
+    bool cmd(const AP_Mission::Mission_Command &) { return true; }
+    void complete(void) {}
+};
+
+static MissionCallbacks callbacks;
+
+static AP_InertialSensor ins;
+static AP_Baro baro;
+static AP_GPS gps;
+static Compass compass;
+static AP_AHRS_DCM ahrs;
+static GCS_Dummy _gcs;
+static AP_Mission mission{
+    FUNCTOR_BIND(&callbacks, &MissionCallbacks::cmd, bool, const AP_Mission::Mission_Command &),
+    FUNCTOR_BIND(&callbacks, &MissionCallbacks::cmd, bool, const AP_Mission::Mission_Command &),
+    FUNCTOR_BIND(&callbacks, &MissionCallbacks::complete, void)};
+static AP_Terrain terrain{mission};
+
+static const uint16_t num_points = 200;
+static Location path[num_points];
+
+static void setup_path(void)
+{
+    Location loc;
+    loc.lat = -353632610;
+    loc.lng = 1491652300;
+    for (uint16_t i=0; i<num_points; i++) {
+        path[i] = loc;
+        loc.offset_bearing(60, 50);
+    }
+}
+
+static void BM_TerrainHeightPerPoint(benchmark::State& state)
+{
+    setup_path();
+    float height;
+    while (state.KeepRunning()) {
+        for (uint16_t i=0; i<num_points; i++) {
+            bool ok = terrain.height_amsl(path[i], height, false);
+            gbenchmark_escape(&ok);
+        }
+        gbenchmark_escape(&height);
+    }
+    state.SetItemsProcessed(state.iterations() * num_points);
+}
+
+static void BM_TerrainHeightBatch(benchmark::State& state)
+{
+    setup_path();
+    float heights[num_points];
+    bool valid[num_points];
+    while (state.KeepRunning()) {
+        uint16_t n = terrain.height_amsl(path, num_points, heights, valid, false);
+        gbenchmark_escape(&n);
+        gbenchmark_escape(heights);
+    }
+    state.SetItemsProcessed(state.iterations() * num_points);
+}
+
+BENCHMARK(BM_TerrainHeightPerPoint);
+BENCHMARK(BM_TerrainHeightBatch);
+
+#endif // AP_TERRAIN_AVAILABLE
+
+BENCHMARK_MAIN();
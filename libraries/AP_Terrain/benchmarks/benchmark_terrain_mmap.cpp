@@ -0,0 +1,87 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Terrain/TerrainMmap.h>
+
+#if AP_TERRAIN_MMAP_ENABLED
+
+#include <fcntl.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+  compare lookups of 2k terrain blocks through a memory mapped degree
+  file against the lseek/read path used by the terrain IO thread. The
+  file is 16MB, which is a large cached area of about 8000 grid
+  blocks, and is in the page cache for both benchmarks
+ */
+
+static const uint32_t block_size = 2048;
+static const uint32_t num_blocks = 8192;
+
+static int create_degree_file(void)
+{
+    char path[] = "/tmp/terrain_benchXXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        return -1;
+    }
+    unlink(path);
+    uint8_t block[block_size];
+    for (uint32_t i=0; i<num_blocks; i++) {
+        memset(block, i & 0xFF, sizeof(block));
+        if (write(fd, block, sizeof(block)) != (ssize_t)sizeof(block)) {
+            close(fd);
+            return -1;
+        }
+    }
+    return fd;
+}
+
+static void BM_TerrainBlockMmap(benchmark::State& state)
+{
+    int fd = create_degree_file();
+    AP_Terrain_Mmap store;
+    if (fd == -1 || !store.map_file(fd, -35, 149)) {
+        state.SkipWithError("unable to map terrain file");
+        return;
+    }
+    uint8_t block[block_size];
+    uint32_t blocknum = 0;
+
+    while (state.KeepRunning()) {
+        blocknum = (blocknum + 97) % num_blocks;
+        store.read(-35, 149, blocknum * block_size, block, sizeof(block));
+        gbenchmark_escape(block);
+    }
+    state.SetItemsProcessed(state.iterations());
+    close(fd);
+}
+
+static void BM_TerrainBlockRead(benchmark::State& state)
+{
+    int fd = create_degree_file();
+    if (fd == -1) {
+        state.SkipWithError("unable to create terrain file");
+        return;
+    }
+    uint8_t block[block_size];
+    uint32_t blocknum = 0;
+
+    while (state.KeepRunning()) {
+        blocknum = (blocknum + 97) % num_blocks;
+        lseek(fd, blocknum * block_size, SEEK_SET);
+        ssize_t ret = read(fd, block, sizeof(block));
+        gbenchmark_escape(&ret);
+        gbenchmark_escape(block);
+    }
+    state.SetItemsProcessed(state.iterations());
+    close(fd);
+}
+
+BENCHMARK(BM_TerrainBlockMmap);
+BENCHMARK(BM_TerrainBlockRead);
+
+#endif // AP_TERRAIN_MMAP_ENABLED
+
+BENCHMARK_MAIN();
@@ -18,6 +18,11 @@ MAV_MISSION_RESULT MissionItemProtocol_Fence::get_item(const GCS_MAVLINK &_link,
         return MAV_MISSION_ERROR;
     }
 
+    return convert_AC_PolyFenceItem_to_MISSION_ITEM_INT(fenceitem, ret_packet);
+}
+
+MAV_MISSION_RESULT MissionItemProtocol_Fence::convert_AC_PolyFenceItem_to_MISSION_ITEM_INT(const AC_PolyFenceItem &fenceitem, mavlink_mission_item_int_t &ret)
+{
     MAV_CMD ret_cmd = MAV_CMD_NAV_FENCE_POLYGON_VERTEX_INCLUSION; // initialised to avoid compiler warning
     float p1 = 0;
     switch (fenceitem.type) {
@@ -44,11 +49,11 @@ MAV_MISSION_RESULT MissionItemProtocol_Fence::get_item(const GCS_MAVLINK &_link,
         return MAV_MISSION_ERROR;
     }
 
-    ret_packet.command = ret_cmd;
-    ret_packet.param1 = p1;
-    ret_packet.x = fenceitem.loc.x;
-    ret_packet.y = fenceitem.loc.y;
-    ret_packet.z = 0;
+    ret.command = ret_cmd;
+    ret.param1 = p1;
+    ret.x = fenceitem.loc.x;
+    ret.y = fenceitem.loc.y;
+    ret.z = 0;
 
     return MAV_MISSION_ACCEPTED;
 }
@@ -61,7 +66,7 @@ uint16_t MissionItemProtocol_Fence::item_count() const
     return _fence.polyfence().num_stored_items();
 }
 
-static MAV_MISSION_RESULT convert_MISSION_ITEM_INT_to_AC_PolyFenceItem(const mavlink_mission_item_int_t &mission_item_int, AC_PolyFenceItem &ret)
+MAV_MISSION_RESULT MissionItemProtocol_Fence::convert_MISSION_ITEM_INT_to_AC_PolyFenceItem(const mavlink_mission_item_int_t &mission_item_int, AC_PolyFenceItem &ret)
 {
     if (mission_item_int.frame != MAV_FRAME_GLOBAL &&
         mission_item_int.frame != MAV_FRAME_GLOBAL_INT &&
@@ -17,6 +17,11 @@ public:
     MAV_MISSION_RESULT complete(const GCS_MAVLINK &_link) override;
     void timeout() override;
 
+    // fill in the MISSION_ITEM_INT fields describing a stored fence item
+    static MAV_MISSION_RESULT convert_AC_PolyFenceItem_to_MISSION_ITEM_INT(const class AC_PolyFenceItem &fenceitem, mavlink_mission_item_int_t &ret) WARN_IF_UNUSED;
+    // and the reverse
+    static MAV_MISSION_RESULT convert_MISSION_ITEM_INT_to_AC_PolyFenceItem(const mavlink_mission_item_int_t &mission_item_int, class AC_PolyFenceItem &ret) WARN_IF_UNUSED;
+
 protected:
 
     ap_message next_item_ap_message_id() const override {
@@ -83,15 +83,20 @@ MAV_MISSION_RESULT MissionItemProtocol_Rally::get_item(const GCS_MAVLINK &_link,
         return MAV_MISSION_INVALID_SEQUENCE;
     }
 
-    ret_packet.frame = MAV_FRAME_GLOBAL_RELATIVE_ALT;
-    ret_packet.command = MAV_CMD_NAV_RALLY_POINT;
-    ret_packet.x = rallypoint.lat;
-    ret_packet.y = rallypoint.lng;
-    ret_packet.z = rallypoint.alt;
+    convert_RallyLocation_to_MISSION_ITEM_INT(rallypoint, ret_packet);
 
     return MAV_MISSION_ACCEPTED;
 }
 
+void MissionItemProtocol_Rally::convert_RallyLocation_to_MISSION_ITEM_INT(const RallyLocation &rallypoint, mavlink_mission_item_int_t &ret)
+{
+    ret.frame = MAV_FRAME_GLOBAL_RELATIVE_ALT;
+    ret.command = MAV_CMD_NAV_RALLY_POINT;
+    ret.x = rallypoint.lat;
+    ret.y = rallypoint.lng;
+    ret.z = rallypoint.alt;
+}
+
 uint16_t MissionItemProtocol_Rally::item_count() const {
     return rally.get_rally_total();
 }
@@ -12,6 +12,11 @@ public:
     MAV_MISSION_RESULT complete(const GCS_MAVLINK &_link) override;
     void timeout() override;
 
+    // fill in the MISSION_ITEM_INT fields describing a rally point
+    static void convert_RallyLocation_to_MISSION_ITEM_INT(const class RallyLocation &rallypoint, mavlink_mission_item_int_t &ret);
+    // and the reverse
+    static MAV_MISSION_RESULT convert_MISSION_ITEM_INT_to_RallyLocation(const mavlink_mission_item_int_t &cmd, class RallyLocation &ret) WARN_IF_UNUSED;
+
 protected:
 
     ap_message next_item_ap_message_id() const override {
@@ -33,6 +38,4 @@ private:
                                 const mavlink_mission_request_int_t &packet,
                                 mavlink_mission_item_int_t &ret_packet) override WARN_IF_UNUSED;
 
-    static MAV_MISSION_RESULT convert_MISSION_ITEM_INT_to_RallyLocation(const mavlink_mission_item_int_t &cmd, class RallyLocation &ret) WARN_IF_UNUSED;
-
 };
@@ -288,6 +288,20 @@ void Frame::init(float _mass, float _hover_throttle, float _terminal_velocity, f
 
     terminal_velocity = _terminal_velocity;
     terminal_rotation_rate = _terminal_rotation_rate;
+
+    geometry.fixed = num_motors <= SIM_FRAME_MAX_MOTORS;
+    for (uint8_t i=0; i<num_motors && geometry.fixed; i++) {
+        const Motor &m = motors[i];
+        if (m.can_tilt()) {
+            geometry.fixed = false;
+            break;
+        }
+        // same arm as Motor::calculate_forces()
+        geometry.servo[i] = m.servo;
+        geometry.arm_x[i] = Motor::arm_scale * cosf(radians(m.angle));
+        geometry.arm_y[i] = Motor::arm_scale * sinf(radians(m.angle));
+        geometry.yaw_factor[i] = m.yaw_factor;
+    }
 }
 
 /*
@@ -318,14 +332,15 @@ void Frame::calculate_forces(const Aircraft &aircraft,
     // scale thrust for altitude
     float scaling = thrust_scale * AP::baro().get_air_density_ratio();
 
-    for (uint8_t i=0; i<num_motors; i++) {
-        Vector3f mraccel, mthrust;
-        motors[i].calculate_forces(input, scaling, motor_offset, mraccel, mthrust);
-        rot_accel += mraccel;
-        thrust += mthrust;
-        // simulate motor rpm
-        if (!is_zero(AP::sitl()->vibe_motor)) {
-            rpm[i] = sqrtf(mthrust.length() / scaling) * AP::sitl()->vibe_motor * 60.0f;
+    Vector3f motor_rot_accel;
+    float motor_speed[SIM_FRAME_MAX_MOTORS];
+    calculate_motor_forces(input, scaling, motor_rot_accel, thrust, motor_speed);
+    rot_accel += motor_rot_accel;
+
+    // simulate motor rpm
+    if (!is_zero(AP::sitl()->vibe_motor)) {
+        for (uint8_t i=0; i<num_motors; i++) {
+            rpm[i] = sqrtf(motor_speed[i]) * AP::sitl()->vibe_motor * 60.0f;
         }
     }
 
@@ -358,16 +373,64 @@ void Frame::calculate_forces(const Aircraft &aircraft,
 }
 
 
+/*
+  sum the forces from all motors. Untilted motor i at speed s has
+  thrust (0, 0, -s) and an arm in the XY plane, so arm % thrust is
+  (-arm_y*s, arm_x*s, 0); with the geometry precomputed that makes one
+  branch free pass over the motors. Frames with tilting motors use the
+  full per motor model
+ */
+void Frame::calculate_motor_forces(const struct sitl_input &input, float scaling,
+                                   Vector3f &rot_accel, Vector3f &thrust, float *motor_speed)
+{
+    rot_accel.zero();
+    thrust.zero();
+
+    if (!geometry.fixed) {
+        for (uint8_t i=0; i<num_motors; i++) {
+            Vector3f mraccel, mthrust;
+            motors[i].calculate_forces(input, scaling, motor_offset, mraccel, mthrust);
+            rot_accel += mraccel;
+            thrust += mthrust;
+            motor_speed[i] = mthrust.length() / scaling;
+        }
+        return;
+    }
+
+    for (uint8_t i=0; i<num_motors; i++) {
+        motor_speed[i] = constrain_float((input.servos[motor_offset+geometry.servo[i]]-1100)/900.0, 0, 1);
+    }
+
+    float rx = 0, ry = 0, rz = 0, tz = 0;
+    for (uint8_t i=0; i<num_motors; i++) {
+        const float s = motor_speed[i];
+        rx -= geometry.arm_y[i] * s;
+        ry += geometry.arm_x[i] * s;
+        rz += geometry.yaw_factor[i] * s * Motor::yaw_scale;
+        tz -= s * scaling;
+    }
+    rot_accel = Vector3f(rx, ry, rz);
+    thrust = Vector3f(0, 0, tz);
+}
+
 // calculate current and voltage
 void Frame::current_and_voltage(const struct sitl_input &input, float &voltage, float &current)
 {
     voltage = 0;
     current = 0;
+
+    SITL *sitl = AP::sitl();
+    const float batt_voltage = sitl != nullptr ? sitl->batt_voltage : 0;
     for (uint8_t i=0; i<num_motors; i++) {
-        float c, v;
-        motors[i].current_and_voltage(input, v, c, motor_offset);
-        current += c;
-        voltage += v;
+        // get motor speed from 0 to 1
+        const float motor_speed = constrain_float((input.servos[motor_offset+motors[i].servo]-1100)/900.0, 0, 1);
+
+        // assume 10A per motor at full speed
+        current += 10 * motor_speed;
+
+        // assume 3S, and full throttle drops voltage by 0.7V
+        const float motor_voltage = batt_voltage - motor_speed * 0.7;
+        voltage += motor_voltage;
     }
     // use average for voltage, total for current
     voltage /= num_motors;
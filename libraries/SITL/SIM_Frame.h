@@ -21,6 +21,8 @@
 #include "SIM_Aircraft.h"
 #include "SIM_Motor.h"
 
+#define SIM_FRAME_MAX_MOTORS 12
+
 namespace SITL {
 
 /*
@@ -50,7 +52,14 @@ public:
     void calculate_forces(const Aircraft &aircraft,
                           const struct sitl_input &input,
                           Vector3f &rot_accel, Vector3f &body_accel, float* rpm);
-    
+
+    /*
+      total thrust (N, body frame) and rotational acceleration from
+      all motors, with the speed of each motor from 0 to 1
+     */
+    void calculate_motor_forces(const struct sitl_input &input, float scaling,
+                                Vector3f &rot_accel, Vector3f &thrust, float *motor_speed);
+
     float terminal_velocity;
     float terminal_rotation_rate;
     float thrust_scale;
@@ -58,5 +67,18 @@ public:
 
     // calculate current and voltage
     void current_and_voltage(const struct sitl_input &input, float &voltage, float &current);
+
+private:
+    /*
+      motor geometry precomputed by init() as arrays, so frames without
+      tilting motors need one pass over all motors and no trig per step
+     */
+    struct {
+        bool fixed;  // no motor can tilt
+        uint8_t servo[SIM_FRAME_MAX_MOTORS];
+        float arm_x[SIM_FRAME_MAX_MOTORS];
+        float arm_y[SIM_FRAME_MAX_MOTORS];
+        float yaw_factor[SIM_FRAME_MAX_MOTORS];
+    } geometry;
 };
 }
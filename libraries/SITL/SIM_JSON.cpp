@@ -64,6 +64,16 @@ JSON::JSON(const char *frame_str) :
     if (colon) {
         target_ip = colon+1;
     }
+    if (strncmp(target_ip, "shm", 3) == 0 && (target_ip[3] == '\0' || target_ip[3] == ':')) {
+        use_shm = true;
+        if (target_ip[3] == ':') {
+            shm_name = &target_ip[4];
+        }
+    }
+
+    if (!parser.init(keytable, ARRAY_SIZE(keytable))) {
+        AP_HAL::panic("JSON: unable to hash sensor keys");
+    }
 
     for (uint8_t i=0; i<ARRAY_SIZE(sim_defaults); i++) {
     AP_Param::set_default_by_name(sim_defaults[i].name, sim_defaults[i].value);
@@ -82,6 +92,10 @@ JSON::JSON(const char *frame_str) :
 */
 void JSON::set_interface_ports(const char* address, const int port_in, const int port_out)
 {
+    if (use_shm) {
+        return;
+    }
+
     sock.set_blocking(false);
     sock.reuseaddress();
 
@@ -93,11 +107,43 @@ void JSON::set_interface_ports(const char* address, const int port_in, const int
     printf("JSON control interface set to %s:%u\n", target_ip, control_port);
 }
 
+/*
+    Create the shared memory segment, named for the SITL instance
+    unless a name was given
+*/
+bool JSON::open_shm()
+{
+    char name[64];
+    if (shm_name != nullptr) {
+        strncpy(name, shm_name, sizeof(name));
+        name[sizeof(name)-1] = 0;
+    } else {
+        snprintf(name, sizeof(name), "%s_%u", SIM_SHM_DEFAULT_NAME, (unsigned)instance);
+    }
+    if (!shm.open(name, SHMLink::Role::SITL)) {
+        printf("Unable to create JSON shared memory %s - Error: %s\n", name, strerror(errno));
+        return false;
+    }
+    printf("JSON shared memory interface at %s\n", name);
+    return true;
+}
+
 /*
     Decode and send servos
 */
 void JSON::output_servos(const struct sitl_input &input)
 {
+    if (use_shm) {
+        SHMLink::servo_frame frame;
+        frame.frame_rate = rate_hz;
+        frame.frame_count = frame_counter;
+        memcpy(frame.pwm, input.servos, sizeof(frame.pwm));
+        // this only fails if the physics backend has stopped reading
+        // and the ring is full, recv_fdm() will resend
+        shm.send_servos(frame);
+        return;
+    }
+
     servo_packet pkt;
     pkt.frame_rate = rate_hz;
     pkt.frame_count = frame_counter;
@@ -118,92 +164,10 @@ void JSON::output_servos(const struct sitl_input &input)
 
 
 /*
-    very simple JSON parser for sensor data
-    called with pointer to one row of sensor data, nul terminated
-
-    This parser does not do any syntax checking, and is not at all
-    general purpose
-*/
-uint16_t JSON::parse_sensors(const char *json)
-{
-    uint16_t received_bitmask = 0;
-
-    //printf("%s\n", json);
-    for (uint16_t i=0; i<ARRAY_SIZE(keytable); i++) {
-        struct keytable &key = keytable[i];
-
-        /* look for section header */
-        const char *p = strstr(json, key.section);
-        if (!p) {
-            // we don't have this sensor
-            if (key.required) {
-                printf("Failed to find %s\n", key.section);
-                return 0;
-            }
-            continue;
-        }
-        p += strlen(key.section)+1;
-
-        // find key inside section
-        p = strstr(p, key.key);
-        if (!p) {
-            if (key.required) {
-                printf("Failed to find key %s/%s\n", key.section, key.key);
-                return 0;
-            }
-            continue;
-        }
-
-        // record the keys that are found
-        received_bitmask |= 1U << i;
-
-        p += strlen(key.key)+2;
-        switch (key.type) {
-            case DATA_UINT64:
-                *((uint64_t *)key.ptr) = strtoull(p, nullptr, 10);
-                //printf("%s/%s = %lu\n", key.section, key.key, *((uint64_t *)key.ptr));
-                break;
-
-            case DATA_FLOAT:
-                *((float *)key.ptr) = atof(p);
-                //printf("%s/%s = %f\n", key.section, key.key, *((float *)key.ptr));
-                break;
-
-            case DATA_DOUBLE:
-                *((double *)key.ptr) = atof(p);
-                //printf("%s/%s = %f\n", key.section, key.key, *((double *)key.ptr));
-                break;
-
-            case DATA_VECTOR3F: {
-                Vector3f *v = (Vector3f *)key.ptr;
-                if (sscanf(p, "[%f, %f, %f]", &v->x, &v->y, &v->z) != 3) {
-                    printf("Failed to parse Vector3f for %s/%s\n", key.section, key.key);
-                    return received_bitmask;
-                }
-                //printf("%s/%s = %f, %f, %f\n", key.section, key.key, v->x, v->y, v->z);
-                break;
-            }
-
-            case QUATERNION: {
-                Quaternion *v = static_cast<Quaternion*>(key.ptr);
-                if (sscanf(p, "[%f, %f, %f, %f]", &(v->q1), &(v->q2), &(v->q3), &(v->q4)) != 4) {
-                    printf("Failed to parse Vector4f for %s/%s\n", key.section, key.key);
-                    return received_bitmask;
-                }
-                break;
-            }
-
-        }
-    }
-
-    return received_bitmask;
-}
-
-/*
-    Receive new sensor data from simulator
+    Receive new sensor data in JSON or binary format from the socket
     This is a blocking function
 */
-void JSON::recv_fdm(const struct sitl_input &input)
+uint16_t JSON::recv_json(const struct sitl_input &input)
 {
     // Receive sensor packet
     ssize_t ret = sock.recv(&sensor_buffer[sensor_buffer_len], sizeof(sensor_buffer)-sensor_buffer_len, UDP_TIMEOUT_MS);
@@ -220,6 +184,12 @@ void JSON::recv_fdm(const struct sitl_input &input)
         }
     }
 
+    // binary frames are one per datagram and need no parsing
+    SHMLink::fdm_frame frame;
+    if (JSONParser::parse_binary(&sensor_buffer[sensor_buffer_len], ret, frame)) {
+        return decode_fdm_frame(frame);
+    }
+
     // convert '\n' into nul
     while (uint8_t *p = (uint8_t *)memchr(&sensor_buffer[sensor_buffer_len], '\n', ret)) {
         *p = 0;
@@ -228,24 +198,89 @@ void JSON::recv_fdm(const struct sitl_input &input)
 
     const uint8_t *p2 = (const uint8_t *)memrchr(sensor_buffer, 0, sensor_buffer_len);
     if (p2 == nullptr || p2 == sensor_buffer) {
-        return;
+        return 0;
     }
 
     const uint8_t *p1 = (const uint8_t *)memrchr(sensor_buffer, 0, p2 - sensor_buffer);
     if (p1 == nullptr) {
-        return;
+        return 0;
     }
 
-    const uint16_t received_bitmask = parse_sensors((const char *)(p1+1));
+    const uint16_t received_bitmask = parser.parse((const char *)(p1+1));
     if (received_bitmask == 0) {
         // did not receve one of the mandatory fields
         printf("Did not contain all mandatory fields\n");
-        return;
+        return 0;
     }
 
     // Must get either attitude or quaternion fields
     if ((received_bitmask & (EULER_ATT | QUAT_ATT)) == 0) {
         printf("Did not receive attitude or quaternion\n");
+        return 0;
+    }
+
+    memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
+    sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
+
+    return received_bitmask;
+}
+
+/*
+    Receive new sensor data in binary format from shared memory
+    This is a blocking function
+*/
+uint16_t JSON::recv_shm(const struct sitl_input &input)
+{
+    SHMLink::fdm_frame frame;
+    uint32_t wait_ms = 0;
+    while (true) {
+        if (shm.recv_fdm(frame, UDP_TIMEOUT_MS*1000)) {
+            if (frame.frame_count == frame_counter) {
+                break;
+            }
+            // stale reply to a resent servo frame
+            continue;
+        }
+        wait_ms += UDP_TIMEOUT_MS;
+        // same resend logic as the socket interface
+        if (wait_ms > 1000) {
+            wait_ms = 0;
+            printf("No JSON sensor message received, resending servos\n");
+            output_servos(input);
+        }
+    }
+
+    return decode_fdm_frame(frame);
+}
+
+/*
+    Copy a binary sensor frame into the same state the JSON parser fills
+*/
+uint16_t JSON::decode_fdm_frame(const SHMLink::fdm_frame &frame)
+{
+    state.timestamp_s = frame.timestamp_s;
+    state.imu.gyro = Vector3f(frame.gyro[0], frame.gyro[1], frame.gyro[2]);
+    state.imu.accel_body = Vector3f(frame.accel_body[0], frame.accel_body[1], frame.accel_body[2]);
+    state.position = Vector3f(frame.position[0], frame.position[1], frame.position[2]);
+    state.velocity = Vector3f(frame.velocity[0], frame.velocity[1], frame.velocity[2]);
+    state.quaternion = Quaternion(frame.quaternion[0], frame.quaternion[1], frame.quaternion[2], frame.quaternion[3]);
+    memcpy(state.rng, frame.rng, sizeof(state.rng));
+    state.wind_vane_apparent.direction = frame.wind_vane_direction;
+    state.wind_vane_apparent.speed = frame.wind_vane_speed;
+
+    // the optional field flags are in the same order as RNG_1 to WIND_SPD
+    return TIMESTAMP | GYRO | ACCEL_BODY | POSITION | QUAT_ATT | VELOCITY |
+        ((frame.flags & 0xFF) << 7);
+}
+
+/*
+    Receive new sensor data from simulator
+    This is a blocking function
+*/
+void JSON::recv_fdm(const struct sitl_input &input)
+{
+    const uint16_t received_bitmask = use_shm ? recv_shm(input) : recv_json(input);
+    if (received_bitmask == 0) {
         return;
     }
 
@@ -267,9 +302,6 @@ void JSON::recv_fdm(const struct sitl_input &input)
     }
     last_received_bitmask = received_bitmask;
 
-    memmove(sensor_buffer, p2, sensor_buffer_len - (p2 - sensor_buffer));
-    sensor_buffer_len = sensor_buffer_len - (p2 - sensor_buffer);
-
     accel_body = state.imu.accel_body;
     gyro = state.imu.gyro;
     velocity_ef = state.velocity;
@@ -403,6 +435,10 @@ void JSON::recv_fdm(const struct sitl_input &input)
 */
 void JSON::update(const struct sitl_input &input)
 {
+    if (use_shm && !shm.is_open() && !open_shm()) {
+        AP_HAL::panic("JSON: failed to create shared memory");
+    }
+
     // send to JSON model
     output_servos(input);
 
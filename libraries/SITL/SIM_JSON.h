@@ -16,6 +16,8 @@
 
 #include <AP_HAL/utility/Socket.h>
 #include "SIM_Aircraft.h"
+#include "SIM_SHM.h"
+#include "SIM_JSON_Parser.h"
 
 namespace SITL {
 
@@ -51,26 +53,26 @@ private:
 
     SocketAPM sock;
 
+    // shared memory link, used instead of sock with "JSON:shm[:name]"
+    bool use_shm;
+    const char *shm_name;
+    SHMLink shm;
+
     uint32_t frame_counter;
     double last_timestamp_s;
 
     void output_servos(const struct sitl_input &input);
     void recv_fdm(const struct sitl_input &input);
+    uint16_t recv_json(const struct sitl_input &input);
+    uint16_t recv_shm(const struct sitl_input &input);
+    bool open_shm();
 
-    uint16_t parse_sensors(const char *json);
+    uint16_t decode_fdm_frame(const SHMLink::fdm_frame &frame);
 
     // buffer for parsing pose data in JSON format
     uint8_t sensor_buffer[65000];
     uint32_t sensor_buffer_len;
 
-    enum data_type {
-        DATA_UINT64,
-        DATA_FLOAT,
-        DATA_DOUBLE,
-        DATA_VECTOR3F,
-        QUATERNION,
-    };
-
     struct {
         double timestamp_s;
         struct {
@@ -89,29 +91,24 @@ private:
     } state;
 
     // table to aid parsing of JSON sensor data
-    struct keytable {
-        const char *section;
-        const char *key;
-        void *ptr;
-        enum data_type type;
-        bool required;
-    } keytable[15] = {
-        { "", "timestamp", &state.timestamp_s, DATA_DOUBLE, true },
-        { "imu", "gyro",    &state.imu.gyro, DATA_VECTOR3F, true },
-        { "imu", "accel_body", &state.imu.accel_body, DATA_VECTOR3F, true },
-        { "", "position", &state.position, DATA_VECTOR3F, true },
-        { "", "attitude", &state.attitude, DATA_VECTOR3F, false },
-        { "", "quaternion", &state.quaternion, QUATERNION, false },
-        { "", "velocity", &state.velocity, DATA_VECTOR3F, true },
-        { "", "rng_1", &state.rng[0], DATA_FLOAT, false },
-        { "", "rng_2", &state.rng[1], DATA_FLOAT, false },
-        { "", "rng_3", &state.rng[2], DATA_FLOAT, false },
-        { "", "rng_4", &state.rng[3], DATA_FLOAT, false },
-        { "", "rng_5", &state.rng[4], DATA_FLOAT, false },
-        { "", "rng_6", &state.rng[5], DATA_FLOAT, false },
-        {"windvane","direction", &state.wind_vane_apparent.direction, DATA_FLOAT, false},
-        {"windvane","speed", &state.wind_vane_apparent.speed, DATA_FLOAT, false},
+    struct JSONParser::keytable keytable[15] = {
+        { "", "timestamp", &state.timestamp_s, JSONParser::DATA_DOUBLE, true },
+        { "imu", "gyro",    &state.imu.gyro, JSONParser::DATA_VECTOR3F, true },
+        { "imu", "accel_body", &state.imu.accel_body, JSONParser::DATA_VECTOR3F, true },
+        { "", "position", &state.position, JSONParser::DATA_VECTOR3F, true },
+        { "", "attitude", &state.attitude, JSONParser::DATA_VECTOR3F, false },
+        { "", "quaternion", &state.quaternion, JSONParser::QUATERNION, false },
+        { "", "velocity", &state.velocity, JSONParser::DATA_VECTOR3F, true },
+        { "", "rng_1", &state.rng[0], JSONParser::DATA_FLOAT, false },
+        { "", "rng_2", &state.rng[1], JSONParser::DATA_FLOAT, false },
+        { "", "rng_3", &state.rng[2], JSONParser::DATA_FLOAT, false },
+        { "", "rng_4", &state.rng[3], JSONParser::DATA_FLOAT, false },
+        { "", "rng_5", &state.rng[4], JSONParser::DATA_FLOAT, false },
+        { "", "rng_6", &state.rng[5], JSONParser::DATA_FLOAT, false },
+        {"windvane","direction", &state.wind_vane_apparent.direction, JSONParser::DATA_FLOAT, false},
+        {"windvane","speed", &state.wind_vane_apparent.speed, JSONParser::DATA_FLOAT, false},
     };
+    JSONParser parser;
 
     // Enum coresponding to the ordering of keys in the keytable.
     enum DataKey {
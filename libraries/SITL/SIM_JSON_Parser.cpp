@@ -0,0 +1,275 @@
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  single pass parser for JSON sensor frames
+ */
+
+#include "SIM_JSON_Parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AP_Math/AP_Math.h>
+
+using namespace SITL;
+
+// seeds to try before giving up on a collision free hash
+#define JSON_HASH_MAX_SEEDS 10000
+
+/*
+  FNV-1a over "section/key", with the seed folded into the offset
+  basis and a final multiply so the top bits are well mixed
+ */
+uint32_t JSONParser::hash(const char *section, uint8_t section_len,
+                          const char *key, uint8_t key_len, uint32_t seed)
+{
+    uint32_t h = 2166136261U ^ seed;
+    for (uint8_t i=0; i<section_len; i++) {
+        h = (h ^ (uint8_t)section[i]) * 16777619U;
+    }
+    h = (h ^ '/') * 16777619U;
+    for (uint8_t i=0; i<key_len; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619U;
+    }
+    return (h * 0x9E3779B1U) >> (32 - HASH_BITS);
+}
+
+bool JSONParser::init(const struct keytable *table, uint8_t count)
+{
+    _table = table;
+    _count = count;
+    if (count > 32) {
+        return false;
+    }
+
+    for (_seed=0; _seed<JSON_HASH_MAX_SEEDS; _seed++) {
+        memset(_slots, 0, sizeof(_slots));
+        uint8_t i;
+        for (i=0; i<count; i++) {
+            const uint32_t slot = hash(table[i].section, strlen(table[i].section),
+                                       table[i].key, strlen(table[i].key), _seed);
+            if (_slots[slot] != 0) {
+                break;
+            }
+            _slots[slot] = i + 1;
+        }
+        if (i == count) {
+            return true;
+        }
+    }
+
+    _count = 0;
+    memset(_slots, 0, sizeof(_slots));
+    return false;
+}
+
+uint8_t JSONParser::slot(const char *section, const char *key) const
+{
+    return hash(section, strlen(section), key, strlen(key), _seed);
+}
+
+/*
+  return the keytable index for a key, or -1 if it is not known
+ */
+int8_t JSONParser::lookup(const char *section, uint8_t section_len,
+                          const char *key, uint8_t key_len) const
+{
+    const uint8_t idx = _slots[hash(section, section_len, key, key_len, _seed)];
+    if (idx == 0) {
+        return -1;
+    }
+    // the hash is only perfect for known keys, so confirm the match
+    const struct keytable &k = _table[idx-1];
+    if (strncmp(k.section, section, section_len) != 0 || k.section[section_len] != 0 ||
+        strncmp(k.key, key, key_len) != 0 || k.key[key_len] != 0) {
+        return -1;
+    }
+    return idx - 1;
+}
+
+/*
+  parse an array of n floats such as "[1.0, 2, -3e-2]"
+ */
+bool JSONParser::parse_floats(const char *&p, float *v, uint8_t n)
+{
+    if (*p != '[') {
+        return false;
+    }
+    p++;
+    for (uint8_t i=0; i<n; i++) {
+        char *end;
+        v[i] = strtof(p, &end);
+        if (end == p) {
+            return false;
+        }
+        p = end;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p != (i == n-1 ? ']' : ',')) {
+            return false;
+        }
+        p++;
+    }
+    return true;
+}
+
+bool JSONParser::parse_value(const struct keytable &key, const char *&p) const
+{
+    char *end;
+    switch (key.type) {
+    case DATA_UINT64:
+        *((uint64_t *)key.ptr) = strtoull(p, &end, 10);
+        break;
+
+    case DATA_FLOAT:
+        *((float *)key.ptr) = strtof(p, &end);
+        break;
+
+    case DATA_DOUBLE:
+        *((double *)key.ptr) = strtod(p, &end);
+        break;
+
+    case DATA_VECTOR3F: {
+        Vector3f *v = (Vector3f *)key.ptr;
+        float f[3];
+        if (!parse_floats(p, f, 3)) {
+            return false;
+        }
+        *v = Vector3f(f[0], f[1], f[2]);
+        return true;
+    }
+
+    case QUATERNION: {
+        Quaternion *q = (Quaternion *)key.ptr;
+        float f[4];
+        if (!parse_floats(p, f, 4)) {
+            return false;
+        }
+        *q = Quaternion(f[0], f[1], f[2], f[3]);
+        return true;
+    }
+
+    default:
+        return false;
+    }
+
+    if (end == p) {
+        return false;
+    }
+    p = end;
+    return true;
+}
+
+uint32_t JSONParser::parse(const char *json) const
+{
+    uint32_t received_bitmask = 0;
+    uint8_t depth = 0;
+    const char *section = "";
+    uint8_t section_len = 0;
+
+    const char *p = json;
+    while (*p) {
+        switch (*p) {
+        case '{':
+            depth++;
+            p++;
+            break;
+
+        case '}':
+            if (depth > 0) {
+                depth--;
+            }
+            if (depth <= 1) {
+                section = "";
+                section_len = 0;
+            }
+            p++;
+            break;
+
+        case '"': {
+            const char *str = p + 1;
+            const char *str_end = strchr(str, '"');
+            if (str_end == nullptr) {
+                p = str + strlen(str);
+                break;
+            }
+            p = str_end + 1;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (*p != ':') {
+                // a string value, nothing we know about
+                break;
+            }
+            p++;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            const uint8_t str_len = MIN(str_end - str, 255);
+            if (*p == '{') {
+                if (depth == 1) {
+                    section = str;
+                    section_len = str_len;
+                }
+                break;
+            }
+            if (depth == 0 || depth > 2) {
+                break;
+            }
+            const int8_t i = lookup(section, section_len, str, str_len);
+            if (i < 0) {
+                break;
+            }
+            const struct keytable &key = _table[i];
+            if (!parse_value(key, p)) {
+                printf("Failed to parse %s/%s\n", key.section, key.key);
+                return 0;
+            }
+            // record the keys that are found
+            received_bitmask |= 1U << i;
+            break;
+        }
+
+        default:
+            p++;
+            break;
+        }
+    }
+
+    for (uint8_t i=0; i<_count; i++) {
+        if (_table[i].required && (received_bitmask & (1U << i)) == 0) {
+            printf("Failed to find %s/%s\n", _table[i].section, _table[i].key);
+            return 0;
+        }
+    }
+
+    return received_bitmask;
+}
+
+bool JSONParser::parse_binary(const uint8_t *buf, size_t len, SHMLink::fdm_frame &frame)
+{
+    if (len != sizeof(fdm_packet)) {
+        return false;
+    }
+    fdm_packet pkt;
+    memcpy(&pkt, buf, sizeof(pkt));
+    if (pkt.magic != FDM_PACKET_MAGIC || pkt.length != sizeof(pkt)) {
+        return false;
+    }
+    frame = pkt.frame;
+    return true;
+}
@@ -0,0 +1,100 @@
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  single pass parser for the JSON sensor frames sent by external
+  physics simulators.
+
+  Known keys are looked up through a perfect hash built once from the
+  key table, so each frame is scanned once regardless of the number of
+  keys. Like the parser it replaces it is not a general purpose JSON
+  parser: only objects nested two deep are understood, and values of
+  unknown keys are skipped.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SIM_SHM.h"
+
+namespace SITL {
+
+class JSONParser {
+public:
+    enum data_type {
+        DATA_UINT64,
+        DATA_FLOAT,
+        DATA_DOUBLE,
+        DATA_VECTOR3F,
+        QUATERNION,
+    };
+
+    struct keytable {
+        const char *section; // "" for top level keys
+        const char *key;
+        void *ptr;
+        enum data_type type;
+        bool required;
+    };
+
+    /*
+      build the hash for a table of up to 32 keys, returns false if
+      no collision free hash was found
+     */
+    bool init(const struct keytable *table, uint8_t count);
+
+    /*
+      parse one nul terminated frame, returning a bitmask of the keys
+      found in table order, or 0 if a required key is missing or a
+      known key's value can't be parsed
+     */
+    uint32_t parse(const char *json) const;
+
+    // binary alternative to a JSON sensor frame, one per datagram
+    struct fdm_packet {
+        uint32_t magic;  // FDM_PACKET_MAGIC
+        uint32_t length; // sizeof(fdm_packet)
+        SHMLink::fdm_frame frame;
+    };
+    static const uint32_t FDM_PACKET_MAGIC = 0x4E534A42; // "BJSN"
+
+    /*
+      copy out the frame if a datagram is a binary sensor frame,
+      returns false if it isn't
+     */
+    static bool parse_binary(const uint8_t *buf, size_t len, SHMLink::fdm_frame &frame);
+
+    static const uint8_t HASH_BITS = 6;
+
+    // the hash slot of a key, for the seed the table was built with
+    uint8_t slot(const char *section, const char *key) const;
+
+private:
+    static uint32_t hash(const char *section, uint8_t section_len,
+                         const char *key, uint8_t key_len, uint32_t seed);
+    int8_t lookup(const char *section, uint8_t section_len,
+                  const char *key, uint8_t key_len) const;
+    static bool parse_floats(const char *&p, float *v, uint8_t n);
+    bool parse_value(const struct keytable &key, const char *&p) const;
+
+    const struct keytable *_table;
+    uint8_t _count;
+    uint32_t _seed;
+
+    // keytable index plus one for each hash slot, 0 for empty
+    uint8_t _slots[1U << HASH_BITS];
+};
+
+}
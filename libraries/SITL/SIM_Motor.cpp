@@ -28,10 +28,6 @@ void Motor::calculate_forces(const struct sitl_input &input,
                              Vector3f &rot_accel,
                              Vector3f &thrust)
 {
-    // fudge factors
-    const float arm_scale = radians(5000);
-    const float yaw_scale = radians(400);
-
     // get motor speed from 0 to 1
     float motor_speed = constrain_float((input.servos[motor_offset+servo]-1100)/900.0, 0, 1);
 
@@ -109,19 +105,3 @@ uint16_t Motor::update_servo(uint16_t demand, uint64_t time_usec, float &last_va
     return uint16_t(last_value+0.5);
 }
 
-
-// calculate current and voltage
-void Motor::current_and_voltage(const struct sitl_input &input, float &voltage, float &current,
-                                uint8_t motor_offset)
-{
-    // get motor speed from 0 to 1
-    float motor_speed = constrain_float((input.servos[motor_offset+servo]-1100)/900.0, 0, 1);
-
-    // assume 10A per motor at full speed
-    current = 10 * motor_speed;
-
-    // assume 3S, and full throttle drops voltage by 0.7V
-    if (AP::sitl()) {
-        voltage = AP::sitl()->batt_voltage - motor_speed * 0.7;
-    }
-}
@@ -38,6 +38,10 @@ public:
     int8_t pitch_servo = -1;
     float pitch_min, pitch_max;
 
+    // fudge factors for arm length and rotor yaw torque
+    static constexpr float arm_scale = radians(5000);
+    static constexpr float yaw_scale = radians(400);
+
     // support for servo slew rate
     enum {SERVO_NORMAL, SERVO_RETRACT} servo_type;
     float servo_rate = 0.24; // seconds per 60 degrees
@@ -77,8 +81,9 @@ public:
 
     uint16_t update_servo(uint16_t demand, uint64_t time_usec, float &last_value);
 
-    // calculate current and voltage
-    void current_and_voltage(const struct sitl_input &input, float &voltage, float &current, uint8_t motor_offset);
+    bool can_tilt() const {
+        return roll_servo >= 0 || pitch_servo >= 0;
+    }
 };
 
 }
@@ -0,0 +1,252 @@
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  shared memory transport between SITL and an external physics simulator
+ */
+
+#include "SIM_SHM.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace SITL;
+
+// number of polls of the ring before sleeping on the futex
+#define SHM_SPIN_COUNT 200
+
+// longest sleep on the futex before checking for a reset
+#define SHM_RESET_POLL_NS 10000000ULL
+
+static uint64_t monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+bool SHMLink::open(const char *name, Role role)
+{
+    close();
+
+    int fd;
+    if (role == Role::SITL) {
+        fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+        if (fd != -1 && ftruncate(fd, sizeof(layout)) == -1) {
+            ::close(fd);
+            fd = -1;
+        }
+    } else {
+        fd = shm_open(name, O_RDWR, 0);
+    }
+    if (fd == -1) {
+        return false;
+    }
+
+    void *ptr = mmap(nullptr, sizeof(layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) {
+        return false;
+    }
+    layout *shm = (layout *)ptr;
+
+    if (role == Role::SITL) {
+        /*
+          empty the rings, leaving the segment in place so that a
+          physics simulator which is already attached sees the new
+          session rather than a stale mapping. The session is bumped
+          first so that a push or pop already under way gives up
+          rather than using the old head or tail
+         */
+        shm->session.fetch_add(1);
+        shm->servos.tail.store(shm->servos.head.load());
+        shm->fdm.tail.store(shm->fdm.head.load());
+        shm->magic = SHM_MAGIC;
+        shm->version = SHM_VERSION;
+        shm->length = sizeof(layout);
+        wake(shm->servos.head);
+        wake(shm->fdm.head);
+    } else if (shm->magic != SHM_MAGIC ||
+               shm->version != SHM_VERSION ||
+               shm->length != sizeof(layout)) {
+        ::printf("SHM: %s is not a version %u segment\n", name, (unsigned)SHM_VERSION);
+        munmap(ptr, sizeof(layout));
+        return false;
+    }
+
+    _shm = shm;
+    _role = role;
+    return true;
+}
+
+void SHMLink::close()
+{
+    if (_shm == nullptr) {
+        return;
+    }
+    munmap(_shm, sizeof(layout));
+    _shm = nullptr;
+}
+
+uint32_t SHMLink::session() const
+{
+    if (_shm == nullptr) {
+        return 0;
+    }
+    return _shm->session.load();
+}
+
+bool SHMLink::send_servos(const servo_frame &frame)
+{
+    if (_shm == nullptr || _role != Role::SITL) {
+        return false;
+    }
+    return push(_shm->servos, _shm->session, frame);
+}
+
+bool SHMLink::recv_fdm(fdm_frame &frame, uint32_t timeout_us)
+{
+    if (_shm == nullptr || _role != Role::SITL) {
+        return false;
+    }
+    return pop(_shm->fdm, _shm->session, frame, timeout_us);
+}
+
+bool SHMLink::recv_servos(servo_frame &frame, uint32_t timeout_us)
+{
+    if (_shm == nullptr || _role != Role::PHYSICS) {
+        return false;
+    }
+    return pop(_shm->servos, _shm->session, frame, timeout_us);
+}
+
+bool SHMLink::send_fdm(const fdm_frame &frame)
+{
+    if (_shm == nullptr || _role != Role::PHYSICS) {
+        return false;
+    }
+    return push(_shm->fdm, _shm->session, frame);
+}
+
+/*
+  add a frame to a ring, waking the reader if it is asleep. Returns
+  false if the ring is full, which only happens when the other end
+  has stopped reading, or if the segment was reset
+ */
+template <typename T>
+bool SHMLink::push(ring<T> &r, const std::atomic<uint32_t> &session, const T &frame)
+{
+    const uint32_t gen = session.load(std::memory_order_acquire);
+    const uint32_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        return false;
+    }
+    r.frame[head % RING_SIZE] = frame;
+    if (session.load(std::memory_order_acquire) != gen) {
+        // the frame belongs to the old session
+        return false;
+    }
+
+    // the store to head and the load of waiters must not be
+    // reordered, pairing with the increment of waiters in pop()
+    r.head.store(head + 1, std::memory_order_seq_cst);
+    if (r.waiters.load(std::memory_order_seq_cst) != 0) {
+        wake(r.head);
+    }
+    return true;
+}
+
+/*
+  take the oldest frame from a ring, spinning briefly and then
+  sleeping until one arrives or timeout_us passes. Returns false
+  early if the segment is reset, as the tail read here is then stale
+ */
+template <typename T>
+bool SHMLink::pop(ring<T> &r, const std::atomic<uint32_t> &session, T &frame, uint32_t timeout_us)
+{
+    const uint32_t gen = session.load(std::memory_order_acquire);
+    uint32_t tail = r.tail.load(std::memory_order_acquire);
+
+    for (uint16_t i=0; i<SHM_SPIN_COUNT && r.head.load(std::memory_order_acquire) == tail; i++) {
+    }
+
+    if (r.head.load(std::memory_order_acquire) == tail) {
+        const uint64_t deadline_ns = monotonic_ns() + timeout_us * 1000ULL;
+        r.waiters.fetch_add(1, std::memory_order_seq_cst);
+        while (r.head.load(std::memory_order_seq_cst) == tail &&
+               session.load(std::memory_order_seq_cst) == gen) {
+            const uint64_t now_ns = monotonic_ns();
+            if (now_ns >= deadline_ns) {
+                break;
+            }
+            // a reset doesn't move head, so sleep in slices to
+            // notice one that races with going to sleep
+            const uint64_t remaining_ns = deadline_ns - now_ns;
+            wait(r.head, tail, remaining_ns < SHM_RESET_POLL_NS ? remaining_ns : SHM_RESET_POLL_NS);
+        }
+        r.waiters.fetch_sub(1, std::memory_order_seq_cst);
+        if (r.head.load(std::memory_order_acquire) == tail) {
+            return false;
+        }
+    }
+
+    frame = r.frame[tail % RING_SIZE];
+
+    // a reset moves the tail, so this fails if the frame was copied
+    // from the old session
+    if (session.load(std::memory_order_acquire) != gen ||
+        !r.tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel)) {
+        return false;
+    }
+    return true;
+}
+
+#if defined(__linux__)
+/*
+  the segment is shared between processes, so these must not use the
+  FUTEX_PRIVATE_FLAG variants
+ */
+void SHMLink::wait(std::atomic<uint32_t> &word, uint32_t value, uint64_t timeout_ns)
+{
+    struct timespec ts;
+    ts.tv_sec = timeout_ns / 1000000000ULL;
+    ts.tv_nsec = timeout_ns % 1000000000ULL;
+    syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAIT, value, &ts, nullptr, 0);
+}
+
+void SHMLink::wake(std::atomic<uint32_t> &word)
+{
+    syscall(SYS_futex, (uint32_t *)&word, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+#else
+// no futex on this platform, poll instead
+void SHMLink::wait(std::atomic<uint32_t> &word, uint32_t value, uint64_t timeout_ns)
+{
+    usleep(timeout_ns > 50000 ? 50 : 1);
+}
+
+void SHMLink::wake(std::atomic<uint32_t> &word)
+{
+}
+#endif
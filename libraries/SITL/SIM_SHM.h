@@ -0,0 +1,152 @@
+/*
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/*
+  shared memory transport between SITL and an external physics
+  simulator.
+
+  Each direction is a single producer, single consumer ring of fixed
+  size binary frames in a POSIX shared memory segment. A reader with
+  no data sleeps on a futex on the ring head, so a lockstep exchange
+  costs two wakeups per physics step instead of two UDP round trips.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+#define SIM_SHM_DEFAULT_NAME "/ardupilot_sitl"
+
+namespace SITL {
+
+class SHMLink {
+public:
+    // bump SHM_VERSION whenever the layout of the segment changes
+    static const uint32_t SHM_MAGIC = 0x41505348; // "APSH"
+    static const uint32_t SHM_VERSION = 1;
+    static const uint8_t RING_SIZE = 4;
+
+    /*
+      frame sent from SITL to the physics simulator, the same
+      content as the JSON backend servo packet
+     */
+    struct servo_frame {
+        uint32_t frame_count;
+        uint16_t frame_rate;
+        uint16_t pwm[16];
+    };
+
+    // bits in fdm_frame::flags for the optional fields
+    enum FDMFlags : uint32_t {
+        FDM_RNG_1     = 1U << 0,
+        FDM_RNG_2     = 1U << 1,
+        FDM_RNG_3     = 1U << 2,
+        FDM_RNG_4     = 1U << 3,
+        FDM_RNG_5     = 1U << 4,
+        FDM_RNG_6     = 1U << 5,
+        FDM_WIND_DIR  = 1U << 6,
+        FDM_WIND_SPD  = 1U << 7,
+    };
+
+    /*
+      frame sent from the physics simulator to SITL, with the same
+      units and frames as the JSON backend sensor data
+     */
+    struct fdm_frame {
+        uint32_t frame_count;      // frame_count of the servo frame this replies to
+        uint32_t flags;            // FDMFlags
+        double timestamp_s;        // physics time
+        float gyro[3];             // rad/s, body frame
+        float accel_body[3];       // m/s/s, body frame
+        float position[3];         // m, NED from origin
+        float velocity[3];         // m/s, NED
+        float quaternion[4];       // attitude, body to earth
+        float rng[6];              // m
+        float wind_vane_direction; // rad, relative to the front
+        float wind_vane_speed;     // m/s
+    };
+
+    enum class Role {
+        SITL,
+        PHYSICS,
+    };
+
+    SHMLink() {}
+    ~SHMLink() { close(); }
+
+    /* Do not allow copies */
+    SHMLink(const SHMLink &other) = delete;
+    SHMLink &operator=(const SHMLink&) = delete;
+
+    /*
+      SITL creates (or resets) the segment, the physics simulator
+      attaches to an existing one
+     */
+    bool open(const char *name, Role role);
+    void close();
+
+    bool is_open() const { return _shm != nullptr; }
+
+    // SITL side
+    bool send_servos(const servo_frame &frame);
+    bool recv_fdm(fdm_frame &frame, uint32_t timeout_us);
+
+    // physics side
+    bool recv_servos(servo_frame &frame, uint32_t timeout_us);
+    bool send_fdm(const fdm_frame &frame);
+
+    /*
+      incremented each time SITL resets the segment; a physics
+      simulator can use this to reset its vehicle. A receive that is
+      waiting when the segment is reset returns false
+     */
+    uint32_t session() const;
+
+private:
+    /*
+      head and tail only ever increase, a reset empties a ring by
+      moving its tail up to its head
+     */
+    template <typename T>
+    struct ring {
+        std::atomic<uint32_t> head;    // next frame to write, futex word
+        std::atomic<uint32_t> tail;    // next frame to read
+        std::atomic<uint32_t> waiters; // readers sleeping on head
+        T frame[RING_SIZE];
+    };
+
+    struct layout {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t length;
+        std::atomic<uint32_t> session;
+        ring<servo_frame> servos;
+        ring<fdm_frame> fdm;
+    };
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+    template <typename T>
+    static bool push(ring<T> &r, const std::atomic<uint32_t> &session, const T &frame);
+    template <typename T>
+    static bool pop(ring<T> &r, const std::atomic<uint32_t> &session, T &frame, uint32_t timeout_us);
+
+    static void wait(std::atomic<uint32_t> &word, uint32_t value, uint64_t timeout_ns);
+    static void wake(std::atomic<uint32_t> &word);
+
+    layout *_shm = nullptr;
+    Role _role;
+};
+
+}
@@ -0,0 +1,161 @@
+/*
+  frames per second for the JSON sensor frame parsers and the binary
+  frame used by the JSON backend
+ */
+#include <AP_gbenchmark.h>
+
+#include <string.h>
+
+#include <AP_Math/AP_Math.h>
+#include <SITL/SIM_JSON_Parser.h>
+#include <SITL/SIM_SHM.h>
+
+using namespace SITL;
+
+static struct {
+    double timestamp_s;
+    struct {
+        Vector3f gyro;
+        Vector3f accel_body;
+    } imu;
+    Vector3f position;
+    Vector3f attitude;
+    Quaternion quaternion;
+    Vector3f velocity;
+    float rng[6];
+    struct {
+        float direction;
+        float speed;
+    } wind_vane_apparent;
+} sensors;
+
+// same keys as SIM_JSON
+static const struct JSONParser::keytable keytable[] = {
+    { "", "timestamp", &sensors.timestamp_s, JSONParser::DATA_DOUBLE, true },
+    { "imu", "gyro",    &sensors.imu.gyro, JSONParser::DATA_VECTOR3F, true },
+    { "imu", "accel_body", &sensors.imu.accel_body, JSONParser::DATA_VECTOR3F, true },
+    { "", "position", &sensors.position, JSONParser::DATA_VECTOR3F, true },
+    { "", "attitude", &sensors.attitude, JSONParser::DATA_VECTOR3F, false },
+    { "", "quaternion", &sensors.quaternion, JSONParser::QUATERNION, false },
+    { "", "velocity", &sensors.velocity, JSONParser::DATA_VECTOR3F, true },
+    { "", "rng_1", &sensors.rng[0], JSONParser::DATA_FLOAT, false },
+    { "", "rng_2", &sensors.rng[1], JSONParser::DATA_FLOAT, false },
+    { "", "rng_3", &sensors.rng[2], JSONParser::DATA_FLOAT, false },
+    { "", "rng_4", &sensors.rng[3], JSONParser::DATA_FLOAT, false },
+    { "", "rng_5", &sensors.rng[4], JSONParser::DATA_FLOAT, false },
+    { "", "rng_6", &sensors.rng[5], JSONParser::DATA_FLOAT, false },
+    {"windvane","direction", &sensors.wind_vane_apparent.direction, JSONParser::DATA_FLOAT, false},
+    {"windvane","speed", &sensors.wind_vane_apparent.speed, JSONParser::DATA_FLOAT, false},
+};
+
+static const char frame[] =
+    "{\"timestamp\":2500.0025,"
+    "\"imu\":{\"gyro\":[0.0012,-0.0034,0.0101],\"accel_body\":[0.0512,-0.0213,-9.8066]},"
+    "\"position\":[12.5,-3.25,-10.0],"
+    "\"quaternion\":[0.9998,0.0012,-0.0034,0.0178],"
+    "\"velocity\":[1.25,-0.5,0.02],"
+    "\"rng_1\":10.01,"
+    "\"windvane\":{\"direction\":0.35,\"speed\":4.5}}";
+
+/*
+  the strstr based parser SIM_JSON used before, as a reference
+ */
+static uint32_t parse_strstr(const char *json)
+{
+    uint32_t received_bitmask = 0;
+    for (uint8_t i=0; i<ARRAY_SIZE(keytable); i++) {
+        const struct JSONParser::keytable &key = keytable[i];
+        const char *p = strstr(json, key.section);
+        if (!p) {
+            if (key.required) {
+                return 0;
+            }
+            continue;
+        }
+        p += strlen(key.section)+1;
+        p = strstr(p, key.key);
+        if (!p) {
+            if (key.required) {
+                return 0;
+            }
+            continue;
+        }
+        received_bitmask |= 1U << i;
+        p += strlen(key.key)+2;
+        switch (key.type) {
+        case JSONParser::DATA_UINT64:
+            *((uint64_t *)key.ptr) = strtoull(p, nullptr, 10);
+            break;
+        case JSONParser::DATA_FLOAT:
+            *((float *)key.ptr) = atof(p);
+            break;
+        case JSONParser::DATA_DOUBLE:
+            *((double *)key.ptr) = atof(p);
+            break;
+        case JSONParser::DATA_VECTOR3F: {
+            Vector3f *v = (Vector3f *)key.ptr;
+            sscanf(p, "[%f, %f, %f]", &v->x, &v->y, &v->z);
+            break;
+        }
+        case JSONParser::QUATERNION: {
+            Quaternion *q = (Quaternion *)key.ptr;
+            sscanf(p, "[%f, %f, %f, %f]", &q->q1, &q->q2, &q->q3, &q->q4);
+            break;
+        }
+        }
+    }
+    return received_bitmask;
+}
+
+static void BM_JSONParseStrstr(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        uint32_t mask = parse_strstr(frame);
+        gbenchmark_escape(&mask);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_JSONParseStrstr);
+
+static void BM_JSONParseHashed(benchmark::State& state)
+{
+    JSONParser parser;
+    parser.init(keytable, ARRAY_SIZE(keytable));
+
+    while (state.KeepRunning()) {
+        uint32_t mask = parser.parse(frame);
+        gbenchmark_escape(&mask);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_JSONParseHashed);
+
+static void BM_JSONBinaryFrame(benchmark::State& state)
+{
+    JSONParser::fdm_packet pkt {};
+    pkt.magic = JSONParser::FDM_PACKET_MAGIC;
+    pkt.length = sizeof(pkt);
+    uint8_t buf[sizeof(pkt)];
+    memcpy(buf, &pkt, sizeof(pkt));
+
+    while (state.KeepRunning()) {
+        SHMLink::fdm_frame fdm;
+        if (!JSONParser::parse_binary(buf, sizeof(buf), fdm)) {
+            continue;
+        }
+        sensors.timestamp_s = fdm.timestamp_s;
+        sensors.imu.gyro = Vector3f(fdm.gyro[0], fdm.gyro[1], fdm.gyro[2]);
+        sensors.imu.accel_body = Vector3f(fdm.accel_body[0], fdm.accel_body[1], fdm.accel_body[2]);
+        sensors.position = Vector3f(fdm.position[0], fdm.position[1], fdm.position[2]);
+        sensors.velocity = Vector3f(fdm.velocity[0], fdm.velocity[1], fdm.velocity[2]);
+        sensors.quaternion = Quaternion(fdm.quaternion[0], fdm.quaternion[1], fdm.quaternion[2], fdm.quaternion[3]);
+        gbenchmark_escape(&sensors);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_JSONBinaryFrame);
+
+BENCHMARK_MAIN();
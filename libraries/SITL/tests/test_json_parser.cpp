@@ -0,0 +1,331 @@
+#include <AP_gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <SITL/SIM_JSON_Parser.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+using namespace SITL;
+
+struct sensors {
+    double timestamp_s;
+    struct {
+        Vector3f gyro;
+        Vector3f accel_body;
+    } imu;
+    Vector3f position;
+    Vector3f attitude;
+    Quaternion quaternion;
+    Vector3f velocity;
+    float rng[6];
+    struct {
+        float direction;
+        float speed;
+    } wind_vane_apparent;
+};
+
+#define NUM_KEYS 15
+
+// same keys as SIM_JSON
+static void make_keytable(struct sensors &s, struct JSONParser::keytable *table)
+{
+    const struct JSONParser::keytable keys[NUM_KEYS] = {
+        { "", "timestamp", &s.timestamp_s, JSONParser::DATA_DOUBLE, true },
+        { "imu", "gyro",    &s.imu.gyro, JSONParser::DATA_VECTOR3F, true },
+        { "imu", "accel_body", &s.imu.accel_body, JSONParser::DATA_VECTOR3F, true },
+        { "", "position", &s.position, JSONParser::DATA_VECTOR3F, true },
+        { "", "attitude", &s.attitude, JSONParser::DATA_VECTOR3F, false },
+        { "", "quaternion", &s.quaternion, JSONParser::QUATERNION, false },
+        { "", "velocity", &s.velocity, JSONParser::DATA_VECTOR3F, true },
+        { "", "rng_1", &s.rng[0], JSONParser::DATA_FLOAT, false },
+        { "", "rng_2", &s.rng[1], JSONParser::DATA_FLOAT, false },
+        { "", "rng_3", &s.rng[2], JSONParser::DATA_FLOAT, false },
+        { "", "rng_4", &s.rng[3], JSONParser::DATA_FLOAT, false },
+        { "", "rng_5", &s.rng[4], JSONParser::DATA_FLOAT, false },
+        { "", "rng_6", &s.rng[5], JSONParser::DATA_FLOAT, false },
+        {"windvane","direction", &s.wind_vane_apparent.direction, JSONParser::DATA_FLOAT, false},
+        {"windvane","speed", &s.wind_vane_apparent.speed, JSONParser::DATA_FLOAT, false},
+    };
+    memcpy(table, keys, sizeof(keys));
+}
+
+/*
+  the strstr based parser SIM_JSON used before, as a reference
+ */
+static uint32_t parse_strstr(const struct JSONParser::keytable *table, const char *json)
+{
+    uint32_t received_bitmask = 0;
+    for (uint8_t i=0; i<NUM_KEYS; i++) {
+        const struct JSONParser::keytable &key = table[i];
+        const char *p = strstr(json, key.section);
+        if (!p) {
+            if (key.required) {
+                return 0;
+            }
+            continue;
+        }
+        p += strlen(key.section)+1;
+        p = strstr(p, key.key);
+        if (!p) {
+            if (key.required) {
+                return 0;
+            }
+            continue;
+        }
+        received_bitmask |= 1U << i;
+        p += strlen(key.key)+2;
+        switch (key.type) {
+        case JSONParser::DATA_UINT64:
+            *((uint64_t *)key.ptr) = strtoull(p, nullptr, 10);
+            break;
+        case JSONParser::DATA_FLOAT:
+            *((float *)key.ptr) = atof(p);
+            break;
+        case JSONParser::DATA_DOUBLE:
+            *((double *)key.ptr) = atof(p);
+            break;
+        case JSONParser::DATA_VECTOR3F: {
+            Vector3f *v = (Vector3f *)key.ptr;
+            sscanf(p, "[%f, %f, %f]", &v->x, &v->y, &v->z);
+            break;
+        }
+        case JSONParser::QUATERNION: {
+            Quaternion *q = (Quaternion *)key.ptr;
+            sscanf(p, "[%f, %f, %f, %f]", &q->q1, &q->q2, &q->q3, &q->q4);
+            break;
+        }
+        }
+    }
+    return received_bitmask;
+}
+
+/*
+  the old and new parsers, each filling its own copy of the sensors
+ */
+class Parsers {
+public:
+    Parsers() {
+        make_keytable(ref, ref_table);
+        make_keytable(hashed, hashed_table);
+    }
+
+    bool init() {
+        return parser.init(hashed_table, NUM_KEYS);
+    }
+
+    struct sensors ref {};
+    struct sensors hashed {};
+    struct JSONParser::keytable ref_table[NUM_KEYS];
+    struct JSONParser::keytable hashed_table[NUM_KEYS];
+    JSONParser parser;
+};
+
+static void expect_vector_eq(const Vector3f &a, const Vector3f &b)
+{
+    EXPECT_FLOAT_EQ(a.x, b.x);
+    EXPECT_FLOAT_EQ(a.y, b.y);
+    EXPECT_FLOAT_EQ(a.z, b.z);
+}
+
+static void expect_sensors_eq(const struct sensors &a, const struct sensors &b)
+{
+    EXPECT_DOUBLE_EQ(a.timestamp_s, b.timestamp_s);
+    expect_vector_eq(a.imu.gyro, b.imu.gyro);
+    expect_vector_eq(a.imu.accel_body, b.imu.accel_body);
+    expect_vector_eq(a.position, b.position);
+    expect_vector_eq(a.attitude, b.attitude);
+    EXPECT_FLOAT_EQ(a.quaternion.q1, b.quaternion.q1);
+    EXPECT_FLOAT_EQ(a.quaternion.q2, b.quaternion.q2);
+    EXPECT_FLOAT_EQ(a.quaternion.q3, b.quaternion.q3);
+    EXPECT_FLOAT_EQ(a.quaternion.q4, b.quaternion.q4);
+    expect_vector_eq(a.velocity, b.velocity);
+    for (uint8_t i=0; i<ARRAY_SIZE(a.rng); i++) {
+        EXPECT_FLOAT_EQ(a.rng[i], b.rng[i]);
+    }
+    EXPECT_FLOAT_EQ(a.wind_vane_apparent.direction, b.wind_vane_apparent.direction);
+    EXPECT_FLOAT_EQ(a.wind_vane_apparent.speed, b.wind_vane_apparent.speed);
+}
+
+/*
+  both parsers find the same keys and values in json, returning the
+  key bitmask
+ */
+static uint32_t expect_same(const char *json)
+{
+    Parsers p;
+    EXPECT_TRUE(p.init());
+    const uint32_t ref_mask = parse_strstr(p.ref_table, json);
+    const uint32_t mask = p.parser.parse(json);
+    EXPECT_EQ(mask, ref_mask) << json;
+    expect_sensors_eq(p.hashed, p.ref);
+    return mask;
+}
+
+#define REQUIRED_KEYS ((1U<<0) | (1U<<1) | (1U<<2) | (1U<<3) | (1U<<6))
+
+static const char frame[] =
+    "{\"timestamp\":2500.0025,"
+    "\"imu\":{\"gyro\":[0.0012,-0.0034,0.0101],\"accel_body\":[0.0512,-0.0213,-9.8066]},"
+    "\"position\":[12.5,-3.25,-10.0],"
+    "\"quaternion\":[0.9998,0.0012,-0.0034,0.0178],"
+    "\"velocity\":[1.25,-0.5,0.02],"
+    "\"rng_1\":10.01,"
+    "\"windvane\":{\"direction\":0.35,\"speed\":4.5}}";
+
+TEST(JSONParser, matches_reference)
+{
+    EXPECT_EQ(expect_same(frame), REQUIRED_KEYS | (1U<<5) | (1U<<7) | (1U<<13) | (1U<<14));
+}
+
+TEST(JSONParser, whitespace)
+{
+    // spacing the old parser coped with
+    EXPECT_EQ(expect_same("{\"timestamp\":1.5, \"imu\":{\"gyro\":[0.1, -0.2,  0.3],\t"
+                          "\"accel_body\":[1,\t2, 3]} , \"position\":[4, 5, 6] ,"
+                          "\"velocity\":[7, 8, 9], \"quaternion\":[1, 0, 0, 0]}"),
+              REQUIRED_KEYS | (1U<<5));
+
+    // spacing around colons and inside brackets, which the old parser
+    // read as zeros
+    Parsers p;
+    ASSERT_TRUE(p.init());
+    EXPECT_EQ(p.parser.parse("{ \"timestamp\" : 1.5 , \"imu\" : { \"gyro\" : [ 0.1 , -0.2 , 0.3 ] ,"
+                             " \"accel_body\" : [1,2,3] } , \"position\" : [ 4,5,6 ] ,"
+                             " \"velocity\": [7,8,9 ] , \"attitude\" :[0.1,0.2,0.3] }"),
+              REQUIRED_KEYS | (1U<<4));
+    EXPECT_DOUBLE_EQ(p.hashed.timestamp_s, 1.5);
+    expect_vector_eq(p.hashed.imu.gyro, Vector3f(0.1, -0.2, 0.3));
+    expect_vector_eq(p.hashed.imu.accel_body, Vector3f(1, 2, 3));
+    expect_vector_eq(p.hashed.position, Vector3f(4, 5, 6));
+    expect_vector_eq(p.hashed.velocity, Vector3f(7, 8, 9));
+    expect_vector_eq(p.hashed.attitude, Vector3f(0.1, 0.2, 0.3));
+}
+
+TEST(JSONParser, unknown_keys)
+{
+    // unknown keys, string values and nested objects are skipped
+    char json[512];
+    snprintf(json, sizeof(json), "%.*s,\"name\":\"quad\","
+             "\"extra\":{\"gyro\":[9,9,9],\"deep\":{\"speed\":99,\"x\":[1,2]}},\"count\":42}",
+             int(strlen(frame) - 1), frame);
+    EXPECT_EQ(expect_same(json), REQUIRED_KEYS | (1U<<5) | (1U<<7) | (1U<<13) | (1U<<14));
+
+    // a known key in an unknown section isn't taken for the top level
+    // key, which the old parser got wrong
+    Parsers p;
+    ASSERT_TRUE(p.init());
+    snprintf(json, sizeof(json), "{\"gps\":{\"position\":[9,9,9],\"timestamp\":1},%s", &frame[1]);
+    EXPECT_NE(p.parser.parse(json), 0U);
+    EXPECT_DOUBLE_EQ(p.hashed.timestamp_s, 2500.0025);
+    expect_vector_eq(p.hashed.position, Vector3f(12.5, -3.25, -10.0));
+}
+
+TEST(JSONParser, missing_required_key)
+{
+    EXPECT_EQ(expect_same("{\"timestamp\":2500.0025,"
+                          "\"imu\":{\"gyro\":[0.0012,-0.0034,0.0101],\"accel_body\":[0.0512,-0.0213,-9.8066]},"
+                          "\"position\":[12.5,-3.25,-10.0],"
+                          "\"quaternion\":[0.9998,0.0012,-0.0034,0.0178]}"),
+              0U);
+}
+
+TEST(JSONParser, malformed_values)
+{
+    // the old parser stored zeros for these, the frame is now rejected
+    Parsers p;
+    ASSERT_TRUE(p.init());
+    char json[512];
+
+    // truncated array
+    snprintf(json, sizeof(json), "%.*s", int(strstr(frame, "-0.5") - frame + 4), frame);
+    EXPECT_EQ(p.parser.parse(json), 0U);
+
+    // not a number
+    snprintf(json, sizeof(json), "{\"timestamp\":abc,%s", strchr(frame, ',') + 1);
+    EXPECT_EQ(p.parser.parse(json), 0U);
+
+    // too few elements
+    snprintf(json, sizeof(json), "{\"velocity\":[1,2],%s", &frame[1]);
+    EXPECT_EQ(p.parser.parse(json), 0U);
+
+    // missing value at the end of the frame
+    snprintf(json, sizeof(json), "%s", frame);
+    strcpy(strstr(json, "10.01"), "");
+    EXPECT_EQ(p.parser.parse(json), 0U);
+}
+
+/*
+  find a key that isn't in the table but hashes to the same slot as
+  section/key
+ */
+static bool find_collision(const JSONParser &parser, const char *section, const char *key, char *name, size_t len)
+{
+    const uint8_t slot = parser.slot(section, key);
+    for (uint32_t i=0; i<100000; i++) {
+        snprintf(name, len, "k%u", (unsigned)i);
+        if (parser.slot(section, name) == slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST(JSONParser, hash_collision)
+{
+    Parsers p;
+    ASSERT_TRUE(p.init());
+    char top[16], imu[16];
+    ASSERT_TRUE(find_collision(p.parser, "", "timestamp", top, sizeof(top)));
+    ASSERT_TRUE(find_collision(p.parser, "imu", "gyro", imu, sizeof(imu)));
+
+    // keys sharing a slot with a known key are still unknown
+    char json[512];
+    snprintf(json, sizeof(json), "%.*s,\"imu\":{\"%s\":[9,9,9]},\"%s\":123.0}",
+             int(strlen(frame) - 1), frame, imu, top);
+    EXPECT_EQ(p.parser.parse(json), REQUIRED_KEYS | (1U<<5) | (1U<<7) | (1U<<13) | (1U<<14));
+    EXPECT_DOUBLE_EQ(p.hashed.timestamp_s, 2500.0025);
+    expect_vector_eq(p.hashed.imu.gyro, Vector3f(0.0012, -0.0034, 0.0101));
+}
+
+TEST(JSONParser, binary_frame)
+{
+    JSONParser::fdm_packet pkt {};
+    pkt.magic = JSONParser::FDM_PACKET_MAGIC;
+    pkt.length = sizeof(pkt);
+    pkt.frame.frame_count = 17;
+    pkt.frame.timestamp_s = 2500.0025;
+    pkt.frame.gyro[2] = 0.0101;
+    pkt.frame.flags = SHMLink::FDM_RNG_1;
+    uint8_t buf[sizeof(pkt) + 1];
+    memcpy(buf, &pkt, sizeof(pkt));
+
+    SHMLink::fdm_frame frame {};
+    ASSERT_TRUE(JSONParser::parse_binary(buf, sizeof(pkt), frame));
+    EXPECT_EQ(frame.frame_count, 17U);
+    EXPECT_DOUBLE_EQ(frame.timestamp_s, 2500.0025);
+    EXPECT_FLOAT_EQ(frame.gyro[2], 0.0101);
+    EXPECT_EQ(frame.flags, uint32_t(SHMLink::FDM_RNG_1));
+
+    // wrong size datagrams
+    EXPECT_FALSE(JSONParser::parse_binary(buf, sizeof(pkt) - 1, frame));
+    EXPECT_FALSE(JSONParser::parse_binary(buf, sizeof(pkt) + 1, frame));
+    EXPECT_FALSE(JSONParser::parse_binary(buf, 0, frame));
+
+    // bad length field
+    pkt.length = sizeof(pkt) - 4;
+    memcpy(buf, &pkt, sizeof(pkt));
+    EXPECT_FALSE(JSONParser::parse_binary(buf, sizeof(pkt), frame));
+
+    // bad magic, such as a JSON frame of the same size
+    pkt.length = sizeof(pkt);
+    pkt.magic = 0x6d69747b; // "{tim"
+    memcpy(buf, &pkt, sizeof(pkt));
+    EXPECT_FALSE(JSONParser::parse_binary(buf, sizeof(pkt), frame));
+}
+
+AP_GTEST_MAIN()
@@ -0,0 +1,265 @@
+#include <AP_gtest.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <SITL/SIM_SHM.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+using namespace SITL;
+
+#define TEST_SHM_NAME "/ardupilot_sitl_test"
+
+/*
+  stand-in physics simulator: a point mass moving vertically under
+  gravity and a throttle on servo 3, replying to every servo frame
+  with an fdm frame the way an external simulator would
+ */
+class ReferenceSim {
+public:
+    bool start() {
+        if (!link.open(TEST_SHM_NAME, SHMLink::Role::PHYSICS)) {
+            return false;
+        }
+        return pthread_create(&thread, nullptr, run, this) == 0;
+    }
+
+    void stop() {
+        done = true;
+        pthread_join(thread, nullptr);
+    }
+
+    uint32_t steps;
+
+private:
+    static void *run(void *arg) {
+        ((ReferenceSim *)arg)->loop();
+        return nullptr;
+    }
+
+    void loop() {
+        SHMLink::servo_frame servos;
+        while (!done) {
+            if (!link.recv_servos(servos, 10000)) {
+                continue;
+            }
+            const double dt = 1.0 / servos.frame_rate;
+            const float throttle = (servos.pwm[2] - 1000) * 0.001f;
+            const float accel_z = 9.80665f - 2 * 9.80665f * throttle;
+            velocity_z += accel_z * dt;
+            position_z += velocity_z * dt;
+            time_s += dt;
+
+            SHMLink::fdm_frame fdm {};
+            fdm.frame_count = servos.frame_count;
+            fdm.flags = SHMLink::FDM_RNG_1;
+            fdm.timestamp_s = time_s;
+            fdm.accel_body[2] = accel_z - 9.80665f;
+            fdm.position[2] = position_z;
+            fdm.velocity[2] = velocity_z;
+            fdm.quaternion[0] = 1;
+            fdm.rng[0] = -position_z;
+            link.send_fdm(fdm);
+            steps++;
+        }
+    }
+
+    SHMLink link;
+    pthread_t thread;
+    volatile bool done;
+    double time_s;
+    float position_z;
+    float velocity_z;
+};
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+TEST(SHMLink, attach_needs_segment)
+{
+    shm_unlink(TEST_SHM_NAME);
+    SHMLink physics;
+    EXPECT_FALSE(physics.open(TEST_SHM_NAME, SHMLink::Role::PHYSICS));
+
+    SHMLink sitl;
+    ASSERT_TRUE(sitl.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+    EXPECT_TRUE(physics.open(TEST_SHM_NAME, SHMLink::Role::PHYSICS));
+    EXPECT_EQ(physics.session(), sitl.session());
+
+    // wrong direction for the role
+    SHMLink::servo_frame servos {};
+    EXPECT_FALSE(physics.send_servos(servos));
+    EXPECT_FALSE(sitl.recv_servos(servos, 0));
+    shm_unlink(TEST_SHM_NAME);
+}
+
+TEST(SHMLink, timeout_and_full)
+{
+    SHMLink sitl;
+    ASSERT_TRUE(sitl.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+
+    SHMLink::fdm_frame fdm;
+    const uint64_t start_us = monotonic_us();
+    EXPECT_FALSE(sitl.recv_fdm(fdm, 20000));
+    EXPECT_GE(monotonic_us() - start_us, 20000U);
+
+    SHMLink::servo_frame servos {};
+    for (uint8_t i=0; i<SHMLink::RING_SIZE; i++) {
+        EXPECT_TRUE(sitl.send_servos(servos));
+    }
+    EXPECT_FALSE(sitl.send_servos(servos));
+    shm_unlink(TEST_SHM_NAME);
+}
+
+TEST(SHMLink, reset_by_sitl)
+{
+    SHMLink sitl;
+    ASSERT_TRUE(sitl.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+    SHMLink physics;
+    ASSERT_TRUE(physics.open(TEST_SHM_NAME, SHMLink::Role::PHYSICS));
+
+    SHMLink::servo_frame servos {};
+    servos.frame_count = 7;
+    EXPECT_TRUE(sitl.send_servos(servos));
+
+    // a restarted SITL discards unread frames and starts a new session
+    const uint32_t session = physics.session();
+    SHMLink sitl2;
+    ASSERT_TRUE(sitl2.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+    EXPECT_EQ(physics.session(), session + 1);
+    EXPECT_FALSE(physics.recv_servos(servos, 0));
+    shm_unlink(TEST_SHM_NAME);
+}
+
+/*
+  physics side receiving servo frames on its own thread, as it would
+  while blocked waiting for SITL
+ */
+class ServoReader {
+public:
+    explicit ServoReader(SHMLink &_link) : link(_link) {}
+
+    bool start() {
+        return pthread_create(&thread, nullptr, run, this) == 0;
+    }
+
+    void stop() {
+        done = true;
+        pthread_join(thread, nullptr);
+    }
+
+    static const uint8_t max_frames = 3 * SHMLink::RING_SIZE;
+    uint32_t frame_count[max_frames];
+    std::atomic<uint8_t> count {0};
+
+private:
+    static void *run(void *arg) {
+        ((ServoReader *)arg)->loop();
+        return nullptr;
+    }
+
+    void loop() {
+        SHMLink::servo_frame servos;
+        while (!done && count < max_frames) {
+            if (link.recv_servos(servos, 1000000)) {
+                frame_count[count] = servos.frame_count;
+                count++;
+            }
+        }
+    }
+
+    SHMLink &link;
+    pthread_t thread;
+    std::atomic<bool> done {false};
+};
+
+TEST(SHMLink, reset_while_waiting)
+{
+    SHMLink sitl;
+    ASSERT_TRUE(sitl.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+    SHMLink physics;
+    ASSERT_TRUE(physics.open(TEST_SHM_NAME, SHMLink::Role::PHYSICS));
+
+    // move the rings away from zero so a stale tail is noticeable
+    SHMLink::servo_frame servos {};
+    for (uint8_t i=0; i<SHMLink::RING_SIZE-1; i++) {
+        EXPECT_TRUE(sitl.send_servos(servos));
+        EXPECT_TRUE(physics.recv_servos(servos, 0));
+    }
+
+    // restart SITL while the physics side is asleep in recv_servos()
+    ServoReader reader(physics);
+    ASSERT_TRUE(reader.start());
+    usleep(20000);
+    SHMLink sitl2;
+    ASSERT_TRUE(sitl2.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+
+    // every frame of the new session arrives once and in order, and
+    // the ring keeps draining past its size
+    const uint64_t start_us = monotonic_us();
+    for (uint8_t i=0; i<ServoReader::max_frames; i++) {
+        servos.frame_count = 100 + i;
+        while (!sitl2.send_servos(servos) && monotonic_us() - start_us < 1000000U) {
+            usleep(100);
+        }
+    }
+    while (reader.count < ServoReader::max_frames && monotonic_us() - start_us < 1000000U) {
+        usleep(100);
+    }
+    reader.stop();
+    ASSERT_EQ(reader.count.load(), uint8_t(ServoReader::max_frames));
+    for (uint8_t i=0; i<ServoReader::max_frames; i++) {
+        EXPECT_EQ(reader.frame_count[i], 100U + i);
+    }
+    shm_unlink(TEST_SHM_NAME);
+}
+
+TEST(SHMLink, lockstep)
+{
+    const uint16_t rate_hz = 8000;
+    const uint32_t nsteps = 8000;
+
+    SHMLink sitl;
+    ASSERT_TRUE(sitl.open(TEST_SHM_NAME, SHMLink::Role::SITL));
+    ReferenceSim sim {};
+    ASSERT_TRUE(sim.start());
+
+    double last_timestamp_s = 0;
+    float min_z = 0;
+    for (uint32_t i=0; i<nsteps; i++) {
+        SHMLink::servo_frame servos {};
+        servos.frame_count = i;
+        servos.frame_rate = rate_hz;
+        // climb for the first half, then fall
+        servos.pwm[2] = i < nsteps/2 ? 1800 : 1000;
+        ASSERT_TRUE(sitl.send_servos(servos));
+
+        SHMLink::fdm_frame fdm;
+        ASSERT_TRUE(sitl.recv_fdm(fdm, 1000000));
+        ASSERT_EQ(fdm.frame_count, i);
+        EXPECT_GT(fdm.timestamp_s, last_timestamp_s);
+        EXPECT_TRUE(fdm.flags & SHMLink::FDM_RNG_1);
+        last_timestamp_s = fdm.timestamp_s;
+        min_z = MIN(min_z, fdm.position[2]);
+    }
+    sim.stop();
+
+    // exactly one reply per step, and physics time tracks the rate
+    EXPECT_EQ(sim.steps, nsteps);
+    EXPECT_NEAR(last_timestamp_s, nsteps / float(rate_hz), 1e-6);
+    // 0.5s at 0.6g upwards climbs over a metre
+    EXPECT_LT(min_z, -1.0f);
+
+    shm_unlink(TEST_SHM_NAME);
+}
+
+AP_GTEST_MAIN()
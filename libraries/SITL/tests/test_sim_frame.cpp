@@ -0,0 +1,83 @@
+#include <AP_gtest.h>
+
+#include <stdlib.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <SITL/SIM_Frame.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+using namespace SITL;
+
+// frames whose motors can't tilt, which use the precomputed geometry
+static const char *fixed_frames[] = {
+    "+", "x", "bfxrev", "bfx", "djix", "cwx",
+    "hexax", "hexa-cwx", "hexa-dji", "hexa",
+    "octa-cwx", "octa-dji", "octa-quad-cwx", "octa-quad", "octa",
+    "dodeca-hexa", "y6",
+};
+
+/*
+  the per motor model the frame used before, summing
+  Motor::calculate_forces() over all motors
+ */
+static void reference_forces(Frame &frame, const struct sitl_input &input, float scaling,
+                             Vector3f &rot_accel, Vector3f &thrust, float *motor_speed)
+{
+    for (uint8_t i=0; i<frame.num_motors; i++) {
+        Vector3f mraccel, mthrust;
+        frame.motors[i].calculate_forces(input, scaling, frame.motor_offset, mraccel, mthrust);
+        rot_accel += mraccel;
+        thrust += mthrust;
+        motor_speed[i] = mthrust.length() / scaling;
+    }
+}
+
+TEST(SIMFrame, matches_per_motor_model)
+{
+    srandom(42);
+
+    for (const char *name : fixed_frames) {
+        Frame *frame = Frame::find_frame(name);
+        ASSERT_NE(frame, nullptr) << name;
+        for (uint8_t j=0; j<frame->num_motors; j++) {
+            ASSERT_FALSE(frame->motors[j].can_tilt()) << name;
+        }
+
+        for (uint8_t motor_offset : { 0, 4 }) {
+            frame->motor_offset = motor_offset;
+            frame->init(3.0, 0.5, 85, 4*radians(360));
+
+            for (uint16_t n=0; n<200; n++) {
+                struct sitl_input input {};
+                for (uint8_t i=0; i<ARRAY_SIZE(input.servos); i++) {
+                    // include values outside the 1100 to 2000 range
+                    input.servos[i] = 900 + random() % 1300;
+                }
+                const float scaling = 5 + (random() % 1000) * 0.01f;
+
+                Vector3f ref_rot_accel, ref_thrust;
+                float ref_speed[SIM_FRAME_MAX_MOTORS];
+                reference_forces(*frame, input, scaling, ref_rot_accel, ref_thrust, ref_speed);
+
+                Vector3f rot_accel, thrust;
+                float speed[SIM_FRAME_MAX_MOTORS];
+                frame->calculate_motor_forces(input, scaling, rot_accel, thrust, speed);
+
+                const float tol = 1e-5f * (1 + ref_rot_accel.length());
+                EXPECT_NEAR(rot_accel.x, ref_rot_accel.x, tol) << name;
+                EXPECT_NEAR(rot_accel.y, ref_rot_accel.y, tol) << name;
+                EXPECT_NEAR(rot_accel.z, ref_rot_accel.z, tol) << name;
+                EXPECT_FLOAT_EQ(thrust.x, ref_thrust.x) << name;
+                EXPECT_FLOAT_EQ(thrust.y, ref_thrust.y) << name;
+                EXPECT_FLOAT_EQ(thrust.z, ref_thrust.z) << name;
+                for (uint8_t i=0; i<frame->num_motors; i++) {
+                    EXPECT_NEAR(speed[i], ref_speed[i], 1e-6f) << name;
+                }
+            }
+        }
+        frame->motor_offset = 0;
+    }
+}
+
+AP_GTEST_MAIN()